@@ -46,7 +46,23 @@ void AnisotropicParticleMesher::setNumPolygonizationSlices(int n) {
     _numPolygonizationSlices = n;
 }
 
-TriangleMesh AnisotropicParticleMesher::meshParticles(FragmentedVector<MarkerParticle> &particles, 
+void AnisotropicParticleMesher::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
+}
+
+void AnisotropicParticleMesher::enableSparseScalarField() {
+    _isSparseScalarFieldEnabled = true;
+}
+
+void AnisotropicParticleMesher::disableSparseScalarField() {
+    _isSparseScalarFieldEnabled = false;
+}
+
+bool AnisotropicParticleMesher::isSparseScalarFieldEnabled() {
+    return _isSparseScalarFieldEnabled;
+}
+
+TriangleMesh AnisotropicParticleMesher::meshParticles(MarkerParticleVector &particles, 
                                                       LevelSet &levelset,
                                                       FluidMaterialGrid &materialGrid,
                                                       double particleRadius) {
@@ -70,16 +86,17 @@ TriangleMesh AnisotropicParticleMesher::meshParticles(FragmentedVector<MarkerPar
     return _polygonizeSlices(filteredParticles, levelset, materialGrid);
 }
 
-void AnisotropicParticleMesher::_filterHighDensityParticles(FragmentedVector<MarkerParticle> &particles,
+void AnisotropicParticleMesher::_filterHighDensityParticles(MarkerParticleVector &particles,
                                                             FragmentedVector<vmath::vec3> &filtered) {
     filtered.reserve(particles.size());
 
     Array3d<int> countGrid = Array3d<int>(_isize, _jsize, _ksize, 0);
 
+    std::vector<vmath::vec3> *positions = particles.getPositions();
     vmath::vec3 p;
     GridIndex g;
-    for (unsigned int i = 0; i < particles.size(); i++) {
-        p = particles[i].position;
+    for (unsigned int i = 0; i < positions->size(); i++) {
+        p = positions->at(i);
         g = Grid3d::positionToGridIndex(p, _dx);
 
         if (countGrid(g) >= _maxParticlesPerCell) {
@@ -87,7 +104,7 @@ void AnisotropicParticleMesher::_filterHighDensityParticles(FragmentedVector<Mar
         }
         countGrid.add(g, 1);
 
-        filtered.push_back(particles[i].position);
+        filtered.push_back(p);
     }
 
 }
@@ -118,6 +135,7 @@ void AnisotropicParticleMesher::_initializeSurfaceParticles(FragmentedVector<vma
 
 void AnisotropicParticleMesher::_initializeSurfaceParticleSpatialGrid() {
     _pointGrid = SpatialPointGrid(_isize, _jsize, _ksize, _dx);
+    _pointGrid.setThreadPool(_threadPool);
 
     FragmentedVector<vmath::vec3> points;
     for (unsigned int i = 0; i < _surfaceParticles.size(); i++) {
@@ -157,16 +175,24 @@ AnisotropicParticleMesher::ParticleLocation AnisotropicParticleMesher::_getParti
 void AnisotropicParticleMesher::_updateNearFarSurfaceParticleReferences(LevelSet &levelset) {
     SurfaceParticle sp;
     ParticleLocation type;
+    std::vector<GridPointReference> nearRefs;
     for (unsigned int i = 0; i < _surfaceParticles.size(); i++) {
         sp = _surfaceParticles[i];
         type = _getParticleLocationType(sp.position, levelset);
 
         if (type == ParticleLocation::NearSurface) {
-            _nearSurfaceParticleRefs.push_back(sp.ref);
+            nearRefs.push_back(sp.ref);
         } else {
             _farSurfaceParticleRefs.push_back(sp.ref);
         }
     }
+
+    // Spatially coherent ranges of near surface particles share cell 
+    // groups in batched neighbour queries
+    _pointGrid.sortPointReferences(nearRefs);
+    for (unsigned int i = 0; i < nearRefs.size(); i++) {
+        _nearSurfaceParticleRefs.push_back(nearRefs[i]);
+    }
 }
 
 
@@ -212,26 +238,37 @@ void AnisotropicParticleMesher::_computeSmoothedNearSurfaceParticlePositions() {
     int numElements = _nearSurfaceParticleRefs.size();
     _smoothedPositions = FragmentedVector<vmath::vec3>(numElements);
     
-    _smoothRangeOfSurfaceParticlePositions(0, _nearSurfaceParticleRefs.size() - 1);
+    _runParticleRangeTasks(numElements, [this](int startidx, int endidx, 
+                                               ParticleTaskScratch &scratch) {
+        _smoothRangeOfSurfaceParticlePositions(startidx, endidx, scratch);
+    });
 }
 
-void AnisotropicParticleMesher::_smoothRangeOfSurfaceParticlePositions(int startidx, int endidx) {
-    std::vector<GridPointReference> neighbourRefs;
+void AnisotropicParticleMesher::_smoothRangeOfSurfaceParticlePositions(int startidx, int endidx,
+                                                                       ParticleTaskScratch &scratch) {
+    scratch.queryRefs.clear();
+    for (int i = startidx; i <= endidx; i++) {
+        scratch.queryRefs.push_back(_nearSurfaceParticleRefs[i]);
+    }
+
+    GridPointNeighbourList &nlist = scratch.neighbourList;
+    _pointGrid.queryPointReferencesInsideSphere(scratch.queryRefs, _kernelRadius, nlist);
+
     GridPointReference ref;
     vmath::vec3 newp;
     for (int i = startidx; i <= endidx; i++) {
+        int q = i - startidx;
         ref = _nearSurfaceParticleRefs[i];
-        newp = _getSmoothedParticlePosition(ref, _kernelRadius, neighbourRefs);
+        newp = _getSmoothedParticlePosition(ref, nlist.getNeighbours(q), 
+                                            nlist.getNumNeighbours(q));
         _smoothedPositions[i] = newp;
     }
 }
 
 vmath::vec3 AnisotropicParticleMesher::_getSmoothedParticlePosition(GridPointReference ref,
-                                                                    double radius,
-                                                                    std::vector<GridPointReference> &neighbourRefs) {
-    neighbourRefs.clear();
-    _pointGrid.queryPointReferencesInsideSphere(ref, radius, neighbourRefs);
-    vmath::vec3 mean = _getWeightedMeanParticlePosition(ref, neighbourRefs);
+                                                                    GridPointReference *neighbours,
+                                                                    int numNeighbours) {
+    vmath::vec3 mean = _getWeightedMeanParticlePosition(ref, neighbours, numNeighbours);
 
     SurfaceParticle spi = _surfaceParticles[ref.id]; 
     float k = (float)_smoothingConstant;
@@ -239,22 +276,19 @@ vmath::vec3 AnisotropicParticleMesher::_getSmoothedParticlePosition(GridPointRef
 }
 
 vmath::vec3 AnisotropicParticleMesher::_getWeightedMeanParticlePosition(GridPointReference ref,
-                                                                        std::vector<GridPointReference> &neighbours) {
-    SurfaceParticle spi = _surfaceParticles[ref.id]; 
-    SurfaceParticle spj;
+                                                                        GridPointReference *neighbours,
+                                                                        int numNeighbours) {
+    SurfaceParticle &spi = _surfaceParticles[ref.id]; 
 
     double xsum = 0.0;
     double ysum = 0.0;
     double zsum = 0.0;
     double weightSum = 0.0;
     double kernalVal;
-    vmath::vec3 v;
 
-    GridPointReference refj;
     double eps = 1e-9;
-    for (unsigned int i = 0; i < neighbours.size(); i++) {
-        refj = neighbours[i];
-        spj = _surfaceParticles[refj.id];
+    for (int i = 0; i < numNeighbours; i++) {
+        SurfaceParticle &spj = _surfaceParticles[neighbours[i].id];
 
         kernalVal = _evaluateKernel(spi, spj);
         xsum += kernalVal*spj.position.x;
@@ -317,30 +351,13 @@ TriangleMesh AnisotropicParticleMesher::_polygonizeSlice(int startidx, int endid
                                                          FragmentedVector<vmath::vec3> &particles, 
                                                          LevelSet &levelset,
                                                          FluidMaterialGrid &materialGrid) {
-    int width, height, depth;
-    double dx;
-    _getSubdividedGridDimensions(&width, &height, &depth, &dx);
-
-    bool isStartSlice = startidx == 0;
-    bool isEndSlice = endidx == width - 1;
-    bool isMiddleSlice = !isStartSlice && !isEndSlice;
-
-    int gridWidth = endidx - startidx + 1;
-    int gridHeight = height;
-    int gridDepth = depth;
-    if (isStartSlice || isEndSlice) {
-        gridWidth++;
-    } else if (isMiddleSlice) {
-        gridWidth += 2;
-    }
-
     _computeSliceScalarField(startidx, endidx, particles, levelset, materialGrid);
 
-    Array3d<bool> mask(gridWidth, gridHeight, gridDepth);
-    _getSliceMask(startidx, endidx, mask);
+    GridIndex gmin, gmax;
+    _getSliceCellBounds(startidx, endidx, &gmin, &gmax);
 
     Polygonizer3d polygonizer(&_scalarField);
-    polygonizer.setSurfaceCellMask(&mask);
+    polygonizer.setSurfaceCellBounds(gmin, gmax);
 
     return polygonizer.polygonizeSurface();
 }
@@ -442,7 +459,12 @@ void AnisotropicParticleMesher::_applyScalarFieldSliceSeamData() {
     for (int k = 0; k < depth; k++) {
         for (int j = 0; j < height; j++) {
             for (int i = 0; i <= 2; i++) {
-                _scalarField.setScalarFieldValue(i, j, k, _scalarFieldSeamData(i, j, k));
+                // Skip unchanged values so that a sparse field does not 
+                // allocate empty blocks along the seam
+                float value = _scalarFieldSeamData(i, j, k);
+                if (value != _scalarField.getRawScalarFieldValue(i, j, k)) {
+                    _scalarField.setScalarFieldValue(i, j, k, value);
+                }
             }
         }
     }
@@ -462,33 +484,31 @@ void AnisotropicParticleMesher::_saveScalarFieldSliceSeamData() {
     }
 }
 
-void AnisotropicParticleMesher::_getSliceMask(int startidx, int endidx, Array3d<bool> &mask) {
-    mask.fill(true);
-
+void AnisotropicParticleMesher::_getSliceCellBounds(int startidx, int endidx, 
+                                                    GridIndex *gmin, GridIndex *gmax) {
     int width, height, depth;
     double dx;
     _getSubdividedGridDimensions(&width, &height, &depth, &dx);
 
+    int fieldWidth, fieldHeight, fieldDepth;
+    _scalarField.getGridDimensions(&fieldWidth, &fieldHeight, &fieldDepth);
+
+    // The first and last cell columns of a slice overlap its neighbours 
+    // and are polygonized by them
     bool isStartSlice = startidx == 0;
     bool isEndSlice = endidx == width - 1;
+    int imin = isStartSlice ? 0 : 1;
+    int imax = isEndSlice ? fieldWidth - 2 : fieldWidth - 3;
 
-    if (!isStartSlice) {
-        int idx = 0;
-        for (int k = 0; k < mask.depth; k++) {
-            for (int j = 0; j < mask.height; j++) {
-                mask.set(idx, j, k, false);
-            }
-        }
-    }
+    *gmin = GridIndex(imin, 0, 0);
+    *gmax = GridIndex(imax, fieldHeight - 2, fieldDepth - 2);
+}
 
-    if (!isEndSlice) {
-        int idx = mask.width - 1;
-        for (int k = 0; k < mask.depth; k++) {
-            for (int j = 0; j < mask.height; j++) {
-                mask.set(idx, j, k, false);
-            }
-        }
+ScalarFieldStorage AnisotropicParticleMesher::_getScalarFieldStorage() {
+    if (_isSparseScalarFieldEnabled) {
+        return ScalarFieldStorage::sparse;
     }
+    return ScalarFieldStorage::dense;
 }
 
 void AnisotropicParticleMesher::_computeScalarField(FluidMaterialGrid &materialGrid,
@@ -532,7 +552,7 @@ void AnisotropicParticleMesher::_initializeScalarField(FluidMaterialGrid &materi
     int depth = _ksize*subd;
     double dx = _dx / (double)subd;
 
-    _scalarField = ScalarField(width + 1, height + 1, depth + 1, dx);
+    _scalarField = ScalarField(width + 1, height + 1, depth + 1, dx, _getScalarFieldStorage());
     
     int origsubd = materialGrid.getSubdivisionLevel();
     materialGrid.setSubdivisionLevel(subd);
@@ -562,7 +582,8 @@ void AnisotropicParticleMesher::_initializeSliceScalarField(int startidx, int en
     }
 
 
-    _scalarField = ScalarField(gridWidth + 1, gridHeight + 1, gridDepth + 1, dx);
+    _scalarField = ScalarField(gridWidth + 1, gridHeight + 1, gridDepth + 1, dx, 
+                               _getScalarFieldStorage());
 
     FluidMaterialGrid sliceMaterialGrid(gridWidth, gridHeight, gridDepth);
     _getSliceMaterialGrid(startidx, endidx, materialGrid, sliceMaterialGrid);
@@ -575,14 +596,17 @@ void AnisotropicParticleMesher::_initializeSliceScalarField(int startidx, int en
 
 void AnisotropicParticleMesher::_computeRangeOfAnisotropicParticles(int startidx, int endidx, 
                                                                     std::vector<AnisotropicParticle> &particles) {
+    std::vector<GridPointReference> refs;
     GridPointReference ref;
     for (int i = startidx; i <= endidx; i++) {
         ref = _nearSurfaceParticleRefs[i];
 
         if (_surfaceParticles[ref.id].componentID != -1) {
-            particles.push_back(_computeAnisotropicParticle(ref));
+            refs.push_back(ref);
         }
     }
+
+    _computeAnisotropicParticles(refs, particles);
 }
 
 void AnisotropicParticleMesher::_computeRangeOfSliceAnisotropicParticles(int refstartidx, int refendidx, 
@@ -590,6 +614,7 @@ void AnisotropicParticleMesher::_computeRangeOfSliceAnisotropicParticles(int ref
                                                                          std::vector<AnisotropicParticle> &particles) {
     AABB bbox = _getSliceAABB(slicestartidx, sliceendidx);
 
+    std::vector<GridPointReference> refs;
     GridPointReference ref;
     for (int i = refstartidx; i <= refendidx; i++) {
         ref = _nearSurfaceParticleRefs[i];
@@ -599,9 +624,93 @@ void AnisotropicParticleMesher::_computeRangeOfSliceAnisotropicParticles(int ref
         }
 
         if (bbox.isPointInside(_surfaceParticles[ref.id].position)) {
-            particles.push_back(_computeAnisotropicParticle(ref));
+            refs.push_back(ref);
         }
     }
+
+    _computeAnisotropicParticles(refs, particles);
+}
+
+/*
+    Appends the anisotropic particles for refs to particles in the same 
+    order as refs.
+*/
+void AnisotropicParticleMesher::_computeAnisotropicParticles(std::vector<GridPointReference> &refs,
+                                                             std::vector<AnisotropicParticle> &particles) {
+    int offset = particles.size();
+    particles.resize(offset + refs.size());
+
+    _runParticleRangeTasks(refs.size(), [this, &refs, &particles, offset](
+                                        int startidx, int endidx, 
+                                        ParticleTaskScratch &scratch) {
+        _computeAnisotropicParticleBatch(&refs[startidx], endidx - startidx + 1,
+                                         &particles[offset + startidx], scratch);
+    });
+}
+
+void AnisotropicParticleMesher::_computeAnisotropicParticleBatch(GridPointReference *refs, int n,
+                                                                 AnisotropicParticle *particles,
+                                                                 ParticleTaskScratch &scratch) {
+    scratch.covariances.resize(n);
+    scratch.eigenvectors.resize(n);
+    scratch.eigenvalues.resize(n);
+
+    scratch.queryRefs.assign(refs, refs + n);
+    GridPointNeighbourList &nlist = scratch.neighbourList;
+    _pointGrid.queryPointReferencesInsideSphere(scratch.queryRefs, _kernelRadius, nlist);
+
+    for (int i = 0; i < n; i++) {
+        scratch.covariances[i] = _computeCovarianceMatrix(refs[i], nlist.getNeighbours(i), 
+                                                          nlist.getNumNeighbours(i));
+    }
+
+    JacobiSVD::decomposeSymmetric(scratch.covariances.data(), n, 
+                                  scratch.eigenvectors.data(), 
+                                  scratch.eigenvalues.data());
+
+    SVD svd;
+    for (int i = 0; i < n; i++) {
+        _eigenDecompositionToSVD(scratch.eigenvectors[i], scratch.eigenvalues[i], svd);
+        vmath::mat3 G = _SVDToAnisotropicMatrix(svd);
+        vmath::vec3 p = _surfaceParticles[refs[i].id].position;
+        particles[i] = AnisotropicParticle(p, G);
+    }
+}
+
+/*
+    Executes func(startidx, endidx, scratch) over inclusive subranges of 
+    [0, numElements). Each thread claims subranges of 
+    _particleTaskChunkSize elements until the range is exhausted and 
+    passes the same scratch buffers to every subrange it processes.
+*/
+void AnisotropicParticleMesher::_runParticleRangeTasks(int numElements, 
+                                                       std::function<void(int, int, ParticleTaskScratch&)> func) {
+    if (numElements <= 0) {
+        return;
+    }
+
+    int chunkSize = _particleTaskChunkSize;
+    int numChunks = (numElements + chunkSize - 1) / chunkSize;
+    int numThreads = _threadPool == nullptr ? 1 : _threadPool->getNumThreads();
+    numThreads = (int)fmin(numThreads, numChunks);
+
+    std::vector<ParticleTaskScratch> scratch(numThreads);
+    std::atomic<int> nextChunk(0);
+    auto threadFunc = [&](int tid) {
+        int chunk;
+        while ((chunk = nextChunk.fetch_add(1)) < numChunks) {
+            int startidx = chunk*chunkSize;
+            int endidx = (int)fmin(startidx + chunkSize, numElements) - 1;
+            func(startidx, endidx, scratch[tid]);
+        }
+    };
+
+    if (numThreads == 1) {
+        threadFunc(0);
+        return;
+    }
+
+    _threadPool->run(numThreads, threadFunc);
 }
 
 void AnisotropicParticleMesher::_addAnisotropicParticlesToScalarField() {
@@ -673,30 +782,15 @@ void AnisotropicParticleMesher::_addIsotropicParticlesToScalarField(FragmentedVe
     }
 }
 
-AnisotropicParticleMesher::AnisotropicParticle AnisotropicParticleMesher::_computeAnisotropicParticle(
-                                                                            GridPointReference ref) {
-    std::vector<GridPointReference> neighbours;
-    vmath::mat3 covariance = _computeCovarianceMatrix(ref, _kernelRadius, neighbours);
-
-    SVD svd;
-    _covarianceMatrixToSVD(covariance, svd);
-    vmath::mat3 G = _SVDToAnisotropicMatrix(svd);
+vmath::mat3 AnisotropicParticleMesher::_computeCovarianceMatrix(GridPointReference ref,
+                                                                GridPointReference *neighbours,
+                                                                int numNeighbours) {
 
-    vmath::vec3 p = _surfaceParticles[ref.id].position;
-    return AnisotropicParticle(p, G);
-}
-
-vmath::mat3 AnisotropicParticleMesher::_computeCovarianceMatrix(GridPointReference ref, double radius,
-                                                                std::vector<GridPointReference> &neighbours) {
-
-    neighbours.clear();
-    _pointGrid.queryPointReferencesInsideSphere(ref, radius, neighbours);
-
-    if ((int)neighbours.size() <= _minAnisotropicParticleNeighbourThreshold) {
+    if (numNeighbours <= _minAnisotropicParticleNeighbourThreshold) {
         return vmath::mat3();
     }
 
-    vmath::vec3 meanpos = _getWeightedMeanParticlePosition(ref, neighbours);
+    vmath::vec3 meanpos = _getWeightedMeanParticlePosition(ref, neighbours, numNeighbours);
 
     SurfaceParticle meansp = SurfaceParticle(meanpos);
     meansp.componentID = _surfaceParticles[ref.id].componentID;
@@ -708,15 +802,11 @@ vmath::mat3 AnisotropicParticleMesher::_computeCovarianceMatrix(GridPointReferen
     float sum01 = 0.0;
     float sum02 = 0.0;
     float sum12 = 0.0;
-    GridPointReference refj;
-    SurfaceParticle spj;
-    vmath::vec3 v;
     double kernelVal;
     double scale = _particleRadius*_anisotropicParticleScale;
     double eps = 1e-9;
-    for (unsigned int i = 0; i < neighbours.size(); i++) {
-        refj = neighbours[i];
-        spj = _surfaceParticles[refj.id];
+    for (int i = 0; i < numNeighbours; i++) {
+        SurfaceParticle &spj = _surfaceParticles[neighbours[i].id];
 
         kernelVal = _evaluateKernel(meansp, spj)*scale;
 
@@ -724,13 +814,15 @@ vmath::mat3 AnisotropicParticleMesher::_computeCovarianceMatrix(GridPointReferen
             continue;
         }
 
-        v = spj.position - meansp.position;
-        sum00 += (float)kernelVal*v[0]*v[0];
-        sum11 += (float)kernelVal*v[1]*v[1];
-        sum22 += (float)kernelVal*v[2]*v[2];
-        sum01 += (float)kernelVal*v[0]*v[1];
-        sum02 += (float)kernelVal*v[0]*v[2];
-        sum12 += (float)kernelVal*v[1]*v[2];
+        float vx = spj.position.x - meansp.position.x;
+        float vy = spj.position.y - meansp.position.y;
+        float vz = spj.position.z - meansp.position.z;
+        sum00 += (float)kernelVal*vx*vx;
+        sum11 += (float)kernelVal*vy*vy;
+        sum22 += (float)kernelVal*vz*vz;
+        sum01 += (float)kernelVal*vx*vy;
+        sum02 += (float)kernelVal*vx*vz;
+        sum12 += (float)kernelVal*vy*vz;
         weightSum += kernelVal;
     }
 
@@ -743,14 +835,18 @@ vmath::mat3 AnisotropicParticleMesher::_computeCovarianceMatrix(GridPointReferen
                      sum02, sum12, sum22) / (float) weightSum;
 }
 
-void AnisotropicParticleMesher::_covarianceMatrixToSVD(vmath::mat3 &covariance, SVD &svd) {
-    vmath::quat q = _diagonalizeMatrix(covariance);
-    vmath::mat3 Q = vmath::mat3_cast(q);
-    vmath::mat3 D = vmath::transpose(Q) * covariance * Q;
-
-    double d0 = D[0][0];
-    double d1 = D[1][1];
-    double d2 = D[2][2];
+/*
+    Sorts the eigenvalues of the covariance matrix in decreasing order, 
+    clamps small eigenvalues to limit the ratio between the largest and 
+    smallest and scales the result to unit determinant.
+*/
+void AnisotropicParticleMesher::_eigenDecompositionToSVD(vmath::mat3 &eigenvectors, 
+                                                         vmath::vec3 &eigenvalues, 
+                                                         SVD &svd) {
+    vmath::mat3 Q = eigenvectors;
+    double d0 = eigenvalues.x;
+    double d1 = eigenvalues.y;
+    double d2 = eigenvalues.z;
     int k0 = 0;
     int k1 = 1;
     int k2 = 2;
@@ -776,72 +872,15 @@ void AnisotropicParticleMesher::_covarianceMatrixToSVD(vmath::mat3 &covariance,
     }
 
     double kr = _maxEigenvalueRatio;
-    double sigma0 = (double)D[k0][k0];
-    double sigma1 = std::max((double)D[k1][k1], sigma0 / kr);
-    double sigma2 = std::max((double)D[k2][k2], sigma0 / kr);
+    double sigma0 = (double)eigenvalues[k0];
+    double sigma1 = std::max((double)eigenvalues[k1], sigma0 / kr);
+    double sigma2 = std::max((double)eigenvalues[k2], sigma0 / kr);
 
     double ks = cbrt(1.0/(sigma0*sigma1*sigma2));          // scale so that det(covariance) == 1
     svd.rotation = vmath::mat3(Q[k0], Q[k1], Q[k2]);
     svd.diag = (float)ks*vmath::vec3(sigma0, sigma1, sigma2);
 }
 
-/*
-    A must be a symmetric matrix.
-	returns quaternion q such that its corresponding matrix Q 
-	can be used to Diagonalize A
-	Diagonal matrix D = Transpose(Q) * A * Q;  and  A = Q * D * Transpose(Q)
-	The columns of Q are the eigenvectors, D's diagonal is the eigenvalues
-
-    Method adapted from:
-        www.melax.com/diag.html?attredirects=0
-*/
-vmath::quat AnisotropicParticleMesher::_diagonalizeMatrix(vmath::mat3 A) {
-
-    int maxsteps = 24;
-    vmath::quat q(1.0, vmath::vec3());
-    int i = 0;
-
-    for (i = 0; i < maxsteps; i++) {
-        vmath::mat3 Q = vmath::mat3_cast(q);
-        vmath::mat3 D = vmath::transpose(Q) * A * Q;
-        vmath::vec3 offdiag(D[2][1], D[2][0], D[1][0]);
-        vmath::vec3 om(fabsf(offdiag.x), fabsf(offdiag.y), fabsf(offdiag.z));
-        int k = (om.x > om.y && om.x > om.z)?0: (om.y > om.z)? 1 : 2;
-        int k1 = (k+1)%3;
-		int k2 = (k+2)%3;
-
-        if(offdiag[k]==0.0f) {
-            break;
-        }
-
-        float thet = (D[k2][k2]-D[k1][k1])/(2.0f*offdiag[k]);
-		float sgn = (thet > 0.0f)?1.0f:-1.0f;
-		thet *= sgn;
-        float t = sgn /(thet +((thet < 1.E6f)?sqrtf(thet*thet+1.0f):thet));
-		float c = 1.0f/sqrtf(t*t+1.0f);
-
-        if(c==1.0f) { 
-            break; 
-        }
-
-        float jrtemp[3] = {0.0f, 0.0f, 0.0f};
-        jrtemp[k] = sgn*sqrtf((1.0f-c)/2.0f);
-        jrtemp[k] *= -1.0f;
-
-        vmath::quat jr(sqrtf(1.0f - jrtemp[k]*jrtemp[k]), 
-                     vmath::vec3(jrtemp[0], jrtemp[1], jrtemp[2]));
-
-        if(jr.w==1.0f) {
-            break; 
-        }
-
-        q = vmath::cross(q,jr); 
-		q = vmath::normalize(q);
-    }
-
-    return q;
-}
-
 vmath::mat3 AnisotropicParticleMesher::_SVDToAnisotropicMatrix(SVD &svd) {
     vmath::mat3 invD = vmath::mat3(vmath::vec3(1.0 / svd.diag.x, 0.0, 0.0),
                                vmath::vec3(0.0, 1.0 / svd.diag.y, 0.0),
@@ -866,7 +905,12 @@ double AnisotropicParticleMesher::_evaluateKernel(SurfaceParticle &pi, SurfacePa
         return 0.0;
     }
 
-    double dist = vmath::length(pj.position - pi.position);
+    // Evaluated per component to avoid vec3 temporaries in the 
+    // neighbour loops
+    float vx = pj.position.x - pi.position.x;
+    float vy = pj.position.y - pi.position.y;
+    float vz = pj.position.z - pi.position.z;
+    double dist = (float)sqrt(vx*vx + vy*vy + vz*vz);
     if (dist >= _kernelRadius) {
         return 0.0;
     }
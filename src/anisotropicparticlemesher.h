@@ -22,6 +22,9 @@ freely, subject to the following restrictions:
 
 #include <stdio.h>
 #include <iostream>
+#include <vector>
+#include <atomic>
+#include <functional>
 
 #include "array3d.h"
 #include "grid3d.h"
@@ -35,7 +38,9 @@ freely, subject to the following restrictions:
 #include "vmath.h"
 #include "fluidmaterialgrid.h"
 #include "fragmentedvector.h"
-#include "markerparticle.h"
+#include "markerparticlevector.h"
+#include "threadpool.h"
+#include "jacobisvd.h"
 
 class AnisotropicParticleMesher
 {
@@ -47,7 +52,22 @@ public:
     void setSubdivisionLevel(int n);
     void setNumPolygonizationSlices(int n);
 
-    TriangleMesh meshParticles(FragmentedVector<MarkerParticle> &particles, 
+    /*
+        Surface particle smoothing and anisotropy computation are split 
+        between the threads of the pool. Runs serially if no pool is set.
+    */
+    void setThreadPool(ThreadPool *pool);
+
+    /*
+        Store the scalar field in blocks that are only allocated near
+        particles. Memory then scales with the particle-occupied volume 
+        instead of the subdivided grid volume.
+    */
+    void enableSparseScalarField();
+    void disableSparseScalarField();
+    bool isSparseScalarFieldEnabled();
+
+    TriangleMesh meshParticles(MarkerParticleVector &particles, 
                                LevelSet &levelset,
                                FluidMaterialGrid &materialGrid,
                                double particleRadius);
@@ -100,6 +120,19 @@ private:
         SVD(vmath::vec3 d, vmath::mat3 rot) : rotation(rot), diag(d) {}
     };
 
+    /*
+        Scratch buffers owned by one thread while it processes ranges of 
+        surface particles so that batched neighbour queries and covariance 
+        batches do not allocate per particle.
+    */
+    struct ParticleTaskScratch {
+        std::vector<GridPointReference> queryRefs;
+        GridPointNeighbourList neighbourList;
+        std::vector<vmath::mat3> covariances;
+        std::vector<vmath::mat3> eigenvectors;
+        std::vector<vmath::vec3> eigenvalues;
+    };
+
     enum class ParticleLocation : char { 
         Inside   = 0x00, 
         NearSurface = 0x01, 
@@ -110,7 +143,7 @@ private:
 
     void _initializeSurfaceParticles(FragmentedVector<vmath::vec3> &particles, 
                                      LevelSet &levelset);
-    void _filterHighDensityParticles(FragmentedVector<MarkerParticle> &particles, 
+    void _filterHighDensityParticles(MarkerParticleVector &particles, 
                                      FragmentedVector<vmath::vec3> &filtered);
     ParticleLocation _getParticleLocationType(vmath::vec3 p, LevelSet &levelset);
 
@@ -134,12 +167,14 @@ private:
     void _updateSurfaceParticleComponentIDs();
     void _smoothSurfaceParticlePositions();
     void _computeSmoothedNearSurfaceParticlePositions();
-    void _smoothRangeOfSurfaceParticlePositions(int startidx, int endidx);
+    void _smoothRangeOfSurfaceParticlePositions(int startidx, int endidx,
+                                                ParticleTaskScratch &scratch);
     vmath::vec3 _getSmoothedParticlePosition(GridPointReference ref,
-                                           double radius,
-                                           std::vector<GridPointReference> &refs);
+                                           GridPointReference *neighbours,
+                                           int numNeighbours);
     vmath::vec3 _getWeightedMeanParticlePosition(GridPointReference ref,
-                                               std::vector<GridPointReference> &neighbours);
+                                               GridPointReference *neighbours,
+                                               int numNeighbours);
     TriangleMesh _polygonizeAll(FragmentedVector<vmath::vec3> &particles, 
                                 LevelSet &levelset,
                                 FluidMaterialGrid &materialGrid);
@@ -167,7 +202,8 @@ private:
     void _updateScalarFieldSeam(int startidx, int endidx);
     void _applyScalarFieldSliceSeamData();
     void _saveScalarFieldSliceSeamData();
-    void _getSliceMask(int startidx, int endidx, Array3d<bool> &mask);
+    void _getSliceCellBounds(int startidx, int endidx, GridIndex *gmin, GridIndex *gmax);
+    ScalarFieldStorage _getScalarFieldStorage();
 
     void _computeScalarField(FluidMaterialGrid &materialGrid,
                              FragmentedVector<vmath::vec3> &particles,
@@ -182,16 +218,23 @@ private:
     void _computeRangeOfSliceAnisotropicParticles(int refstartidx, int refendidx, 
                                                   int slicestartidx, int sliceendidx,
                                                   std::vector<AnisotropicParticle> &particles);
+    void _computeAnisotropicParticles(std::vector<GridPointReference> &refs,
+                                      std::vector<AnisotropicParticle> &particles);
+    void _computeAnisotropicParticleBatch(GridPointReference *refs, int n,
+                                          AnisotropicParticle *particles,
+                                          ParticleTaskScratch &scratch);
     void _addAnisotropicParticleToScalarField(AnisotropicParticle &aniso);
     void _addIsotropicParticlesToScalarField(FragmentedVector<vmath::vec3> &particles, LevelSet &levelset);
-    AnisotropicParticle _computeAnisotropicParticle(GridPointReference ref);
     void _getUnprocessedParticlesFromStack(int num, std::vector<GridPointReference> &refs);
-    vmath::mat3 _computeCovarianceMatrix(GridPointReference ref, double radius,
-                                       std::vector<GridPointReference> &neighbours);
-    void _covarianceMatrixToSVD(vmath::mat3 &covariance, SVD &svd);
-    vmath::quat _diagonalizeMatrix(vmath::mat3 A);
+    vmath::mat3 _computeCovarianceMatrix(GridPointReference ref,
+                                       GridPointReference *neighbours,
+                                       int numNeighbours);
+    void _eigenDecompositionToSVD(vmath::mat3 &eigenvectors, vmath::vec3 &eigenvalues, SVD &svd);
     vmath::mat3 _SVDToAnisotropicMatrix(SVD &svd);
 
+    void _runParticleRangeTasks(int numElements, 
+                                std::function<void(int, int, ParticleTaskScratch&)> func);
+
     void _setParticleRadius(double r);
     void _setKernelRadius(double r);
     double _evaluateKernel(SurfaceParticle &pi, SurfaceParticle &pj);
@@ -232,6 +275,10 @@ private:
 
     int _subdivisionLevel = 1;
     int _numPolygonizationSlices = 1;
+    bool _isSparseScalarFieldEnabled = false;
+
+    ThreadPool *_threadPool = nullptr;
+    int _particleTaskChunkSize = 2048;
 
     Array3d<float> _scalarFieldSeamData;
 };
@@ -21,12 +21,15 @@ freely, subject to the following restrictions:
 #define ARRAY3D_H
 
 #include <vector>
+#include <algorithm>
 #include <stdio.h>
 #include <iostream>
 #include <stdexcept>
 #include <string>
 #include <sstream>
 
+#include "array3dlayout.h"
+
 struct GridIndex {
     int i, j, k;
 
@@ -55,7 +58,13 @@ struct GridIndex {
     }
 };
 
-template <class T>
+/*
+    The Layout policy determines how elements are ordered in memory. Flat 
+    indices passed to the accessors are always i + width*(j + height*k) 
+    regardless of layout. The raw storage array is only available with the
+    linear layout.
+*/
+template <class T, class Layout = Array3dLinearLayout>
 class Array3d
 {
 public:
@@ -80,14 +89,8 @@ public:
 
         _initializeGrid();
 
-        T val;
-        for (int k = 0; k < depth; k++) {
-            for (int j = 0; j < height; j++) {
-                for (int i = 0; i < width; i++) {
-                    val = obj._grid[_getFlatIndex(i, j, k)];
-                    set(i, j, k, val);
-                }
-            }
+        if (obj._storageSize > 0) {
+            std::copy(obj._grid, obj._grid + obj._storageSize, _grid);
         }
 
         if (obj._isOutOfRangeValueSet) {
@@ -97,6 +100,10 @@ public:
     }
 
     Array3d operator=(const Array3d &rhs) {
+        if (this == &rhs) {
+            return *this;
+        }
+
         delete[] _grid;
 
         width = rhs.width;
@@ -106,14 +113,8 @@ public:
 
         _initializeGrid();
 
-        T val;
-        for (int k = 0; k < depth; k++) {
-            for (int j = 0; j < height; j++) {
-                for (int i = 0; i < width; i++) {
-                    val = rhs._grid[_getFlatIndex(i, j, k)];
-                    set(i, j, k, val);
-                }
-            }
+        if (rhs._storageSize > 0) {
+            std::copy(rhs._grid, rhs._grid + rhs._storageSize, _grid);
         }
 
         if (rhs._isOutOfRangeValueSet) {
@@ -129,8 +130,8 @@ public:
     }
 
     void fill(T value) {
-        for (int idx = 0; idx < width*height*depth; idx++) {
-            _grid[idx] = value;
+        if (_storageSize > 0) {
+            std::fill(_grid, _grid + _storageSize, value);
         }
     }
 
@@ -176,7 +177,7 @@ public:
             throw std::out_of_range(msg);
         }
 
-        return _grid[flatidx];
+        return _grid[_layout.getIndex(flatidx)];
     }
 
     T get(int i, int j, int k) {
@@ -221,7 +222,7 @@ public:
             throw std::out_of_range(msg);
         }
 
-        return _grid[flatidx];
+        return _grid[_layout.getIndex(flatidx)];
     }
 
     void set(int i, int j, int k, T value) {
@@ -257,7 +258,7 @@ public:
             throw std::out_of_range(msg);
         }
 
-        _grid[flatidx] = value;
+        _grid[_layout.getIndex(flatidx)] = value;
     }
 
     void add(int i, int j, int k, T value) {
@@ -287,7 +288,7 @@ public:
             throw std::out_of_range(msg);
         }
 
-        _grid[flatidx] += value;
+        _grid[_layout.getIndex(flatidx)] += value;
     }
 
     T *getPointer(int i, int j, int k) {
@@ -332,10 +333,11 @@ public:
             throw std::out_of_range(msg);
         }
 
-        return &_grid[flatidx];
+        return &_grid[_layout.getIndex(flatidx)];
     }
 
     T *getRawArray() {
+        static_assert(Layout::isLinear, "Raw array access requires a linear layout");
         return _grid;
     }
 
@@ -380,7 +382,9 @@ private:
             throw std::domain_error(msg);
         }
 
-        _grid = new T[width*height*depth];
+        _layout.initialize(width, height, depth);
+        _storageSize = _layout.getStorageSize();
+        _grid = new T[_storageSize];
     }
 
     inline bool _isIndexInRange(int i, int j, int k) {
@@ -392,13 +396,11 @@ private:
     }
 
     inline unsigned int _getFlatIndex(int i, int j, int k) {
-        return (unsigned int)i + (unsigned int)width *
-               ((unsigned int)j + (unsigned int)height * (unsigned int)k);
+        return _layout.getIndex(i, j, k);
     }
 
     inline unsigned int _getFlatIndex(GridIndex g) {
-        return (unsigned int)g.i + (unsigned int)width *
-               ((unsigned int)g.j + (unsigned int)height * (unsigned int)g.k);
+        return _layout.getIndex(g.i, g.j, g.k);
     }
 
     template<class S>
@@ -410,6 +412,8 @@ private:
     }
 
     T *_grid;
+    Layout _layout;
+    int _storageSize = 0;
 
     bool _isOutOfRangeValueSet = false;
     T _outOfRangeValue;
@@ -0,0 +1,169 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef ARRAY3DLAYOUT_H
+#define ARRAY3DLAYOUT_H
+
+/*
+    Storage layout policies for Array3d. A layout maps a grid index to an 
+    offset in the storage array of a grid with the given dimensions.
+
+    Array3dLinearLayout - i-fastest flat layout. The storage array can be 
+                          shared with code that indexes it as 
+                          i + width*(j + height*k), such as OpenCL kernels 
+                          and savestates.
+    Array3dTiledLayout  - 4x4x4 tiles in i-fastest tile order with an 
+                          i-fastest layout within each tile. A 3x3x3 
+                          stencil touches at most 8 tiles.
+    Array3dMortonLayout - 8x8x8 blocks in i-fastest block order with a 
+                          Morton (Z-order) layout within each block. 
+
+    Tiled and Morton layouts pad the grid dimensions up to a multiple of 
+    the tile or block width.
+*/
+
+class Array3dLinearLayout
+{
+public:
+    static const bool isLinear = true;
+
+    void initialize(int width, int height, int depth) {
+        _width = width;
+        _height = height;
+        _storageSize = width*height*depth;
+    }
+
+    int getStorageSize() {
+        return _storageSize;
+    }
+
+    inline unsigned int getIndex(int i, int j, int k) {
+        return (unsigned int)i + (unsigned int)_width *
+               ((unsigned int)j + (unsigned int)_height * (unsigned int)k);
+    }
+
+    inline unsigned int getIndex(int flatidx) {
+        return (unsigned int)flatidx;
+    }
+
+private:
+    int _width = 0;
+    int _height = 0;
+    int _storageSize = 0;
+};
+
+class Array3dTiledLayout
+{
+public:
+    static const bool isLinear = false;
+
+    void initialize(int width, int height, int depth) {
+        _width = width;
+        _height = height;
+        _tileGridWidth = (width + _tileMask) >> _tileBits;
+        _tileGridHeight = (height + _tileMask) >> _tileBits;
+        int tileGridDepth = (depth + _tileMask) >> _tileBits;
+        _storageSize = _tileGridWidth*_tileGridHeight*tileGridDepth << (3*_tileBits);
+    }
+
+    int getStorageSize() {
+        return _storageSize;
+    }
+
+    inline unsigned int getIndex(int i, int j, int k) {
+        unsigned int tileidx = (unsigned int)(i >> _tileBits) + (unsigned int)_tileGridWidth *
+                               ((unsigned int)(j >> _tileBits) + 
+                                (unsigned int)_tileGridHeight * (unsigned int)(k >> _tileBits));
+        unsigned int offset = (unsigned int)(i & _tileMask) | 
+                              (unsigned int)(j & _tileMask) << _tileBits | 
+                              (unsigned int)(k & _tileMask) << (2*_tileBits);
+        return (tileidx << (3*_tileBits)) | offset;
+    }
+
+    inline unsigned int getIndex(int flatidx) {
+        int i = flatidx % _width;
+        int j = (flatidx / _width) % _height;
+        int k = flatidx / (_width*_height);
+        return getIndex(i, j, k);
+    }
+
+private:
+    static const int _tileBits = 2;
+    static const int _tileMask = (1 << _tileBits) - 1;
+
+    int _width = 0;
+    int _height = 0;
+    int _tileGridWidth = 0;
+    int _tileGridHeight = 0;
+    int _storageSize = 0;
+};
+
+class Array3dMortonLayout
+{
+public:
+    static const bool isLinear = false;
+
+    void initialize(int width, int height, int depth) {
+        _width = width;
+        _height = height;
+        _blockGridWidth = (width + _blockMask) >> _blockBits;
+        _blockGridHeight = (height + _blockMask) >> _blockBits;
+        int blockGridDepth = (depth + _blockMask) >> _blockBits;
+        _storageSize = _blockGridWidth*_blockGridHeight*blockGridDepth << (3*_blockBits);
+    }
+
+    int getStorageSize() {
+        return _storageSize;
+    }
+
+    inline unsigned int getIndex(int i, int j, int k) {
+        unsigned int blockidx = (unsigned int)(i >> _blockBits) + (unsigned int)_blockGridWidth *
+                                ((unsigned int)(j >> _blockBits) + 
+                                 (unsigned int)_blockGridHeight * (unsigned int)(k >> _blockBits));
+        unsigned int offset = _mortonSpread(i & _blockMask) | 
+                              _mortonSpread(j & _blockMask) << 1 | 
+                              _mortonSpread(k & _blockMask) << 2;
+        return (blockidx << (3*_blockBits)) | offset;
+    }
+
+    inline unsigned int getIndex(int flatidx) {
+        int i = flatidx % _width;
+        int j = (flatidx / _width) % _height;
+        int k = flatidx / (_width*_height);
+        return getIndex(i, j, k);
+    }
+
+private:
+
+    // Spreads the three low bits of v so that bit n moves to bit 3n
+    inline unsigned int _mortonSpread(int v) {
+        return (unsigned int)((v & 0x1) | (v & 0x2) << 2 | (v & 0x4) << 4);
+    }
+
+    static const int _blockBits = 3;
+    static const int _blockMask = (1 << _blockBits) - 1;
+
+    int _width = 0;
+    int _height = 0;
+    int _blockGridWidth = 0;
+    int _blockGridHeight = 0;
+    int _storageSize = 0;
+};
+
+#endif
@@ -173,7 +173,7 @@ public:
     }
 
     void getViewAsArray3d(Array3d<T> &view) {
-        if (!(view.width == width && view.height == height && view.depth = depth)) {
+        if (!(view.width == width && view.height == height && view.depth == depth)) {
             std::string msg = "Error: array dimensions must be equal to view dimensions.\n";
             msg += "width: " + _toString(width) + 
                    " height: " + _toString(height) + 
@@ -188,8 +188,6 @@ public:
                 }
             }
         }
-
-        return view;
     }
 
     void fill(T value) {
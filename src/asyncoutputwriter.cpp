@@ -0,0 +1,221 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "asyncoutputwriter.h"
+
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+
+std::mutex AsyncOutputWriter::_registryMutex;
+std::vector<AsyncOutputWriter*> AsyncOutputWriter::_registry;
+bool AsyncOutputWriter::_isExitHandlerRegistered = false;
+
+AsyncOutputWriter::AsyncOutputWriter() {
+    _registerWriter(this);
+}
+
+AsyncOutputWriter::~AsyncOutputWriter() {
+    _unregisterWriter(this);
+    _stopWorker();
+}
+
+void AsyncOutputWriter::enableAsynchronousWrites() {
+    _isAsynchronousWritesEnabled = true;
+}
+
+void AsyncOutputWriter::disableAsynchronousWrites() {
+    flush();
+    _isAsynchronousWritesEnabled = false;
+}
+
+bool AsyncOutputWriter::isAsynchronousWritesEnabled() {
+    return _isAsynchronousWritesEnabled;
+}
+
+void AsyncOutputWriter::setMaxQueueSize(size_t numBytes) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _maxQueueSize = numBytes;
+    lock.unlock();
+    _spaceCondition.notify_all();
+}
+
+size_t AsyncOutputWriter::getMaxQueueSize() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _maxQueueSize;
+}
+
+size_t AsyncOutputWriter::getQueueSize() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _queueSize;
+}
+
+void AsyncOutputWriter::writeTriangleMesh(TriangleMesh &&mesh, 
+                                          TriangleMeshFormat format, 
+                                          std::string filename) {
+    WriteTask task;
+    task.type = WriteType::mesh;
+    task.mesh = std::move(mesh);
+    task.format = format;
+    task.filename = filename;
+    task.numBytes = _getMeshSize(task.mesh);
+    _queueTask(task);
+}
+
+void AsyncOutputWriter::writeData(std::vector<char> &&data, std::string filename) {
+    WriteTask task;
+    task.type = WriteType::data;
+    task.data = std::move(data);
+    task.filename = filename;
+    task.numBytes = task.data.size();
+    _queueTask(task);
+}
+
+void AsyncOutputWriter::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idleCondition.wait(lock, [this]() { 
+        return _queue.empty() && !_isTaskRunning; 
+    });
+}
+
+void AsyncOutputWriter::flushAll() {
+    std::unique_lock<std::mutex> lock(_registryMutex);
+    for (unsigned int i = 0; i < _registry.size(); i++) {
+        _registry[i]->flush();
+    }
+}
+
+void AsyncOutputWriter::_queueTask(WriteTask &task) {
+    if (!_isAsynchronousWritesEnabled) {
+        _executeTask(task);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_isWorkerRunning) {
+        _startWorker();
+    }
+
+    _spaceCondition.wait(lock, [this, &task]() { 
+        return _queueSize == 0 || _queueSize + task.numBytes <= _maxQueueSize; 
+    });
+
+    _queueSize += task.numBytes;
+    _queue.push_back(std::move(task));
+    lock.unlock();
+    _taskCondition.notify_one();
+}
+
+void AsyncOutputWriter::_executeTask(WriteTask &task) {
+    if (task.type == WriteType::mesh) {
+        if (task.format == TriangleMeshFormat::ply) {
+            task.mesh.writeMeshToPLY(task.filename);
+        } else if (task.format == TriangleMeshFormat::bobj) {
+            task.mesh.writeMeshToBOBJ(task.filename);
+        }
+    } else if (task.type == WriteType::data) {
+        _writeDataToFile(task.data, task.filename);
+    }
+}
+
+void AsyncOutputWriter::_writeDataToFile(std::vector<char> &data, std::string filename) {
+    std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
+    file.write(data.data(), data.size());
+    file.close();
+}
+
+size_t AsyncOutputWriter::_getMeshSize(TriangleMesh &mesh) {
+    return mesh.vertices.size()*sizeof(vmath::vec3) + 
+           mesh.vertexcolors.size()*sizeof(vmath::vec3) +
+           mesh.normals.size()*sizeof(vmath::vec3) +
+           mesh.triangles.size()*sizeof(Triangle);
+}
+
+void AsyncOutputWriter::_startWorker() {
+    _isShutdown = false;
+    _worker = std::thread(&AsyncOutputWriter::_workerLoop, this);
+    _isWorkerRunning = true;
+}
+
+void AsyncOutputWriter::_stopWorker() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_isWorkerRunning) {
+        return;
+    }
+    _isShutdown = true;
+    lock.unlock();
+    _taskCondition.notify_all();
+
+    _worker.join();
+
+    lock.lock();
+    _isWorkerRunning = false;
+}
+
+/*
+    The worker exits on shutdown only after the queue has been drained.
+*/
+void AsyncOutputWriter::_workerLoop() {
+    for (;;) {
+        WriteTask task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _taskCondition.wait(lock, [this]() { 
+                return _isShutdown || !_queue.empty(); 
+            });
+
+            if (_queue.empty()) {
+                return;
+            }
+
+            task = std::move(_queue.front());
+            _queue.pop_front();
+            _isTaskRunning = true;
+        }
+
+        _executeTask(task);
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _queueSize -= task.numBytes;
+            _isTaskRunning = false;
+        }
+        _spaceCondition.notify_all();
+        _idleCondition.notify_all();
+    }
+}
+
+void AsyncOutputWriter::_registerWriter(AsyncOutputWriter *writer) {
+    std::unique_lock<std::mutex> lock(_registryMutex);
+    _registry.push_back(writer);
+    if (!_isExitHandlerRegistered) {
+        std::atexit(_exitHandler);
+        _isExitHandlerRegistered = true;
+    }
+}
+
+void AsyncOutputWriter::_unregisterWriter(AsyncOutputWriter *writer) {
+    std::unique_lock<std::mutex> lock(_registryMutex);
+    _registry.erase(std::remove(_registry.begin(), _registry.end(), writer), 
+                    _registry.end());
+}
+
+void AsyncOutputWriter::_exitHandler() {
+    flushAll();
+}
@@ -0,0 +1,136 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef ASYNCOUTPUTWRITER_H
+#define ASYNCOUTPUTWRITER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "trianglemesh.h"
+#include "fluidsimassert.h"
+
+/*
+    Writes output files on a background thread.
+
+    Meshes and data buffers are moved into a queue and written in order by a 
+    single worker thread, so the caller can continue with the next time step 
+    while the previous output is serialized and written to disk. The worker 
+    thread is started on the first queued write.
+
+    The queue is bounded by the total size of the data it holds. If queuing a
+    write would exceed the limit, the caller blocks until enough queued data 
+    has been written. A write that is larger than the limit is still accepted 
+    once the queue is empty.
+
+    flush() blocks until every queued write has completed. Writers flush on 
+    destruction and any writers that are still alive are flushed when the 
+    program exits normally.
+
+    If asynchronous writing is disabled, files are written immediately on 
+    the calling thread.
+*/
+class AsyncOutputWriter
+{
+public:
+    AsyncOutputWriter();
+    ~AsyncOutputWriter();
+
+    void enableAsynchronousWrites();
+    void disableAsynchronousWrites();
+    bool isAsynchronousWritesEnabled();
+
+    void setMaxQueueSize(size_t numBytes);
+    size_t getMaxQueueSize();
+    size_t getQueueSize();
+
+    /*
+        The contents of mesh are moved into the queue.
+    */
+    void writeTriangleMesh(TriangleMesh &&mesh, 
+                           TriangleMeshFormat format, 
+                           std::string filename);
+
+    /*
+        The contents of data are moved into the queue and written as raw bytes.
+    */
+    void writeData(std::vector<char> &&data, std::string filename);
+
+    void flush();
+
+    /*
+        Flushes every writer that has not been destroyed.
+    */
+    static void flushAll();
+
+private:
+
+    AsyncOutputWriter(const AsyncOutputWriter &) = delete;
+    AsyncOutputWriter& operator=(const AsyncOutputWriter &) = delete;
+
+    enum class WriteType : char { 
+        mesh = 0x00, 
+        data = 0x01
+    };
+
+    struct WriteTask {
+        WriteType type;
+        TriangleMesh mesh;
+        TriangleMeshFormat format;
+        std::vector<char> data;
+        std::string filename;
+        size_t numBytes = 0;
+    };
+
+    void _queueTask(WriteTask &task);
+    void _executeTask(WriteTask &task);
+    void _writeDataToFile(std::vector<char> &data, std::string filename);
+    size_t _getMeshSize(TriangleMesh &mesh);
+    void _startWorker();
+    void _stopWorker();
+    void _workerLoop();
+
+    static void _registerWriter(AsyncOutputWriter *writer);
+    static void _unregisterWriter(AsyncOutputWriter *writer);
+    static void _exitHandler();
+
+    bool _isAsynchronousWritesEnabled = true;
+    size_t _maxQueueSize = 1073741824;    // 1 GB
+    size_t _queueSize = 0;
+
+    std::deque<WriteTask> _queue;
+    bool _isTaskRunning = false;
+    bool _isShutdown = false;
+    bool _isWorkerRunning = false;
+    std::thread _worker;
+    std::mutex _mutex;
+    std::condition_variable _taskCondition;
+    std::condition_variable _spaceCondition;
+    std::condition_variable _idleCondition;
+
+    static std::mutex _registryMutex;
+    static std::vector<AsyncOutputWriter*> _registry;
+    static bool _isExitHandlerRegistered;
+};
+
+#endif
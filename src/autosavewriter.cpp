@@ -0,0 +1,534 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "autosavewriter.h"
+
+#include <stdio.h>
+#include <fstream>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+    #include <io.h>
+    #include <fcntl.h>
+#else
+    #include <dirent.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+#endif
+
+AutosaveWriter::AutosaveWriter() {
+}
+
+AutosaveWriter::~AutosaveWriter() {
+    _stopWorker();
+}
+
+void AutosaveWriter::enableAsynchronousWrites() {
+    _isAsynchronousWritesEnabled = true;
+}
+
+void AutosaveWriter::disableAsynchronousWrites() {
+    flush();
+    _isAsynchronousWritesEnabled = false;
+}
+
+bool AutosaveWriter::isAsynchronousWritesEnabled() {
+    return _isAsynchronousWritesEnabled;
+}
+
+void AutosaveWriter::setNumCheckpoints(int n) {
+    FLUIDSIM_ASSERT(n >= 1);
+    std::unique_lock<std::mutex> lock(_mutex);
+    _settings.numCheckpoints = n;
+}
+
+int AutosaveWriter::getNumCheckpoints() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _settings.numCheckpoints;
+}
+
+void AutosaveWriter::enableCompression() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _settings.isCompressionEnabled = true;
+}
+
+void AutosaveWriter::disableCompression() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _settings.isCompressionEnabled = false;
+}
+
+bool AutosaveWriter::isCompressionEnabled() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _settings.isCompressionEnabled;
+}
+
+void AutosaveWriter::enableIncrementalCheckpoints() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _settings.isIncrementalCheckpointsEnabled = true;
+}
+
+void AutosaveWriter::disableIncrementalCheckpoints() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _settings.isIncrementalCheckpointsEnabled = false;
+}
+
+bool AutosaveWriter::isIncrementalCheckpointsEnabled() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _settings.isIncrementalCheckpointsEnabled;
+}
+
+void AutosaveWriter::setFullCheckpointInterval(int n) {
+    FLUIDSIM_ASSERT(n >= 1);
+    std::unique_lock<std::mutex> lock(_mutex);
+    _settings.fullCheckpointInterval = n;
+}
+
+int AutosaveWriter::getFullCheckpointInterval() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _settings.fullCheckpointInterval;
+}
+
+void AutosaveWriter::setThreadPool(ThreadPool *pool) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _settings.threadPool = pool;
+}
+
+bool AutosaveWriter::isWriting() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _isWriting;
+}
+
+FluidSimulationSaveStateSnapshot* AutosaveWriter::getSnapshot() {
+    FLUIDSIM_ASSERT(!isWriting());
+    return &_snapshot;
+}
+
+void AutosaveWriter::writeSnapshot(std::string filename) {
+    if (!_isAsynchronousWritesEnabled) {
+        FLUIDSIM_ASSERT(!isWriting());
+        _writeCheckpoint(filename, _getSettings());
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    FLUIDSIM_ASSERT(!_isWriting);
+    if (!_isWorkerRunning) {
+        _startWorker();
+    }
+
+    _filename = filename;
+    _isWritePending = true;
+    _isWriting = true;
+    lock.unlock();
+    _taskCondition.notify_one();
+}
+
+void AutosaveWriter::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idleCondition.wait(lock, [this]() { 
+        return !_isWriting; 
+    });
+}
+
+AutosaveWriter::CheckpointSettings AutosaveWriter::_getSettings() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _settings;
+}
+
+void AutosaveWriter::_writeCheckpoint(std::string filename, CheckpointSettings settings) {
+    if (!_isCheckpointHistoryInitialized) {
+        _initializeCheckpointHistory(filename, settings.numCheckpoints);
+        _isCheckpointHistoryInitialized = true;
+    }
+
+    std::string tempfilename = filename + ".tmp";
+
+    FluidSimulationSaveState state;
+    state.setThreadPool(settings.threadPool);
+    if (settings.isCompressionEnabled) {
+        state.enableCompression();
+    }
+
+    std::string baseFilename;
+    if (settings.isIncrementalCheckpointsEnabled) {
+        _writeIncrementalCheckpoint(tempfilename, filename, settings, state);
+        baseFilename = _baseFilename;
+    } else {
+        state.saveState(tempfilename, _snapshot);
+    }
+    _syncFile(tempfilename);
+
+    _rotateCheckpoints(filename, settings.numCheckpoints);
+
+    int error = rename(tempfilename.c_str(), filename.c_str());
+    FLUIDSIM_ASSERT(error == 0);
+
+    _syncDirectory(_getDirectory(filename));
+
+    _removeUnusedFullCheckpoints(baseFilename, settings.numCheckpoints);
+}
+
+void AutosaveWriter::_writeIncrementalCheckpoint(std::string tempfilename, 
+                                                 std::string filename,
+                                                 CheckpointSettings settings,
+                                                 FluidSimulationSaveState &state) {
+    typedef FluidSimulationSaveState::SaveStateSection SaveStateSection;
+
+    std::vector<SaveStateSection> referencedSections;
+    if (_isFullCheckpointRequired(settings)) {
+        _writeFullCheckpoint(filename, state);
+
+        // The checkpoint is identical to the full checkpoint
+        referencedSections = {
+            SaveStateSection::markerParticlePositions,
+            SaveStateSection::markerParticleVelocities,
+            SaveStateSection::diffuseParticlePositions,
+            SaveStateSection::diffuseParticleVelocities,
+            SaveStateSection::diffuseParticleLifetimes,
+            SaveStateSection::diffuseParticleTypes,
+            SaveStateSection::solidCells,
+            SaveStateSection::fluidBrickGrid
+        };
+    } else {
+        referencedSections.push_back(SaveStateSection::solidCells);
+    }
+    _numCheckpointsSinceFull++;
+
+    state.saveState(tempfilename, _snapshot, _baseFilename, referencedSections);
+}
+
+void AutosaveWriter::_writeFullCheckpoint(std::string filename, 
+                                          FluidSimulationSaveState &state) {
+    std::string fullfilename = _getFullCheckpointFilename(filename, _snapshot.currentFrame);
+    std::string tempfilename = fullfilename + ".tmp";
+
+    state.saveState(tempfilename, _snapshot);
+    _syncFile(tempfilename);
+
+    int error = rename(tempfilename.c_str(), fullfilename.c_str());
+    FLUIDSIM_ASSERT(error == 0);
+
+    _syncDirectory(_getDirectory(fullfilename));
+
+    _baseFilename = fullfilename;
+    _baseSolidCells = _snapshot.solidCells;
+    _baseIsize = _snapshot.isize;
+    _baseJsize = _snapshot.jsize;
+    _baseKsize = _snapshot.ksize;
+    _baseDx = _snapshot.dx;
+    _numCheckpointsSinceFull = 0;
+    _fullCheckpointFilenames.push_back(fullfilename);
+}
+
+bool AutosaveWriter::_isFullCheckpointRequired(CheckpointSettings settings) {
+    if (_baseFilename.empty() || 
+            _numCheckpointsSinceFull >= settings.fullCheckpointInterval) {
+        return true;
+    }
+
+    if (_snapshot.isize != _baseIsize || _snapshot.jsize != _baseJsize || 
+            _snapshot.ksize != _baseKsize || _snapshot.dx != _baseDx) {
+        return true;
+    }
+
+    return _snapshot.solidCells != _baseSolidCells || !_isFile(_baseFilename);
+}
+
+/*
+    Full checkpoints and checkpoints may have been left in the directory by 
+    an earlier process, for example before a simulation was resumed. The 
+    base referenced by each kept checkpoint is read from its header and all 
+    full checkpoints on disk are tracked, so that full checkpoints that are
+    no longer referenced are removed by the next write.
+*/
+void AutosaveWriter::_initializeCheckpointHistory(std::string filename, 
+                                                  int numCheckpoints) {
+    _checkpointBaseFilenames.clear();
+    for (int i = 0; i < numCheckpoints; i++) {
+        std::string f = _getCheckpointFilename(filename, i);
+        _checkpointBaseFilenames.push_back(
+                FluidSimulationSaveState::getBaseStateFilename(f));
+    }
+
+    _fullCheckpointFilenames.clear();
+    _findFullCheckpoints(filename, _fullCheckpointFilenames);
+}
+
+/*
+    Finds files named "autosave.full.<frame>.state" or 
+    "autosave.full.<frame>.<n>.state" in the directory of the checkpoint.
+*/
+void AutosaveWriter::_findFullCheckpoints(std::string filename, 
+                                          std::vector<std::string> &fullfilenames) {
+    std::string directory = _getDirectory(filename);
+    std::string name = _getFilename(filename);
+    size_t extpos = name.find_last_of('.');
+    if (extpos == std::string::npos) {
+        extpos = name.size();
+    }
+    std::string prefix = name.substr(0, extpos) + ".full.";
+    std::string extension = name.substr(extpos);
+
+    std::vector<std::string> names;
+    #ifdef _WIN32
+        WIN32_FIND_DATAA data;
+        std::string pattern = directory + "/" + prefix + "*";
+        HANDLE handle = FindFirstFileA(pattern.c_str(), &data);
+        if (handle != INVALID_HANDLE_VALUE) {
+            do {
+                names.push_back(data.cFileName);
+            } while (FindNextFileA(handle, &data));
+            FindClose(handle);
+        }
+    #else
+        DIR *dir = opendir(directory.c_str());
+        if (dir != nullptr) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != nullptr) {
+                names.push_back(entry->d_name);
+            }
+            closedir(dir);
+        }
+    #endif
+
+    for (size_t i = 0; i < names.size(); i++) {
+        std::string n = names[i];
+        if (n.size() <= prefix.size() + extension.size() ||
+                n.compare(0, prefix.size(), prefix) != 0 ||
+                n.compare(n.size() - extension.size(), extension.size(), extension) != 0) {
+            continue;
+        }
+
+        std::string frame = n.substr(prefix.size(), 
+                                     n.size() - prefix.size() - extension.size());
+        if (frame.find_first_not_of("0123456789.") == std::string::npos) {
+            fullfilenames.push_back(directory + "/" + n);
+        }
+    }
+}
+
+/*
+    Removes full checkpoints that are no longer referenced by a kept 
+    checkpoint. The latest full checkpoint is always kept so that it can be 
+    referenced by the next checkpoint. Full checkpoints are in the same
+    directory as the checkpoints, so they are compared by filename.
+*/
+void AutosaveWriter::_removeUnusedFullCheckpoints(std::string baseFilename, 
+                                                  int numCheckpoints) {
+    _checkpointBaseFilenames.insert(_checkpointBaseFilenames.begin(), baseFilename);
+    if ((int)_checkpointBaseFilenames.size() > numCheckpoints) {
+        _checkpointBaseFilenames.resize(numCheckpoints);
+    }
+
+    std::vector<std::string> fullCheckpointFilenames;
+    for (size_t i = 0; i < _fullCheckpointFilenames.size(); i++) {
+        std::string f = _fullCheckpointFilenames[i];
+        bool isReferenced = false;
+        for (size_t j = 0; j < _checkpointBaseFilenames.size(); j++) {
+            if (!_checkpointBaseFilenames[j].empty() &&
+                    _getFilename(_checkpointBaseFilenames[j]) == _getFilename(f)) {
+                isReferenced = true;
+                break;
+            }
+        }
+
+        if (isReferenced || (!_baseFilename.empty() && 
+                             _getFilename(f) == _getFilename(_baseFilename))) {
+            fullCheckpointFilenames.push_back(f);
+        } else {
+            remove(f.c_str());
+        }
+    }
+
+    _fullCheckpointFilenames = fullCheckpointFilenames;
+}
+
+/*
+    Shifts each existing checkpoint one place towards the oldest position,
+    discarding the oldest checkpoint. The latest checkpoint is only moved
+    if it will be kept.
+*/
+void AutosaveWriter::_rotateCheckpoints(std::string filename, int numCheckpoints) {
+    for (int i = numCheckpoints - 1; i >= 1; i--) {
+        std::string src = _getCheckpointFilename(filename, i - 1);
+        if (!_isFile(src)) {
+            continue;
+        }
+
+        std::string dst = _getCheckpointFilename(filename, i);
+        #ifdef _WIN32
+            remove(dst.c_str());
+        #endif
+        int error = rename(src.c_str(), dst.c_str());
+        FLUIDSIM_ASSERT(error == 0);
+    }
+
+    #ifdef _WIN32
+        remove(filename.c_str());
+    #endif
+}
+
+/*
+    Index 0 is the filename itself. Other indices are inserted before the
+    file extension: "autosave.state" -> "autosave.1.state"
+*/
+std::string AutosaveWriter::_getCheckpointFilename(std::string filename, int idx) {
+    if (idx == 0) {
+        return filename;
+    }
+
+    return _insertBeforeExtension(filename, std::to_string(idx));
+}
+
+/*
+    "autosave.state" -> "autosave.full.<frame>.state". A number is appended 
+    to the frame if a file of that name already exists, for example when a
+    simulation is resumed from an earlier frame.
+*/
+std::string AutosaveWriter::_getFullCheckpointFilename(std::string filename, int frame) {
+    std::string name = "full." + std::to_string(frame);
+    std::string fullfilename = _insertBeforeExtension(filename, name);
+    for (int i = 1; _isFile(fullfilename); i++) {
+        fullfilename = _insertBeforeExtension(filename, name + "." + std::to_string(i));
+    }
+
+    return fullfilename;
+}
+
+std::string AutosaveWriter::_insertBeforeExtension(std::string filename, std::string str) {
+    size_t extpos = filename.find_last_of('.');
+    size_t dirpos = filename.find_last_of("/\\");
+    if (extpos == std::string::npos || 
+            (dirpos != std::string::npos && extpos < dirpos)) {
+        return filename + "." + str;
+    }
+
+    return filename.substr(0, extpos) + "." + str + filename.substr(extpos);
+}
+
+std::string AutosaveWriter::_getDirectory(std::string filename) {
+    size_t dirpos = filename.find_last_of("/\\");
+    if (dirpos == std::string::npos) {
+        return ".";
+    }
+
+    return filename.substr(0, dirpos);
+}
+
+std::string AutosaveWriter::_getFilename(std::string filename) {
+    size_t dirpos = filename.find_last_of("/\\");
+    if (dirpos == std::string::npos) {
+        return filename;
+    }
+
+    return filename.substr(dirpos + 1);
+}
+
+bool AutosaveWriter::_isFile(std::string filename) {
+    std::ifstream file(filename.c_str());
+    return file.good();
+}
+
+void AutosaveWriter::_syncFile(std::string filename) {
+    #ifdef _WIN32
+        int fd = _open(filename.c_str(), _O_RDWR | _O_BINARY);
+        if (fd != -1) {
+            _commit(fd);
+            _close(fd);
+        }
+    #else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd != -1) {
+            fsync(fd);
+            close(fd);
+        }
+    #endif
+}
+
+/*
+    Makes the rename durable. Directories cannot be synced on Windows, where 
+    a rename is committed by the file system.
+*/
+void AutosaveWriter::_syncDirectory(std::string directory) {
+    #ifndef _WIN32
+        int fd = open(directory.c_str(), O_RDONLY);
+        if (fd != -1) {
+            fsync(fd);
+            close(fd);
+        }
+    #else
+        (void)directory;
+    #endif
+}
+
+void AutosaveWriter::_startWorker() {
+    _isShutdown = false;
+    _worker = std::thread(&AutosaveWriter::_workerLoop, this);
+    _isWorkerRunning = true;
+}
+
+void AutosaveWriter::_stopWorker() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (!_isWorkerRunning) {
+        return;
+    }
+    _isShutdown = true;
+    lock.unlock();
+    _taskCondition.notify_all();
+
+    _worker.join();
+
+    lock.lock();
+    _isWorkerRunning = false;
+}
+
+/*
+    The worker exits on shutdown only after a pending write has completed.
+*/
+void AutosaveWriter::_workerLoop() {
+    for (;;) {
+        std::string filename;
+        CheckpointSettings settings;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _taskCondition.wait(lock, [this]() { 
+                return _isShutdown || _isWritePending; 
+            });
+
+            if (!_isWritePending) {
+                return;
+            }
+
+            filename = _filename;
+            settings = _settings;
+            _isWritePending = false;
+        }
+
+        _writeCheckpoint(filename, settings);
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _isWriting = false;
+        }
+        _idleCondition.notify_all();
+    }
+}
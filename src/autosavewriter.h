@@ -0,0 +1,167 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef AUTOSAVEWRITER_H
+#define AUTOSAVEWRITER_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "fluidsimulationsavestate.h"
+#include "fluidsimassert.h"
+#include "threadpool.h"
+
+/*
+    Writes autosave states on a background thread.
+
+    The writer owns a single FluidSimulationSaveStateSnapshot. The caller 
+    fills the snapshot returned by getSnapshot() and then calls 
+    writeSnapshot(), which returns immediately while the save state is 
+    written by a worker thread. The snapshot may not be modified again until 
+    isWriting() returns false. The snapshot is reused between writes so that 
+    its buffers only need to be allocated once.
+
+    A save state is first written to a temporary file in the same directory 
+    and synced to disk. The previous checkpoints are then rotated and the 
+    temporary file is renamed to the checkpoint filename, so a partially 
+    written save state never replaces a complete one. With n checkpoints,
+    "autosave.state" holds the latest save state and "autosave.1.state" 
+    through "autosave.<n-1>.state" hold the previous ones, oldest last.
+
+    If incremental checkpoints are enabled, a complete save state is only 
+    written every n checkpoints, or when the solid cells have changed, to a 
+    file named after its frame, such as "autosave.full.120.state". The
+    checkpoints are then delta save states that store the solid cells by
+    reference to the latest full checkpoint. The checkpoint written together
+    with a full checkpoint stores all of its sections by reference. A full 
+    checkpoint is removed once no kept checkpoint refers to it, including
+    full checkpoints left in the directory by an earlier process.
+
+    If asynchronous writing is disabled, writeSnapshot() writes the save 
+    state on the calling thread.
+*/
+class AutosaveWriter
+{
+public:
+    AutosaveWriter();
+    ~AutosaveWriter();
+
+    void enableAsynchronousWrites();
+    void disableAsynchronousWrites();
+    bool isAsynchronousWritesEnabled();
+
+    void setNumCheckpoints(int n);
+    int getNumCheckpoints();
+
+    void enableCompression();
+    void disableCompression();
+    bool isCompressionEnabled();
+
+    void enableIncrementalCheckpoints();
+    void disableIncrementalCheckpoints();
+    bool isIncrementalCheckpointsEnabled();
+
+    void setFullCheckpointInterval(int n);
+    int getFullCheckpointInterval();
+
+    /*
+        Thread pool used to compress save states. A write that starts while 
+        the pool is busy with another batch compresses serially. The pool 
+        must not be destroyed while a write is in progress.
+    */
+    void setThreadPool(ThreadPool *pool);
+
+    bool isWriting();
+    FluidSimulationSaveStateSnapshot* getSnapshot();
+    void writeSnapshot(std::string filename);
+
+    /*
+        Blocks until the current write has completed.
+    */
+    void flush();
+
+private:
+
+    struct CheckpointSettings {
+        int numCheckpoints = 2;
+        bool isCompressionEnabled = false;
+        bool isIncrementalCheckpointsEnabled = false;
+        int fullCheckpointInterval = 10;
+        ThreadPool *threadPool = nullptr;
+    };
+
+    AutosaveWriter(const AutosaveWriter &) = delete;
+    AutosaveWriter& operator=(const AutosaveWriter &) = delete;
+
+    CheckpointSettings _getSettings();
+    void _writeCheckpoint(std::string filename, CheckpointSettings settings);
+    void _writeIncrementalCheckpoint(std::string tempfilename, std::string filename,
+                                     CheckpointSettings settings,
+                                     FluidSimulationSaveState &state);
+    void _writeFullCheckpoint(std::string filename, FluidSimulationSaveState &state);
+    bool _isFullCheckpointRequired(CheckpointSettings settings);
+    void _initializeCheckpointHistory(std::string filename, int numCheckpoints);
+    void _findFullCheckpoints(std::string filename, 
+                              std::vector<std::string> &fullfilenames);
+    void _removeUnusedFullCheckpoints(std::string baseFilename, int numCheckpoints);
+    void _rotateCheckpoints(std::string filename, int numCheckpoints);
+    std::string _getCheckpointFilename(std::string filename, int idx);
+    std::string _getFullCheckpointFilename(std::string filename, int frame);
+    std::string _insertBeforeExtension(std::string filename, std::string str);
+    std::string _getDirectory(std::string filename);
+    std::string _getFilename(std::string filename);
+    bool _isFile(std::string filename);
+    void _syncFile(std::string filename);
+    void _syncDirectory(std::string directory);
+    void _startWorker();
+    void _stopWorker();
+    void _workerLoop();
+
+    bool _isAsynchronousWritesEnabled = true;
+    CheckpointSettings _settings;
+
+    // Incremental checkpoint state, only accessed by the writing thread
+    std::string _baseFilename;
+    std::vector<GridIndex> _baseSolidCells;
+    int _baseIsize = 0;
+    int _baseJsize = 0;
+    int _baseKsize = 0;
+    double _baseDx = 0.0;
+    int _numCheckpointsSinceFull = 0;
+    std::vector<std::string> _checkpointBaseFilenames;
+    std::vector<std::string> _fullCheckpointFilenames;
+    bool _isCheckpointHistoryInitialized = false;
+
+    FluidSimulationSaveStateSnapshot _snapshot;
+    std::string _filename;
+    bool _isWritePending = false;
+    bool _isWriting = false;
+
+    bool _isShutdown = false;
+    bool _isWorkerRunning = false;
+    std::thread _worker;
+    std::mutex _mutex;
+    std::condition_variable _taskCondition;
+    std::condition_variable _idleCondition;
+};
+
+#endif
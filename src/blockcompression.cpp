@@ -0,0 +1,273 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "blockcompression.h"
+
+#include <cstring>
+#include <vector>
+
+namespace BlockCompression {
+
+static const int MIN_MATCH = 4;
+static const size_t MAX_OFFSET = 65535;
+static const int HASH_BITS = 16;
+
+// Matches may not start in the last 12 bytes or extend into the last 5 
+// bytes of the input so that the final sequence always holds literals
+static const size_t MATCH_START_LIMIT = 12;
+static const size_t MATCH_END_LIMIT = 5;
+
+void shuffle(const char *src, char *dst, size_t numBytes, size_t wordSize) {
+    if (numBytes == 0) {
+        return;
+    }
+
+    if (wordSize <= 1) {
+        memcpy(dst, src, numBytes);
+        return;
+    }
+
+    size_t numWords = numBytes / wordSize;
+    for (size_t b = 0; b < wordSize; b++) {
+        char *out = dst + b*numWords;
+        const char *in = src + b;
+        for (size_t w = 0; w < numWords; w++) {
+            out[w] = in[w*wordSize];
+        }
+    }
+
+    size_t tail = numWords*wordSize;
+    memcpy(dst + tail, src + tail, numBytes - tail);
+}
+
+void unshuffle(const char *src, char *dst, size_t numBytes, size_t wordSize) {
+    if (numBytes == 0) {
+        return;
+    }
+
+    if (wordSize <= 1) {
+        memcpy(dst, src, numBytes);
+        return;
+    }
+
+    size_t numWords = numBytes / wordSize;
+    for (size_t b = 0; b < wordSize; b++) {
+        const char *in = src + b*numWords;
+        char *out = dst + b;
+        for (size_t w = 0; w < numWords; w++) {
+            out[w*wordSize] = in[w];
+        }
+    }
+
+    size_t tail = numWords*wordSize;
+    memcpy(dst + tail, src + tail, numBytes - tail);
+}
+
+size_t getMaxCompressedSize(size_t numBytes) {
+    return numBytes + numBytes / 255 + 16;
+}
+
+inline unsigned int _read32(const unsigned char *p) {
+    unsigned int v;
+    memcpy(&v, p, sizeof(unsigned int));
+    return v;
+}
+
+inline unsigned int _hash(unsigned int v) {
+    return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+inline bool _writeLength(size_t length, unsigned char **op, unsigned char *oend) {
+    while (length >= 255) {
+        if (*op >= oend) {
+            return false;
+        }
+        *(*op)++ = 255;
+        length -= 255;
+    }
+
+    if (*op >= oend) {
+        return false;
+    }
+    *(*op)++ = (unsigned char)length;
+
+    return true;
+}
+
+inline bool _writeSequence(const unsigned char *literals, size_t numLiterals,
+                           size_t offset, size_t matchLength, bool isLastSequence,
+                           unsigned char **op, unsigned char *oend) {
+    if (*op >= oend) {
+        return false;
+    }
+
+    size_t matchCode = isLastSequence ? 0 : matchLength - MIN_MATCH;
+    unsigned char *token = (*op)++;
+    *token = (unsigned char)(((numLiterals < 15 ? numLiterals : 15) << 4) | 
+                             (matchCode < 15 ? matchCode : 15));
+
+    if (numLiterals >= 15 && !_writeLength(numLiterals - 15, op, oend)) {
+        return false;
+    }
+
+    if ((size_t)(oend - *op) < numLiterals) {
+        return false;
+    }
+    if (numLiterals > 0) {
+        memcpy(*op, literals, numLiterals);
+    }
+    *op += numLiterals;
+
+    if (isLastSequence) {
+        return true;
+    }
+
+    if (oend - *op < 2) {
+        return false;
+    }
+    *(*op)++ = (unsigned char)(offset & 0xFF);
+    *(*op)++ = (unsigned char)(offset >> 8);
+
+    if (matchCode >= 15 && !_writeLength(matchCode - 15, op, oend)) {
+        return false;
+    }
+
+    return true;
+}
+
+size_t compress(const char *src, size_t srcSize, char *dst, size_t dstCapacity) {
+    const unsigned char *input = (const unsigned char *)src;
+    unsigned char *op = (unsigned char *)dst;
+    unsigned char *oend = op + dstCapacity;
+
+    size_t anchor = 0;
+    if (srcSize > MATCH_START_LIMIT) {
+        std::vector<int> table((size_t)1 << HASH_BITS, -1);
+        size_t startLimit = srcSize - MATCH_START_LIMIT;
+        size_t endLimit = srcSize - MATCH_END_LIMIT;
+
+        size_t ip = 0;
+        while (ip < startLimit) {
+            unsigned int sequence = _read32(input + ip);
+            unsigned int h = _hash(sequence);
+            int ref = table[h];
+            table[h] = (int)ip;
+
+            if (ref < 0 || ip - ref > MAX_OFFSET || _read32(input + ref) != sequence) {
+                // Skip faster through data that does not compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            size_t length = MIN_MATCH;
+            while (ip + length < endLimit && input[ref + length] == input[ip + length]) {
+                length++;
+            }
+
+            if (!_writeSequence(input + anchor, ip - anchor, ip - ref, length, 
+                                false, &op, oend)) {
+                return 0;
+            }
+
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    if (!_writeSequence(input + anchor, srcSize - anchor, 0, 0, true, &op, oend)) {
+        return 0;
+    }
+
+    return op - (unsigned char *)dst;
+}
+
+inline bool _readLength(size_t *length, const unsigned char **ip, 
+                        const unsigned char *iend) {
+    unsigned char b;
+    do {
+        if (*ip >= iend) {
+            return false;
+        }
+        b = *(*ip)++;
+        *length += b;
+    } while (b == 255);
+
+    return true;
+}
+
+bool decompress(const char *src, size_t srcSize, char *dst, size_t dstSize) {
+    const unsigned char *ip = (const unsigned char *)src;
+    const unsigned char *iend = ip + srcSize;
+    unsigned char *ostart = (unsigned char *)dst;
+    unsigned char *op = ostart;
+    unsigned char *oend = op + dstSize;
+
+    while (ip < iend) {
+        unsigned char token = *ip++;
+
+        size_t numLiterals = token >> 4;
+        if (numLiterals == 15 && !_readLength(&numLiterals, &ip, iend)) {
+            return false;
+        }
+
+        if ((size_t)(iend - ip) < numLiterals || (size_t)(oend - op) < numLiterals) {
+            return false;
+        }
+        if (numLiterals > 0) {
+            memcpy(op, ip, numLiterals);
+        }
+        ip += numLiterals;
+        op += numLiterals;
+
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+
+        size_t length = token & 0x0F;
+        if (length == 15 && !_readLength(&length, &ip, iend)) {
+            return false;
+        }
+        length += MIN_MATCH;
+
+        if (offset == 0 || offset > (size_t)(op - ostart) || 
+                (size_t)(oend - op) < length) {
+            return false;
+        }
+
+        const unsigned char *match = op - offset;
+        if (offset >= length) {
+            memcpy(op, match, length);
+            op += length;
+        } else {
+            for (size_t i = 0; i < length; i++) {
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op == oend;
+}
+
+}
@@ -0,0 +1,61 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef BLOCKCOMPRESSION_H
+#define BLOCKCOMPRESSION_H
+
+#include <stddef.h>
+
+/*
+    Lossless compression of binary data blocks.
+
+    shuffle() transposes the bytes of fixed width words so that the i-th 
+    byte of every word is stored contiguously. For float data the sign and 
+    exponent bytes become long runs of similar values that compress well.
+
+    compress() is a byte oriented LZ77 codec in the style of LZ4. Each 
+    sequence consists of a token byte holding the literal length and match 
+    length, extended lengths, the literal bytes and a 2 byte match offset. 
+    The final sequence holds only literals. The codec favours speed over 
+    compression ratio.
+*/
+namespace BlockCompression {
+
+    extern void shuffle(const char *src, char *dst, size_t numBytes, size_t wordSize);
+    extern void unshuffle(const char *src, char *dst, size_t numBytes, size_t wordSize);
+
+    extern size_t getMaxCompressedSize(size_t numBytes);
+
+    /*
+        Returns the compressed size, or 0 if the compressed data does not 
+        fit in dstCapacity bytes.
+    */
+    extern size_t compress(const char *src, size_t srcSize, 
+                           char *dst, size_t dstCapacity);
+
+    /*
+        Returns false if the compressed data is malformed or does not 
+        decompress to exactly dstSize bytes.
+    */
+    extern bool decompress(const char *src, size_t srcSize, 
+                           char *dst, size_t dstSize);
+
+}
+
+#endif
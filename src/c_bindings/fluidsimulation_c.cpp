@@ -233,6 +233,42 @@ extern "C" {
         );
     }
 
+    EXPORTDLL long long FluidSimulation_get_max_polygonizer_memory(FluidSimulation* obj, 
+                                                                   int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::getMaxPolygonizerMemory, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_set_max_polygonizer_memory(FluidSimulation* obj, 
+                                                              long long bytes,
+                                                              int *err) {
+        CBindings::safe_execute_method_void_1param(
+            obj, &FluidSimulation::setMaxPolygonizerMemory, bytes, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_enable_sparse_surface_reconstruction(FluidSimulation* obj,
+                                                                        int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enableSparseSurfaceReconstruction, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_sparse_surface_reconstruction(FluidSimulation* obj,
+                                                                         int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disableSparseSurfaceReconstruction, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_sparse_surface_reconstruction_enabled(FluidSimulation* obj,
+                                                                           int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isSparseSurfaceReconstructionEnabled, err
+        );
+    }
+
     EXPORTDLL int FluidSimulation_get_min_polyhedron_triangle_count(FluidSimulation* obj, 
                                                                     int *err) {
         return CBindings::safe_execute_method_ret_0param(
@@ -363,6 +399,27 @@ extern "C" {
         );
     }
 
+    EXPORTDLL void FluidSimulation_enable_levelset_fast_sweeping(FluidSimulation* obj,
+                                                                 int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enableLevelSetFastSweeping, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_levelset_fast_sweeping(FluidSimulation* obj,
+                                                                  int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disableLevelSetFastSweeping, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_levelset_fast_sweeping_enabled(FluidSimulation* obj,
+                                                                    int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isLevelSetFastSweepingEnabled, err
+        );
+    }
+
     EXPORTDLL void FluidSimulation_enable_diffuse_material_output(FluidSimulation* obj,
                                                                   int *err) {
         CBindings::safe_execute_method_void_0param(
@@ -561,6 +618,169 @@ extern "C" {
         );
     }
 
+    EXPORTDLL void FluidSimulation_enable_asynchronous_autosave(FluidSimulation* obj, 
+                                                                int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enableAsynchronousAutosave, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_asynchronous_autosave(FluidSimulation* obj,
+                                                                 int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disableAsynchronousAutosave, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_asynchronous_autosave_enabled(FluidSimulation* obj,
+                                                                   int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isAsynchronousAutosaveEnabled, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_flush_autosave(FluidSimulation* obj,
+                                                  int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::flushAutosave, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_get_num_autosave_checkpoints(FluidSimulation* obj, 
+                                                               int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::getNumAutosaveCheckpoints, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_set_num_autosave_checkpoints(FluidSimulation* obj, 
+                                                                int n,
+                                                                int *err) {
+        CBindings::safe_execute_method_void_1param(
+            obj, &FluidSimulation::setNumAutosaveCheckpoints, n, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_enable_incremental_autosave(FluidSimulation* obj, 
+                                                               int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enableIncrementalAutosave, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_incremental_autosave(FluidSimulation* obj,
+                                                                int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disableIncrementalAutosave, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_incremental_autosave_enabled(FluidSimulation* obj,
+                                                                  int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isIncrementalAutosaveEnabled, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_get_autosave_full_checkpoint_interval(
+            FluidSimulation* obj, int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::getAutosaveFullCheckpointInterval, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_set_autosave_full_checkpoint_interval(
+            FluidSimulation* obj, int n, int *err) {
+        CBindings::safe_execute_method_void_1param(
+            obj, &FluidSimulation::setAutosaveFullCheckpointInterval, n, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_enable_savestate_compression(FluidSimulation* obj, 
+                                                                int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enableSaveStateCompression, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_savestate_compression(FluidSimulation* obj,
+                                                                 int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disableSaveStateCompression, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_savestate_compression_enabled(FluidSimulation* obj,
+                                                                   int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isSaveStateCompressionEnabled, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_enable_asynchronous_output(FluidSimulation* obj, 
+                                                              int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enableAsynchronousOutput, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_asynchronous_output(FluidSimulation* obj,
+                                                               int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disableAsynchronousOutput, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_asynchronous_output_enabled(FluidSimulation* obj,
+                                                                 int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isAsynchronousOutputEnabled, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_flush_output(FluidSimulation* obj,
+                                                int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::flushOutput, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_get_max_output_queue_size(FluidSimulation* obj, 
+                                                            int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::getMaxOutputQueueSize, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_set_max_output_queue_size(FluidSimulation* obj, 
+                                                             int megabytes,
+                                                             int *err) {
+        CBindings::safe_execute_method_void_1param(
+            obj, &FluidSimulation::setMaxOutputQueueSize, megabytes, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_set_compute_backend_as_opencl(FluidSimulation* obj,
+                                                                 int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::setComputeBackendAsOpenCL, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_set_compute_backend_as_threaded(FluidSimulation* obj,
+                                                                   int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::setComputeBackendAsThreaded, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_set_compute_backend_as_serial(FluidSimulation* obj,
+                                                                 int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::setComputeBackendAsSerial, err
+        );
+    }
+
     EXPORTDLL void FluidSimulation_enable_opencl_particle_advection(FluidSimulation* obj, 
                                                    int *err) {
         CBindings::safe_execute_method_void_0param(
@@ -635,6 +855,147 @@ extern "C" {
         );
     }
 
+    EXPORTDLL int FluidSimulation_get_num_threads(FluidSimulation* obj, 
+                                                  int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::getNumThreads, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_set_num_threads(FluidSimulation* obj, 
+                                                   int n,
+                                                   int *err) {
+        CBindings::safe_execute_method_void_1param(
+            obj, &FluidSimulation::setNumThreads, n, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_enable_multithreaded_pressure_solver(FluidSimulation* obj,
+                                                  int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enableMultithreadedPressureSolver, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_multithreaded_pressure_solver(FluidSimulation* obj,
+                                                   int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disableMultithreadedPressureSolver, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_multithreaded_pressure_solver_enabled(FluidSimulation* obj,
+                                                     int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isMultithreadedPressureSolverEnabled, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_enable_deterministic_pressure_solver_reduction(FluidSimulation* obj,
+                                                  int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enableDeterministicPressureSolverReduction, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_deterministic_pressure_solver_reduction(FluidSimulation* obj,
+                                                   int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disableDeterministicPressureSolverReduction, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_deterministic_pressure_solver_reduction_enabled(FluidSimulation* obj,
+                                                     int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isDeterministicPressureSolverReductionEnabled, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_enable_multigrid_pressure_solver(FluidSimulation* obj,
+                                                  int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enableMultigridPressureSolver, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_multigrid_pressure_solver(FluidSimulation* obj,
+                                                   int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disableMultigridPressureSolver, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_multigrid_pressure_solver_enabled(FluidSimulation* obj,
+                                                     int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isMultigridPressureSolverEnabled, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_enable_pressure_solver_warm_start(FluidSimulation* obj,
+                                                  int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enablePressureSolverWarmStart, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_pressure_solver_warm_start(FluidSimulation* obj,
+                                                   int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disablePressureSolverWarmStart, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_pressure_solver_warm_start_enabled(FluidSimulation* obj,
+                                                     int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isPressureSolverWarmStartEnabled, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_get_pressure_solver_iteration_count(
+            FluidSimulation* obj, int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::getPressureSolverIterationCount, err
+        );
+    }
+
+    EXPORTDLL double FluidSimulation_get_pressure_solver_initial_residual(
+            FluidSimulation* obj, int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::getPressureSolverInitialResidual, err
+        );
+    }
+
+    EXPORTDLL double FluidSimulation_get_pressure_solver_residual(
+            FluidSimulation* obj, int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::getPressureSolverResidual, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_enable_matrix_free_pressure_operator(FluidSimulation* obj,
+                                                  int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::enableMatrixFreePressureOperator, err
+        );
+    }
+
+    EXPORTDLL void FluidSimulation_disable_matrix_free_pressure_operator(FluidSimulation* obj,
+                                                   int *err) {
+        CBindings::safe_execute_method_void_0param(
+            obj, &FluidSimulation::disableMatrixFreePressureOperator, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulation_is_matrix_free_pressure_operator_enabled(FluidSimulation* obj,
+                                                     int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulation::isMatrixFreePressureOperatorEnabled, err
+        );
+    }
+
     EXPORTDLL void FluidSimulation_add_body_force(FluidSimulation* obj,
                                                   double fx, double fy, double fz,
                                                   int *err) {
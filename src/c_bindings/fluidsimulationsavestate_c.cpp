@@ -221,6 +221,29 @@ extern "C" {
         );
     }
 
+    EXPORTDLL int FluidSimulationSaveState_get_version(FluidSimulationSaveState* obj,
+                                                       int *err) {
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulationSaveState::getVersion, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulationSaveState_verify_checksums(
+            FluidSimulationSaveState* obj, int *err) {
+
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulationSaveState::verifyChecksums, err
+        );
+    }
+
+    EXPORTDLL int FluidSimulationSaveState_is_delta_state(
+            FluidSimulationSaveState* obj, int *err) {
+
+        return CBindings::safe_execute_method_ret_0param(
+            obj, &FluidSimulationSaveState::isDeltaState, err
+        );
+    }
+
     EXPORTDLL int FluidSimulationSaveState_is_load_state_initialized(
             FluidSimulationSaveState* obj, int *err) {
 
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <iostream>
+#include <limits>
 
 #include "../utils.h"
 
@@ -0,0 +1,181 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifdef __GNUC__
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+#include "clbufferpool.h"
+
+#if CONFIG_WITH_OPENCL
+
+CLBufferPool::CLBufferPool() {
+}
+
+CLBufferPool::~CLBufferPool() {
+    clear();
+}
+
+void CLBufferPool::initialize(OpenCLDevice *device) {
+    clear();
+    _device = device;
+}
+
+bool CLBufferPool::isInitialized() {
+    return _device != nullptr && _device->isInitialized();
+}
+
+void* CLBufferPool::reserve(int id, size_t numBytes, cl_mem_flags flags) {
+    FLUIDSIM_ASSERT(isInitialized());
+
+    PinnedBuffer *b = _getPinnedBuffer(id);
+    if (b->capacity < numBytes || b->flags != flags) {
+        if (b->hostPtr != nullptr) {
+            unmapBuffer(id);
+        }
+
+        size_t capacity = (size_t)(_capacityGrowthFactor * b->capacity);
+        if (capacity < numBytes || b->flags != flags) {
+            capacity = numBytes;
+        }
+        _allocateBuffer(b, capacity, flags);
+    }
+
+    if (b->hostPtr == nullptr) {
+        cl_int err;
+        b->hostPtr = _device->getCommandQueue().enqueueMapBuffer(b->buffer, 
+                                                                 CL_TRUE,
+                                                                 getWriteMapFlags(),
+                                                                 0, 
+                                                                 b->capacity,
+                                                                 NULL,
+                                                                 NULL,
+                                                                 &err);
+        OpenCLDevice::checkError(err, "CommandQueue::enqueueMapBuffer()");
+    }
+
+    return b->hostPtr;
+}
+
+cl::Buffer& CLBufferPool::getBuffer(int id) {
+    return _getPinnedBuffer(id)->buffer;
+}
+
+void* CLBufferPool::getHostPointer(int id) {
+    return _getPinnedBuffer(id)->hostPtr;
+}
+
+bool CLBufferPool::isMapped(int id) {
+    return _getPinnedBuffer(id)->hostPtr != nullptr;
+}
+
+void CLBufferPool::mapBuffer(int id, cl_map_flags flags, cl::Event *event) {
+    FLUIDSIM_ASSERT(isInitialized());
+
+    PinnedBuffer *b = _getPinnedBuffer(id);
+    FLUIDSIM_ASSERT(b->hostPtr == nullptr && b->capacity > 0);
+
+    cl_int err;
+    b->hostPtr = _device->getCommandQueue().enqueueMapBuffer(b->buffer, 
+                                                             CL_FALSE,
+                                                             flags,
+                                                             0, 
+                                                             b->capacity,
+                                                             NULL,
+                                                             event,
+                                                             &err);
+    OpenCLDevice::checkError(err, "CommandQueue::enqueueMapBuffer()");
+}
+
+void CLBufferPool::unmapBuffer(int id) {
+    FLUIDSIM_ASSERT(isInitialized());
+
+    PinnedBuffer *b = _getPinnedBuffer(id);
+    FLUIDSIM_ASSERT(b->hostPtr != nullptr);
+
+    cl_int err = _device->getCommandQueue().enqueueUnmapMemObject(b->buffer, b->hostPtr);
+    OpenCLDevice::checkError(err, "CommandQueue::enqueueUnmapMemObject()");
+    b->hostPtr = nullptr;
+}
+
+cl_map_flags CLBufferPool::getWriteMapFlags() {
+    #ifdef CL_MAP_WRITE_INVALIDATE_REGION
+        return CL_MAP_WRITE_INVALIDATE_REGION;
+    #else
+        return CL_MAP_WRITE;
+    #endif
+}
+
+void CLBufferPool::clear() {
+    if (!isInitialized()) {
+        _buffers.clear();
+        return;
+    }
+
+    bool isUnmapped = false;
+    for (unsigned int i = 0; i < _buffers.size(); i++) {
+        if (_buffers[i].hostPtr != nullptr) {
+            unmapBuffer(i);
+            isUnmapped = true;
+        }
+    }
+
+    if (isUnmapped) {
+        _device->getCommandQueue().finish();
+    }
+    _buffers.clear();
+}
+
+size_t CLBufferPool::getAllocatedBytes() {
+    size_t n = 0;
+    for (unsigned int i = 0; i < _buffers.size(); i++) {
+        n += _buffers[i].capacity;
+    }
+    return n;
+}
+
+CLBufferPool::PinnedBuffer* CLBufferPool::_getPinnedBuffer(int id) {
+    FLUIDSIM_ASSERT(id >= 0);
+    if (id >= (int)_buffers.size()) {
+        _buffers.resize(id + 1);
+    }
+    return &(_buffers[id]);
+}
+
+void CLBufferPool::_allocateBuffer(PinnedBuffer *b, size_t numBytes, cl_mem_flags flags) {
+    FLUIDSIM_ASSERT(b->hostPtr == nullptr);
+
+    cl_int err;
+    b->buffer = cl::Buffer(_device->getContext(), 
+                           flags | CL_MEM_ALLOC_HOST_PTR, 
+                           numBytes, 
+                           NULL, 
+                           &err);
+    OpenCLDevice::checkError(err, "Creating pinned data buffer");
+
+    b->flags = flags;
+    b->capacity = numBytes;
+}
+
+#endif
+
+#ifdef __GNUC__
+    #pragma GCC diagnostic pop
+#endif
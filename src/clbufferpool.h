@@ -0,0 +1,98 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef CLBUFFERPOOL_H
+#define CLBUFFERPOOL_H
+
+#include "opencldevice.h"
+
+#if CONFIG_WITH_OPENCL
+
+#include <vector>
+
+#include "fluidsimassert.h"
+
+/*
+    Persistent OpenCL buffers allocated in pinned host memory 
+    (CL_MEM_ALLOC_HOST_PTR).
+
+    Buffers are identified by an integer id and are kept between 
+    computations. A buffer is only reallocated when a computation needs 
+    more memory than its current capacity.
+
+    Host data is written to and read from mapped pointers. On devices that 
+    share memory with the host, mapping does not copy any data. A buffer is 
+    kept mapped while the host is using it and must be unmapped before a 
+    kernel that uses the buffer is enqueued.
+*/
+class CLBufferPool
+{
+public:
+    CLBufferPool();
+    ~CLBufferPool();
+
+    void initialize(OpenCLDevice *device);
+    bool isInitialized();
+
+    /*
+        Returns a host pointer to a mapped buffer with a capacity of at least
+        numBytes. If the buffer needs to be mapped or reallocated, this 
+        method will block until the buffer is available to the host.
+    */
+    void* reserve(int id, size_t numBytes, cl_mem_flags flags);
+
+    cl::Buffer& getBuffer(int id);
+    void* getHostPointer(int id);
+    bool isMapped(int id);
+
+    /*
+        Enqueues a non-blocking map of the buffer. The host pointer is valid 
+        once the event has completed.
+    */
+    void mapBuffer(int id, cl_map_flags flags, cl::Event *event);
+    void unmapBuffer(int id);
+
+    // Map flags for a buffer that is only written by the host
+    static cl_map_flags getWriteMapFlags();
+
+    void clear();
+    size_t getAllocatedBytes();
+
+private:
+
+    struct PinnedBuffer {
+        cl::Buffer buffer;
+        cl_mem_flags flags = 0;
+        size_t capacity = 0;
+        void *hostPtr = nullptr;
+    };
+
+    PinnedBuffer* _getPinnedBuffer(int id);
+    void _allocateBuffer(PinnedBuffer *b, size_t numBytes, cl_mem_flags flags);
+
+    OpenCLDevice *_device = nullptr;
+    std::vector<PinnedBuffer> _buffers;
+
+    double _capacityGrowthFactor = 1.5;
+    
+};
+
+#endif
+
+#endif
@@ -26,43 +26,45 @@ freely, subject to the following restrictions:
 #include "clscalarfield.h"
 
 CLScalarField::CLScalarField() {
+    if (OpenCLDevice::isOpenCLAvailable()) {
+        _computeBackend = ComputeBackend::opencl;
+    }
 }
 
-bool CLScalarField::initialize() {
-    cl_int err;
-    cl::Context context = _getCLContext(&err);
-    if (err != CL_SUCCESS) {
-        return false;
-    }
+bool CLScalarField::initialize(OpenCLDevice *device) {
+    _isInitialized = false;
 
-    cl::Device device = _getCLDevice(context, &err);
-    if (err != CL_SUCCESS) {
-        return false;
-    }
-    _CLContext = context;
-    _CLDevice = device;
-    _deviceInfo = _initializeDeviceInfo(device);
+    #if CONFIG_WITH_OPENCL
+        if (device == nullptr || !device->isInitialized()) {
+            return false;
+        }
+        _device = device;
+        _deviceInfo = device->getCLDeviceInfo();
 
-    err = _initializeChunkDimensions();
-    if (err != CL_SUCCESS) {
-        return false;
-    }
-    
-    err = _initializeCLKernels();
-    if (err != CL_SUCCESS) {
-        return false;
-    }
-    _kernelPointsInfo = _initializeKernelInfo(_CLKernelPoints);
-    _kernelPointValuesInfo = _initializeKernelInfo(_CLKernelPointValues);
-    _kernelWeightPointValuesInfo = _initializeKernelInfo(_CLKernelWeightPointValues);
+        cl_int err = _initializeChunkDimensions();
+        if (err != CL_SUCCESS) {
+            return false;
+        }
+        
+        err = _initializeCLKernels();
+        if (err != CL_SUCCESS) {
+            return false;
+        }
+        _kernelPointsInfo = device->getKernelInfo(_CLKernelPoints);
+        _kernelPointValuesInfo = device->getKernelInfo(_CLKernelPointValues);
+        _kernelWeightPointValuesInfo = device->getKernelInfo(_CLKernelWeightPointValues);
+        _bufferPool.initialize(device);
 
-    err = _initializeCLCommandQueue();
-    if (err != CL_SUCCESS) {
-        return false;
-    }
+        _isInitialized = true;
+    #else
+        (void)device;
+    #endif
 
-    _isInitialized = true;
-    return true;
+    return _isInitialized;
+}
+
+bool CLScalarField::isInitialized() {
+    return _isInitialized;
 }
 
 void CLScalarField::addPoints(std::vector<vmath::vec3> &points, 
@@ -70,12 +72,15 @@ void CLScalarField::addPoints(std::vector<vmath::vec3> &points,
                               vmath::vec3 offset,
                               double dx,
                               Array3d<float> *field) {
-    FLUIDSIM_ASSERT(_isInitialized);
-
-    if (!_isOpenCLEnabled) {
+    if (_computeBackend != ComputeBackend::opencl) {
         _addPointsNoCL(points, radius, offset, dx, field);
+        return;
     }
 
+    FLUIDSIM_ASSERT(_isInitialized);
+
+    #if CONFIG_WITH_OPENCL
+
     _isize = field->width;
     _jsize = field->height;
     _ksize = field->depth;
@@ -99,26 +104,13 @@ void CLScalarField::addPoints(std::vector<vmath::vec3> &points,
     std::vector<WorkChunk> workChunkQueue;
     _initializeWorkChunks(workGroupGrid, workChunkQueue);
 
-    int maxChunks = _getMaxChunksPerPointValueComputation();
-    
-    std::vector<WorkChunk> chunks;
-    while (!workChunkQueue.empty()) {
-        _updateWorkGroupMinimumValues(workGroupGrid);
-
-        chunks.clear();
-
-        _getNextWorkChunksToProcess(workChunkQueue, 
-                                    workGroupGrid, 
-                                    chunks, 
-                                    maxChunks);
-
-        _computePointScalarField(chunks, workGroupGrid);
-    }
+    _computeScalarField(workChunkQueue, workGroupGrid, FieldComputation::points);
 
     if (!isOutOfRangeValueSet) {
         field->setOutOfRangeValue();
     }
-    
+
+    #endif
 }
 
 void CLScalarField::addPoints(std::vector<vmath::vec3> &points, 
@@ -148,14 +140,17 @@ void CLScalarField::addPointValues(std::vector<vmath::vec3> &points,
                                    double dx,
                                    Array3d<float> *field) {
     
-    FLUIDSIM_ASSERT(_isInitialized);
     FLUIDSIM_ASSERT(points.size() == values.size());
 
-    if (!_isOpenCLEnabled) {
+    if (_computeBackend != ComputeBackend::opencl) {
         _addPointValuesNoCL(points, values, radius, offset, dx, field);
         return;
     }
 
+    FLUIDSIM_ASSERT(_isInitialized);
+
+    #if CONFIG_WITH_OPENCL
+
     _isize = field->width;
     _jsize = field->height;
     _ksize = field->depth;
@@ -178,23 +173,13 @@ void CLScalarField::addPointValues(std::vector<vmath::vec3> &points,
     std::vector<WorkChunk> workChunkQueue;
     _initializeWorkChunks(workGroupGrid, workChunkQueue);
 
-    int maxChunks = _getMaxChunksPerPointValueComputation();
-
-    std::vector<WorkChunk> chunks;
-    while (!workChunkQueue.empty()) {
-        _updateWorkGroupMinimumValues(workGroupGrid);
-
-        chunks.clear();
-        _getNextWorkChunksToProcess(workChunkQueue, 
-                                    workGroupGrid, 
-                                    chunks, 
-                                    maxChunks);
-        _computePointValueScalarField(chunks, workGroupGrid);
-    }
+    _computeScalarField(workChunkQueue, workGroupGrid, FieldComputation::pointValues);
 
     if (!isOutOfRangeValueSet) {
         field->setOutOfRangeValue();
     }
+
+    #endif
 }
 
 void CLScalarField::addPointValues(std::vector<vmath::vec3> &points, 
@@ -204,18 +189,21 @@ void CLScalarField::addPointValues(std::vector<vmath::vec3> &points,
                                    double dx,
                                    Array3d<float> *scalarfield,
                                    Array3d<float> *weightfield) {
-    FLUIDSIM_ASSERT(_isInitialized);
     FLUIDSIM_ASSERT(points.size() == values.size());
     FLUIDSIM_ASSERT(scalarfield->width == weightfield->width &&
                     scalarfield->height == weightfield->height &&
                     scalarfield->depth == weightfield->depth);
 
-    if (!_isOpenCLEnabled) {
+    if (_computeBackend != ComputeBackend::opencl) {
         _addPointValuesNoCL(points, values, radius, offset, dx, 
                             scalarfield, weightfield);
         return;
     }
 
+    FLUIDSIM_ASSERT(_isInitialized);
+
+    #if CONFIG_WITH_OPENCL
+
     _isize = scalarfield->width;
     _jsize = scalarfield->height;
     _ksize = scalarfield->depth;
@@ -243,19 +231,7 @@ void CLScalarField::addPointValues(std::vector<vmath::vec3> &points,
     std::vector<WorkChunk> workChunkQueue;
     _initializeWorkChunks(workGroupGrid, workChunkQueue);
 
-    int maxChunks = _getMaxChunksPerWeightPointValueComputation();
-
-    std::vector<WorkChunk> chunks;
-    while (!workChunkQueue.empty()) {
-        _updateWorkGroupMinimumValues(workGroupGrid);
-
-        chunks.clear();
-        _getNextWorkChunksToProcess(workChunkQueue, 
-                                    workGroupGrid, 
-                                    chunks, 
-                                    maxChunks);
-        _computePointValueScalarWeightField(chunks, workGroupGrid);
-    }
+    _computeScalarField(workChunkQueue, workGroupGrid, FieldComputation::weightPointValues);
 
     if (!isScalarFieldOutOfRangeValueSet) {
         scalarfield->setOutOfRangeValue();
@@ -263,7 +239,8 @@ void CLScalarField::addPointValues(std::vector<vmath::vec3> &points,
     if (!isWeightFieldOutOfRangeValueSet) {
         weightfield->setOutOfRangeValue();
     }
-    
+
+    #endif
 }
 
 void CLScalarField::addPointValues(std::vector<vmath::vec3> &points, 
@@ -317,129 +294,69 @@ double CLScalarField::getMaxScalarFieldValueThreshold() {
     return _maxScalarFieldValueThreshold;
 }
 
-void CLScalarField::setDevicePreference(std::string devtype) {
-    std::transform(devtype.begin(), devtype.end(), devtype.begin(), ::tolower);
-
-    if (devtype == "gpu") {
-        setDevicePreferenceGPU();
-    } else if (devtype == "cpu") {
-        setDevicePreferenceCPU();
-    }
-}
-
-void CLScalarField::setDevicePreferenceGPU() {
-    _devicePreference1 = CL_DEVICE_TYPE_GPU;
-    _devicePreference2 = CL_DEVICE_TYPE_CPU;
-}
-
-void CLScalarField::setDevicePreferenceCPU() {
-    _devicePreference1 = CL_DEVICE_TYPE_CPU;
-    _devicePreference2 = CL_DEVICE_TYPE_GPU;
-}
-
-void CLScalarField::printDeviceInfo() {
+void CLScalarField::printKernelInfo() {
     if (!_isInitialized) {
         return;
     }
 
-    std::cout << getDeviceInfo();
+    std::cout << getKernelInfo();
 }
 
-std::string CLScalarField::getDeviceInfo() {
-    std::ostringstream ss;
+std::string CLScalarField::getKernelInfo() {
     if (!_isInitialized) {
-        return ss.str();
+        return std::string();
     }
 
-    ss << "CL_DEVICE_NAME:                " << 
-          _deviceInfo.cl_device_name << std::endl;
-    ss << "CL_DEVICE_VENDOR:              " << 
-          _deviceInfo.cl_device_vendor << std::endl;
-    ss << "CL_DEVICE_VERSION:             " << 
-          _deviceInfo.cl_device_version << std::endl;
-    ss << "CL_DRIVER_VERSION:             " << 
-           _deviceInfo.cl_driver_version << std::endl;
-    ss << "CL_DEVICE_OPENCL_C_VERSION:    " << 
-          _deviceInfo.cl_device_opencl_c_version << std::endl;
-
-    std::string type;
-    switch (_deviceInfo.device_type) {
-        case CL_DEVICE_TYPE_CPU:
-            type = "CPU";
-            break;
-        case CL_DEVICE_TYPE_GPU:
-            type = "GPU";
-            break;
-        case CL_DEVICE_TYPE_ACCELERATOR:
-            type = "ACCELERATOR";
-            break;
-        case CL_DEVICE_TYPE_DEFAULT:
-            type = "DEFAULT";
-            break;
-        default:
-            break;
-    }
-    ss << "CL_DEVICE_TYPE:                " << 
-          type << std::endl;
-    ss << "CL_DEVICE_MAX_CLOCK_FREQUENCY: " << 
-          _deviceInfo.cl_device_max_clock_frequency << "MHz" << std::endl;
-    ss << "CL_DEVICE_GLOBAL_MEM_SIZE:     " << 
-          _deviceInfo.cl_device_global_mem_size << std::endl;
-    ss << "CL_DEVICE_LOCAL_MEM_SIZE:      " << 
-          _deviceInfo.cl_device_local_mem_size << std::endl;
-    ss << "CL_DEVICE_MAX_MEM_ALLOC_SIZE:  " << 
-          _deviceInfo.cl_device_max_mem_alloc_size << std::endl;
-    ss << "CL_DEVICE_MAX_WORK_GROUP_SIZE: " << 
-          _deviceInfo.cl_device_max_work_group_size << std::endl;
-
-    GridIndex g = _deviceInfo.cl_device_max_work_item_sizes;
-    ss << "CL_DEVICE_MAX_WORK_ITEM_SIZES: " << g.i << " x " << 
-                                               g.j << " x " << 
-                                               g.k << std::endl;
-    return ss.str();
+    #if CONFIG_WITH_OPENCL
+        std::string k1 = _device->getKernelInfoString(_kernelPointsInfo);
+        std::string k2 = _device->getKernelInfoString(_kernelPointValuesInfo);
+        std::string k3 = _device->getKernelInfoString(_kernelWeightPointValuesInfo);
+
+        return k1 + "\n" + k2 + "\n" + k3;
+    #else
+        return std::string();
+    #endif
 }
 
-void CLScalarField::printKernelInfo() {
-    if (!_isInitialized) {
-        return;
+void CLScalarField::setComputeBackend(ComputeBackend backend) {
+    if (backend == ComputeBackend::opencl && !OpenCLDevice::isOpenCLAvailable()) {
+        backend = ComputeBackend::threaded;
     }
+    _computeBackend = backend;
+}
 
-    std::cout << getKernelInfo();
+ComputeBackend CLScalarField::getComputeBackend() {
+    return _computeBackend;
 }
 
-std::string CLScalarField::getKernelInfo() {
-    std::string k1 = _getKernelInfo(_kernelPointsInfo);
-    std::string k2 = _getKernelInfo(_kernelPointValuesInfo);
-    std::string k3 = _getKernelInfo(_kernelWeightPointValuesInfo);
+void CLScalarField::disableOpenCL() {
+    if (_computeBackend == ComputeBackend::opencl) {
+        _computeBackend = ComputeBackend::threaded;
+    }
+}
 
-    return k1 + "\n" + k2 + "\n" + k3;
+void CLScalarField::enableOpenCL() {
+    setComputeBackend(ComputeBackend::opencl);
 }
 
-std::string CLScalarField::_getKernelInfo(CLKernelInfo &info) {
-    std::ostringstream ss;
-    if (!_isInitialized) {
-        return ss.str();
-    }
+bool CLScalarField::isOpenCLEnabled() {
+    return _computeBackend == ComputeBackend::opencl;
+}
 
-    ss << "CL_KERNEL_FUNCTION_NAME:                      " << 
-                 info.cl_kernel_function_name << std::endl;
-    ss << "CL_KERNEL_ATTRIBUTES:                        " << 
-                 info.cl_kernel_attributes << std::endl;
+int CLScalarField::getKernelWorkLoadSize() {
+    return _kernelWorkLoadSize;
+}
 
-    ss << "CL_KERNEL_NUM_ARGS:                           " << 
-                 info.cl_kernel_num_args << std::endl;
-    ss << "CL_KERNEL_WORK_GROUP_SIZE:                    " << 
-                 info.cl_kernel_work_group_size << std::endl;
-    ss << "CL_KERNEL_LOCAL_MEM_SIZE:                     " << 
-                 info.cl_kernel_local_mem_size << std::endl;
-    ss << "CL_KERNEL_PRIVATE_MEM_SIZE:                   " << 
-                 info.cl_kernel_private_mem_size << std::endl;
-    ss << "CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE: " << 
-                 info.cl_kernel_preferred_work_group_size_multiple << std::endl;
+void CLScalarField::setKernelWorkLoadSize(int n) {
+    _kernelWorkLoadSize = n;
+}
 
-    return ss.str();
+void CLScalarField::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
 }
 
+#if CONFIG_WITH_OPENCL
+
 cl_int CLScalarField::_initializeChunkDimensions() {
     unsigned int groupsize = (unsigned int)_deviceInfo.cl_device_max_work_group_size;
     groupsize = fmin(groupsize, _maxWorkGroupSize);
@@ -482,210 +399,21 @@ cl_int CLScalarField::_initializeChunkDimensions() {
     return CL_SUCCESS;
 }
 
-bool CLScalarField::isUsingGPU() {
-    if (!_isInitialized) {
-        return false;
-    }
-    return _deviceInfo.device_type == CL_DEVICE_TYPE_GPU;
-}
-
-bool CLScalarField::isUsingCPU() {
-    if (!_isInitialized) {
-        return false;
-    }
-    return _deviceInfo.device_type == CL_DEVICE_TYPE_CPU;
-}
-
-void CLScalarField::disableOpenCL() {
-    _isOpenCLEnabled = false;
-}
-
-void CLScalarField::enableOpenCL() {
-    _isOpenCLEnabled = true;
-}
-
-bool CLScalarField::isOpenCLEnabled() {
-    return _isOpenCLEnabled;
-}
-
-int CLScalarField::getKernelWorkLoadSize() {
-    return _kernelWorkLoadSize;
-}
-
-void CLScalarField::setKernelWorkLoadSize(int n) {
-    _kernelWorkLoadSize = n;
-}
-
-void CLScalarField::_checkError(cl_int err, const char * name) {
-    if (err != CL_SUCCESS) {
-        std::cerr << "ERROR: " << name  << " (" << err << ")" << std::endl;
-        FLUIDSIM_ASSERT(err == CL_SUCCESS);
-    }
-}
-
-cl::Context CLScalarField::_getCLContext(cl_int *err) {
-    cl::Context context;
-
-    std::vector< cl::Platform > platforms;
-    cl::Platform::get(&platforms);
-
-    if (platforms.size() == 0) {
-        *err = -1;
-        return context;
-    }
-
-    // Try to find a platform with first device preference
-    for (unsigned int i = 0; i < platforms.size(); i++) {
-        cl_context_properties p = (cl_context_properties)(platforms[i]());
-
-        cl_context_properties cprops[3] = {CL_CONTEXT_PLATFORM, p, 0};
-        context = cl::Context(_devicePreference1, cprops, NULL, NULL, err);
-
-        if (*err == CL_SUCCESS) {
-            return context;
-        }
-    }
-
-    // If first preference device not found, try to find a platform with 
-    // second device preference.
-    for (unsigned int i = 0; i < platforms.size(); i++) {
-        cl_context_properties p = (cl_context_properties)(platforms[i]());
-
-        cl_context_properties cprops[3] = {CL_CONTEXT_PLATFORM, p, 0};
-        context = cl::Context(_devicePreference2, cprops, NULL, NULL, err);
-
-        if (*err == CL_SUCCESS) {
-            return context;
-        }
-    }
-
-    *err = -1;
-
-    return context;
-}
-
-cl::Device CLScalarField::_getCLDevice(cl::Context &context, cl_int *err) {
-    std::vector<cl::Device> devices;
-    devices = context.getInfo<CL_CONTEXT_DEVICES>();
-
-    if (devices.size() == 0) {
-        *err = -1;
-        return cl::Device();
-    }
-
-    *err = CL_SUCCESS;
-    return devices[0];
-}
-
-CLScalarField::CLDeviceInfo CLScalarField::_initializeDeviceInfo(cl::Device &device) {
-    CLDeviceInfo info;
-
-    device.getInfo(CL_DEVICE_NAME, &(info.cl_device_name));
-    device.getInfo(CL_DEVICE_VENDOR, &(info.cl_device_vendor));
-    device.getInfo(CL_DEVICE_VERSION, &(info.cl_device_version));
-    device.getInfo(CL_DRIVER_VERSION, &(info.cl_driver_version));
-    device.getInfo(CL_DEVICE_OPENCL_C_VERSION, &(info.cl_device_opencl_c_version));
-
-    clGetDeviceInfo(device(), CL_DEVICE_TYPE, 
-                    sizeof(cl_device_type), &(info.device_type), NULL);
-    clGetDeviceInfo(device(), CL_DEVICE_MAX_CLOCK_FREQUENCY, 
-                    sizeof(cl_uint), &(info.cl_device_max_clock_frequency), NULL);
-    clGetDeviceInfo(device(), CL_DEVICE_GLOBAL_MEM_SIZE, 
-                    sizeof(cl_ulong), &(info.cl_device_global_mem_size), NULL);
-    clGetDeviceInfo(device(), CL_DEVICE_LOCAL_MEM_SIZE, 
-                    sizeof(cl_ulong), &(info.cl_device_local_mem_size), NULL);
-    clGetDeviceInfo(device(), CL_DEVICE_MAX_MEM_ALLOC_SIZE, 
-                    sizeof(cl_ulong), &(info.cl_device_max_mem_alloc_size), NULL);
-    clGetDeviceInfo(device(), CL_DEVICE_MAX_WORK_GROUP_SIZE, 
-                    sizeof(size_t), &(info.cl_device_max_work_group_size), NULL);
-
-    std::vector<size_t> workItemSizes;
-    device.getInfo(CL_DEVICE_MAX_WORK_ITEM_SIZES, &workItemSizes);
-
-    GridIndex groupdims(1, 1, 1);
-    if (workItemSizes.size() >= 1) {
-        groupdims.i = (int)workItemSizes[0];
-    }
-    if (workItemSizes.size() >= 2) {
-        groupdims.j = (int)workItemSizes[1];
-    }
-    if (workItemSizes.size() >= 3) {
-        groupdims.k = (int)workItemSizes[2];
-    }
-    info.cl_device_max_work_item_sizes = groupdims;
-
-    return info;
-}
-
-CLScalarField::CLKernelInfo CLScalarField::_initializeKernelInfo(cl::Kernel &kernel) {
-    CLKernelInfo info;
-
-    kernel.getInfo(CL_KERNEL_FUNCTION_NAME, &(info.cl_kernel_function_name));
-    kernel.getInfo(CL_KERNEL_ATTRIBUTES, &(info.cl_kernel_attributes));
-
-    clGetKernelInfo (kernel(), CL_KERNEL_NUM_ARGS,
-                     sizeof(cl_ulong), &(info.cl_kernel_num_args), NULL);
-    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_WORK_GROUP_SIZE,
-                             sizeof(size_t), &(info.cl_kernel_work_group_size), NULL);
-    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_LOCAL_MEM_SIZE,
-                             sizeof(cl_ulong), &(info.cl_kernel_local_mem_size), NULL);
-    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_PRIVATE_MEM_SIZE,
-                             sizeof(cl_ulong), &(info.cl_kernel_private_mem_size), NULL);
-    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
-                             sizeof(size_t), &(info.cl_kernel_preferred_work_group_size_multiple), NULL);
-    return info;
-}
-
 cl_int CLScalarField::_initializeCLKernels() {
-    std::string prog = Kernels::scalarfieldCL;
-    cl::Program::Sources source(1, std::make_pair(prog.c_str(), prog.length()+1));
-    cl::Program program(_CLContext, source);
-
-    std::vector<cl::Device> devices = _CLContext.getInfo<CL_CONTEXT_DEVICES>();
+    std::vector<std::string> names;
+    names.push_back("compute_scalar_field_points");
+    names.push_back("compute_scalar_field_point_values");
+    names.push_back("compute_scalar_weight_field_point_values");
 
-    cl_int err = program.build(devices, "");
+    std::vector<cl::Kernel> kernels;
+    cl_int err = _device->buildKernels(Kernels::scalarfieldCL, names, kernels);
     if (err != CL_SUCCESS) {
         return err;
     }
 
-    cl::Kernel kernel(program, "compute_scalar_field_points", &err);
-    if (err != CL_SUCCESS) {
-        return err;
-    }
-    _CLKernelPoints = kernel;
-
-    kernel = cl::Kernel(program, "compute_scalar_field_point_values", &err);
-    if (err != CL_SUCCESS) {
-        return err;
-    }
-    _CLKernelPointValues = kernel;
-
-    kernel = cl::Kernel(program, "compute_scalar_weight_field_point_values", &err);
-    if (err != CL_SUCCESS) {
-        return err;
-    }
-    _CLKernelWeightPointValues = kernel;
-
-    return CL_SUCCESS;
-}
-
-std::string CLScalarField::_getProgramString(std::string filename) {
-    std::ifstream file(filename);
-    _checkError(file.is_open() ? CL_SUCCESS : -1, filename.c_str());
-    
-    std::string prog(std::istreambuf_iterator<char>(file), (std::istreambuf_iterator<char>()));
-
-    return prog;
-}
-
-cl_int CLScalarField::_initializeCLCommandQueue() {
-    cl_int err;
-    cl::CommandQueue queue(_CLContext, _CLDevice, 0, &err);
-    if (err != CL_SUCCESS) {
-        return err;
-    }
-
-    _CLQueue = queue;
+    _CLKernelPoints = kernels[0];
+    _CLKernelPointValues = kernels[1];
+    _CLKernelWeightPointValues = kernels[2];
 
     return CL_SUCCESS;
 }
@@ -1077,58 +805,114 @@ int CLScalarField::_getMaxChunkLimit(int pointDataSize, int fieldDataSize, int o
     return fmin(hardwareLimit, softwareLimit);
 }
 
-void CLScalarField::_computePointScalarField(std::vector<WorkChunk> &chunks,
-                                             Array3d<WorkGroup> &workGroupGrid) {
-    
-    int numParticles = _getMaxNumParticlesInChunk(chunks);
+/*
+    Work is split into several computations so that the host can prepare 
+    the data for one computation while the device runs the kernel for 
+    another.
+*/
+int CLScalarField::_getChunksPerComputation(int numChunks, FieldComputation type) {
+    int maxChunks = 0;
+    if (type == FieldComputation::points) {
+        maxChunks = _getMaxChunksPerPointComputation();
+    } else if (type == FieldComputation::pointValues) {
+        maxChunks = _getMaxChunksPerPointValueComputation();
+    } else {
+        maxChunks = _getMaxChunksPerWeightPointValueComputation();
+    }
 
-    DataBuffer buffer;
-    _initializePointComputationDataBuffer(chunks, workGroupGrid, numParticles, buffer);
-    _setPointComputationCLKernelArgs(buffer, numParticles);
+    int n = (int)ceil((double)numChunks / (double)_minComputationsPerCall);
+    n = (int)fmax(n, _minChunksPerComputation);
+    return (int)fmin(n, maxChunks);
+}
 
-    int numWorkItems = (int)chunks.size() * _workGroupSize;
-    _launchKernel(_CLKernelPoints, numWorkItems, _workGroupSize);
+/*
+    The next computation is launched before the results of the previous
+    computation are read back. When the max scalar field value threshold 
+    is set, work group minimum values do not yet include the results of 
+    the computation that is still running. Minimum values only increase 
+    as points are added, so this can only cull fewer chunks.
+*/
+void CLScalarField::_computeScalarField(std::vector<WorkChunk> &workChunkQueue,
+                                        Array3d<WorkGroup> &workGroupGrid,
+                                        FieldComputation type) {
+    DataBuffer buffers[2];
+    for (int i = 0; i < 2; i++) {
+        buffers[i].pointDataID = 3*i;
+        buffers[i].scalarFieldDataID = 3*i + 1;
+        buffers[i].offsetDataID = 3*i + 2;
+    }
 
-    int dataSize = (int)chunks.size() * _getChunkScalarFieldDataSize();
-    _readCLBuffer(buffer.scalarFieldDataCL, buffer.scalarFieldDataH, dataSize);
-    _setPointComputationOutputFieldData(buffer.scalarFieldDataH, chunks, workGroupGrid);
-}
+    int maxChunks = _getChunksPerComputation((int)workChunkQueue.size(), type);
 
-void CLScalarField::_computePointValueScalarField(std::vector<WorkChunk> &chunks,
-                                                  Array3d<WorkGroup> &workGroupGrid) {
-    
-    
-    int numParticles = _getMaxNumParticlesInChunk(chunks);
+    int bufferidx = 0;
+    while (!workChunkQueue.empty()) {
+        DataBuffer &buffer = buffers[bufferidx];
+        DataBuffer &prevBuffer = buffers[1 - bufferidx];
+        FLUIDSIM_ASSERT(!buffer.isComputing);
 
-    DataBuffer buffer;
-    _initializePointValueComputationDataBuffer(chunks, workGroupGrid, numParticles, buffer);
-    _setPointValueComputationCLKernelArgs(buffer, numParticles);
+        _updateWorkGroupMinimumValues(workGroupGrid);
 
-    int numWorkItems = (int)chunks.size() * _workGroupSize;
-    _launchKernel(_CLKernelPointValues, numWorkItems, _workGroupSize);
+        buffer.chunks.clear();
+        _getNextWorkChunksToProcess(workChunkQueue, 
+                                    workGroupGrid, 
+                                    buffer.chunks, 
+                                    maxChunks);
+        if (!buffer.chunks.empty()) {
+            _launchComputation(buffer, workGroupGrid, type);
+        }
 
-    int dataSize = (int)chunks.size() * _getChunkScalarFieldDataSize();
-    _readCLBuffer(buffer.scalarFieldDataCL, buffer.scalarFieldDataH, dataSize);
-    _setPointValueComputationOutputFieldData(buffer.scalarFieldDataH, chunks, workGroupGrid);
+        if (prevBuffer.isComputing) {
+            _finishComputation(prevBuffer, workGroupGrid, type);
+        }
+
+        bufferidx = 1 - bufferidx;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (buffers[i].isComputing) {
+            _finishComputation(buffers[i], workGroupGrid, type);
+        }
+    }
 }
 
-void CLScalarField::_computePointValueScalarWeightField(std::vector<WorkChunk> &chunks,
-                                                        Array3d<WorkGroup> &workGroupGrid) {
+void CLScalarField::_launchComputation(DataBuffer &buffer,
+                                       Array3d<WorkGroup> &workGroupGrid,
+                                       FieldComputation type) {
+    buffer.numParticles = _getMaxNumParticlesInChunk(buffer.chunks);
+    _initializeDataBuffer(buffer, workGroupGrid, type);
 
-    int numParticles = _getMaxNumParticlesInChunk(chunks);
+    _bufferPool.unmapBuffer(buffer.pointDataID);
+    _bufferPool.unmapBuffer(buffer.scalarFieldDataID);
+    _bufferPool.unmapBuffer(buffer.offsetDataID);
 
-    DataBuffer buffer;
-    _initializeWeightPointValueComputationDataBuffer(chunks, workGroupGrid, numParticles, buffer);
-    _setWeightPointValueComputationCLKernelArgs(buffer, numParticles);
+    _setCLKernelArgs(buffer, type);
 
-    int numWorkItems = (int)chunks.size() * _workGroupSize;
-    _launchKernel(_CLKernelWeightPointValues, numWorkItems, _workGroupSize);
+    int numWorkItems = (int)buffer.chunks.size() * _workGroupSize;
+    _launchKernel(_getCLKernel(type), numWorkItems, _workGroupSize);
 
-    int dataSize = (int)chunks.size() * _getChunkScalarWeightFieldDataSize();
-    _readCLBuffer(buffer.scalarFieldDataCL, buffer.scalarFieldDataH, dataSize);
-    _setWeightPointValueComputationOutputFieldData(buffer.scalarFieldDataH, 
-                                                   chunks, 
-                                                   workGroupGrid);
+    // The queue is in-order, so the buffers are mapped back to the host 
+    // once the kernels have completed. The scalar field map is enqueued 
+    // last and its event marks the end of the computation.
+    cl_map_flags writeFlags = CLBufferPool::getWriteMapFlags();
+    _bufferPool.mapBuffer(buffer.pointDataID, writeFlags, NULL);
+    _bufferPool.mapBuffer(buffer.offsetDataID, writeFlags, NULL);
+    _bufferPool.mapBuffer(buffer.scalarFieldDataID, CL_MAP_READ, &(buffer.event));
+    buffer.isComputing = true;
+}
+
+void CLScalarField::_finishComputation(DataBuffer &buffer,
+                                       Array3d<WorkGroup> &workGroupGrid,
+                                       FieldComputation type) {
+    cl_int err = buffer.event.wait();
+    OpenCLDevice::checkError(err, "Event::wait()");
+
+    float *scalarFieldDataH = (float*)_bufferPool.getHostPointer(buffer.scalarFieldDataID);
+    if (type == FieldComputation::weightPointValues) {
+        _setScalarWeightFieldOutputData(scalarFieldDataH, buffer.chunks, workGroupGrid);
+    } else {
+        _setScalarFieldOutputData(scalarFieldDataH, buffer.chunks, workGroupGrid);
+    }
+    buffer.isComputing = false;
 }
 
 int CLScalarField::_getMaxNumParticlesInChunk(std::vector<WorkChunk> &chunks) {
@@ -1143,71 +927,44 @@ int CLScalarField::_getMaxNumParticlesInChunk(std::vector<WorkChunk> &chunks) {
     return maxParticles;
 }
 
-void CLScalarField::_initializePointComputationDataBuffer(std::vector<WorkChunk> &chunks,
-                                                          Array3d<WorkGroup> &workGroupGrid,
-                                                          int numParticles,
-                                                          DataBuffer &buffer) {
-    _getHostPointDataBuffer(chunks, workGroupGrid, numParticles, buffer.pointDataH);
-    _getHostScalarFieldDataBuffer(chunks, buffer.scalarFieldDataH);
-    _getHostChunkOffsetDataBuffer(chunks, buffer.offsetDataH);
-    _initializeCLDataBuffers(buffer);
-}
-
-void CLScalarField::_initializePointValueComputationDataBuffer(std::vector<WorkChunk> &chunks,
-                                                               Array3d<WorkGroup> &workGroupGrid,
-                                                               int numParticles,
-                                                               DataBuffer &buffer) {
-    _getHostPointValueDataBuffer(chunks, workGroupGrid, numParticles, buffer.pointDataH);
-    _getHostScalarFieldDataBuffer(chunks, buffer.scalarFieldDataH);
-    _getHostChunkOffsetDataBuffer(chunks, buffer.offsetDataH);
-    _initializeCLDataBuffers(buffer);
-}
-
-void CLScalarField::_initializeWeightPointValueComputationDataBuffer(std::vector<WorkChunk> &chunks,
-                                                                     Array3d<WorkGroup> &workGroupGrid,
-                                                                     int numParticles,
-                                                                     DataBuffer &buffer) {
-    _getHostPointValueDataBuffer(chunks, workGroupGrid, numParticles, buffer.pointDataH);
-    _getHostScalarWeightFieldDataBuffer(chunks, buffer.scalarFieldDataH);
-    _getHostChunkOffsetDataBuffer(chunks, buffer.offsetDataH);
-    _initializeCLDataBuffers(buffer);
-}
-
-void CLScalarField::_initializeCLDataBuffers(DataBuffer &buffer) {
-    size_t pointDataBytes = buffer.pointDataH.size() * sizeof(float);
-    size_t scalarFieldDataBytes = buffer.scalarFieldDataH.size() * sizeof(float);
-    size_t offsetDataBytes = buffer.offsetDataH.size() * sizeof(GridIndex);
+void CLScalarField::_initializeDataBuffer(DataBuffer &buffer,
+                                          Array3d<WorkGroup> &workGroupGrid,
+                                          FieldComputation type) {
+    size_t numChunks = buffer.chunks.size();
+    int elementsPerPoint = type == FieldComputation::points ? 3 : 4;
+    int fieldDataSize = type == FieldComputation::weightPointValues ? 
+                            _getChunkScalarWeightFieldDataSize() : 
+                            _getChunkScalarFieldDataSize();
+
+    size_t pointDataBytes = numChunks * elementsPerPoint * buffer.numParticles * sizeof(float);
+    size_t scalarFieldDataBytes = numChunks * fieldDataSize;
+    size_t offsetDataBytes = numChunks * sizeof(GridIndex);
+
+    float *pointDataH = (float*)_bufferPool.reserve(buffer.pointDataID, 
+                                                    pointDataBytes, 
+                                                    CL_MEM_READ_ONLY);
+    // The kernels overwrite every scalar field value, so the host never 
+    // writes to the scalar field buffer
+    _bufferPool.reserve(buffer.scalarFieldDataID, scalarFieldDataBytes, CL_MEM_WRITE_ONLY);
+    GridIndex *offsetDataH = (GridIndex*)_bufferPool.reserve(buffer.offsetDataID, 
+                                                             offsetDataBytes, 
+                                                             CL_MEM_READ_ONLY);
+
+    if (type == FieldComputation::points) {
+        _getHostPointDataBuffer(buffer.chunks, workGroupGrid, 
+                                buffer.numParticles, pointDataH);
+    } else {
+        _getHostPointValueDataBuffer(buffer.chunks, workGroupGrid, 
+                                     buffer.numParticles, pointDataH);
+    }
 
-    cl_int err;
-    buffer.positionDataCL = cl::Buffer(_CLContext, 
-                                       CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
-                                       pointDataBytes, 
-                                       (void*)&(buffer.pointDataH[0]), 
-                                       (cl_int*)&err);
-    _checkError(err, "Creating position data buffer");
-
-    buffer.scalarFieldDataCL = cl::Buffer(_CLContext, 
-                                          CL_MEM_WRITE_ONLY | CL_MEM_USE_HOST_PTR, 
-                                          scalarFieldDataBytes, 
-                                          (void*)&(buffer.scalarFieldDataH[0]), 
-                                          &err);
-    _checkError(err, "Creating scalar field data buffer");
-
-    buffer.offsetDataCL = cl::Buffer(_CLContext, 
-                                     CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
-                                     offsetDataBytes, 
-                                     (void*)&(buffer.offsetDataH[0]), 
-                                     &err);
-    _checkError(err, "Creating chunk offset data buffer");
+    _getHostChunkOffsetDataBuffer(buffer.chunks, offsetDataH);
 }
 
 void CLScalarField::_getHostPointDataBuffer(std::vector<WorkChunk> &chunks,
                                             Array3d<WorkGroup> &grid,
                                             int numParticles,
-                                            std::vector<float> &buffer) {
-    int numElements = (int)chunks.size() * 3 * numParticles;
-    buffer.reserve(numElements);
-
+                                            float *buffer) {
     // Dummy position that is far away enough from the scalar field that it
     // will not affect any scalar field values
     vmath::vec3 outOfRangePos(grid.width * _chunkWidth * _dx + 2 * _radius,
@@ -1227,15 +984,15 @@ void CLScalarField::_getHostPointDataBuffer(std::vector<WorkChunk> &chunks,
         end = c.particlesEnd;
         for (std::vector<PointValue>::iterator it = beg; it != end; ++it) {
             p = (*it).position;
-            buffer.push_back(p.x);
-            buffer.push_back(p.y);
-            buffer.push_back(p.z);
+            *(buffer++) = p.x;
+            *(buffer++) = p.y;
+            *(buffer++) = p.z;
         }
 
         for (int i = 0; i < numPad; i++) {
-            buffer.push_back(outOfRangePos.x);
-            buffer.push_back(outOfRangePos.y);
-            buffer.push_back(outOfRangePos.z);
+            *(buffer++) = outOfRangePos.x;
+            *(buffer++) = outOfRangePos.y;
+            *(buffer++) = outOfRangePos.z;
         }
     }
 }
@@ -1243,10 +1000,7 @@ void CLScalarField::_getHostPointDataBuffer(std::vector<WorkChunk> &chunks,
 void CLScalarField::_getHostPointValueDataBuffer(std::vector<WorkChunk> &chunks,
                                                  Array3d<WorkGroup> &grid,
                                                  int numParticles,
-                                                 std::vector<float> &buffer) {
-    int numElements = (int)chunks.size() * 4 * numParticles;
-    buffer.reserve(numElements);
-
+                                                 float *buffer) {
     // Dummy position that is far away enough from the scalar field that it
     // will not affect any scalar field values
     vmath::vec3 outOfRangePos(grid.width * _chunkWidth * _dx + 2 * _radius,
@@ -1256,7 +1010,6 @@ void CLScalarField::_getHostPointValueDataBuffer(std::vector<WorkChunk> &chunks,
 
     WorkChunk c;
     vmath::vec3 p;
-    float v;
     std::vector<PointValue>::iterator beg;
     std::vector<PointValue>::iterator end;
     for (unsigned int i = 0; i < chunks.size(); i++) {
@@ -1269,137 +1022,92 @@ void CLScalarField::_getHostPointValueDataBuffer(std::vector<WorkChunk> &chunks,
         end = c.particlesEnd;
         for (std::vector<PointValue>::iterator it = beg; it != end; ++it) {
             p = (*it).position;
-            v = (*it).value;
-            buffer.push_back(p.x);
-            buffer.push_back(p.y);
-            buffer.push_back(p.z);
-            buffer.push_back(v);
+            *(buffer++) = p.x;
+            *(buffer++) = p.y;
+            *(buffer++) = p.z;
+            *(buffer++) = (*it).value;
         }
 
         for (int i = 0; i < numPad; i++) {
-            buffer.push_back(outOfRangePos.x);
-            buffer.push_back(outOfRangePos.y);
-            buffer.push_back(outOfRangePos.z);
-            buffer.push_back(outOfRangeValue);
+            *(buffer++) = outOfRangePos.x;
+            *(buffer++) = outOfRangePos.y;
+            *(buffer++) = outOfRangePos.z;
+            *(buffer++) = outOfRangeValue;
         }
     }
 }
 
-void CLScalarField::_getHostScalarFieldDataBuffer(std::vector<WorkChunk> &chunks,
-                                                  std::vector<float> &buffer) {
-    int numElements = (int)chunks.size() * _chunkWidth * _chunkHeight * _chunkWidth;
-    buffer.reserve(numElements);
-    for (int i = 0; i < numElements; i++) {
-        buffer.push_back(0.0);
-    }
-}
-
-void CLScalarField::_getHostScalarWeightFieldDataBuffer(std::vector<WorkChunk> &chunks,
-                                                        std::vector<float> &buffer) {
-    int numElements = 2 * (int)chunks.size() * _chunkWidth * _chunkHeight * _chunkWidth;
-    buffer.reserve(numElements);
-    for (int i = 0; i < numElements; i++) {
-        buffer.push_back(0.0);
-    }
-}
-
 void CLScalarField::_getHostChunkOffsetDataBuffer(std::vector<WorkChunk> &chunks,
-                                                  std::vector<GridIndex> &buffer) {
-    buffer.reserve(chunks.size());
+                                                  GridIndex *buffer) {
     for (unsigned int i = 0; i < chunks.size(); i++) {
-        buffer.push_back(chunks[i].workGroupIndex);
+        buffer[i] = chunks[i].workGroupIndex;
     }
 }
 
-void CLScalarField::_setPointComputationCLKernelArgs(DataBuffer &buffer, 
-                                                     int numParticles) {
-    int localDataBytes = numParticles * 3 * sizeof(float);
-    _setKernelArgs(_CLKernelPoints, 
-                   buffer, localDataBytes, numParticles, _radius, _dx);
-}
-
-void CLScalarField::_setPointValueComputationCLKernelArgs(DataBuffer &buffer, 
-                                                          int numParticles) {
-    int localDataBytes = numParticles * 4 * sizeof(float);
-    _setKernelArgs(_CLKernelPointValues, 
-                   buffer, localDataBytes, numParticles, _radius, _dx);
+cl::Kernel& CLScalarField::_getCLKernel(FieldComputation type) {
+    if (type == FieldComputation::points) {
+        return _CLKernelPoints;
+    } else if (type == FieldComputation::pointValues) {
+        return _CLKernelPointValues;
+    }
+    return _CLKernelWeightPointValues;
 }
 
-void CLScalarField::_setWeightPointValueComputationCLKernelArgs(DataBuffer &buffer, 
-                                                                int numParticles) {
-    int localDataBytes = numParticles * 4 * sizeof(float);
-    _setKernelArgs(_CLKernelWeightPointValues, 
-                   buffer, localDataBytes, numParticles, _radius, _dx);
-}
+void CLScalarField::_setCLKernelArgs(DataBuffer &buffer, FieldComputation type) {
+    cl::Kernel &kernel = _getCLKernel(type);
 
-void CLScalarField::_setKernelArgs(cl::Kernel &kernel, 
-                                   DataBuffer &buffer, 
-                                   int localDataBytes,
-                                   int numParticles, 
-                                   double radius, 
-                                   double dx) {
-    cl_int err = kernel.setArg(0, buffer.positionDataCL);
-    _checkError(err, "Kernel::setArg() - position data");
+    cl_int err = kernel.setArg(0, _bufferPool.getBuffer(buffer.pointDataID));
+    OpenCLDevice::checkError(err, "Kernel::setArg() - position data");
 
-    err = kernel.setArg(1, buffer.scalarFieldDataCL);
-    _checkError(err, "Kernel::setArg() - scalar field data");
+    err = kernel.setArg(1, _bufferPool.getBuffer(buffer.scalarFieldDataID));
+    OpenCLDevice::checkError(err, "Kernel::setArg() - scalar field data");
 
-    err = kernel.setArg(2, buffer.offsetDataCL);
-    _checkError(err, "Kernel::setArg() - chunk offset data");
+    err = kernel.setArg(2, _bufferPool.getBuffer(buffer.offsetDataID));
+    OpenCLDevice::checkError(err, "Kernel::setArg() - chunk offset data");
 
+    int elementsPerPoint = type == FieldComputation::points ? 3 : 4;
+    int localDataBytes = buffer.numParticles * elementsPerPoint * sizeof(float);
     FLUIDSIM_ASSERT((unsigned int)localDataBytes <= _deviceInfo.cl_device_local_mem_size);
     err = kernel.setArg(3, cl::__local(localDataBytes));
-    _checkError(err, "Kernel::setArg() - local position data");
+    OpenCLDevice::checkError(err, "Kernel::setArg() - local position data");
 
-    err = kernel.setArg(4, numParticles);
-    _checkError(err, "Kernel::setArg() - num particles");
+    err = kernel.setArg(4, buffer.numParticles);
+    OpenCLDevice::checkError(err, "Kernel::setArg() - num particles");
 
-    int numGroups = buffer.offsetDataH.size();
+    int numGroups = (int)buffer.chunks.size();
     err = kernel.setArg(5, numGroups);
-    _checkError(err, "Kernel::setArg() - num groups");
+    OpenCLDevice::checkError(err, "Kernel::setArg() - num groups");
 
-    err = kernel.setArg(6, (float)radius);
-    _checkError(err, "Kernel::setArg() - radius");
+    err = kernel.setArg(6, (float)_radius);
+    OpenCLDevice::checkError(err, "Kernel::setArg() - radius");
 
-    err = kernel.setArg(7, (float)dx);
-    _checkError(err, "Kernel::setArg() - dx");
+    err = kernel.setArg(7, (float)_dx);
+    OpenCLDevice::checkError(err, "Kernel::setArg() - dx");
 }
 
 void CLScalarField::_launchKernel(cl::Kernel &kernel, int numWorkItems, int workGroupSize) {
     int numChunks = numWorkItems / workGroupSize;
     int loadSize = _kernelWorkLoadSize;
-    int numComputations = ceil((double)numChunks / (double)loadSize);
+    int numLaunches = ceil((double)numChunks / (double)loadSize);
 
-    cl::Event event;
     cl_int err;
-    for (int i = 0; i < numComputations; i++) {
+    for (int i = 0; i < numLaunches; i++) {
         int offset = i * loadSize * workGroupSize;
         int items = (int)fmin(numWorkItems - offset, loadSize * workGroupSize);
         
-        err = _CLQueue.enqueueNDRangeKernel(kernel, 
+        err = _device->getCommandQueue().enqueueNDRangeKernel(kernel, 
                                             cl::NDRange(offset), 
                                             cl::NDRange(items), 
                                             cl::NDRange(workGroupSize), 
                                             NULL, 
-                                            &event);    
-        _checkError(err, "CommandQueue::enqueueNDRangeKernel()");
+                                            NULL);    
+        OpenCLDevice::checkError(err, "CommandQueue::enqueueNDRangeKernel()");
     }
-
-    event.wait();
-}
-
-void CLScalarField::_readCLBuffer(cl::Buffer &sourceCL, std::vector<float> &destH, int dataSize) {
-    FLUIDSIM_ASSERT((int)(destH.size() * sizeof(float)) >= dataSize);
-    cl_int err = _CLQueue.enqueueReadBuffer(sourceCL, CL_TRUE, 0, dataSize, (void*)&(destH[0]));
-    _checkError(err, "CommandQueue::enqueueReadBuffer()");
 }
 
-void CLScalarField::_setPointComputationOutputFieldData(std::vector<float> &buffer, 
-                                                        std::vector<WorkChunk> &chunks,
-                                                        Array3d<WorkGroup> &workGroupGrid) {
-    int elementsPerChunk = _chunkWidth * _chunkHeight * _chunkDepth;
-    FLUIDSIM_ASSERT(buffer.size() == chunks.size() * elementsPerChunk);
-
+void CLScalarField::_setScalarFieldOutputData(float *buffer, 
+                                              std::vector<WorkChunk> &chunks,
+                                              Array3d<WorkGroup> &workGroupGrid) {
     GridIndex cg;
     ArrayView3d<float> fieldview;
     int bufferidx = 0;
@@ -1418,17 +1126,10 @@ void CLScalarField::_setPointComputationOutputFieldData(std::vector<float> &buff
     }
 }
 
-void CLScalarField::_setPointValueComputationOutputFieldData(std::vector<float> &buffer, 
-                                                             std::vector<WorkChunk> &chunks,
-                                                             Array3d<WorkGroup> &workGroupGrid) {
-    _setPointComputationOutputFieldData(buffer, chunks, workGroupGrid);
-}
-
-void CLScalarField::_setWeightPointValueComputationOutputFieldData(std::vector<float> &buffer, 
-                                                                   std::vector<WorkChunk> &chunks,
-                                                                   Array3d<WorkGroup> &workGroupGrid) {
+void CLScalarField::_setScalarWeightFieldOutputData(float *buffer, 
+                                                    std::vector<WorkChunk> &chunks,
+                                                    Array3d<WorkGroup> &workGroupGrid) {
     int elementsPerChunk = _chunkWidth * _chunkHeight * _chunkDepth;
-    FLUIDSIM_ASSERT(buffer.size() == 2 * chunks.size() * elementsPerChunk);
 
     GridIndex cg;
     WorkGroup *group;
@@ -1482,6 +1183,8 @@ float CLScalarField::_getWorkGroupMinimumValue(WorkGroup *g) {
     return minval;
 }
 
+#endif
+
 void CLScalarField::_addPointsNoCL(std::vector<vmath::vec3> &points, 
                                    double radius,
                                    vmath::vec3 offset,
@@ -1491,13 +1194,13 @@ void CLScalarField::_addPointsNoCL(std::vector<vmath::vec3> &points,
     ScalarField calcfield(field->width, field->height, field->depth, dx);
     calcfield.setPointRadius(radius);
     calcfield.setOffset(offset);
-    for (unsigned int i = 0; i < points.size(); i++) {
-        calcfield.addPoint(points[i]);
+    if (_isMaxScalarFieldValueThresholdSet) {
+        calcfield.setMaxScalarFieldThreshold(_maxScalarFieldValueThreshold);
     }
+    _addPointValuesToScalarField(points, nullptr, calcfield);
 
     Array3d<float>* calcfieldp = calcfield.getPointerToScalarField();
-    _copyField(calcfieldp, field);
-
+    _addField(calcfieldp, field);
 }
 
 void CLScalarField::_addPointValuesNoCL(std::vector<vmath::vec3> &points, 
@@ -1510,12 +1213,13 @@ void CLScalarField::_addPointValuesNoCL(std::vector<vmath::vec3> &points,
     ScalarField calcfield(field->width, field->height, field->depth, dx);
     calcfield.setPointRadius(radius);
     calcfield.setOffset(offset);
-    for (unsigned int i = 0; i < points.size(); i++) {
-        calcfield.addPointValue(points[i], values[i]);
+    if (_isMaxScalarFieldValueThresholdSet) {
+        calcfield.setMaxScalarFieldThreshold(_maxScalarFieldValueThreshold);
     }
+    _addPointValuesToScalarField(points, &values, calcfield);
 
     Array3d<float>* calcfieldp = calcfield.getPointerToScalarField();
-    _copyField(calcfieldp, field);
+    _addField(calcfieldp, field);
 }
 
 void CLScalarField::_addPointValuesNoCL(std::vector<vmath::vec3> &points, 
@@ -1530,21 +1234,96 @@ void CLScalarField::_addPointValuesNoCL(std::vector<vmath::vec3> &points,
     calcfield.enableWeightField();
     calcfield.setPointRadius(radius);
     calcfield.setOffset(offset);
-    for (unsigned int i = 0; i < points.size(); i++) {
-        calcfield.addPointValue(points[i], values[i]);
+    if (_isMaxScalarFieldValueThresholdSet) {
+        calcfield.setMaxScalarFieldThreshold(_maxScalarFieldValueThreshold);
     }
+    _addPointValuesToScalarField(points, &values, calcfield);
 
     Array3d<float>* calcfieldp = calcfield.getPointerToScalarField();
     Array3d<float>* calcweightfieldp = calcfield.getPointerToWeightField();
-    _copyField(calcfieldp, scalarfield);
-    _copyField(calcweightfieldp, weightfield);
+    _addField(calcfieldp, scalarfield);
+    _addField(calcweightfieldp, weightfield);
+}
+
+/*
+    The threaded backend sorts points into slabs along the k axis. Slabs are 
+    wide enough that points in slabs s and s + 2 never write to the same 
+    cell, so all even slabs are processed in parallel followed by all odd 
+    slabs. Points within a slab are added in their original order, so the
+    result does not depend on the number of threads.
+*/
+void CLScalarField::_addPointValuesToScalarField(std::vector<vmath::vec3> &points, 
+                                                 std::vector<float> *values,
+                                                 ScalarField &calcfield) {
+
+    if (_computeBackend == ComputeBackend::serial) {
+        for (unsigned int i = 0; i < points.size(); i++) {
+            if (values == nullptr) {
+                calcfield.addPoint(points[i]);
+            } else {
+                calcfield.addPointValue(points[i], (*values)[i]);
+            }
+        }
+        return;
+    }
+
+    int isize, jsize, ksize;
+    calcfield.getGridDimensions(&isize, &jsize, &ksize);
+    double dx = calcfield.getCellSize();
+    double offsetz = calcfield.getOffset().z;
+
+    int rcells = (int)ceil(calcfield.getPointRadius() / dx);
+    int slabWidth = 2*rcells + 2;
+    int numSlabs = (ksize + slabWidth - 1) / slabWidth;
+
+    std::vector<int> slabIndices(points.size());
+    std::vector<int> slabOffsets(numSlabs + 1, 0);
+    for (unsigned int i = 0; i < points.size(); i++) {
+        int k = (int)floor((points[i].z - offsetz) / dx);
+        k = (int)fmin(fmax(k, 0), ksize - 1);
+        slabIndices[i] = k / slabWidth;
+        slabOffsets[slabIndices[i] + 1]++;
+    }
+
+    for (int i = 0; i < numSlabs; i++) {
+        slabOffsets[i + 1] += slabOffsets[i];
+    }
+
+    std::vector<int> sortedIndices(points.size());
+    std::vector<int> slabCounts(slabOffsets.begin(), slabOffsets.end() - 1);
+    for (unsigned int i = 0; i < points.size(); i++) {
+        sortedIndices[slabCounts[slabIndices[i]]++] = i;
+    }
+
+    for (int parity = 0; parity < 2; parity++) {
+        int numTasks = (numSlabs - parity + 1) / 2;
+        auto func = [&, parity](int taskid) {
+            int slab = 2*taskid + parity;
+            for (int sidx = slabOffsets[slab]; sidx < slabOffsets[slab + 1]; sidx++) {
+                int i = sortedIndices[sidx];
+                if (values == nullptr) {
+                    calcfield.addPoint(points[i]);
+                } else {
+                    calcfield.addPointValue(points[i], (*values)[i]);
+                }
+            }
+        };
+
+        if (_threadPool == nullptr) {
+            for (int taskid = 0; taskid < numTasks; taskid++) {
+                func(taskid);
+            }
+        } else {
+            _threadPool->run(numTasks, func);
+        }
+    }
 }
 
-void CLScalarField::_copyField(Array3d<float> *src, Array3d<float> *dest) {
+void CLScalarField::_addField(Array3d<float> *src, Array3d<float> *dest) {
     for (int k = 0; k < dest->depth; k++) {
         for (int j = 0; j < dest->height; j++) {
             for (int i = 0; i < dest->width; i++) {
-                dest->set(i, j, k, src->get(i, j, k));
+                dest->add(i, j, k, src->get(i, j, k));
             }
         }
     }
@@ -21,30 +21,6 @@ freely, subject to the following restrictions:
 #ifndef CLSCALARFIELD_H
 #define CLSCALARFIELD_H
 
-#ifdef __GNUC__
-    #pragma GCC diagnostic push
-    #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
-#endif
-
-#ifdef _MSC_VER 
-    #pragma warning(push)
-    #pragma warning(disable : 4996 4512 4510 4512 4610 )
-#endif
-
-#if defined(__APPLE__) || defined(__MACOSX)
-    #include <OpenCL/cl.hpp>
-#else
-    #include <CL/cl.hpp>
-#endif
-
-#ifdef _MSC_VER 
-    #pragma warning(pop)
-#endif
-
-#ifdef __GNUC__
-  #pragma GCC diagnostic pop
-#endif
-
 #include <vector>
 #include <fstream>
 #include <algorithm>
@@ -60,13 +36,23 @@ freely, subject to the following restrictions:
 #include "config.h"
 #include "fluidsimassert.h"
 #include "kernels/kernels.h"
+#include "opencldevice.h"
+#include "clbufferpool.h"
+#include "computebackend.h"
+#include "threadpool.h"
 
 class CLScalarField
 {
 public:
     CLScalarField();
 
-    bool initialize();
+    /*
+        Compiles the OpenCL kernels on the shared device. Returns false if
+        the device is not initialized or the kernels could not be built.
+    */
+    bool initialize(OpenCLDevice *device);
+    bool isInitialized();
+
     void addPoints(std::vector<vmath::vec3> &points, 
                    double radius,
                    vmath::vec3 offset,
@@ -108,59 +94,36 @@ public:
     bool isMaxScalarFieldValueThresholdSet();
     double getMaxScalarFieldValueThreshold();
 
-    void setDevicePreference(std::string devtype);
-    void setDevicePreferenceGPU();
-    void setDevicePreferenceCPU();
-
-    void printDeviceInfo();
-    std::string getDeviceInfo();
     void printKernelInfo();
     std::string getKernelInfo();
-    bool isUsingGPU();
-    bool isUsingCPU();
+
+    /*
+        Backend used to compute scalar field values. The opencl backend 
+        requires a successful call to initialize().
+    */
+    void setComputeBackend(ComputeBackend backend);
+    ComputeBackend getComputeBackend();
     void disableOpenCL();
     void enableOpenCL();
     bool isOpenCLEnabled();
     int getKernelWorkLoadSize();
     void setKernelWorkLoadSize(int n);
 
-private:
-
-    struct CLDeviceInfo {
-        char cl_device_name[4096];
-        char cl_device_vendor[4096];
-        char cl_device_version[4096];
-        char cl_driver_version[4096];
-        char cl_device_opencl_c_version[4096];
-
-        cl_device_type device_type;
-        cl_uint cl_device_max_clock_frequency;
-        cl_ulong cl_device_global_mem_size;
-        cl_ulong cl_device_local_mem_size;
-        cl_ulong cl_device_max_mem_alloc_size;
-        size_t cl_device_max_work_group_size;
-        GridIndex cl_device_max_work_item_sizes;
-    };
-
-    struct CLKernelInfo {
-        char cl_kernel_function_name[4096];
-        char cl_kernel_attributes[4096];
+    /*
+        Thread pool used by the threaded compute backend. The pool is not 
+        owned by the CLScalarField. If no pool is set, points are added on 
+        the calling thread.
+    */
+    void setThreadPool(ThreadPool *pool);
 
-        cl_ulong cl_kernel_num_args;
-        size_t cl_kernel_work_group_size;
-        cl_ulong cl_kernel_local_mem_size;
-        cl_ulong cl_kernel_private_mem_size;
-        size_t cl_kernel_preferred_work_group_size_multiple;
-    };
+private:
 
-    struct DataBuffer {
-        std::vector<float> pointDataH;
-        std::vector<float> scalarFieldDataH;
-        std::vector<GridIndex> offsetDataH;
+#if CONFIG_WITH_OPENCL
 
-        cl::Buffer positionDataCL;
-        cl::Buffer scalarFieldDataCL;
-        cl::Buffer offsetDataCL;
+    enum class FieldComputation : char { 
+        points            = 0x00, 
+        pointValues       = 0x01, 
+        weightPointValues = 0x02
     };
 
     struct PointValue {
@@ -190,16 +153,24 @@ private:
         std::vector<PointValue>::iterator particlesEnd;
     };
 
-    void _checkError(cl_int err, const char * name);
-    cl::Context _getCLContext(cl_int *err);
-    cl::Device _getCLDevice(cl::Context &context, cl_int *err);
-    CLDeviceInfo _initializeDeviceInfo(cl::Device &device);
-    CLKernelInfo _initializeKernelInfo(cl::Kernel &kernel);
+    /*
+        Identifies a set of buffers in the buffer pool and the chunks that
+        are being computed with them. Two sets are used so that the host 
+        can prepare one computation while the device runs the other.
+    */
+    struct DataBuffer {
+        int pointDataID = 0;
+        int scalarFieldDataID = 0;
+        int offsetDataID = 0;
+
+        std::vector<WorkChunk> chunks;
+        int numParticles = 0;
+        cl::Event event;
+        bool isComputing = false;
+    };
+
     cl_int _initializeChunkDimensions();
     cl_int _initializeCLKernels();
-    std::string _getKernelInfo(CLKernelInfo &info);
-    std::string _getProgramString(std::string filename);
-    cl_int _initializeCLCommandQueue();
 
     vmath::vec3 _getInternalOffset();
     void _initializePointValues(std::vector<vmath::vec3> &points,
@@ -246,64 +217,45 @@ private:
     int _getMaxChunksPerPointValueComputation();
     int _getMaxChunksPerWeightPointValueComputation();
     int _getMaxChunkLimit(int pointDataSize, int fieldDataSize, int offsetDataSize);
-
-    void _computePointScalarField(std::vector<WorkChunk> &chunks,
-                                  Array3d<WorkGroup> &workGroupGrid);
-    void _computePointValueScalarField(std::vector<WorkChunk> &chunks,
-                                       Array3d<WorkGroup> &workGroupGrid);
-    void _computePointValueScalarWeightField(std::vector<WorkChunk> &chunks,
-                                             Array3d<WorkGroup> &workGroupGrid);
+    int _getChunksPerComputation(int numChunks, FieldComputation type);
+
+    void _computeScalarField(std::vector<WorkChunk> &workChunkQueue,
+                             Array3d<WorkGroup> &workGroupGrid,
+                             FieldComputation type);
+    void _launchComputation(DataBuffer &buffer,
+                            Array3d<WorkGroup> &workGroupGrid,
+                            FieldComputation type);
+    void _finishComputation(DataBuffer &buffer,
+                            Array3d<WorkGroup> &workGroupGrid,
+                            FieldComputation type);
     int _getMaxNumParticlesInChunk(std::vector<WorkChunk> &chunks);
-    void _initializePointComputationDataBuffer(std::vector<WorkChunk> &chunks,
-                                               Array3d<WorkGroup> &workGroupGrid,
-                                               int numParticles,
-                                               DataBuffer &buffer);
-    void _initializePointValueComputationDataBuffer(std::vector<WorkChunk> &chunks,
-                                                    Array3d<WorkGroup> &workGroupGrid,
-                                                    int numParticles,
-                                                    DataBuffer &buffer);
-    void _initializeWeightPointValueComputationDataBuffer(std::vector<WorkChunk> &chunks,
-                                                          Array3d<WorkGroup> &workGroupGrid,
-                                                          int numParticles,
-                                                          DataBuffer &buffer);
+    void _initializeDataBuffer(DataBuffer &buffer,
+                               Array3d<WorkGroup> &workGroupGrid,
+                               FieldComputation type);
     void _getHostPointDataBuffer(std::vector<WorkChunk> &chunks,
                                  Array3d<WorkGroup> &grid,
                                  int numParticles,
-                                 std::vector<float> &buffer);
+                                 float *buffer);
     void _getHostPointValueDataBuffer(std::vector<WorkChunk> &chunks,
                                       Array3d<WorkGroup> &grid,
                                       int numParticles,
-                                      std::vector<float> &buffer);
-    void _getHostScalarFieldDataBuffer(std::vector<WorkChunk> &chunks,
-                                       std::vector<float> &buffer);
-    void _getHostScalarWeightFieldDataBuffer(std::vector<WorkChunk> &chunks,
-                                             std::vector<float> &buffer);
+                                      float *buffer);
     void _getHostChunkOffsetDataBuffer(std::vector<WorkChunk> &chunks,
-                                       std::vector<GridIndex> &buffer);
-    void _initializeCLDataBuffers(DataBuffer &buffer);
-    void _setPointComputationCLKernelArgs(DataBuffer &buffer, int numParticles);
-    void _setPointValueComputationCLKernelArgs(DataBuffer &buffer, int numParticles);
-    void _setWeightPointValueComputationCLKernelArgs(DataBuffer &buffer, int numParticles);
-    void _setKernelArgs(cl::Kernel &kernel, 
-                        DataBuffer &buffer, 
-                        int localDataBytes,
-                        int numParticles, 
-                        double radius, 
-                        double dx);
+                                       GridIndex *buffer);
+    cl::Kernel& _getCLKernel(FieldComputation type);
+    void _setCLKernelArgs(DataBuffer &buffer, FieldComputation type);
     void _launchKernel(cl::Kernel &kernel, int numWorkItems, int workGroupSize);
-    void _readCLBuffer(cl::Buffer &sourceCL, std::vector<float> &destH, int dataSize);
-    void _setPointComputationOutputFieldData(std::vector<float> &buffer, 
-                                             std::vector<WorkChunk> &chunks,
-                                             Array3d<WorkGroup> &workGroupGrid);
-    void _setPointValueComputationOutputFieldData(std::vector<float> &buffer, 
-                                                  std::vector<WorkChunk> &chunks,
-                                                  Array3d<WorkGroup> &workGroupGrid);
-    void _setWeightPointValueComputationOutputFieldData(std::vector<float> &buffer, 
-                                                        std::vector<WorkChunk> &chunks,
-                                                        Array3d<WorkGroup> &workGroupGrid);
+    void _setScalarFieldOutputData(float *buffer, 
+                                   std::vector<WorkChunk> &chunks,
+                                   Array3d<WorkGroup> &workGroupGrid);
+    void _setScalarWeightFieldOutputData(float *buffer, 
+                                         std::vector<WorkChunk> &chunks,
+                                         Array3d<WorkGroup> &workGroupGrid);
     void _updateWorkGroupMinimumValues(Array3d<WorkGroup> &grid);
     float _getWorkGroupMinimumValue(WorkGroup *g);
 
+#endif
+
     void _addPointsNoCL(std::vector<vmath::vec3> &points, 
                         double radius,
                         vmath::vec3 offset,
@@ -322,23 +274,25 @@ private:
                              double dx,
                              Array3d<float> *scalarfield,
                              Array3d<float> *weightfield);
-    void _copyField(Array3d<float> *src, Array3d<float> *dest);
+    void _addPointValuesToScalarField(std::vector<vmath::vec3> &points, 
+                                      std::vector<float> *values,
+                                      ScalarField &calcfield);
+    void _addField(Array3d<float> *src, Array3d<float> *dest);
 
     bool _isInitialized = false;
+    OpenCLDevice *_device = nullptr;
+    ComputeBackend _computeBackend = ComputeBackend::threaded;
 
-    cl_device_type _devicePreference1 = CL_DEVICE_TYPE_GPU;
-    cl_device_type _devicePreference2 = CL_DEVICE_TYPE_CPU;
-
-    CLDeviceInfo _deviceInfo;
-    cl::Context _CLContext;
-    cl::Device _CLDevice;
+#if CONFIG_WITH_OPENCL
+    OpenCLDevice::CLDeviceInfo _deviceInfo;
     cl::Kernel _CLKernelPoints;
     cl::Kernel _CLKernelPointValues;
     cl::Kernel _CLKernelWeightPointValues;
-    CLKernelInfo _kernelPointsInfo;
-    CLKernelInfo _kernelPointValuesInfo;
-    CLKernelInfo _kernelWeightPointValuesInfo;
-    cl::CommandQueue _CLQueue;
+    OpenCLDevice::CLKernelInfo _kernelPointsInfo;
+    OpenCLDevice::CLKernelInfo _kernelPointValuesInfo;
+    OpenCLDevice::CLKernelInfo _kernelWeightPointValuesInfo;
+    CLBufferPool _bufferPool;
+#endif
 
     int _isize = 0;
     int _jsize = 0;
@@ -358,12 +312,14 @@ private:
     int _minWorkGroupSize = 32;
     int _maxParticlesPerChunk = 1000;
     int _maxChunksPerComputation = 15000;
+    int _minChunksPerComputation = 256;
+    int _minComputationsPerCall = 4;
     int _kernelWorkLoadSize = 1000;
 
     bool _isMaxScalarFieldValueThresholdSet = false;
     float _maxScalarFieldValueThreshold = 1.0;
 
-    bool _isOpenCLEnabled = true;
+    ThreadPool *_threadPool = nullptr;
     
 };
 
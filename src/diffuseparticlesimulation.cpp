@@ -26,7 +26,7 @@ DiffuseParticleSimulation::~DiffuseParticleSimulation() {
 }
 
 void DiffuseParticleSimulation::update(int isize, int jsize, int ksize, double dx,
-                                       FragmentedVector<MarkerParticle> *markerParticles,
+                                       MarkerParticleVector *markerParticles,
                                        MACVelocityField *vfield,
                                        LevelSet *levelset,
                                        FluidMaterialGrid *mgrid,
@@ -48,6 +48,7 @@ void DiffuseParticleSimulation::update(int isize, int jsize, int ksize, double d
     _materialGrid = mgrid;
     _particleAdvector = particleAdvector;
     _bodyForce = bodyForce;
+    _randomSeed = _mixRandomBits(_randomSeed);
 
 	std::vector<DiffuseParticleEmitter> emitters;
 	_getDiffuseParticleEmitters(emitters);
@@ -58,8 +59,16 @@ void DiffuseParticleSimulation::update(int isize, int jsize, int ksize, double d
     }
 
     _updateDiffuseParticleTypes();
+
+    DiffuseParticleRange bubbles, foam, spray;
+    _partitionDiffuseParticlesByType(&bubbles, &foam, &spray);
+
     _updateDiffuseParticleLifetimes(dt);
-    _advanceDiffuseParticles(dt);
+    _advanceSprayParticles(spray, dt);
+    _advanceBubbleParticles(bubbles, dt);
+    _advanceFoamParticles(foam, dt);
+
+    // Compaction keeps the particles partitioned by type
     _removeDiffuseParticles();
 }
 
@@ -177,31 +186,64 @@ void DiffuseParticleSimulation::setDiffuseParticleEmissionRates(double rwc,
     setDiffuseParticleTurbulenceEmissionRate(rt);
 }
 
+void DiffuseParticleSimulation::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
+    _turbulenceField.setThreadPool(pool);
+}
+
+void DiffuseParticleSimulation::_parallelForRange(int begin, int end, int grainSize,
+                                                  std::function<void(int, int)> func) {
+    if (_threadPool == nullptr) {
+        if (end > begin) {
+            func(begin, end);
+        }
+        return;
+    }
+
+    _threadPool->parallelForRange(begin, end, grainSize, func);
+}
+
 void DiffuseParticleSimulation::
 		_getDiffuseParticleEmitters(std::vector<DiffuseParticleEmitter> &emitters) {
 
 	_levelset->calculateSurfaceCurvature();
-    _turbulenceField.calculateTurbulenceField(_vfield, *_materialGrid);
 
     std::vector<vmath::vec3> surfaceParticles;
     std::vector<vmath::vec3> insideParticles;
     _sortMarkerParticlePositions(surfaceParticles, insideParticles);
+
+    // Turbulence is only sampled at inside particles
+    _turbulenceField.calculateTurbulenceField(_vfield, *_materialGrid, insideParticles);
     _getSurfaceDiffuseParticleEmitters(surfaceParticles, emitters);
     _getInsideDiffuseParticleEmitters(insideParticles, emitters);
-    _shuffleDiffuseParticleEmitters(emitters);
 }
 
 void DiffuseParticleSimulation::
         _sortMarkerParticlePositions(std::vector<vmath::vec3> &surface, 
                                      std::vector<vmath::vec3> &inside) {
-    vmath::vec3 p;
+    std::vector<vmath::vec3> *positions = _markerParticles->getPositions();
     double width = _diffuseSurfaceNarrowBandSize * _dx;
-    for (unsigned int i = 0; i < _markerParticles->size(); i++) {
-        p = _markerParticles->at(i).position;
-        if (_levelset->getDistance(p) < width) {
-            surface.push_back(p);
-        } else if (_levelset->isPointInInsideCell(p)) {
-            inside.push_back(p);
+
+    // Each chunk records which of its particles are near the surface (1) 
+    // or inside (2) so that both lists are gathered in particle order
+    std::vector<char> locations(positions->size(), 0);
+    _parallelForRange(0, (int)positions->size(), _particleChunkSize, 
+                      [&](int startidx, int endidx) {
+        for (int i = startidx; i < endidx; i++) {
+            vmath::vec3 &p = (*positions)[i];
+            if (_levelset->getDistance(p) < width) {
+                locations[i] = 1;
+            } else if (_levelset->isPointInInsideCell(p)) {
+                locations[i] = 2;
+            }
+        }
+    });
+
+    for (unsigned int i = 0; i < positions->size(); i++) {
+        if (locations[i] == 1) {
+            surface.push_back((*positions)[i]);
+        } else if (locations[i] == 2) {
+            inside.push_back((*positions)[i]);
         }
     }
 }
@@ -213,22 +255,24 @@ void DiffuseParticleSimulation::
     std::vector<vmath::vec3> velocities;
     _particleAdvector->tricubicInterpolate(surface, _vfield, velocities);
 
-    vmath::vec3 p, v;
-    for (unsigned int i = 0; i < surface.size(); i++) {
-        p = surface[i];
-        v = velocities[i];
-
-        double Iwc = _getWavecrestPotential(p, v);
-        double It = 0.0;
-
-        if (Iwc > 0.0 || It > 0.0) {
-            double Ie = _getEnergyPotential(v);
-            if (Ie > 0.0) {
-                emitters.push_back(DiffuseParticleEmitter(p, v, Ie, Iwc, It));
+    _gatherChunks<DiffuseParticleEmitter>((int)surface.size(), 
+                  [&](int startidx, int endidx, 
+                      std::vector<DiffuseParticleEmitter> &chunkEmitters) {
+        for (int i = startidx; i < endidx; i++) {
+            vmath::vec3 p = surface[i];
+            vmath::vec3 v = velocities[i];
+
+            double Iwc = _getWavecrestPotential(p, v);
+            double It = 0.0;
+
+            if (Iwc > 0.0 || It > 0.0) {
+                double Ie = _getEnergyPotential(v);
+                if (Ie > 0.0) {
+                    chunkEmitters.push_back(DiffuseParticleEmitter(p, v, Ie, Iwc, It));
+                }
             }
         }
-    }
-    
+    }, emitters);
 }
 
 double DiffuseParticleSimulation::
@@ -287,45 +331,81 @@ void DiffuseParticleSimulation::
     std::vector<vmath::vec3> velocities;
     _particleAdvector->tricubicInterpolate(inside, _vfield, velocities);
 
-    vmath::vec3 p, v;
-    for (unsigned int i = 0; i < inside.size(); i++) {
-        p = inside[i];
-        v = velocities[i];
-        double It = _getTurbulencePotential(p, _turbulenceField);
-
-        if (It > 0.0) {
-            double Ie = _getEnergyPotential(v);
-            if (Ie > 0.0) {
-                emitters.push_back(DiffuseParticleEmitter(p, v, Ie, 0.0, It));
+    _gatherChunks<DiffuseParticleEmitter>((int)inside.size(), 
+                  [&](int startidx, int endidx, 
+                      std::vector<DiffuseParticleEmitter> &chunkEmitters) {
+        for (int i = startidx; i < endidx; i++) {
+            vmath::vec3 p = inside[i];
+            vmath::vec3 v = velocities[i];
+            double It = _getTurbulencePotential(p, _turbulenceField);
+
+            if (It > 0.0) {
+                double Ie = _getEnergyPotential(v);
+                if (Ie > 0.0) {
+                    chunkEmitters.push_back(DiffuseParticleEmitter(p, v, Ie, 0.0, It));
+                }
             }
         }
-    }
+    }, emitters);
 }
 
 void DiffuseParticleSimulation::
         _shuffleDiffuseParticleEmitters(std::vector<DiffuseParticleEmitter> &emitters) {
+    // Emitters are numbered as streams from 0, so the shuffle uses the 
+    // stream after the last emitter
+    unsigned int stream = (unsigned int)emitters.size();
     DiffuseParticleEmitter em;
     for (int i = (int)emitters.size() - 2; i >= 0; i--) {
-        int j = (rand() % (int)(i - 0 + 1));
+        int j = _randomInt(stream, i) % (unsigned int)(i + 1);
         em = emitters[i];
         emitters[i] = emitters[j];
         emitters[j] = em;
     }
 }
 
+/*
+    Emission counts are assigned in emitter order until the particle limit is
+    reached. Emitters are only shuffled when the limit cuts emission short so
+    that the emitters that miss out are not always the same ones.
+*/
 void DiffuseParticleSimulation::
         _emitDiffuseParticles(std::vector<DiffuseParticleEmitter> &emitters,
                               double dt) {
 
-    std::vector<DiffuseParticle> newdps;
-    for (unsigned int i = 0; i < emitters.size(); i++) {
-        if (_diffuseParticles.size() >= _maxNumDiffuseParticles) {
-            return;
-        }
+    if (_diffuseParticles.size() >= _maxNumDiffuseParticles) {
+        return;
+    }
+    long long capacity = (long long)_maxNumDiffuseParticles - 
+                         (long long)_diffuseParticles.size();
 
-        _emitDiffuseParticles(emitters[i], dt, newdps);
+    std::vector<int> counts;
+    _getNumberOfEmissionParticles(emitters, dt, counts);
+
+    long long total = 0;
+    for (unsigned int i = 0; i < counts.size(); i++) {
+        total += counts[i];
+    }
+
+    if (total > capacity) {
+        _shuffleDiffuseParticleEmitters(emitters);
+        _getNumberOfEmissionParticles(emitters, dt, counts);
+
+        long long remaining = capacity;
+        for (unsigned int i = 0; i < counts.size(); i++) {
+            counts[i] = (int)std::min((long long)counts[i], remaining);
+            remaining -= counts[i];
+        }
     }
 
+    std::vector<DiffuseParticle> newdps;
+    _gatherChunks<DiffuseParticle>((int)emitters.size(), 
+                  [&](int startidx, int endidx, 
+                      std::vector<DiffuseParticle> &particles) {
+        for (int i = startidx; i < endidx; i++) {
+            _emitDiffuseParticles(emitters[i], i, counts[i], dt, particles);
+        }
+    }, newdps);
+
     _computeNewDiffuseParticleVelocities(newdps);
 
     _diffuseParticles.reserve((unsigned int)(_diffuseParticles.size() + newdps.size()));
@@ -336,14 +416,10 @@ void DiffuseParticleSimulation::
 
 void DiffuseParticleSimulation::
         _emitDiffuseParticles(DiffuseParticleEmitter &emitter, 
+                              int emitterIndex,
+                              int n,
                               double dt,
                               std::vector<DiffuseParticle> &particles) {
-    int n = _getNumberOfEmissionParticles(emitter, dt);
-
-    if (_diffuseParticles.size() + n >= _maxNumDiffuseParticles) {
-        n = _maxNumDiffuseParticles - _diffuseParticles.size();
-    }
-
     if (n <= 0) {
         return;
     }
@@ -362,18 +438,23 @@ void DiffuseParticleSimulation::
     e1 = e1*(float)particleRadius;
     vmath::vec3 e2 = vmath::normalize(vmath::cross(axis, e1)) * (float)particleRadius;
 
-    float Xr, Xt, Xh, r, theta, h, sinval, cosval, lifetime;
+    float maxLifetime = (float)(emitter.energyPotential*_maxDiffuseParticleLifetime);
+    float height = vmath::length((float)dt*emitter.velocity);
+
+    float Xr, Xt, Xh, Xl, r, theta, h, sinval, cosval, lifetime;
     vmath::vec3 p;
     vmath::vec3 v(0.0, 0.0, 0.0); // velocities will computed in bulk by ParticleAdvector
     GridIndex g;
+    unsigned int counter = 0;
     for (int i = 0; i < n; i++) {
-        Xr = (float)(rand()) / (float)RAND_MAX;
-        Xt = (float)(rand()) / (float)RAND_MAX;
-        Xh = (float)(rand()) / (float)RAND_MAX;
+        Xr = _randomFloat(emitterIndex, counter++);
+        Xt = _randomFloat(emitterIndex, counter++);
+        Xh = _randomFloat(emitterIndex, counter++);
+        Xl = _randomFloat(emitterIndex, counter++);
 
         r = particleRadius*sqrt(Xr);
         theta = Xt*2.0f*3.141592653f;
-        h = Xh*vmath::length((float)dt*emitter.velocity);
+        h = Xh*height;
         sinval = sin(theta);
         cosval = cos(theta);
 
@@ -384,12 +465,21 @@ void DiffuseParticleSimulation::
             continue;
         }
 
-        lifetime = (float)(emitter.energyPotential*_maxDiffuseParticleLifetime);
-        lifetime = _randomDouble(0.5*lifetime, lifetime);
+        lifetime = maxLifetime*(0.5f + 0.5f*Xl);
         particles.push_back(DiffuseParticle(p, v, lifetime));
     }
 }
 
+void DiffuseParticleSimulation::
+        _getNumberOfEmissionParticles(std::vector<DiffuseParticleEmitter> &emitters,
+                                      double dt,
+                                      std::vector<int> &counts) {
+    counts.resize(emitters.size());
+    for (unsigned int i = 0; i < emitters.size(); i++) {
+        counts[i] = _getNumberOfEmissionParticles(emitters[i], dt);
+    }
+}
+
 int DiffuseParticleSimulation::
         _getNumberOfEmissionParticles(DiffuseParticleEmitter &emitter,
                                       double dt) {
@@ -420,13 +510,13 @@ void DiffuseParticleSimulation::
 }
 
 void DiffuseParticleSimulation::_updateDiffuseParticleTypes() {
-    DiffuseParticle dp;
-    DiffuseParticleType type;
-    for (unsigned int i = 0; i < _diffuseParticles.size(); i++) {
-        dp = _diffuseParticles[i];
-        type = _getDiffuseParticleType(dp);
-        _diffuseParticles[i].type = type;
-    }
+    _parallelForRange(0, _diffuseParticles.size(), _particleChunkSize, 
+                      [this](int startidx, int endidx) {
+        for (int i = startidx; i < endidx; i++) {
+            DiffuseParticle &dp = _diffuseParticles[i];
+            dp.type = _getDiffuseParticleType(dp);
+        }
+    });
 }
 
 DiffuseParticleType DiffuseParticleSimulation::
@@ -456,122 +546,143 @@ DiffuseParticleType DiffuseParticleSimulation::
     return type;
 }
 
-void DiffuseParticleSimulation::_updateDiffuseParticleLifetimes(double dt) {
-    double maxDist = _maxSprayToSurfaceDistance*_dx;
-
-    DiffuseParticle dp;
-    for (unsigned int i = 0; i < _diffuseParticles.size(); i++) {
-        dp = _diffuseParticles[i];
-
-        double modifier = 0.0;
-        if (dp.type == DiffuseParticleType::spray) {
-            modifier = _sprayParticleLifetimeModifier;
-            if (_levelset->getDistance(dp.position) > maxDist) {
-                modifier = _sprayParticleMaxDistanceLifetimeModifier;
+/*
+    Orders the particles as bubbles, then foam, then spray so that each type
+    can be advanced over a contiguous range. Particles of a type are mostly
+    already grouped from the previous update, so few are moved.
+*/
+void DiffuseParticleSimulation::
+        _partitionDiffuseParticlesByType(DiffuseParticleRange *bubbles,
+                                         DiffuseParticleRange *foam,
+                                         DiffuseParticleRange *spray) {
+    int lo = 0;
+    int mid = 0;
+    int hi = (int)_diffuseParticles.size() - 1;
+    DiffuseParticle swap;
+    while (mid <= hi) {
+        DiffuseParticleType type = _diffuseParticles[mid].type;
+        if (type == DiffuseParticleType::bubble) {
+            if (lo != mid) {
+                swap = _diffuseParticles[lo];
+                _diffuseParticles[lo] = _diffuseParticles[mid];
+                _diffuseParticles[mid] = swap;
             }
-        } else if (dp.type == DiffuseParticleType::bubble) {
-            modifier = _bubbleParticleLifetimeModifier;
-        } else if (dp.type == DiffuseParticleType::foam) {
-            modifier = _foamParticleLifetimeModifier;
+            lo++;
+            mid++;
+        } else if (type == DiffuseParticleType::spray) {
+            swap = _diffuseParticles[hi];
+            _diffuseParticles[hi] = _diffuseParticles[mid];
+            _diffuseParticles[mid] = swap;
+            hi--;
+        } else {
+            mid++;
         }
-
-        _diffuseParticles[i].lifetime = dp.lifetime - (float)(modifier*dt);
     }
-}
 
-void DiffuseParticleSimulation::_advanceDiffuseParticles(double dt) {
-    _advanceSprayParticles(dt);
-    _advanceBubbleParticles(dt);
-    _advanceFoamParticles(dt);
+    *bubbles = DiffuseParticleRange(0, lo);
+    *foam = DiffuseParticleRange(lo, mid);
+    *spray = DiffuseParticleRange(mid, (int)_diffuseParticles.size());
 }
 
-void DiffuseParticleSimulation::_advanceSprayParticles(double dt) {
+void DiffuseParticleSimulation::_updateDiffuseParticleLifetimes(double dt) {
+    double maxDist = _maxSprayToSurfaceDistance*_dx;
 
-    DiffuseParticle dp;
-    vmath::vec3 nextv, nextp;
-    GridIndex g;
-    for (unsigned int i = 0; i < _diffuseParticles.size(); i++) {
-        dp = _diffuseParticles[i];
+    _parallelForRange(0, _diffuseParticles.size(), _particleChunkSize, 
+                      [this, maxDist, dt](int startidx, int endidx) {
+        for (int i = startidx; i < endidx; i++) {
+            DiffuseParticle &dp = _diffuseParticles[i];
+
+            double modifier = 0.0;
+            if (dp.type == DiffuseParticleType::spray) {
+                modifier = _sprayParticleLifetimeModifier;
+                if (_levelset->getDistance(dp.position) > maxDist) {
+                    modifier = _sprayParticleMaxDistanceLifetimeModifier;
+                }
+            } else if (dp.type == DiffuseParticleType::bubble) {
+                modifier = _bubbleParticleLifetimeModifier;
+            } else if (dp.type == DiffuseParticleType::foam) {
+                modifier = _foamParticleLifetimeModifier;
+            }
 
-        if (dp.type != DiffuseParticleType::spray) {
-            continue;
+            dp.lifetime = dp.lifetime - (float)(modifier*dt);
         }
+    });
+}
+
+void DiffuseParticleSimulation::_advanceSprayParticles(DiffuseParticleRange spray, 
+                                                       double dt) {
+    _parallelForRange(spray.begin, spray.end, _particleChunkSize, 
+                      [this, dt](int startidx, int endidx) {
+        vmath::vec3 nextv, nextp;
+        GridIndex g;
+        for (int i = startidx; i < endidx; i++) {
+            DiffuseParticle &dp = _diffuseParticles[i];
+
+            nextv = dp.velocity + _bodyForce * (float)dt;
+            nextp = dp.position + nextv * (float)dt;
+            
+            g = Grid3d::positionToGridIndex(nextp, _dx);
+            if (_materialGrid->isCellSolid(g)) {
+                nextp = _resolveParticleSolidCellCollision(dp.position, nextp);
+            }
 
-        nextv = dp.velocity + _bodyForce * (float)dt;
-        nextp = dp.position + nextv * (float)dt;
-        
-        g = Grid3d::positionToGridIndex(nextp, _dx);
-        if (_materialGrid->isCellSolid(g)) {
-            nextp = _resolveParticleSolidCellCollision(dp.position, nextp);
+            dp.position = nextp;
+            dp.velocity = nextv;
         }
-
-        _diffuseParticles[i].position = nextp;
-        _diffuseParticles[i].velocity = nextv;
-    }
+    });
 }
 
-void DiffuseParticleSimulation::_advanceBubbleParticles(double dt) {
-
-    int bubblecount = _getNumBubbleParticles();
-    if (bubblecount == 0) {
+void DiffuseParticleSimulation::_advanceBubbleParticles(DiffuseParticleRange bubbles, 
+                                                        double dt) {
+    if (bubbles.size() == 0) {
         return;
     }
 
     std::vector<vmath::vec3> data;
-    data.reserve(bubblecount);
-    for (unsigned int i = 0; i < _diffuseParticles.size(); i++) {
-        if (_diffuseParticles[i].type == DiffuseParticleType::bubble) {
-            data.push_back(_diffuseParticles[i].position);
-        }
+    data.reserve(bubbles.size());
+    for (int i = bubbles.begin; i < bubbles.end; i++) {
+        data.push_back(_diffuseParticles[i].position);
     }
 
     _particleAdvector->tricubicInterpolate(data, _vfield);
 
-    DiffuseParticle dp;
-    vmath::vec3 vmac, vbub, bouyancyVelocity, dragVelocity;
-    vmath::vec3 nextv, nextp;
-    GridIndex g;
-    int dataidx = 0;
-    for (unsigned int i = 0; i < _diffuseParticles.size(); i++) {
-        dp = _diffuseParticles[i];
-        
-        if (dp.type != DiffuseParticleType::bubble) {
-            continue;
-        }
-
-        vmac = data[dataidx];
-        vbub = dp.velocity;
-        bouyancyVelocity = (float)-_bubbleBouyancyCoefficient * _bodyForce;
-        dragVelocity = (float)_bubbleDragCoefficient*(vmac - vbub) / (float)dt;
-
-        nextv = dp.velocity + (float)dt*(bouyancyVelocity + dragVelocity);
-        nextp = dp.position + nextv * (float)dt;
+    vmath::vec3 bouyancyVelocity = (float)-_bubbleBouyancyCoefficient * _bodyForce;
+    _parallelForRange(bubbles.begin, bubbles.end, _particleChunkSize, 
+                      [&](int startidx, int endidx) {
+        vmath::vec3 vmac, vbub, dragVelocity;
+        vmath::vec3 nextv, nextp;
+        GridIndex g;
+        for (int i = startidx; i < endidx; i++) {
+            DiffuseParticle &dp = _diffuseParticles[i];
+
+            vmac = data[i - bubbles.begin];
+            vbub = dp.velocity;
+            dragVelocity = (float)_bubbleDragCoefficient*(vmac - vbub) / (float)dt;
+
+            nextv = dp.velocity + (float)dt*(bouyancyVelocity + dragVelocity);
+            nextp = dp.position + nextv * (float)dt;
+
+            g = Grid3d::positionToGridIndex(nextp, _dx);
+            if (_materialGrid->isCellSolid(g)) {
+                nextp = _resolveParticleSolidCellCollision(dp.position, nextp);
+            }
 
-        g = Grid3d::positionToGridIndex(nextp, _dx);
-        if (_materialGrid->isCellSolid(g)) {
-            nextp = _resolveParticleSolidCellCollision(dp.position, nextp);
+            dp.position = nextp;
+            dp.velocity = nextv;
         }
-
-        _diffuseParticles[i].position = nextp;
-        _diffuseParticles[i].velocity = nextv;
-
-        dataidx++;
-    }
+    });
 }
 
-void DiffuseParticleSimulation::_advanceFoamParticles(double dt) {
-
-    int foamcount = _getNumFoamParticles();
-    if (foamcount == 0) {
+void DiffuseParticleSimulation::_advanceFoamParticles(DiffuseParticleRange foam, 
+                                                      double dt) {
+    if (foam.size() == 0) {
         return;
     }
 
     std::vector<vmath::vec3> positions;
-    positions.reserve(foamcount);
-    for (unsigned int i = 0; i < _diffuseParticles.size(); i++) {
-        if (_diffuseParticles[i].type == DiffuseParticleType::foam) {
-            positions.push_back(_diffuseParticles[i].position);
-        }
+    positions.reserve(foam.size());
+    for (int i = foam.begin; i < foam.end; i++) {
+        positions.push_back(_diffuseParticles[i].position);
     }
 
     std::vector<vmath::vec3> nextpositions;
@@ -580,28 +691,23 @@ void DiffuseParticleSimulation::_advanceFoamParticles(double dt) {
                                           dt,
                                           nextpositions);
 
-    DiffuseParticle dp;
-    vmath::vec3 nextp;
-    GridIndex g;
-    int sprayidx = 0;
-    for (unsigned int i = 0; i < _diffuseParticles.size(); i++) {
-        dp = _diffuseParticles[i];
-        
-        if (dp.type != DiffuseParticleType::foam) {
-            continue;
-        }
-
-        nextp = nextpositions[sprayidx];
+    _parallelForRange(foam.begin, foam.end, _particleChunkSize, 
+                      [&](int startidx, int endidx) {
+        vmath::vec3 nextp;
+        GridIndex g;
+        for (int i = startidx; i < endidx; i++) {
+            DiffuseParticle &dp = _diffuseParticles[i];
 
-        g = Grid3d::positionToGridIndex(nextp, _dx);
-        if (_materialGrid->isCellSolid(g)) {
-            nextp = _resolveParticleSolidCellCollision(dp.position, nextp);
-        }
+            nextp = nextpositions[i - foam.begin];
 
-        _diffuseParticles[i].position = nextp;
+            g = Grid3d::positionToGridIndex(nextp, _dx);
+            if (_materialGrid->isCellSolid(g)) {
+                nextp = _resolveParticleSolidCellCollision(dp.position, nextp);
+            }
 
-        sprayidx++;
-    }
+            dp.position = nextp;
+        }
+    });
 }
 
 vmath::vec3 DiffuseParticleSimulation::
@@ -22,6 +22,7 @@ freely, subject to the following restrictions:
 #define DIFFUSEPARTICLESIMULATION_H
 
 #include <vector>
+#include <functional>
 
 #include "fragmentedvector.h"
 #include "macvelocityfield.h"
@@ -29,11 +30,12 @@ freely, subject to the following restrictions:
 #include "fluidmaterialgrid.h"
 #include "turbulencefield.h"
 #include "particleadvector.h"
-#include "markerparticle.h"
+#include "markerparticlevector.h"
 #include "diffuseparticle.h"
 #include "vmath.h"
 #include "grid3d.h"
 #include "collision.h"
+#include "threadpool.h"
 #include "fluidsimassert.h"
 
 class DiffuseParticleSimulation
@@ -44,7 +46,7 @@ public:
 	~DiffuseParticleSimulation();
 
 	void update(int isize, int jsize, int ksize, double dx,
-              FragmentedVector<MarkerParticle> *markerParticles,
+              MarkerParticleVector *markerParticles,
               MACVelocityField *vfield,
               LevelSet *levelset,
               FluidMaterialGrid *mgrid,
@@ -78,6 +80,8 @@ public:
   void setDiffuseParticleEmissionRates(double r);
   void setDiffuseParticleEmissionRates(double rwc, double rt);
 
+  void setThreadPool(ThreadPool *pool);
+
 private:
 
     struct DiffuseParticleEmitter {
@@ -100,6 +104,16 @@ private:
                                    turbulencePotential(t) {}
     };    
 
+    // Range of _diffuseParticles holding a single particle type
+    struct DiffuseParticleRange {
+        int begin = 0;
+        int end = 0;
+
+        DiffuseParticleRange() {}
+        DiffuseParticleRange(int b, int e) : begin(b), end(e) {}
+        int size() { return end - begin; }
+    };
+
     void _getDiffuseParticleEmitters(std::vector<DiffuseParticleEmitter> &emitters);
     void _sortMarkerParticlePositions(std::vector<vmath::vec3> &surface, 
                                       std::vector<vmath::vec3> &inside);
@@ -114,21 +128,28 @@ private:
 
     void _emitDiffuseParticles(std::vector<DiffuseParticleEmitter> &emitters, double dt);
     void _emitDiffuseParticles(DiffuseParticleEmitter &emitter, 
+                               int emitterIndex,
+                               int numParticles,
                                double dt,
                                std::vector<DiffuseParticle> &particles);
+    void _getNumberOfEmissionParticles(std::vector<DiffuseParticleEmitter> &emitters,
+                                       double dt,
+                                       std::vector<int> &counts);
     int _getNumberOfEmissionParticles(DiffuseParticleEmitter &emitter,
                                       double dt);
     void _computeNewDiffuseParticleVelocities(std::vector<DiffuseParticle> &particles);
 
     void _updateDiffuseParticleTypes();
     DiffuseParticleType _getDiffuseParticleType(DiffuseParticle &p);
+    void _partitionDiffuseParticlesByType(DiffuseParticleRange *bubbles,
+                                          DiffuseParticleRange *foam,
+                                          DiffuseParticleRange *spray);
 
     void _updateDiffuseParticleLifetimes(double dt);
 
-    void _advanceDiffuseParticles(double dt);
-    void _advanceSprayParticles(double dt);
-    void _advanceBubbleParticles(double dt);
-    void _advanceFoamParticles(double dt);
+    void _advanceSprayParticles(DiffuseParticleRange spray, double dt);
+    void _advanceBubbleParticles(DiffuseParticleRange bubbles, double dt);
+    void _advanceFoamParticles(DiffuseParticleRange foam, double dt);
     vmath::vec3 _resolveParticleSolidCellCollision(vmath::vec3 p0, 
                                                    vmath::vec3 p1);
     void _getDiffuseParticleTypeCounts(int *numspray, 
@@ -140,6 +161,39 @@ private:
 
     void _removeDiffuseParticles();
 
+    void _parallelForRange(int begin, int end, int grainSize,
+                           std::function<void(int, int)> func);
+
+    /*
+        Runs func over [0, n) in chunks of _particleChunkSize. Each chunk 
+        appends to its own buffer and the buffers are joined in chunk order,
+        so the result does not depend on the number of threads.
+    */
+    template<class T>
+    void _gatherChunks(int n, 
+                       std::function<void(int, int, std::vector<T> &)> func,
+                       std::vector<T> &result) {
+        int chunkSize = _particleChunkSize;
+        int numChunks = (n + chunkSize - 1) / chunkSize;
+        std::vector<std::vector<T> > buffers(numChunks);
+        _parallelForRange(0, numChunks, 1, [&](int startidx, int endidx) {
+            for (int cidx = startidx; cidx < endidx; cidx++) {
+                int begin = cidx * chunkSize;
+                int end = std::min(begin + chunkSize, n);
+                func(begin, end, buffers[cidx]);
+            }
+        });
+
+        size_t count = result.size();
+        for (int cidx = 0; cidx < numChunks; cidx++) {
+            count += buffers[cidx].size();
+        }
+        result.reserve(count);
+        for (int cidx = 0; cidx < numChunks; cidx++) {
+            result.insert(result.end(), buffers[cidx].begin(), buffers[cidx].end());
+        }
+    }
+
     template<class T>
     void _removeItemsFromVector(FragmentedVector<T> &items, std::vector<bool> &isRemoved) {
         FLUIDSIM_ASSERT(items.size() == isRemoved.size());
@@ -158,8 +212,27 @@ private:
         items.shrink_to_fit();
     }
 
-    inline double _randomDouble(double min, double max) {
-        return min + (double)rand() / ((double)RAND_MAX / (max - min));
+    /*
+        Counter based random numbers. A value depends only on the seed of 
+        the current update, a stream (such as an emitter index) and a 
+        counter within that stream, so particles can be emitted in any order
+        and on any thread with the same result.
+    */
+    inline unsigned long long _mixRandomBits(unsigned long long x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    inline unsigned int _randomInt(unsigned int stream, unsigned int counter) {
+        unsigned long long key = ((unsigned long long)stream << 32) | counter;
+        return (unsigned int)(_mixRandomBits(key + _randomSeed) >> 32);
+    }
+
+    // Uniform in [0, 1)
+    inline float _randomFloat(unsigned int stream, unsigned int counter) {
+        return (float)(_randomInt(stream, counter) >> 8) * (1.0f / 16777216.0f);
     }
 
     int _isize = 0;
@@ -190,7 +263,7 @@ private:
     double _bubbleDragCoefficient = 1.0;
     int _maxDiffuseParticlesPerCell = 250;
 
-    FragmentedVector<MarkerParticle> *_markerParticles;
+    MarkerParticleVector *_markerParticles;
     MACVelocityField *_vfield;
     LevelSet *_levelset;
     FluidMaterialGrid *_materialGrid;
@@ -199,6 +272,10 @@ private:
 
     TurbulenceField _turbulenceField;
     FragmentedVector<DiffuseParticle> _diffuseParticles;
+
+    ThreadPool *_threadPool = nullptr;
+    int _particleChunkSize = 4096;
+    unsigned long long _randomSeed = 0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,240 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../../array3d.h"
+#include "../../array3dlayout.h"
+#include "../../fluidmaterialgrid.h"
+#include "../../grid3d.h"
+#include "../../vmath.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/*
+    Each stage mirrors the access pattern of a simulation kernel over a
+    grid with the given storage layout and returns a checksum so that the
+    work cannot be optimized away. The checksum must match across layouts.
+*/
+
+// TurbulenceField::_calculateTurbulenceAtGridCell
+template <class Layout>
+double layout_stage_turbulence(int n, std::vector<GridIndex> &cells) {
+    Array3d<vmath::vec3, Layout> vgrid(n, n, n);
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < n; i++) {
+                vgrid.set(i, j, k, vmath::vec3(sin(0.1*i + 0.2*j), cos(0.3*k), sin(0.1*(i + k))));
+            }
+        }
+    }
+
+    GridIndex nbs[124];
+    double sum = 0.0;
+    for (unsigned int cidx = 0; cidx < cells.size(); cidx++) {
+        GridIndex g = cells[cidx];
+        vmath::vec3 vi = vgrid(g);
+        Grid3d::getNeighbourGridIndices124(g, nbs);
+        for (int idx = 0; idx < 124; idx++) {
+            if (!Grid3d::isGridIndexInRange(nbs[idx], n, n, n)) {
+                continue;
+            }
+            vmath::vec3 vij = vi - vgrid(nbs[idx]);
+            sum += vmath::dot(vij, vij);
+        }
+    }
+
+    return sum;
+}
+
+// MACVelocityField::_extrapolateVelocityForLayer
+template <class Layout>
+double layout_stage_extrapolation(int n, std::vector<GridIndex> &cells) {
+    Array3d<float, Layout> field(n + 1, n, n);
+    Array3d<int, Layout> layers(n + 1, n, n);
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < n + 1; i++) {
+                field.set(i, j, k, (float)sin(0.1*i + 0.2*j + 0.3*k));
+                layers.set(i, j, k, ((i*7 + j*13 + k*5) % 3) - 1);
+            }
+        }
+    }
+
+    GridIndex nbs[26];
+    double sum = 0.0;
+    for (unsigned int cidx = 0; cidx < cells.size(); cidx++) {
+        GridIndex g = cells[cidx];
+        if (layers(g) != 1) {
+            continue;
+        }
+
+        Grid3d::getNeighbourGridIndices26(g, nbs);
+        float avg = 0.0f;
+        int count = 0;
+        for (int idx = 0; idx < 26; idx++) {
+            if (Grid3d::isGridIndexInRange(nbs[idx], n + 1, n, n) && layers(nbs[idx]) == 0) {
+                avg += field(nbs[idx]);
+                count++;
+            }
+        }
+        if (count > 0) {
+            sum += avg / count;
+        }
+    }
+
+    return sum;
+}
+
+// TricubicInterpolator 4x4x4 gather at unordered particle positions
+template <class Layout>
+double layout_stage_tricubic(int n, std::vector<vmath::vec3> &points) {
+    Array3d<float, Layout> field(n, n, n);
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < n; i++) {
+                field.set(i, j, k, (float)cos(0.1*i + 0.2*j + 0.3*k));
+            }
+        }
+    }
+
+    double sum = 0.0;
+    for (unsigned int pidx = 0; pidx < points.size(); pidx++) {
+        vmath::vec3 p = points[pidx];
+        int pi = (int)p.x - 1;
+        int pj = (int)p.y - 1;
+        int pk = (int)p.z - 1;
+        for (int k = 0; k < 4; k++) {
+            for (int j = 0; j < 4; j++) {
+                for (int i = 0; i < 4; i++) {
+                    sum += field(pi + i, pj + j, pk + k);
+                }
+            }
+        }
+    }
+
+    return sum;
+}
+
+// FluidMaterialGrid::isCellNeighbouringSolid and face queries
+template <class Layout>
+double layout_stage_material(int n, std::vector<GridIndex> &cells) {
+    Array3d<Material, Layout> mgrid(n, n, n);
+    mgrid.setOutOfRangeValue(Material::solid);
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < n; i++) {
+                int m = (i*i + 3*j + 5*k*k) % 7;
+                mgrid.set(i, j, k, m == 0 ? Material::solid : 
+                                   (m < 4 ? Material::fluid : Material::air));
+            }
+        }
+    }
+
+    GridIndex nbs[6];
+    double sum = 0.0;
+    for (int iter = 0; iter < 4; iter++) {
+        for (unsigned int cidx = 0; cidx < cells.size(); cidx++) {
+            GridIndex g = cells[cidx];
+            if (mgrid(g) != Material::fluid) {
+                continue;
+            }
+            Grid3d::getNeighbourGridIndices6(g, nbs);
+            for (int idx = 0; idx < 6; idx++) {
+                if (mgrid(nbs[idx]) == Material::solid) {
+                    sum += 1.0;
+                }
+            }
+        }
+    }
+
+    return sum;
+}
+
+template <class Layout>
+void benchmark_grid_layout(const char *name, int n, 
+                           std::vector<GridIndex> &cells, 
+                           std::vector<vmath::vec3> &points) {
+    int numRuns = 3;
+    double checksums[4] = {0.0, 0.0, 0.0, 0.0};
+    double times[4];
+    for (int stage = 0; stage < 4; stage++) {
+        auto t1 = std::chrono::steady_clock::now();
+        for (int run = 0; run < numRuns; run++) {
+            switch (stage) {
+                case 0: checksums[stage] = layout_stage_turbulence<Layout>(n, cells); break;
+                case 1: checksums[stage] = layout_stage_extrapolation<Layout>(n, cells); break;
+                case 2: checksums[stage] = layout_stage_tricubic<Layout>(n, points); break;
+                case 3: checksums[stage] = layout_stage_material<Layout>(n, cells); break;
+            }
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        times[stage] = std::chrono::duration<double, std::milli>(t2 - t1).count() / numRuns;
+    }
+
+    printf("%-8s %6d %14.2f %14.2f %14.2f %14.2f   %16.6e %16.6e %16.6e %16.6e\n", 
+           name, n, times[0], times[1], times[2], times[3],
+           checksums[0], checksums[1], checksums[2], checksums[3]);
+}
+
+void example_grid_layout_benchmark() {
+
+    // This example times the neighbour access patterns of the turbulence,
+    // velocity extrapolation, tricubic interpolation and material grid 
+    // stages with each Array3d storage layout. Grid cells are visited in 
+    // the same i-fastest order that the simulation uses and interpolation 
+    // points are visited in random order. The checksum of each stage 
+    // should be identical for every layout.
+
+    printf("%-8s %6s %14s %14s %14s %14s   %16s %16s %16s %16s\n", 
+           "layout", "grid", "turbulence ms", "extrapolate ms", "tricubic ms", "material ms",
+           "turbulence sum", "extrapolate sum", "tricubic sum", "material sum");
+
+    int gridsizes[3] = {64, 128, 192};
+    for (int gidx = 0; gidx < 3; gidx++) {
+        int n = gridsizes[gidx];
+
+        std::vector<GridIndex> cells;
+        cells.reserve(n*n*n);
+        for (int k = 0; k < n; k++) {
+            for (int j = 0; j < n; j++) {
+                for (int i = 0; i < n; i++) {
+                    cells.push_back(GridIndex(i, j, k));
+                }
+            }
+        }
+
+        std::vector<vmath::vec3> points;
+        int numPoints = n*n*n / 4;
+        points.reserve(numPoints);
+        srand(n);
+        for (int i = 0; i < numPoints; i++) {
+            float range = (float)(n - 4);
+            points.push_back(vmath::vec3(1.0f + range*rand()/(float)RAND_MAX,
+                                         1.0f + range*rand()/(float)RAND_MAX,
+                                         1.0f + range*rand()/(float)RAND_MAX));
+        }
+
+        benchmark_grid_layout<Array3dLinearLayout>("linear", n, cells, points);
+        benchmark_grid_layout<Array3dTiledLayout>("tiled", n, cells, points);
+        benchmark_grid_layout<Array3dMortonLayout>("morton", n, cells, points);
+    }
+}
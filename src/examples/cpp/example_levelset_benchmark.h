@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "../../levelset.h"
+#include "../../trianglemesh.h"
+#include "../../threadpool.h"
+#include "../../vmath.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+/*
+    Appends a UV sphere with outward facing vertex normals to a mesh.
+*/
+void add_sphere_to_mesh(vmath::vec3 center, double radius, int numSegments,
+                        TriangleMesh &mesh) {
+    double pi = 3.14159265358979;
+    int numRings = numSegments / 2;
+    int base = (int)mesh.vertices.size();
+    for (int r = 0; r <= numRings; r++) {
+        for (int s = 0; s < numSegments; s++) {
+            double theta = pi * r / numRings;
+            double phi = 2.0 * pi * s / numSegments;
+            vmath::vec3 n(sin(theta)*cos(phi), cos(theta), sin(theta)*sin(phi));
+            mesh.vertices.push_back(center + (float)radius*n);
+            mesh.normals.push_back(n);
+        }
+    }
+
+    for (int r = 0; r < numRings; r++) {
+        for (int s = 0; s < numSegments; s++) {
+            int v0 = base + r*numSegments + s;
+            int v1 = base + r*numSegments + (s + 1) % numSegments;
+            int v2 = v0 + numSegments;
+            int v3 = v1 + numSegments;
+            mesh.triangles.push_back(Triangle(v0, v2, v1));
+            mesh.triangles.push_back(Triangle(v1, v2, v3));
+        }
+    }
+}
+
+/*
+    Computes the level set of a sphere with the layer propagation and fast
+    sweeping methods and reports the time per calculation along with the
+    error against the exact sphere distance within the narrow band.
+*/
+void benchmark_levelset(int gridsize, int numLayers, ThreadPool *pool, bool isFastSweeping) {
+    double dx = 1.0 / gridsize;
+    vmath::vec3 center(0.45, 0.5, 0.55);
+    double radius = 0.3;
+
+    TriangleMesh mesh;
+    add_sphere_to_mesh(center, radius, 2*gridsize, mesh);
+
+    LevelSet levelset(gridsize, gridsize, gridsize, dx);
+    levelset.setThreadPool(pool);
+    levelset.setSurfaceMesh(mesh);
+    if (isFastSweeping) {
+        levelset.enableFastSweeping();
+    }
+
+    int numRuns = 3;
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < numRuns; i++) {
+        levelset.calculateSignedDistanceField(numLayers);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    double time = std::chrono::duration<double, std::milli>(t2 - t1).count() / numRuns;
+
+    double maxerr = 0.0;
+    double sumerr = 0.0;
+    int numBandCells = 0;
+    for (int k = 0; k < gridsize; k++) {
+        for (int j = 0; j < gridsize; j++) {
+            for (int i = 0; i < gridsize; i++) {
+                double d = levelset.getSignedDistance(GridIndex(i, j, k));
+                if (std::isinf(d)) {
+                    continue;
+                }
+
+                vmath::vec3 p = Grid3d::GridIndexToCellCenter(i, j, k, dx);
+                double exact = radius - vmath::length(p - center);
+                double err = fabs(d - exact) / dx;
+                maxerr = fmax(maxerr, err);
+                sumerr += err;
+                numBandCells++;
+            }
+        }
+    }
+
+    printf("%-15s %6d %10d %12.2f %14.4f %14.4f\n", 
+           isFastSweeping ? "fast sweeping" : "layers", gridsize, numBandCells, 
+           time, sumerr / fmax(numBandCells, 1), maxerr);
+}
+
+void example_levelset_benchmark() {
+
+    // This example compares the accuracy and speed of the level set
+    // redistancing methods over a range of grid sizes. Errors are measured
+    // in units of cell size against the exact distance to a sphere.
+
+    int numLayers = 7;
+    ThreadPool pool(ThreadPool::getMaxThreadCount());
+
+    printf("%-15s %6s %10s %12s %14s %14s\n", 
+           "method", "grid", "band cells", "time (ms)", "mean error/dx", "max error/dx");
+    
+    int gridsizes[4] = {32, 64, 128, 256};
+    for (int i = 0; i < 4; i++) {
+        benchmark_levelset(gridsizes[i], numLayers, &pool, false);
+        benchmark_levelset(gridsizes[i], numLayers, &pool, true);
+    }
+    
+}
@@ -29,15 +29,15 @@ FluidBrickGridSaveState::~FluidBrickGridSaveState() {
 }
 
 void FluidBrickGridSaveState::saveState(std::string filename, FluidBrickGrid *brickgrid) {
-
-    std::ofstream erasefile;
-    erasefile.open(filename, std::ofstream::out | std::ofstream::trunc);
-    erasefile.close();
-
     std::ofstream state(filename.c_str(), std::ios::out | std::ios::binary);
-
     FLUIDSIM_ASSERT(state.is_open());
 
+    saveState(&state, brickgrid);
+
+    state.close();
+}
+
+void FluidBrickGridSaveState::saveState(std::ostream *state, FluidBrickGrid *brickgrid) {
     int i, j, k;
     brickgrid->getGridDimensions(&i, &j, &k);
 
@@ -50,24 +50,24 @@ void FluidBrickGridSaveState::saveState(std::string filename, FluidBrickGrid *br
     _numUpdates = brickgrid->getNumUpdates();
 
     // i, j, k, dx
-    _writeInt(&_isize, &state);
-    _writeInt(&_jsize, &state);
-    _writeInt(&_ksize, &state);
-    _writeDouble(&_dx, &state);
+    _writeInt(&_isize, state);
+    _writeInt(&_jsize, state);
+    _writeInt(&_ksize, state);
+    _writeDouble(&_dx, state);
 
     // brick width, height, depth
-    _writeDouble(&_brickAABB.width, &state);
-    _writeDouble(&_brickAABB.height, &state);
-    _writeDouble(&_brickAABB.depth, &state);
+    _writeDouble(&_brickAABB.width, state);
+    _writeDouble(&_brickAABB.height, state);
+    _writeDouble(&_brickAABB.depth, state);
 
     // queuesize, num updates
-    _writeInt(&_brickGridQueueSize, &state);
-    _writeInt(&_numUpdates, &state);
+    _writeInt(&_brickGridQueueSize, state);
+    _writeInt(&_numUpdates, state);
 
     // in form: 
     // {{list current densities (floats)}, {list target densities (floats)},
     // {list intensity velocities (floats)}}
-    _writeBinaryDensityGrid(brickgrid, &state);
+    _writeBinaryDensityGrid(brickgrid, state);
 
     // in form:
     // {{isActive  values for queue[0] (bools)}, 
@@ -76,9 +76,7 @@ void FluidBrickGridSaveState::saveState(std::string filename, FluidBrickGrid *br
     //  {intensity values for queue[1] (floats)}, 
     //  {isActive  values for queue[2] (bools)},
     //  {intensity values for queue[2] (floats)}}
-    _writeBinaryBrickGridQueue(brickgrid, &state);
-
-    state.close();
+    _writeBinaryBrickGridQueue(brickgrid, state);
 }
 
 bool FluidBrickGridSaveState::loadState(std::string filename) {
@@ -89,15 +87,33 @@ bool FluidBrickGridSaveState::loadState(std::string filename) {
         return false;
     }
 
-    bool success = _readInt(&_isize, &_loadState) &&
-                   _readInt(&_jsize, &_loadState) &&
-                   _readInt(&_ksize, &_loadState) &&
-                   _readDouble(&_dx, &_loadState) &&
-                   _readDouble(&(_brickAABB.width), &_loadState) &&
-                   _readDouble(&(_brickAABB.height), &_loadState) &&
-                   _readDouble(&(_brickAABB.depth), &_loadState) &&
-                   _readInt(&_brickGridQueueSize, &_loadState) &&
-                   _readInt(&_numUpdates, &_loadState);
+    _loadState.seekg (0, _loadState.end);
+    unsigned int eofOffset = _loadState.tellg();
+    _loadState.seekg (0, _loadState.beg);
+    _currentOffset = 0;
+
+    return _initializeLoadState(eofOffset);
+}
+
+bool FluidBrickGridSaveState::loadState(const char *data, size_t size) {
+    _loadStateData = data;
+    _currentOffset = 0;
+
+    return _initializeLoadState((unsigned int)size);
+}
+
+bool FluidBrickGridSaveState::_initializeLoadState(unsigned int eofOffset) {
+    _eofOffset = eofOffset;
+
+    bool success = _readInt(&_isize) &&
+                   _readInt(&_jsize) &&
+                   _readInt(&_ksize) &&
+                   _readDouble(&_dx) &&
+                   _readDouble(&(_brickAABB.width)) &&
+                   _readDouble(&(_brickAABB.height)) &&
+                   _readDouble(&(_brickAABB.depth)) &&
+                   _readInt(&_brickGridQueueSize) &&
+                   _readInt(&_numUpdates);
 
     if (!success) {
         return false;
@@ -109,7 +125,7 @@ bool FluidBrickGridSaveState::loadState(std::string filename) {
     _getBrickGridDimensions(&bisize, &bjsize, &bksize);
     int numBrickGridElements = bisize*bjsize*bksize;
 
-    _currentDensityOffset = _loadState.tellg();
+    _currentDensityOffset = _currentOffset;
     _targetDensityOffset = _currentDensityOffset + numGridElements * sizeof(float);
     _velocityDensityOffset = _targetDensityOffset + numGridElements * sizeof(float);
 
@@ -129,16 +145,10 @@ bool FluidBrickGridSaveState::loadState(std::string filename) {
         endoff = _brickGridOffset3 + numBrickGridElements * (sizeof(bool) + sizeof(float));
     }
 
-    _loadState.seekg (0, _loadState.end);
-    _eofOffset = _loadState.tellg();
-    _loadState.seekg (0, _loadState.beg);
-
     if (endoff != _eofOffset) {
         return false;
     }
 
-    _currentOffset = _loadState.tellg();
-
     _isLoadStateInitialized = true;
 
     return true;
@@ -151,8 +161,9 @@ bool FluidBrickGridSaveState::isLoadStateInitialized() {
 void FluidBrickGridSaveState::closeState() {
     if (_loadState.is_open()) {
         _loadState.close();
-        _isLoadStateInitialized = false;
     }
+    _loadStateData = nullptr;
+    _isLoadStateInitialized = false;
 }
 
 void FluidBrickGridSaveState::getGridDimensions(int *i, int *j, int *k) {
@@ -279,16 +290,16 @@ void FluidBrickGridSaveState::getBrickIntensityGrid(Array3d<float> &grid, int id
     FLUIDSIM_ASSERT(_readLoadState(bin, binsize));
 }
 
-void FluidBrickGridSaveState::_writeInt(int *value, std::ofstream *state) {
+void FluidBrickGridSaveState::_writeInt(int *value, std::ostream *state) {
     state->write((char *)value, sizeof(int));
 }
 
-void FluidBrickGridSaveState::_writeDouble(double *value, std::ofstream *state) {
+void FluidBrickGridSaveState::_writeDouble(double *value, std::ostream *state) {
     state->write((char *)value, sizeof(double));
 }
 
 void FluidBrickGridSaveState::_writeBinaryDensityGrid(FluidBrickGrid *brickgrid, 
-                                                      std::ofstream *state) {
+                                                      std::ostream *state) {
     Array3d<float> tempgrid(_isize, _jsize, _ksize);
     brickgrid->getDensityGridCurrentDensityValues(tempgrid);
     _writeBinaryArray3df(tempgrid, state);
@@ -301,7 +312,7 @@ void FluidBrickGridSaveState::_writeBinaryDensityGrid(FluidBrickGrid *brickgrid,
 }
 
 void FluidBrickGridSaveState::_writeBinaryBrickGridQueue(FluidBrickGrid *brickgrid, 
-                                                         std::ofstream *state) {
+                                                         std::ostream *state) {
     Array3d<Brick> *queue = brickgrid->getPointerToBrickGridQueue();
     
     Array3d<Brick> *b1 = &(queue[0]);
@@ -320,7 +331,7 @@ void FluidBrickGridSaveState::_writeBinaryBrickGridQueue(FluidBrickGrid *brickgr
 }
 
 void FluidBrickGridSaveState::_writeBinaryBrickGrid(Array3d<Brick> *grid,
-                                                    std::ofstream *state) {
+                                                    std::ostream *state) {
     Array3d<bool> isActiveGrid(grid->width, grid->height, grid->depth);
     Array3d<float> intensityGrid(grid->width, grid->height, grid->depth);
 
@@ -337,52 +348,38 @@ void FluidBrickGridSaveState::_writeBinaryBrickGrid(Array3d<Brick> *grid,
 }
 
 void FluidBrickGridSaveState::_writeBinaryArray3df(Array3d<float> &grid, 
-                                                   std::ofstream *state) {
+                                                   std::ostream *state) {
     int binsize = grid.width * grid.height * grid.depth * sizeof(float);
     char *data = (char *)grid.getRawArray();
     state->write(data, binsize);
 }
 
 void FluidBrickGridSaveState::_writeBinaryArray3db(Array3d<bool> &grid, 
-                                                   std::ofstream *state) {
+                                                   std::ostream *state) {
     int binsize = grid.width * grid.height * grid.depth * sizeof(bool);
     char *data = (char *)grid.getRawArray();
     state->write(data, binsize);
 }
 
 void FluidBrickGridSaveState::_setLoadStateFileOffset(unsigned int foffset) {
-    if (foffset != _currentOffset) {
+    if (foffset == _currentOffset) {
+        return;
+    }
+
+    if (_loadStateData != nullptr) {
+        _currentOffset = foffset;
+    } else {
         _loadState.seekg(foffset);
         _currentOffset = _loadState.tellg();
     }
 }
 
-bool FluidBrickGridSaveState::_readInt(int *value, std::ifstream *state) {
-    char bin[sizeof(int)];
-    state->read(bin, sizeof(int));
-    _currentOffset = _loadState.tellg();
-
-    if (!state->good()) {
-        return false;
-    }
-
-    memcpy(value, bin, sizeof(int));
-
-    return true;
+bool FluidBrickGridSaveState::_readInt(int *value) {
+    return _readLoadState((char *)value, sizeof(int));
 }
 
-bool FluidBrickGridSaveState::_readDouble(double *value, std::ifstream *state) {
-    char bin[sizeof(double)];
-    state->read(bin, sizeof(double));
-    _currentOffset = _loadState.tellg();
-
-    if (!state->good()) {
-        return false;
-    }
-
-    memcpy(value, bin, sizeof(double));
-
-    return true;
+bool FluidBrickGridSaveState::_readDouble(double *value) {
+    return _readLoadState((char *)value, sizeof(double));
 }
 
 void FluidBrickGridSaveState::_getBrickGridDimensions(int *bi, int *bj, int *bk) {
@@ -395,6 +392,15 @@ void FluidBrickGridSaveState::_getBrickGridDimensions(int *bi, int *bj, int *bk)
 }
 
 bool FluidBrickGridSaveState::_readLoadState(char *dest, unsigned int numBytes) {
+    if (_loadStateData != nullptr) {
+        if (_currentOffset + numBytes > _eofOffset) {
+            return false;
+        }
+        memcpy(dest, _loadStateData + _currentOffset, numBytes);
+        _currentOffset += numBytes;
+        return true;
+    }
+
     _loadState.read(dest, numBytes);
     _currentOffset = _loadState.tellg();
     return _loadState.good();
@@ -22,6 +22,7 @@ freely, subject to the following restrictions:
 
 #include <vector>
 #include <fstream>
+#include <ostream>
 
 #include "array3d.h"
 #include "vmath.h"
@@ -38,7 +39,20 @@ public:
     ~FluidBrickGridSaveState();
 
     void saveState(std::string filename, FluidBrickGrid *brickgrid);
+
+    /*
+        Writes the save state to the current position of an open stream.
+        The data written is identical to the contents of a save state file.
+    */
+    void saveState(std::ostream *state, FluidBrickGrid *brickgrid);
     bool loadState(std::string filename);
+
+    /*
+        Loads a save state from a buffer holding the contents of a save state 
+        file. The buffer is not copied and must remain valid until the state 
+        is closed.
+    */
+    bool loadState(const char *data, size_t size);
     void closeState();
 
     bool isLoadStateInitialized();
@@ -56,26 +70,28 @@ public:
 
 private:
 
-    void _writeInt(int *value, std::ofstream *state);
-    void _writeDouble(double *value, std::ofstream *state);
+    void _writeInt(int *value, std::ostream *state);
+    void _writeDouble(double *value, std::ostream *state);
     void _writeBinaryDensityGrid(FluidBrickGrid *brickgrid, 
-                                 std::ofstream *state);
+                                 std::ostream *state);
     void _writeBinaryBrickGridQueue(FluidBrickGrid *brickgrid, 
-                                    std::ofstream *state);
+                                    std::ostream *state);
     void _writeBinaryBrickGrid(Array3d<Brick> *grid,
-                               std::ofstream *state);
+                               std::ostream *state);
     void _writeBinaryArray3df(Array3d<float> &grid, 
-                              std::ofstream *state);
+                              std::ostream *state);
     void _writeBinaryArray3db(Array3d<bool> &grid, 
-                              std::ofstream *state);
+                              std::ostream *state);
 
+    bool _initializeLoadState(unsigned int eofOffset);
     void _setLoadStateFileOffset(unsigned int foffset);
-    bool _readInt(int *value, std::ifstream *state);
-    bool _readDouble(double *value, std::ifstream *state);
+    bool _readInt(int *value);
+    bool _readDouble(double *value);
     void _getBrickGridDimensions(int *bi, int *bj, int *bk);
     bool _readLoadState(char *dest, unsigned int numBytes);
 
     std::ifstream _loadState;
+    const char *_loadStateData = nullptr;
 
     int _isize = 0;
     int _jsize = 0;
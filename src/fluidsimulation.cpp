@@ -39,6 +39,11 @@ FluidSimulation::FluidSimulation(FluidSimulationSaveState &state) {
 }
 
 FluidSimulation::~FluidSimulation() {
+    // A pending autosave may be using the thread pool
+    _autosaveWriter.flush();
+    if (_threadPool != nullptr) {
+        delete _threadPool;
+    }
 }
 
 /*******************************************************************************
@@ -61,6 +66,10 @@ void FluidSimulation::saveState(std::string filename) {
     _logfile.log(std::ostringstream().flush() << 
                  _logfile.getTime() << " saveState: " << filename << std::endl);
     FluidSimulationSaveState state;
+    state.setThreadPool(_getThreadPool());
+    if (_isSaveStateCompressionEnabled) {
+        state.enableCompression();
+    }
     state.saveState(filename, this);
 }
 
@@ -192,6 +201,41 @@ void FluidSimulation::setNumPolygonizerSlices(int n) {
     _numSurfaceReconstructionPolygonizerSlices = n;
 }
 
+long long FluidSimulation::getMaxPolygonizerMemory() {
+    return _maxPolygonizerMemory;
+}
+
+void FluidSimulation::setMaxPolygonizerMemory(long long bytes) {
+    if (bytes < 0) {
+        std::string msg = "Error: polygonizer memory limit must be greater than or equal to 0.\n";
+        msg += "bytes: " + _toString(bytes) + "\n";
+        throw std::domain_error(msg);
+    }
+
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " setMaxPolygonizerMemory: " << bytes << std::endl);
+
+    _maxPolygonizerMemory = bytes;
+}
+
+void FluidSimulation::enableSparseSurfaceReconstruction() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enableSparseSurfaceReconstruction" << std::endl);
+
+    _isSparseSurfaceReconstructionEnabled = true;
+}
+
+void FluidSimulation::disableSparseSurfaceReconstruction() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disableSparseSurfaceReconstruction" << std::endl);
+
+    _isSparseSurfaceReconstructionEnabled = false;
+}
+
+bool FluidSimulation::isSparseSurfaceReconstructionEnabled() {
+    return _isSparseSurfaceReconstructionEnabled;
+}
+
 int FluidSimulation::getMinPolyhedronTriangleCount() {
     return _minimumSurfacePolyhedronTriangleCount;
 }
@@ -318,6 +362,24 @@ bool FluidSimulation::isAnisotropicSurfaceReconstructionEnabled() {
     return _isAnisotropicSurfaceMeshReconstructionEnabled;
 }
 
+void FluidSimulation::enableLevelSetFastSweeping() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enableLevelSetFastSweeping" << std::endl);
+
+    _isLevelSetFastSweepingEnabled = true;
+}
+
+void FluidSimulation::disableLevelSetFastSweeping() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disableLevelSetFastSweeping" << std::endl);
+
+    _isLevelSetFastSweepingEnabled = false;
+}
+
+bool FluidSimulation::isLevelSetFastSweepingEnabled() {
+    return _isLevelSetFastSweepingEnabled;
+}
+
 void FluidSimulation::enableDiffuseMaterialOutput() {
     _logfile.log(std::ostringstream().flush() << 
                  _logfile.getTime() << " enableDiffuseMaterialOutput" << std::endl);
@@ -581,6 +643,173 @@ bool FluidSimulation::isAutosaveEnabled() {
     return _isAutosaveEnabled;
 }
 
+void FluidSimulation::enableAsynchronousAutosave() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enableAsynchronousAutosave" << std::endl);
+
+    _autosaveWriter.enableAsynchronousWrites();
+}
+
+void FluidSimulation::disableAsynchronousAutosave() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disableAsynchronousAutosave" << std::endl);
+
+    _autosaveWriter.disableAsynchronousWrites();
+}
+
+bool FluidSimulation::isAsynchronousAutosaveEnabled() {
+    return _autosaveWriter.isAsynchronousWritesEnabled();
+}
+
+void FluidSimulation::flushAutosave() {
+    _autosaveWriter.flush();
+}
+
+int FluidSimulation::getNumAutosaveCheckpoints() {
+    return _autosaveWriter.getNumCheckpoints();
+}
+
+void FluidSimulation::setNumAutosaveCheckpoints(int n) {
+    if (n < 1) {
+        std::string msg = "Error: number of autosave checkpoints must be greater than or equal to 1.\n";
+        msg += "n: " + _toString(n) + "\n";
+        throw std::domain_error(msg);
+    }
+
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " setNumAutosaveCheckpoints: " << n << std::endl);
+
+    _autosaveWriter.setNumCheckpoints(n);
+}
+
+void FluidSimulation::enableIncrementalAutosave() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enableIncrementalAutosave" << std::endl);
+
+    _autosaveWriter.enableIncrementalCheckpoints();
+}
+
+void FluidSimulation::disableIncrementalAutosave() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disableIncrementalAutosave" << std::endl);
+
+    _autosaveWriter.disableIncrementalCheckpoints();
+}
+
+bool FluidSimulation::isIncrementalAutosaveEnabled() {
+    return _autosaveWriter.isIncrementalCheckpointsEnabled();
+}
+
+int FluidSimulation::getAutosaveFullCheckpointInterval() {
+    return _autosaveWriter.getFullCheckpointInterval();
+}
+
+void FluidSimulation::setAutosaveFullCheckpointInterval(int n) {
+    if (n < 1) {
+        std::string msg = "Error: full checkpoint interval must be greater than or equal to 1.\n";
+        msg += "n: " + _toString(n) + "\n";
+        throw std::domain_error(msg);
+    }
+
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " setAutosaveFullCheckpointInterval: " << n << std::endl);
+
+    _autosaveWriter.setFullCheckpointInterval(n);
+}
+
+void FluidSimulation::enableSaveStateCompression() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enableSaveStateCompression" << std::endl);
+
+    _isSaveStateCompressionEnabled = true;
+    _autosaveWriter.enableCompression();
+}
+
+void FluidSimulation::disableSaveStateCompression() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disableSaveStateCompression" << std::endl);
+
+    _isSaveStateCompressionEnabled = false;
+    _autosaveWriter.disableCompression();
+}
+
+bool FluidSimulation::isSaveStateCompressionEnabled() {
+    return _isSaveStateCompressionEnabled;
+}
+
+void FluidSimulation::enableAsynchronousOutput() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enableAsynchronousOutput" << std::endl);
+
+    _outputWriter.enableAsynchronousWrites();
+}
+
+void FluidSimulation::disableAsynchronousOutput() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disableAsynchronousOutput" << std::endl);
+
+    _outputWriter.disableAsynchronousWrites();
+}
+
+bool FluidSimulation::isAsynchronousOutputEnabled() {
+    return _outputWriter.isAsynchronousWritesEnabled();
+}
+
+void FluidSimulation::flushOutput() {
+    _outputWriter.flush();
+}
+
+int FluidSimulation::getMaxOutputQueueSize() {
+    return (int)(_outputWriter.getMaxQueueSize() / (1024*1024));
+}
+
+void FluidSimulation::setMaxOutputQueueSize(int megabytes) {
+    if (megabytes < 0) {
+        std::string msg = "Error: output queue size must be greater than or equal to 0.\n";
+        msg += "size: " + _toString(megabytes) + "\n";
+        throw std::domain_error(msg);
+    }
+
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " setMaxOutputQueueSize: " << megabytes << std::endl);
+
+    _outputWriter.setMaxQueueSize((size_t)megabytes*1024*1024);
+}
+
+void FluidSimulation::setComputeBackendAsOpenCL() {
+    if (!OpenCLDevice::isOpenCLAvailable()) {
+        std::string msg = "Error: library was built without OpenCL support.\n";
+        throw std::runtime_error(msg);
+    }
+
+    if (_isSimulationInitialized && !_openCLDevice.isInitialized()) {
+        std::string msg = "Error: OpenCL device is not initialized.\n";
+        throw std::runtime_error(msg);
+    }
+
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " setComputeBackendAsOpenCL" << std::endl);
+
+    _particleAdvector.setComputeBackend(ComputeBackend::opencl);
+    _scalarFieldAccelerator.setComputeBackend(ComputeBackend::opencl);
+}
+
+void FluidSimulation::setComputeBackendAsThreaded() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " setComputeBackendAsThreaded" << std::endl);
+
+    _particleAdvector.setComputeBackend(ComputeBackend::threaded);
+    _scalarFieldAccelerator.setComputeBackend(ComputeBackend::threaded);
+}
+
+void FluidSimulation::setComputeBackendAsSerial() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " setComputeBackendAsSerial" << std::endl);
+
+    _particleAdvector.setComputeBackend(ComputeBackend::serial);
+    _scalarFieldAccelerator.setComputeBackend(ComputeBackend::serial);
+}
+
 void FluidSimulation::enableOpenCLParticleAdvection() {
     _logfile.log(std::ostringstream().flush() << 
                  _logfile.getTime() << " enableOpenCLParticleAdvection" << std::endl);
@@ -653,6 +882,134 @@ void FluidSimulation::setScalarFieldKernelWorkLoadSize(int n) {
     _scalarFieldAccelerator.setKernelWorkLoadSize(n);
 }
 
+int FluidSimulation::getNumThreads() {
+    return _numThreads;
+}
+
+void FluidSimulation::setNumThreads(int n) {
+    if (n < 1) {
+        std::string msg = "Error: number of threads must be greater than or equal to 1.\n";
+        msg += "threads: " + _toString(n) + "\n";
+        throw std::domain_error(msg);
+    }
+
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " setNumThreads: " << n << std::endl);
+
+    if (n != _numThreads && _threadPool != nullptr) {
+        _autosaveWriter.flush();
+        _autosaveWriter.setThreadPool(nullptr);
+        _particleAdvector.setThreadPool(nullptr);
+        _scalarFieldAccelerator.setThreadPool(nullptr);
+        delete _threadPool;
+        _threadPool = nullptr;
+    }
+    _numThreads = n;
+}
+
+void FluidSimulation::enableMultithreadedPressureSolver() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enableMultithreadedPressureSolver" << std::endl);
+
+    _isMultithreadedPressureSolverEnabled = true;
+}
+
+void FluidSimulation::disableMultithreadedPressureSolver() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disableMultithreadedPressureSolver" << std::endl);
+
+    _isMultithreadedPressureSolverEnabled = false;
+}
+
+bool FluidSimulation::isMultithreadedPressureSolverEnabled() {
+    return _isMultithreadedPressureSolverEnabled;
+}
+
+void FluidSimulation::enableDeterministicPressureSolverReduction() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enableDeterministicPressureSolverReduction" << std::endl);
+
+    _isDeterministicPressureSolverReductionEnabled = true;
+}
+
+void FluidSimulation::disableDeterministicPressureSolverReduction() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disableDeterministicPressureSolverReduction" << std::endl);
+
+    _isDeterministicPressureSolverReductionEnabled = false;
+}
+
+bool FluidSimulation::isDeterministicPressureSolverReductionEnabled() {
+    return _isDeterministicPressureSolverReductionEnabled;
+}
+
+void FluidSimulation::enableMultigridPressureSolver() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enableMultigridPressureSolver" << std::endl);
+
+    _isMultigridPressureSolverEnabled = true;
+}
+
+void FluidSimulation::disableMultigridPressureSolver() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disableMultigridPressureSolver" << std::endl);
+
+    _isMultigridPressureSolverEnabled = false;
+}
+
+bool FluidSimulation::isMultigridPressureSolverEnabled() {
+    return _isMultigridPressureSolverEnabled;
+}
+
+void FluidSimulation::enableMatrixFreePressureOperator() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enableMatrixFreePressureOperator: " << 
+                 PressureOperator::getInstructionSet() << std::endl);
+
+    _isMatrixFreePressureOperatorEnabled = true;
+}
+
+void FluidSimulation::disableMatrixFreePressureOperator() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disableMatrixFreePressureOperator" << std::endl);
+
+    _isMatrixFreePressureOperatorEnabled = false;
+}
+
+bool FluidSimulation::isMatrixFreePressureOperatorEnabled() {
+    return _isMatrixFreePressureOperatorEnabled;
+}
+
+void FluidSimulation::enablePressureSolverWarmStart() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " enablePressureSolverWarmStart" << std::endl);
+
+    _isPressureSolverWarmStartEnabled = true;
+}
+
+void FluidSimulation::disablePressureSolverWarmStart() {
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " disablePressureSolverWarmStart" << std::endl);
+
+    _isPressureSolverWarmStartEnabled = false;
+}
+
+bool FluidSimulation::isPressureSolverWarmStartEnabled() {
+    return _isPressureSolverWarmStartEnabled;
+}
+
+int FluidSimulation::getPressureSolverIterationCount() {
+    return _pressureSolver.getNumIterations();
+}
+
+double FluidSimulation::getPressureSolverInitialResidual() {
+    return _pressureSolver.getInitialResidual();
+}
+
+double FluidSimulation::getPressureSolverResidual() {
+    return _pressureSolver.getResidual();
+}
+
 void FluidSimulation::addBodyForce(double fx, double fy, double fz) { 
     addBodyForce(vmath::vec3(fx, fy, fz)); 
 }
@@ -979,10 +1336,7 @@ std::vector<vmath::vec3> FluidSimulation::getMarkerParticlePositions(int startid
 
     std::vector<vmath::vec3> particles;
     particles.reserve(endidx - startidx);
-
-    for (int i = startidx; i < endidx; i++) {
-        particles.push_back(_markerParticles[i].position);
-    }
+    _markerParticles.getPositions(startidx, endidx, particles);
 
     return particles;
 }
@@ -1001,10 +1355,7 @@ std::vector<vmath::vec3> FluidSimulation::getMarkerParticleVelocities(int starti
 
     std::vector<vmath::vec3> velocities;
     velocities.reserve(endidx - startidx);
-
-    for (int i = startidx; i < endidx; i++) {
-        velocities.push_back(_markerParticles[i].velocity);
-    }
+    _markerParticles.getVelocities(startidx, endidx, velocities);
 
     return velocities;
 }
@@ -1182,6 +1533,8 @@ void FluidSimulation::_initializeSimulationGrids(int isize, int jsize, int ksize
     t.stop();
 
     _logfile.log("Constructing LevelSet:         \t", t.getTime(), 4, 1);
+
+    _pressureGrid = Array3d<float>(isize, jsize, ksize, 0.0f);
 }
 
 void FluidSimulation::_initializeSimulationVectors(int isize, int jsize, int ksize) {
@@ -1372,7 +1725,7 @@ void FluidSimulation::_initializeMarkerParticles(GridIndexVector &fullFluidCells
 void FluidSimulation::_initializeFluidCellIndices() {
     GridIndex g;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        g = Grid3d::positionToGridIndex(_markerParticles[i].position, _dx);
+        g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
         if (!_materialGrid.isCellFluid(g)) {
             _materialGrid.setFluid(g);
             _fluidCellIndices.push_back(g);
@@ -1437,12 +1790,16 @@ void FluidSimulation::_initializeSimulation() {
 }
 
 void FluidSimulation::_logOpenCLInfo() {
+    if (!_openCLDevice.isInitialized()) {
+        return;
+    }
+
     _logfile.newline();
     _logfile.separator();
     _logfile.newline();
     _logfile.log(std::ostringstream().flush() << 
-                 "OpenCL ParticleAdvector Device Info:" << std::endl);
-    std::string deviceInfo = _particleAdvector.getDeviceInfo();
+                 "OpenCL Device Info:" << std::endl);
+    std::string deviceInfo = _openCLDevice.getDeviceInfo();
     _logfile.log(std::ostringstream().flush() << deviceInfo << std::endl);
 
     _logfile.log(std::ostringstream().flush() << 
@@ -1452,11 +1809,6 @@ void FluidSimulation::_logOpenCLInfo() {
 
     _logfile.separator();
     _logfile.newline();
-    _logfile.log(std::ostringstream().flush() << 
-                 "OpenCL CLScalarField Device Info:" << std::endl);
-    deviceInfo = _scalarFieldAccelerator.getDeviceInfo();
-    _logfile.log(std::ostringstream().flush() << deviceInfo << std::endl);
-
     _logfile.log(std::ostringstream().flush() << 
                  "OpenCL CLScalarField Kernel Info:" << std::endl);
     kernelInfo = _scalarFieldAccelerator.getKernelInfo();
@@ -1464,11 +1816,9 @@ void FluidSimulation::_logOpenCLInfo() {
 }
 
 void FluidSimulation::_initializeFluidMaterialParticlesFromSaveState() {
-    MarkerParticle p;
     GridIndex g;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(p.position, _dx);
+        g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
         FLUIDSIM_ASSERT(!_materialGrid.isCellSolid(g));
         _materialGrid.setFluid(g);
     }
@@ -1489,6 +1839,15 @@ void FluidSimulation::_initializeMarkerParticlesFromSaveState(
                                         FluidSimulationSaveState &state) {
 
     int n = state.getNumMarkerParticles();
+
+    const vmath::vec3 *positions = state.getMarkerParticlePositionData();
+    const vmath::vec3 *velocities = state.getMarkerParticleVelocityData();
+    if (positions != nullptr && velocities != nullptr) {
+        _markerParticles.getPositions()->assign(positions, positions + n);
+        _markerParticles.getVelocities()->assign(velocities, velocities + n);
+        return;
+    }
+
     _markerParticles.reserve(n);
 
     int chunksize = _loadStateReadChunkSize;
@@ -1520,7 +1879,7 @@ void FluidSimulation::_initializeMarkerParticlesFromSaveState(
 
         vectors = state.getMarkerParticleVelocities(startidx, endidx);
         for (unsigned int i = 0; i < vectors.size(); i++) {
-            _markerParticles[startidx + i].velocity = vectors[i];
+            _markerParticles.setVelocity(startidx + i, vectors[i]);
         }
 
         numRead += (int)vectors.size();
@@ -1535,6 +1894,25 @@ void FluidSimulation::_initializeDiffuseParticlesFromSaveState(
     int n = state.getNumDiffuseParticles();
     diffuseParticles.reserve(n);
 
+    const vmath::vec3 *positionData = state.getDiffuseParticlePositionData();
+    const vmath::vec3 *velocityData = state.getDiffuseParticleVelocityData();
+    const float *lifetimeData = state.getDiffuseParticleLifetimeData();
+    const char *typeData = state.getDiffuseParticleTypeData();
+    if (positionData != nullptr && velocityData != nullptr && 
+            lifetimeData != nullptr && typeData != nullptr) {
+        DiffuseParticle dp;
+        for (int i = 0; i < n; i++) {
+            dp.position = positionData[i];
+            dp.velocity = velocityData[i];
+            dp.lifetime = lifetimeData[i];
+            dp.type = (DiffuseParticleType)typeData[i];
+            diffuseParticles.push_back(dp);
+        }
+
+        _diffuseMaterial.setDiffuseParticles(diffuseParticles);
+        return;
+    }
+
     int chunksize = _loadStateReadChunkSize;
     int numRead = 0;
 
@@ -1612,6 +1990,14 @@ void FluidSimulation::_initializeDiffuseParticlesFromSaveState(
 
 void FluidSimulation::_initializeSolidCellsFromSaveState(FluidSimulationSaveState &state) {
     int n = state.getNumSolidCells();
+
+    const GridIndex *cells = state.getSolidCellData();
+    if (cells != nullptr) {
+        std::vector<GridIndex> indices(cells, cells + n);
+        addSolidCells(indices);
+        return;
+    }
+
     int chunksize = _loadStateReadChunkSize;
     int numRead = 0;
 
@@ -1648,6 +2034,10 @@ void FluidSimulation::_initializeSimulationFromSaveState(FluidSimulationSaveStat
     _currentFrame = state.getCurrentFrame();
     _currentBrickMeshFrame = fmax(_currentFrame + _brickMeshFrameOffset, 0);
 
+    // Compressed sections are decompressed on the simulation thread pool
+    // while the particle data is loaded
+    state.setThreadPool(_getThreadPool());
+
     _logfile.log(std::ostringstream().flush() << 
                  "\tCurrentFrame: " << _currentFrame << std::endl);
 
@@ -1689,6 +2079,7 @@ void FluidSimulation::_initializeSimulationFromSaveState(FluidSimulationSaveStat
 
         _logfile.log("Loading Brick Grid:          \t", t.getTime(), 4, 1);
     }
+    state.setThreadPool(nullptr);
 
     t.reset();
     t.start();
@@ -1703,11 +2094,27 @@ void FluidSimulation::_initializeSimulationFromSaveState(FluidSimulationSaveStat
 }
 
 void FluidSimulation::_initializeCLObjects() {
-    bool success = _particleAdvector.initialize();
-    FLUIDSIM_ASSERT(success);
+    if (!OpenCLDevice::isOpenCLAvailable()) {
+        return;
+    }
 
-    success = _scalarFieldAccelerator.initialize();
-    FLUIDSIM_ASSERT(success);
+    bool success = _openCLDevice.initialize() &&
+                   _particleAdvector.initialize(&_openCLDevice) &&
+                   _scalarFieldAccelerator.initialize(&_openCLDevice);
+    if (success) {
+        return;
+    }
+
+    _logfile.log(std::ostringstream().flush() << 
+                 "Unable to initialize OpenCL device. " << 
+                 "Using threaded compute backend." << std::endl);
+
+    if (_particleAdvector.getComputeBackend() == ComputeBackend::opencl) {
+        _particleAdvector.setComputeBackend(ComputeBackend::threaded);
+    }
+    if (_scalarFieldAccelerator.getComputeBackend() == ComputeBackend::opencl) {
+        _scalarFieldAccelerator.setComputeBackend(ComputeBackend::threaded);
+    }
 }
 
 /********************************************************************************
@@ -1718,15 +2125,13 @@ void FluidSimulation::_removeMarkerParticlesFromCells(Array3d<bool> &isRemovalCe
     std::vector<bool> isRemoved;
     isRemoved.reserve(_markerParticles.size());
 
-    MarkerParticle p;
     GridIndex g;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(p.position, _dx);
+        g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
         isRemoved.push_back(isRemovalCell(g));
     }
 
-    _removeItemsFromVector(_markerParticles, isRemoved);
+    _markerParticles.removeParticles(isRemoved);
 }
 
 void FluidSimulation::_removeDiffuseParticlesFromCells(Array3d<bool> &isRemovalCell) {
@@ -1810,8 +2215,8 @@ void FluidSimulation::_getNewFluidParticles(FluidSource *source, std::vector<vma
     vmath::vec3 offset = Grid3d::GridIndexToPosition(gmin, _dx);
     vmath::vec3 p;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        if (bbox.isPointInside(_markerParticles[i].position)) {
-            p = _markerParticles[i].position - offset;
+        if (bbox.isPointInside(_markerParticles.getPosition(i))) {
+            p = _markerParticles.getPosition(i) - offset;
             subg = Grid3d::positionToGridIndex(p, 0.5*_dx);
             newParticleGrid.set(subg, false);
         }
@@ -1911,11 +2316,9 @@ void FluidSimulation::_updateRemovedFluidCellQueue() {
     isRemoved.reserve(_markerParticles.size());
 
     bool isParticlesInRemovalCell = false;
-    MarkerParticle p;
     GridIndex g;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(p.position, _dx);
+        g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
 
         bool isInRemovalCell = isRemovalCell(g);
         if (isInRemovalCell) {
@@ -1926,33 +2329,36 @@ void FluidSimulation::_updateRemovedFluidCellQueue() {
     }
 
     if (isParticlesInRemovalCell) {
-        _removeItemsFromVector(_markerParticles, isRemoved);
+        _markerParticles.removeParticles(isRemoved);
     }
 }
 
 void FluidSimulation::_removeMarkerParticlesInSolidCells() {
-    std::vector<bool> isRemoved;
-    isRemoved.reserve(_markerParticles.size());
+    int numParticles = (int)_markerParticles.size();
+    std::vector<char> isRemoved(numParticles, false);
+    std::atomic<bool> isParticlesInSolidCell(false);
+    _parallelForParticleRange(numParticles, numParticles,
+                              [this, &isRemoved, &isParticlesInSolidCell](int begin, int end) {
+        GridIndex g;
+        bool isSolidCellFound = false;
+        for (int i = begin; i < end; i++) {
+            g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
+
+            bool isInSolidCell = _materialGrid.isCellSolid(g);
+            if (isInSolidCell) {
+                isSolidCellFound = true;
+            }
 
-    bool isParticlesInSolidCell = false;
-    MarkerParticle p;
-    GridIndex g;
-    int count = 0;
-    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(p.position, _dx);
+            isRemoved[i] = isInSolidCell;
+        }
 
-        bool isInSolidCell = _materialGrid.isCellSolid(g);
-        if (isInSolidCell) {
+        if (isSolidCellFound) {
             isParticlesInSolidCell = true;
-            count++;
         }
-
-        isRemoved.push_back(isInSolidCell);
-    }
+    });
 
     if (isParticlesInSolidCell) {
-        _removeItemsFromVector(_markerParticles, isRemoved);
+        _markerParticles.removeParticles(isRemoved);
     }
 }
 
@@ -1995,7 +2401,9 @@ void FluidSimulation::_updateFluidCells() {
 
     //_materialGrid.setAir(_fluidCellIndices);
 
-    for (int k = 1; k < _materialGrid.depth - 1; k++) {
+    ThreadPool *pool = _getThreadPool();
+    pool->run(_materialGrid.depth - 2, [this](int taskidx) {
+        int k = taskidx + 1;
         for (int j = 1; j < _materialGrid.height - 1; j++) {
             for (int i = 1; i < _materialGrid.width - 1; i++) {
                 if (_materialGrid.isCellFluid(i, j, k)) {
@@ -2003,41 +2411,49 @@ void FluidSimulation::_updateFluidCells() {
                 }
             }
         }
-    }
+    });
 
     _fluidCellIndices.clear();
-    
-    MarkerParticle p;
-    GridIndex g;
-    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(p.position, _dx);
-        FLUIDSIM_ASSERT(!_materialGrid.isCellSolid(g));
-        _materialGrid.setFluid(g);
+
+    // Cell lookups run in parallel. Cells are marked as fluid serially 
+    // since many particles write to the same cell.
+    int numParticles = (int)_markerParticles.size();
+    std::vector<GridIndex> particleCells(numParticles);
+    _parallelForParticleRange(numParticles, numParticles, 
+                              [this, &particleCells](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            particleCells[i] = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
+            FLUIDSIM_ASSERT(!_materialGrid.isCellSolid(particleCells[i]));
+        }
+    });
+
+    for (int i = 0; i < numParticles; i++) {
+        _materialGrid.setFluid(particleCells[i]);
     }
 
-    int count = 0;
-    for (int k = 0; k < _materialGrid.depth; k++) {
+    int depth = _materialGrid.depth;
+    std::vector<std::vector<GridIndex> > sliceCells(depth);
+    pool->run(depth, [this, &sliceCells](int k) {
         for (int j = 0; j < _materialGrid.height; j++) {
             for (int i = 0; i < _materialGrid.width; i++) {
                 if (_materialGrid.isCellFluid(i, j, k)) {
-                    count++;
+                    sliceCells[k].push_back(GridIndex(i, j, k));
                 }
             }
         }
+    });
+
+    int count = 0;
+    for (int k = 0; k < depth; k++) {
+        count += (int)sliceCells[k].size();
     }
 
     _fluidCellIndices.reserve(count);
-    for (int k = 0; k < _materialGrid.depth; k++) {
-        for (int j = 0; j < _materialGrid.height; j++) {
-            for (int i = 0; i < _materialGrid.width; i++) {
-                if (_materialGrid.isCellFluid(i, j, k)) {
-                    _fluidCellIndices.push_back(i, j, k);
-                }
-            }
+    for (int k = 0; k < depth; k++) {
+        for (unsigned int idx = 0; idx < sliceCells[k].size(); idx++) {
+            _fluidCellIndices.push_back(sliceCells[k][idx]);
         }
     }
-
 }
 
 /********************************************************************************
@@ -2050,6 +2466,11 @@ void FluidSimulation::_polygonizeInternalSurface(TriangleMesh &surface,
 
     double r = _markerParticleRadius*_markerParticleScale;
     mesher.setScalarFieldAccelerator(&_scalarFieldAccelerator);
+    mesher.setThreadPool(_getThreadPool());
+    mesher.setMaxPolygonizationMemory(_maxPolygonizerMemory);
+    if (_isSparseSurfaceReconstructionEnabled) {
+        mesher.enableSparseScalarField();
+    }
 
     if (_isPreviewSurfaceMeshEnabled) {
         mesher.enablePreviewMesher(_previewdx);
@@ -2080,7 +2501,7 @@ void FluidSimulation::_reconstructInternalFluidSurface() {
 
     _polygonizeInternalSurface(_surfaceMesh, _previewMesh);
     _surfaceMesh.removeMinimumTriangleCountPolyhedra(
-                        _minimumSurfacePolyhedronTriangleCount);
+                        _minimumSurfacePolyhedronTriangleCount, _getThreadPool());
 }
 
 /********************************************************************************
@@ -2098,6 +2519,12 @@ void FluidSimulation::_updateLevelSetSignedDistanceField() {
         return;
     }
 
+    _levelset.setThreadPool(_getThreadPool());
+    if (_isLevelSetFastSweepingEnabled) {
+        _levelset.enableFastSweeping();
+    } else {
+        _levelset.disableFastSweeping();
+    }
     _levelset.setSurfaceMesh(_surfaceMesh);
     int numLayers = _CFLConditionNumber + 2;
     _levelset.calculateSignedDistanceField(numLayers);
@@ -2135,15 +2562,15 @@ void FluidSimulation::_writeDiffuseMaterialToFile(std::string bubblefile,
 
     if (_isBubbleDiffuseMaterialEnabled) {
         bubbleMesh.translate(_domainOffset);
-        _writeTriangleMeshToFile(bubbleMesh, bubblefile);
+        _writeTriangleMeshToFile(std::move(bubbleMesh), bubblefile);
     }
     if (_isFoamDiffuseMaterialEnabled) {
         foamMesh.translate(_domainOffset);
-        _writeTriangleMeshToFile(foamMesh, foamfile);
+        _writeTriangleMeshToFile(std::move(foamMesh), foamfile);
     }
     if (_isSprayDiffuseMaterialEnabled) {
         sprayMesh.translate(_domainOffset);
-        _writeTriangleMeshToFile(sprayMesh, sprayfile);
+        _writeTriangleMeshToFile(std::move(sprayMesh), sprayfile);
     }
 }
 
@@ -2167,13 +2594,13 @@ void FluidSimulation::_writeDiffuseMaterialToFile(std::string diffusefile) {
     }
 
     diffuseMesh.translate(_domainOffset);
-    _writeTriangleMeshToFile(diffuseMesh, diffusefile);
+    _writeTriangleMeshToFile(std::move(diffuseMesh), diffusefile);
 }
 
 void FluidSimulation::_writeBrickColorListToFile(TriangleMesh &mesh, 
                                                      std::string filename) {
     int binsize = 3*sizeof(unsigned char)*(int)mesh.vertexcolors.size();
-    char *storage = new char[binsize];
+    std::vector<char> storage(binsize);
 
     vmath::vec3 c;
     for (unsigned int i = 0; i < mesh.vertexcolors.size(); i++) {
@@ -2182,16 +2609,8 @@ void FluidSimulation::_writeBrickColorListToFile(TriangleMesh &mesh,
         storage[3*i + 1] = (unsigned char)(c.y*255.0);
         storage[3*i + 2] = (unsigned char)(c.z*255.0);
     }
-    
-    std::ofstream erasefile;
-    erasefile.open(filename, std::ofstream::out | std::ofstream::trunc);
-    erasefile.close();
 
-    std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
-    file.write(storage, binsize);
-    file.close();
-
-    delete[] storage;
+    _outputWriter.writeData(std::move(storage), filename);
 }
 
 void FluidSimulation::_writeBrickTextureToFile(TriangleMesh &mesh, 
@@ -2220,27 +2639,19 @@ void FluidSimulation::_writeBrickTextureToFile(TriangleMesh &mesh,
     }
     
     int binsize = sizeof(unsigned char)*bisize*bjsize*bksize;
-    unsigned char *storage = new unsigned char[binsize];
+    std::vector<char> storage(binsize);
 
     int offset = 0;
     for (int k = 0; k < colorGrid.depth; k++) {
         for (int j = 0; j < colorGrid.height; j++) {
             for (int i = 0; i < colorGrid.width; i++) {
-                storage[offset] = colorGrid(i, j, k);
+                storage[offset] = (char)colorGrid(i, j, k);
                 offset++;
             }
         }
     }
-    
-    std::ofstream erasefile;
-    erasefile.open(filename, std::ofstream::out | std::ofstream::trunc);
-    erasefile.close();
-
-    std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
-    file.write((char*)storage, binsize);
-    file.close();
 
-    delete[] storage;
+    _outputWriter.writeData(std::move(storage), filename);
 }
 
 void FluidSimulation::_writeBrickMaterialToFile(std::string brickfile,
@@ -2250,17 +2661,13 @@ void FluidSimulation::_writeBrickMaterialToFile(std::string brickfile,
     _fluidBrickGrid.getBrickMesh(brickmesh);
 
     brickmesh.translate(_domainOffset);
-    _writeTriangleMeshToFile(brickmesh, brickfile);
     _writeBrickColorListToFile(brickmesh, colorfile);
     _writeBrickTextureToFile(brickmesh, texturefile);
+    _writeTriangleMeshToFile(std::move(brickmesh), brickfile);
 }
 
-void FluidSimulation::_writeTriangleMeshToFile(TriangleMesh &mesh, std::string filename) {
-    if (_meshOutputFormat == TriangleMeshFormat::ply) {
-        mesh.writeMeshToPLY(filename);
-    } else if (_meshOutputFormat == TriangleMeshFormat::bobj) {
-        mesh.writeMeshToBOBJ(filename);
-    }
+void FluidSimulation::_writeTriangleMeshToFile(TriangleMesh &&mesh, std::string filename) {
+    _outputWriter.writeTriangleMesh(std::move(mesh), _meshOutputFormat, filename);
 }
 
 std::string FluidSimulation::_numberToString(int number) {
@@ -2356,6 +2763,11 @@ void FluidSimulation::_polygonizeIsotropicOutputSurface(TriangleMesh &surface,
     mesher.setScalarFieldAccelerator(&_scalarFieldAccelerator);
     mesher.setSubdivisionLevel(_outputFluidSurfaceSubdivisionLevel);
     mesher.setNumPolygonizationSlices(slices);
+    mesher.setThreadPool(_getThreadPool());
+    mesher.setMaxPolygonizationMemory(_maxPolygonizerMemory);
+    if (_isSparseSurfaceReconstructionEnabled) {
+        mesher.enableSparseScalarField();
+    }
 
     bool isGeneratingPreview = _isPreviewSurfaceMeshEnabled &&
                                !_isInternalFluidSurfaceNeeded();
@@ -2377,18 +2789,17 @@ TriangleMesh FluidSimulation::_polygonizeAnisotropicOutputSurface() {
     AnisotropicParticleMesher mesher(_isize, _jsize, _ksize, _dx);
     mesher.setSubdivisionLevel(_outputFluidSurfaceSubdivisionLevel);
     mesher.setNumPolygonizationSlices(slices);
+    mesher.setThreadPool(_getThreadPool());
+    if (_isSparseSurfaceReconstructionEnabled) {
+        mesher.enableSparseScalarField();
+    }
 
     return mesher.meshParticles(_markerParticles, _levelset, _materialGrid, r);
 }
 
 void FluidSimulation::_updateBrickGrid(double dt) {
-    std::vector<vmath::vec3> points;
-    points.reserve(_markerParticles.size());
-    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        points.push_back(_markerParticles[i].position);
-    }
-
-    _fluidBrickGrid.update(_levelset, _materialGrid, points, dt);
+    std::vector<vmath::vec3> *points = _markerParticles.getPositions();
+    _fluidBrickGrid.update(_levelset, _materialGrid, *points, dt);
 }
 
 void FluidSimulation::_outputIsotropicSurfaceMesh() {
@@ -2402,7 +2813,7 @@ void FluidSimulation::_outputIsotropicSurfaceMesh() {
     } else {
         _polygonizeIsotropicOutputSurface(isomesh, previewmesh);
         isomesh.removeMinimumTriangleCountPolyhedra(
-            _minimumSurfacePolyhedronTriangleCount
+            _minimumSurfacePolyhedronTriangleCount, _getThreadPool()
         );
     }
 
@@ -2415,11 +2826,11 @@ void FluidSimulation::_outputIsotropicSurfaceMesh() {
     std::string bakedir = Config::getBakefilesDirectory();
     std::string ext = "." + TriangleMesh::getFileExtension(_meshOutputFormat);
     std::string isofile = bakedir + "/" + framestr + ext;
-    _writeTriangleMeshToFile(isomesh, isofile);
+    _writeTriangleMeshToFile(std::move(isomesh), isofile);
 
     if (_isPreviewSurfaceMeshEnabled) {
         std::string previewfile = bakedir + "/preview" + framestr + ext;
-        _writeTriangleMeshToFile(previewmesh, previewfile);
+        _writeTriangleMeshToFile(std::move(previewmesh), previewfile);
     }
 }
 
@@ -2429,7 +2840,7 @@ void FluidSimulation::_outputAnisotropicSurfaceMesh() {
 
     TriangleMesh anisomesh = _polygonizeAnisotropicOutputSurface();
     anisomesh.removeMinimumTriangleCountPolyhedra(
-        _minimumSurfacePolyhedronTriangleCount
+        _minimumSurfacePolyhedronTriangleCount, _getThreadPool()
     );
 
     _smoothSurfaceMesh(anisomesh);
@@ -2439,7 +2850,7 @@ void FluidSimulation::_outputAnisotropicSurfaceMesh() {
     std::string bakedir = Config::getBakefilesDirectory();
     std::string ext = "." + TriangleMesh::getFileExtension(_meshOutputFormat);
     std::string anisofile = bakedir + "/anisotropic" + framestr + ext;
-    _writeTriangleMeshToFile(anisomesh, anisofile);
+    _writeTriangleMeshToFile(std::move(anisomesh), anisofile);
 }
 
 void FluidSimulation::_outputDiffuseMaterial() {
@@ -2523,84 +2934,33 @@ void FluidSimulation::_applyFluidSourceToVelocityField(FluidSource *source,
 
 }
 
-void FluidSimulation::_computeVelocityScalarField(Array3d<float> &field, 
-                                                  Array3d<bool> &isValueSet,
-                                                  int dir) {
-    int U = 0; int V = 1; int W = 2;
-
-    ScalarField grid = ScalarField(field.width,
-                                                                 field.height,
-                                                                 field.depth, _dx);
-    grid.enableWeightField();
-    grid.setPointRadius(_dx); 
-
-    vmath::vec3 offset;
-    if (dir == U) {
-        offset = vmath::vec3(0.0, 0.5*_dx, 0.5*_dx);
-    } else if (dir == V) {
-        offset = vmath::vec3(0.5*_dx, 0.0, 0.5*_dx);
-    } else if (dir == W) {
-        offset = vmath::vec3(0.5*_dx, 0.5*_dx, 0.0);
-    } else {
-        return;
-    }
-    grid.setOffset(offset);
-
-    int n = _maxParticlesPerVelocityAdvection;
-    std::vector<vmath::vec3> positions;
-    std::vector<float> values;
-    positions.reserve(fmin(n, _markerParticles.size()));
-    values.reserve(fmin(n, _markerParticles.size()));
-
-    for (int startidx = 0; startidx < (int)_markerParticles.size(); startidx += n) {
-        int endidx = startidx + n - 1;
-        if (endidx >= (int)_markerParticles.size()) {
-            endidx = _markerParticles.size() - 1;
-        }
-
-        positions.clear();
-        values.clear();
-        for (int i = startidx; i <= endidx; i++) {
-            positions.push_back(_markerParticles[i].position);
-            values.push_back(_markerParticles[i].velocity[dir]);
-        }
-
-        _scalarFieldAccelerator.addPointValues(positions, values, grid);
-    }
-    grid.applyWeightField();
-
-    Array3d<float> *scalarfield = grid.getPointerToScalarField();
-    Array3d<float> *weightfield = grid.getPointerToWeightField();
-
-    double eps = 1e-9;
-    for (int k = 0; k < field.depth; k++) {
-        for (int j = 0; j < field.height; j++) {
-            for (int i = 0; i < field.width; i++) {
-                field.set(i, j, k, scalarfield->get(i, j, k));
-
-                if (weightfield->get(i, j, k) > eps) {
-                    isValueSet.set(i, j, k, true);
-                }
-            }
-        }
-    }
+void FluidSimulation::_computeVelocityGrids(Array3d<float> &ugrid, 
+                                            Array3d<float> &vgrid, 
+                                            Array3d<float> &wgrid,
+                                            Array3d<bool> &isUValueSet, 
+                                            Array3d<bool> &isVValueSet, 
+                                            Array3d<bool> &isWValueSet) {
+    _velocityTransfer.setThreadPool(_getThreadPool());
+    _velocityTransfer.transfer(_markerParticles, _dx, 
+                               ugrid, vgrid, wgrid, 
+                               isUValueSet, isVValueSet, isWValueSet);
 
+    int U = 0; int V = 1; int W = 2;
     FluidSource *source;
     for (unsigned int i = 0; i < _fluidSources.size(); i++) {
         source = _fluidSources[i];
         if (source->isInflow() && source->isActive()) {
-            _applyFluidSourceToVelocityField(source, dir, isValueSet, field);
+            _applyFluidSourceToVelocityField(source, U, isUValueSet, ugrid);
+            _applyFluidSourceToVelocityField(source, V, isVValueSet, vgrid);
+            _applyFluidSourceToVelocityField(source, W, isWValueSet, wgrid);
         }
     }
 }
 
-void FluidSimulation::_advectVelocityFieldU() {
+void FluidSimulation::_advectVelocityFieldU(Array3d<float> &ugrid, 
+                                            Array3d<bool> &isValueSet) {
     _MACVelocity.clearU();
 
-    Array3d<float> ugrid = Array3d<float>(_isize + 1, _jsize, _ksize, 0.0f);
-    Array3d<bool> isValueSet = Array3d<bool>(_isize + 1, _jsize, _ksize, false);
-    _computeVelocityScalarField(ugrid, isValueSet, 0);
-
     GridIndexVector extrapolationIndices(_isize + 1, _jsize, _ksize);
     for (int k = 0; k < ugrid.depth; k++) {
         for (int j = 0; j < ugrid.height; j++) {
@@ -2639,13 +2999,10 @@ void FluidSimulation::_advectVelocityFieldU() {
     }
 }
 
-void FluidSimulation::_advectVelocityFieldV() {
+void FluidSimulation::_advectVelocityFieldV(Array3d<float> &vgrid, 
+                                            Array3d<bool> &isValueSet) {
     _MACVelocity.clearV();
 
-    Array3d<float> vgrid = Array3d<float>(_isize, _jsize + 1, _ksize, 0.0f);
-    Array3d<bool> isValueSet = Array3d<bool>(_isize, _jsize + 1, _ksize, false);
-    _computeVelocityScalarField(vgrid, isValueSet, 1);
-    
     GridIndexVector extrapolationIndices(_isize, _jsize + 1, _ksize);
     for (int k = 0; k < vgrid.depth; k++) {
         for (int j = 0; j < vgrid.height; j++) {
@@ -2684,13 +3041,10 @@ void FluidSimulation::_advectVelocityFieldV() {
     }
 }
 
-void FluidSimulation::_advectVelocityFieldW() {
+void FluidSimulation::_advectVelocityFieldW(Array3d<float> &wgrid, 
+                                            Array3d<bool> &isValueSet) {
     _MACVelocity.clearW();
 
-    Array3d<float> wgrid = Array3d<float>(_isize, _jsize, _ksize + 1, 0.0f);
-    Array3d<bool> isValueSet = Array3d<bool>(_isize, _jsize, _ksize + 1, 0.0f);
-    _computeVelocityScalarField(wgrid, isValueSet, 2);
-    
     GridIndexVector extrapolationIndices(_isize, _jsize, _ksize + 1);
     for (int k = 0; k < wgrid.depth; k++) {
         for (int j = 0; j < wgrid.height; j++) {
@@ -2730,9 +3084,17 @@ void FluidSimulation::_advectVelocityFieldW() {
 }
 
 void FluidSimulation::_advectVelocityField() {
-    _advectVelocityFieldU();
-    _advectVelocityFieldV();
-    _advectVelocityFieldW();
+    Array3d<float> ugrid = Array3d<float>(_isize + 1, _jsize, _ksize, 0.0f);
+    Array3d<float> vgrid = Array3d<float>(_isize, _jsize + 1, _ksize, 0.0f);
+    Array3d<float> wgrid = Array3d<float>(_isize, _jsize, _ksize + 1, 0.0f);
+    Array3d<bool> isUValueSet = Array3d<bool>(_isize + 1, _jsize, _ksize, false);
+    Array3d<bool> isVValueSet = Array3d<bool>(_isize, _jsize + 1, _ksize, false);
+    Array3d<bool> isWValueSet = Array3d<bool>(_isize, _jsize, _ksize + 1, false);
+    _computeVelocityGrids(ugrid, vgrid, wgrid, isUValueSet, isVValueSet, isWValueSet);
+
+    _advectVelocityFieldU(ugrid, isUValueSet);
+    _advectVelocityFieldV(vgrid, isVValueSet);
+    _advectVelocityFieldW(wgrid, isWValueSet);
 }
 
 /********************************************************************************
@@ -2876,12 +3238,29 @@ void FluidSimulation::_updatePressureGrid(Array3d<float> &pressureGrid, double d
     params.materialGrid = &_materialGrid;
     params.velocityField = &_MACVelocity;
     params.logfile = &_logfile;
+    params.isMultithreadingEnabled = _isMultithreadedPressureSolverEnabled;
+    params.isDeterministicReductionEnabled = _isDeterministicPressureSolverReductionEnabled;
+    params.numThreads = _numThreads;
+    params.threadPool = _getThreadPool();
+    params.isMatrixFreeOperatorEnabled = _isMatrixFreePressureOperatorEnabled;
+    if (_isMultigridPressureSolverEnabled) {
+        params.preconditioner = PressureSolverPreconditioner::multigrid;
+    }
 
+    // The pressure grid holds the previous solution. Cells that were not 
+    // fluid cells during the previous solve are zero.
+    GridIndex g;
     VectorXd pressures((int)_fluidCellIndices.size());
-    PressureSolver solver;
-    solver.solve(params, pressures);
+    if (_isPressureSolverWarmStartEnabled) {
+        params.isWarmStartEnabled = true;
+        for (unsigned int idx = 0; idx < _fluidCellIndices.size(); idx++) {
+            pressures[idx] = (double)pressureGrid(_fluidCellIndices[idx]);
+        }
+    }
+    pressureGrid.fill(0.0f);
+
+    _pressureSolver.solve(params, pressures);
 
-    GridIndex g;
     for (unsigned int idx = 0; idx < _fluidCellIndices.size(); idx++) {
         g = _fluidCellIndices[idx];
         pressureGrid.set(g, (float)pressures[idx]);
@@ -3077,6 +3456,7 @@ void FluidSimulation::_updateDiffuseMaterial(double dt) {
 
     vmath::vec3 bodyForce = _getConstantBodyForce();
 
+    _diffuseMaterial.setThreadPool(_getThreadPool());
     _diffuseMaterial.update(_isize, _jsize, _ksize, _dx,
                             &_markerParticles,
                             &_MACVelocity, 
@@ -3101,40 +3481,45 @@ void FluidSimulation::_updateDiffuseMaterial(double dt) {
     11. Update MarkerParticle Velocities
 ********************************************************************************/
 
-void FluidSimulation::_updateRangeOfMarkerParticleVelocities(int startIdx, int endIdx) {
-    int size = endIdx - startIdx + 1;
-    std::vector<vmath::vec3> positions, vnew, vold;
-    positions.reserve(size);
-    vnew.reserve(size);
-    vold.reserve(size);
-
-    for (int i = startIdx; i <= endIdx; i++) {
-        positions.push_back(_markerParticles[i].position);
-    }
-
+/*
+    Velocities of particles in the range [startIdx, startIdx + positions.size())
+    are updated. The positions vector may be the full marker particle position 
+    array, in which case no copy of the positions is made.
+*/
+void FluidSimulation::_updateRangeOfMarkerParticleVelocities(std::vector<vmath::vec3> &positions,
+                                                             int startIdx) {
+    std::vector<vmath::vec3> vnew, vold;
     _particleAdvector.tricubicInterpolate(positions, &_MACVelocity, vnew);
     _particleAdvector.tricubicInterpolate(positions, &_savedVelocityField, vold);
 
-    vmath::vec3 vPIC, vFLIP, v;
-    MarkerParticle mp;
-    for (unsigned int i = 0; i < positions.size(); i++) {
-        mp = _markerParticles[startIdx + i];
-
-        vPIC = vnew[i];
-        vFLIP = mp.velocity + vnew[i] - vold[i];
-
-        v = (float)_ratioPICFLIP * vPIC + (float)(1 - _ratioPICFLIP) * vFLIP;
-        _markerParticles[startIdx + i].velocity = v;
-    }
+    vmath::vec3 *velocities = _markerParticles.getVelocities()->data() + startIdx;
+    float ratioPICFLIP = (float)_ratioPICFLIP;
+    _parallelForParticleRange(positions.size(), positions.size(),
+                              [&vnew, &vold, velocities, ratioPICFLIP](int begin, int end) {
+        vmath::vec3 vPIC, vFLIP;
+        for (int i = begin; i < end; i++) {
+            vPIC = vnew[i];
+            vFLIP = velocities[i] + vnew[i] - vold[i];
+            velocities[i] = ratioPICFLIP * vPIC + (1.0f - ratioPICFLIP) * vFLIP;
+        }
+    });
 }
 
 void FluidSimulation::_updateMarkerParticleVelocities() {
+    std::vector<vmath::vec3> *positions = _markerParticles.getPositions();
+    int numParticles = (int)positions->size();
     int n = _maxParticlesPerPICFLIPUpdate;
-    for (int startidx = 0; startidx < (int)_markerParticles.size(); startidx += n) {
-        int endidx = startidx + n - 1;
-        endidx = fmin(endidx, _markerParticles.size() - 1);
+    if (numParticles <= n) {
+        _updateRangeOfMarkerParticleVelocities(*positions, 0);
+        return;
+    }
 
-        _updateRangeOfMarkerParticleVelocities(startidx, endidx);
+    std::vector<vmath::vec3> rangePositions;
+    for (int startidx = 0; startidx < numParticles; startidx += n) {
+        int endidx = (int)fmin(startidx + n, numParticles);
+        rangePositions.clear();
+        _markerParticles.getPositions(startidx, endidx, rangePositions);
+        _updateRangeOfMarkerParticleVelocities(rangePositions, startidx);
     }
 }
 
@@ -3178,43 +3563,37 @@ vmath::vec3 FluidSimulation::_resolveParticleSolidCellCollision(vmath::vec3 p0,
     return resolvedPosition;
 }
 
-void FluidSimulation::_advanceRangeOfMarkerParticles(int startIdx, int endIdx, 
-                                                     double dt) {
-    FLUIDSIM_ASSERT(startIdx <= endIdx);
-
-    std::vector<vmath::vec3> positions;
-    positions.reserve(endIdx - startIdx + 1);
-    for (int i = startIdx; i <= endIdx; i++) {
-        positions.push_back(_markerParticles[i].position);
-    }
-
+/*
+    Particles in the range [startIdx, startIdx + positions.size()) are 
+    advanced. The positions vector may be the full marker particle position 
+    array, in which case no copy of the positions is made.
+*/
+void FluidSimulation::_advanceRangeOfMarkerParticles(std::vector<vmath::vec3> &positions,
+                                                     int startIdx, double dt) {
     std::vector<vmath::vec3> output;
-    _particleAdvector.advectParticlesRK4(positions, &_MACVelocity, dt, 
-                                         output);
-
-    MarkerParticle mp;
-    vmath::vec3 nextp;
-    GridIndex g;
-    for (unsigned int i = 0; i < output.size(); i++) {
-        mp = _markerParticles[startIdx + i];
-        nextp = output[i];
+    _particleAdvector.advectParticlesRK4(positions, &_MACVelocity, dt, output);
+
+    vmath::vec3 *particlePositions = _markerParticles.getPositions()->data() + startIdx;
+    _parallelForParticleRange(output.size(), output.size(), 
+                              [this, &output, particlePositions](int begin, int end) {
+        vmath::vec3 nextp;
+        GridIndex g;
+        for (int i = begin; i < end; i++) {
+            nextp = output[i];
+            g = Grid3d::positionToGridIndex(nextp, _dx);
+            if (_materialGrid.isCellSolid(g)) {
+                nextp = _resolveParticleSolidCellCollision(particlePositions[i], nextp);
+            }
 
-        g = Grid3d::positionToGridIndex(nextp, _dx);
-        if (_materialGrid.isCellSolid(g)) {
-            nextp = _resolveParticleSolidCellCollision(mp.position, nextp);
+            particlePositions[i] = nextp;
         }
-
-        _markerParticles[startIdx + i].position = nextp;
-    }
+    });
 }
 
 void FluidSimulation::_shuffleMarkerParticleOrder() {
-    MarkerParticle mi;
     for (int i = _markerParticles.size() - 2; i >= 0; i--) {
         int j = (rand() % (int)(i - 0 + 1));
-        mi = _markerParticles[i];
-        _markerParticles[i] = _markerParticles[j];
-        _markerParticles[j] = mi;
+        _markerParticles.swap(i, j);
     }
 }
 
@@ -3222,39 +3601,77 @@ void FluidSimulation::_removeMarkerParticles() {
     Array3d<int> countGrid = Array3d<int>(_isize, _jsize, _ksize, 0);
     _shuffleMarkerParticleOrder();
 
-    std::vector<bool> isRemoved;
-    isRemoved.reserve(_markerParticles.size());
-
-    MarkerParticle mp;
-    GridIndex g;
-    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        mp = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(mp.position, _dx);
-        if (countGrid(g) >= _maxMarkerParticlesPerCell) {
-            isRemoved.push_back(true);
+    int numParticles = (int)_markerParticles.size();
+    std::vector<int> cellIndices(numParticles);
+    _parallelForParticleRange(numParticles, numParticles, 
+                              [this, &cellIndices](int begin, int end) {
+        GridIndex g;
+        for (int i = begin; i < end; i++) {
+            g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
+            FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(g, _isize, _jsize, _ksize));
+            cellIndices[i] = Grid3d::getFlatIndex(g, _isize, _jsize);
+        }
+    });
+
+    // Particles are kept in shuffled order until a cell is full, so this 
+    // pass remains sequential
+    std::vector<char> isRemoved(numParticles, false);
+    for (int i = 0; i < numParticles; i++) {
+        int flatidx = cellIndices[i];
+        if (countGrid(flatidx) >= _maxMarkerParticlesPerCell) {
+            isRemoved[i] = true;
             continue;
         }
-        countGrid.add(g, 1);
-
-        isRemoved.push_back(false);
+        countGrid.add(flatidx, 1);
     }
 
-    _removeItemsFromVector(_markerParticles, isRemoved);
+    _markerParticles.removeParticles(isRemoved);
 }
 
 void FluidSimulation::_advanceMarkerParticles(double dt) {
-
+    std::vector<vmath::vec3> *positions = _markerParticles.getPositions();
+    int numParticles = (int)positions->size();
     int n = _maxParticlesPerParticleAdvection;
-    for (int startidx = 0; startidx < (int)_markerParticles.size(); startidx += n) {
-        int endidx = startidx + n - 1;
-        endidx = fmin(endidx, _markerParticles.size() - 1);
-
-        _advanceRangeOfMarkerParticles(startidx, endidx, dt);
+    if (numParticles <= n) {
+        _advanceRangeOfMarkerParticles(*positions, 0, dt);
+    } else {
+        std::vector<vmath::vec3> rangePositions;
+        for (int startidx = 0; startidx < numParticles; startidx += n) {
+            int endidx = (int)fmin(startidx + n, numParticles);
+            rangePositions.clear();
+            _markerParticles.getPositions(startidx, endidx, rangePositions);
+            _advanceRangeOfMarkerParticles(rangePositions, startidx, dt);
+        }
     }
 
     _removeMarkerParticles();
 }
 
+ThreadPool* FluidSimulation::_getThreadPool() {
+    if (_threadPool == nullptr) {
+        _threadPool = new ThreadPool(_numThreads);
+        _particleAdvector.setThreadPool(_threadPool);
+        _scalarFieldAccelerator.setThreadPool(_threadPool);
+        _autosaveWriter.setThreadPool(_threadPool);
+    }
+    return _threadPool;
+}
+
+void FluidSimulation::_parallelForParticleRange(int numParticles, int maxTaskSize,
+                                                std::function<void(int, int)> func) {
+    if (numParticles <= 0) {
+        return;
+    }
+
+    int tasksPerThread = 4;
+    int numTasks = tasksPerThread*_numThreads;
+    int taskSize = (numParticles + numTasks - 1) / numTasks;
+    taskSize = (int)fmax(taskSize, _minParticlesPerThreadTask);
+    taskSize = (int)fmax(fmin(taskSize, maxTaskSize), 1);
+
+    _getThreadPool()->parallelForRange(0, numParticles, taskSize, func);
+}
+
 /********************************************************************************
     TIME STEP
 ********************************************************************************/
@@ -3315,20 +3732,17 @@ void FluidSimulation::_stepFluid(double dt) {
 
     _logfile.log("Apply Body Forces:           \t", timers[6].getTime(), 4);
 
-    {
-        timers[7].start();
-        Array3d<float> pressureGrid = Array3d<float>(_isize, _jsize, _ksize, 0.0f);
-        _updatePressureGrid(pressureGrid, dt);
-        timers[7].stop();
+    timers[7].start();
+    _updatePressureGrid(_pressureGrid, dt);
+    timers[7].stop();
 
-        _logfile.log("Update Pressure Grid:        \t", timers[7].getTime(), 4);
+    _logfile.log("Update Pressure Grid:        \t", timers[7].getTime(), 4);
 
-        timers[8].start();
-        _applyPressureToVelocityField(pressureGrid, dt);
-        timers[8].stop();
+    timers[8].start();
+    _applyPressureToVelocityField(_pressureGrid, dt);
+    timers[8].stop();
 
-        _logfile.log("Apply Pressure:              \t", timers[8].getTime(), 4);
-    }
+    _logfile.log("Apply Pressure:              \t", timers[8].getTime(), 4);
 
     timers[9].start();
     _extrapolateFluidVelocities(_MACVelocity);
@@ -3411,7 +3825,83 @@ double FluidSimulation::_calculateNextTimeStep() {
 
 void FluidSimulation::_autosave() {
     std::string dir = Config::getSavestatesDirectory();
-    saveState(dir + "/autosave.state");
+    std::string filename = dir + "/autosave.state";
+
+    if (_autosaveWriter.isWriting()) {
+        _logfile.log(std::ostringstream().flush() << 
+                     _logfile.getTime() << " autosave skipped: previous autosave in progress" << 
+                     std::endl);
+        return;
+    }
+
+    _logfile.log(std::ostringstream().flush() << 
+                 _logfile.getTime() << " autosave: " << filename << std::endl);
+
+    FluidSimulationSaveStateSnapshot *snapshot = _autosaveWriter.getSnapshot();
+    _getSaveStateSnapshot(*snapshot);
+    _autosaveWriter.writeSnapshot(filename);
+}
+
+/*
+    Particle buffers are copied in parallel into the snapshot's existing 
+    storage. The brick grid is serialized into memory since its save state 
+    is assembled from several temporary grids.
+*/
+void FluidSimulation::_getSaveStateSnapshot(FluidSimulationSaveStateSnapshot &snapshot) {
+    snapshot.isize = _isize;
+    snapshot.jsize = _jsize;
+    snapshot.ksize = _ksize;
+    snapshot.dx = _dx;
+    snapshot.currentFrame = _currentFrame;
+
+    int numParticles = (int)_markerParticles.size();
+    vmath::vec3 *positions = _markerParticles.getPositions()->data();
+    vmath::vec3 *velocities = _markerParticles.getVelocities()->data();
+    snapshot.markerParticlePositions.resize(numParticles);
+    snapshot.markerParticleVelocities.resize(numParticles);
+    vmath::vec3 *snapshotPositions = snapshot.markerParticlePositions.data();
+    vmath::vec3 *snapshotVelocities = snapshot.markerParticleVelocities.data();
+    _parallelForParticleRange(numParticles, numParticles,
+                              [positions, velocities, snapshotPositions, 
+                               snapshotVelocities](int begin, int end) {
+        std::copy(positions + begin, positions + end, snapshotPositions + begin);
+        std::copy(velocities + begin, velocities + end, snapshotVelocities + begin);
+    });
+
+    FragmentedVector<DiffuseParticle> *dps = _diffuseMaterial.getDiffuseParticles();
+    int numDiffuseParticles = (int)dps->size();
+    snapshot.diffuseParticles.clear();
+    snapshot.diffuseParticles.reserve(numDiffuseParticles);
+    for (int i = 0; i < numDiffuseParticles; i++) {
+        snapshot.diffuseParticles.push_back(dps->at(i));
+    }
+
+    int depth = _materialGrid.depth;
+    std::vector<std::vector<GridIndex> > sliceCells(depth);
+    _getThreadPool()->run(depth, [this, &sliceCells](int k) {
+        for (int j = 0; j < _materialGrid.height; j++) {
+            for (int i = 0; i < _materialGrid.width; i++) {
+                if (_materialGrid.isCellSolid(i, j, k)) {
+                    sliceCells[k].push_back(GridIndex(i, j, k));
+                }
+            }
+        }
+    });
+
+    snapshot.solidCells.clear();
+    for (int k = 0; k < depth; k++) {
+        snapshot.solidCells.insert(snapshot.solidCells.end(), 
+                                   sliceCells[k].begin(), sliceCells[k].end());
+    }
+
+    snapshot.isFluidBrickGridEnabled = _isBrickOutputEnabled;
+    snapshot.fluidBrickGridData.clear();
+    if (_isBrickOutputEnabled) {
+        std::ostringstream data(std::ios::out | std::ios::binary);
+        FluidBrickGridSaveState brickstate;
+        brickstate.saveState(&data, &_fluidBrickGrid);
+        snapshot.fluidBrickGridData = data.str();
+    }
 }
 
 void FluidSimulation::update(double dt) {
@@ -49,14 +49,21 @@ freely, subject to the following restrictions:
 #include "gridindexkeymap.h"
 #include "pressuresolver.h"
 #include "particleadvector.h"
+#include "opencldevice.h"
+#include "computebackend.h"
+#include "velocitytransfer.h"
+#include "threadpool.h"
 #include "fluidmaterialgrid.h"
 #include "gridindexvector.h"
 #include "fragmentedvector.h"
 #include "vmath.h"
+#include "asyncoutputwriter.h"
+#include "autosavewriter.h"
 #include "fluidsimassert.h"
 #include "config.h"
 
 #include "markerparticle.h"
+#include "markerparticlevector.h"
 #include "diffuseparticle.h"
 
 class FluidSimulation
@@ -186,17 +193,44 @@ public:
 
     /*
         How many slices the polygonizer will section the surface reconstruction
-        grid into when computing the triangle mesh. The polygonizer will compute
-        the triangle mesh one slice at a time before combining them into a
-        single triangle mesh.
+        grid into when computing the triangle mesh. Slices are polygonized
+        concurrently on the simulation threads before being combined into a 
+        single triangle mesh. The grid is always split into at least one 
+        slice per thread.
 
         A higher subdivision level may require a very large amount of memory to
         store the polygonization grid data. Setting the number of slices will 
-        reduce the memory required at the cost of speed.
+        reduce the memory required at the cost of speed. Prefer setting
+        the polygonizer memory limit below.
     */
     int getNumPolygonizerSlices();
     void setNumPolygonizerSlices(int n);
 
+    /*
+        Maximum number of bytes of polygonization grid data for the slices 
+        that are polygonized at the same time. The surface reconstruction 
+        grid is split into as many slices as needed to stay under the limit.
+
+        A value of 0 means no limit. No limit by default.
+    */
+    long long getMaxPolygonizerMemory();
+    void setMaxPolygonizerMemory(long long bytes);
+
+    /*
+        Enable/disable storing the surface reconstruction scalar field in 
+        blocks that are only allocated near marker particles. Memory then 
+        scales with the fluid volume rather than the volume of the 
+        subdivided grid, which allows high subdivision levels without 
+        slicing the polygonization grid.
+
+        The OpenCL scalar field accelerator is not used while enabled.
+
+        Disabled by default.
+    */
+    void enableSparseSurfaceReconstruction();
+    void disableSparseSurfaceReconstruction();
+    bool isSparseSurfaceReconstructionEnabled();
+
     /*
         Will ensure that the output triangle mesh only contains polyhedrons
         that contain a minimum number of triangles. Removing polyhedrons with
@@ -273,6 +307,21 @@ public:
     void disableAnisotropicSurfaceReconstruction();
     bool isAnisotropicSurfaceReconstructionEnabled();
 
+    /*
+        Enable/disable computing the level set signed distance field by 
+        parallel fast sweeping instead of layer by layer propagation.
+
+        The level set is used by anisotropic surface reconstruction, brick 
+        output and diffuse material simulation. Fast sweeping passes closest 
+        triangles along diagonal planes in eight directions and can be
+        more accurate for wide level set bands.
+
+        Disabled by default.
+    */
+    void enableLevelSetFastSweeping();
+    void disableLevelSetFastSweeping();
+    bool isLevelSetFastSweepingEnabled();
+
     /*
         Enable/disable the simulation from simulating diffuse 
         material (spray/bubble/foam particles), and saving diffuse mesh data to disk.
@@ -413,6 +462,103 @@ public:
     void disableAutosave();
     bool isAutosaveEnabled();
 
+    /*
+        Enable/disable writing autosave states on a background thread. When
+        enabled, the particle and grid data are copied at the start of each 
+        frame and the save state is written while the simulation continues.
+        If the previous autosave is still being written, the autosave for 
+        the current frame is skipped. Call flushAutosave() to wait for the 
+        current autosave to complete.
+
+        Enabled by default.
+    */
+    void enableAsynchronousAutosave();
+    void disableAsynchronousAutosave();
+    bool isAsynchronousAutosaveEnabled();
+    void flushAutosave();
+
+    /*
+        Number of autosave states kept in the savestates directory. The 
+        latest state is written to autosave.state and older states are 
+        rotated through autosave.1.state to autosave.<n-1>.state. A state 
+        only replaces autosave.state once it has been completely written.
+
+        Default is 2.
+    */
+    int getNumAutosaveCheckpoints();
+    void setNumAutosaveCheckpoints(int n);
+
+    /*
+        Enable/disable incremental autosave checkpoints. When enabled, a 
+        complete save state is written to autosave.full.<frame>.state every 
+        n autosaves, or when the solid cells have changed. The autosaves in 
+        between are delta save states that do not store the solid cells and
+        read them from the latest full checkpoint when loaded. A full 
+        checkpoint is deleted once it is no longer referenced.
+
+        Disabled by default. Default full checkpoint interval is 10.
+    */
+    void enableIncrementalAutosave();
+    void disableIncrementalAutosave();
+    bool isIncrementalAutosaveEnabled();
+    int getAutosaveFullCheckpointInterval();
+    void setAutosaveFullCheckpointInterval(int n);
+
+    /*
+        Enable/disable lossless compression of save states written by 
+        saveState() and by autosave. Particle data is byte shuffled and 
+        compressed in parallel blocks and solid cells are stored as a 
+        compressed bitmask. Compressed save states are decompressed 
+        in parallel when loaded.
+
+        Disabled by default.
+    */
+    void enableSaveStateCompression();
+    void disableSaveStateCompression();
+    bool isSaveStateCompressionEnabled();
+
+    /*
+        Enable/disable writing output files on a background thread. When 
+        enabled, surface meshes, diffuse particles and brick data are queued 
+        and written while the simulation continues. Output files for a frame 
+        may not be complete when update() returns. Call flushOutput() to 
+        wait until all queued files have been written.
+
+        Enabled by default.
+    */
+    void enableAsynchronousOutput();
+    void disableAsynchronousOutput();
+    bool isAsynchronousOutputEnabled();
+    void flushOutput();
+
+    /*
+        Maximum amount of output data in megabytes that can be queued for 
+        writing. The simulation blocks when the queue is full until enough 
+        queued data has been written.
+
+        Defaults to 1024 MB.
+    */
+    int getMaxOutputQueueSize();
+    void setMaxOutputQueueSize(int megabytes);
+
+    /*
+        Compute backend used for particle advection and scalar field
+        computation.
+
+        OpenCL:   kernels are run on an OpenCL device. If no OpenCL device 
+                  is found when the simulation is initialized, the threaded
+                  backend is used instead.
+        Threaded: native SIMD implementation that runs on the simulation 
+                  thread pool.
+        Serial:   single threaded reference implementation.
+
+        OpenCL is the default if the library was built with OpenCL support,
+        otherwise Threaded is the default.
+    */
+    void setComputeBackendAsOpenCL();
+    void setComputeBackendAsThreaded();
+    void setComputeBackendAsSerial();
+
     /*
         Enable/disable use of OpenCL for particle advection.
 
@@ -444,6 +590,84 @@ public:
     int getScalarFieldKernelWorkLoadSize();
     void setScalarFieldKernelWorkLoadSize(int n);
 
+    /*
+        Number of threads used by the simulation. Particle advection, 
+        velocity updates, fluid cell updates and the multithreaded pressure
+        solver share a single pool of threads.
+
+        Defaults to the number of hardware threads on the system.
+    */
+    int getNumThreads();
+    void setNumThreads(int n);
+
+    /*
+        Enable/disable multithreading in the pressure solver. When enabled,
+        matrix and vector operations are distributed across the simulation 
+        threads and a multicolor ordered MIC(0) preconditioner is used in 
+        place of the sequential MIC(0) preconditioner.
+
+        Disabled by default.
+    */
+    void enableMultithreadedPressureSolver();
+    void disableMultithreadedPressureSolver();
+    bool isMultithreadedPressureSolverEnabled();
+
+    /*
+        Enable/disable deterministic reductions in the multithreaded 
+        pressure solver. When enabled, dot products are summed in a fixed 
+        order so that results are reproducible between runs regardless 
+        of thread count.
+
+        Enabled by default.
+    */
+    void enableDeterministicPressureSolverReduction();
+    void disableDeterministicPressureSolverReduction();
+    bool isDeterministicPressureSolverReductionEnabled();
+
+    /*
+        Enable/disable the geometric multigrid preconditioner in the 
+        pressure solver (MGPCG). The number of solver iterations stays 
+        roughly constant as grid resolution increases, at the cost of 
+        additional memory for the multigrid level hierarchy.
+
+        Disabled by default.
+    */
+    void enableMultigridPressureSolver();
+    void disableMultigridPressureSolver();
+    bool isMultigridPressureSolverEnabled();
+
+    /*
+        Enable/disable the matrix-free pressure operator. Fluid cell 
+        neighbours are resolved into flat index arrays once per pressure 
+        solve and the solver iterations run on these arrays using SIMD 
+        kernels when the library is compiled with AVX2 or AVX-512 support.
+
+        Disabled by default.
+    */
+    void enableMatrixFreePressureOperator();
+    void disableMatrixFreePressureOperator();
+    bool isMatrixFreePressureOperatorEnabled();
+
+    /*
+        Enable/disable warm starting the pressure solver. When enabled, the
+        pressure solution from the previous time step is used as the 
+        initial guess for cells that remain fluid cells.
+
+        Enabled by default.
+    */
+    void enablePressureSolverWarmStart();
+    void disablePressureSolverWarmStart();
+    bool isPressureSolverWarmStartEnabled();
+
+    /*
+        Statistics from the most recent pressure solve. Residuals are
+        the maximum absolute value of the residual vector before the first
+        and after the last solver iteration.
+    */
+    int getPressureSolverIterationCount();
+    double getPressureSolverInitialResidual();
+    double getPressureSolverResidual();
+
     /*
         Add a constant force such as gravity to the simulation.
     */
@@ -787,6 +1011,7 @@ private:
     double _calculateNextTimeStep();
     double _getMaximumMarkerParticleSpeed();
     void _autosave();
+    void _getSaveStateSnapshot(FluidSimulationSaveStateSnapshot &snapshot);
     void _stepFluid(double dt);
 
     /*
@@ -871,6 +1096,9 @@ private:
         surface and/or computation of the level set signed distance
         field as a prerequisite.
 
+        Finished meshes and data buffers are moved into _outputWriter,
+        which writes them to disk while the simulation continues.
+
         If the update() method requires multiple calls to _stepFluid(),
         this stage of the algorithm will only be computed on the first
         call to _stepFluid.
@@ -891,7 +1119,7 @@ private:
     void _writeBrickMaterialToFile(std::string brickfile, 
                                    std::string colorfile, 
                                    std::string texturefile);
-    void _writeTriangleMeshToFile(TriangleMesh &mesh, std::string filename);
+    void _writeTriangleMeshToFile(TriangleMesh &&mesh, std::string filename);
     void _smoothSurfaceMesh(TriangleMesh &mesh);
     void _getSmoothVertices(TriangleMesh &mesh, std::vector<int> &smoothVertices);
     bool _isVertexNearSolid(vmath::vec3 v, double eps);
@@ -914,12 +1142,15 @@ private:
         MACVelocityField.
     */
     void _advectVelocityField();
-    void _advectVelocityFieldU();
-    void _advectVelocityFieldV();
-    void _advectVelocityFieldW();
-    void _computeVelocityScalarField(Array3d<float> &field, 
-                                     Array3d<bool> &isValueSet, 
-                                     int dir);
+    void _advectVelocityFieldU(Array3d<float> &ugrid, Array3d<bool> &isValueSet);
+    void _advectVelocityFieldV(Array3d<float> &vgrid, Array3d<bool> &isValueSet);
+    void _advectVelocityFieldW(Array3d<float> &wgrid, Array3d<bool> &isValueSet);
+    void _computeVelocityGrids(Array3d<float> &ugrid, 
+                               Array3d<float> &vgrid, 
+                               Array3d<float> &wgrid,
+                               Array3d<bool> &isUValueSet, 
+                               Array3d<bool> &isVValueSet, 
+                               Array3d<bool> &isWValueSet);
     void _applyFluidSourceToVelocityField(FluidSource *source,
                                           int dir,
                                           Array3d<bool> &isValueSet,
@@ -1023,7 +1254,8 @@ private:
         is used to compute FLIP velocities.
     */
     void _updateMarkerParticleVelocities();
-    void _updateRangeOfMarkerParticleVelocities(int startIdx, int endIdx);
+    void _updateRangeOfMarkerParticleVelocities(std::vector<vmath::vec3> &positions,
+                                                int startIdx);
 
     /*
         12. Advance MarkerParticles
@@ -1039,13 +1271,23 @@ private:
         _maxMarkerParticlesPerCell variable.
     */
     void _advanceMarkerParticles(double dt);
-    void _advanceRangeOfMarkerParticles(int startIdx, int endIdx, double dt);
+    void _advanceRangeOfMarkerParticles(std::vector<vmath::vec3> &positions,
+                                        int startIdx, double dt);
     vmath::vec3 _resolveParticleSolidCellCollision(vmath::vec3 p0, vmath::vec3 p1);
     void _removeMarkerParticles();
     void _shuffleMarkerParticleOrder();
 
-    template<class T>
-    void _removeItemsFromVector(FragmentedVector<T> &items, std::vector<bool> &isRemoved) {
+    /*
+        The thread pool is created on first use. Ranges of particles are
+        split into tasks of at most maxTaskSize particles, with enough tasks
+        to balance the work across threads.
+    */
+    ThreadPool* _getThreadPool();
+    void _parallelForParticleRange(int numParticles, int maxTaskSize,
+                                   std::function<void(int, int)> func);
+
+    template<class T, class F>
+    void _removeItemsFromVector(FragmentedVector<T> &items, std::vector<F> &isRemoved) {
         FLUIDSIM_ASSERT(items.size() == isRemoved.size());
 
         int currentidx = 0;
@@ -1097,14 +1339,17 @@ private:
     bool _isFirstTimeStepForFrame = false;
     double _CFLConditionNumber = 5.0;
     bool _isAutosaveEnabled = true;
+    bool _isSaveStateCompressionEnabled = false;
     LogFile _logfile;
+    AsyncOutputWriter _outputWriter;
+    AutosaveWriter _autosaveWriter;
 
     // Update fluid material
     FluidMaterialGrid _materialGrid;
     std::vector<FluidSource*> _fluidSources;
     std::vector<SphericalFluidSource*> _sphericalFluidSources;
     std::vector<CuboidFluidSource*> _cuboidFluidSources;
-    FragmentedVector<MarkerParticle> _markerParticles;
+    MarkerParticleVector _markerParticles;
     std::vector<GridCellGroup> _addedFluidCellQueue;
     std::vector<GridCellGroup> _removedFluidCellQueue;
     GridIndexVector _fluidCellIndices;
@@ -1123,6 +1368,7 @@ private:
     bool _isSurfaceMeshOutputEnabled = true;
     bool _isIsotropicSurfaceMeshReconstructionEnabled = true;
     bool _isAnisotropicSurfaceMeshReconstructionEnabled = false;
+    bool _isLevelSetFastSweepingEnabled = false;
     bool _isDiffuseMaterialOutputEnabled = false;
     bool _isBubbleDiffuseMaterialEnabled = true;
     bool _isSprayDiffuseMaterialEnabled = true;
@@ -1131,6 +1377,8 @@ private:
     bool _isBrickOutputEnabled = false;
     int _outputFluidSurfaceSubdivisionLevel = 1;
     int _numSurfaceReconstructionPolygonizerSlices = 1;
+    long long _maxPolygonizerMemory = 0;
+    bool _isSparseSurfaceReconstructionEnabled = false;
     double _surfaceReconstructionSmoothingValue = 0.5;
     int _surfaceReconstructionSmoothingIterations = 2;
     int _minimumSurfacePolyhedronTriangleCount = 0;
@@ -1143,7 +1391,12 @@ private:
     FluidBrickGrid _fluidBrickGrid;
 
     // Advect velocity field
-    int _maxParticlesPerVelocityAdvection = 5e6;
+    VelocityTransfer _velocityTransfer;
+
+    // Threading
+    ThreadPool *_threadPool = nullptr;
+    int _numThreads = ThreadPool::getMaxThreadCount();
+    int _minParticlesPerThreadTask = 2048;
 
     // Apply body forces
     typedef vmath::vec3 (*FieldFunction)(vmath::vec3);
@@ -1152,6 +1405,13 @@ private:
 
     // Pressure solve
     double _density = 20.0;
+    PressureSolver _pressureSolver;
+    bool _isMultithreadedPressureSolverEnabled = false;
+    bool _isDeterministicPressureSolverReductionEnabled = true;
+    bool _isMultigridPressureSolverEnabled = false;
+    bool _isPressureSolverWarmStartEnabled = true;
+    bool _isMatrixFreePressureOperatorEnabled = false;
+    Array3d<float> _pressureGrid;
 
     // Update diffuse particle simulation
     DiffuseParticleSimulation _diffuseMaterial;
@@ -1166,7 +1426,8 @@ private:
     int _maxParticlesPerParticleAdvection = 10e6;
     int _maxMarkerParticlesPerCell = 100;
     
-    // OpenCL
+    // Compute backends
+    OpenCLDevice _openCLDevice;
     ParticleAdvector _particleAdvector;
     CLScalarField _scalarFieldAccelerator;
 
@@ -19,7 +19,33 @@ freely, subject to the following restrictions:
 */
 #include "fluidsimulationsavestate.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <sstream>
+
 #include "fluidsimulation.h"
+#include "blockcompression.h"
+
+static const char SAVESTATE_MAGIC[8] = {'F', 'L', 'U', 'I', 'D', 'S', 'S', '2'};
+static const int SAVESTATE_VERSION = 4;
+
+// magic, version, i, j, k, dx, current frame, num sections, brick grid flag
+static const size_t SAVESTATE_HEADER_SIZE = 8 + 4*sizeof(int) + sizeof(double) + 
+                                            2*sizeof(int) + 4;
+
+// type, element type, offset, num elements, num bytes, checksum
+static const size_t SAVESTATE_SECTION_ENTRY_SIZE_V2 = 2*sizeof(int) + 
+                                                      4*sizeof(unsigned long long);
+
+// type, element type, encoding, reserved, offset, num elements, num bytes,
+// decoded bytes, checksum
+static const size_t SAVESTATE_SECTION_ENTRY_SIZE = 4*sizeof(int) + 
+                                                   5*sizeof(unsigned long long);
+
+// Stored size flag of a compressed block that did not compress and is 
+// stored as raw bytes
+static const unsigned int SAVESTATE_RAW_BLOCK_FLAG = 0x80000000;
 
 FluidSimulationSaveState::FluidSimulationSaveState() {
 }
@@ -28,133 +54,255 @@ FluidSimulationSaveState::~FluidSimulationSaveState() {
     closeState();
 }
 
-void FluidSimulationSaveState::saveState(std::string filename, FluidSimulation *_fluidsim) {
-    std::ofstream erasefile;
-    erasefile.open(filename, std::ofstream::out | std::ofstream::trunc);
-    erasefile.close();
+void FluidSimulationSaveState::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
+    if (_baseState != nullptr) {
+        _baseState->setThreadPool(pool);
+    }
+}
 
+void FluidSimulationSaveState::saveState(std::string filename, FluidSimulation *_fluidsim) {
     std::ofstream state(filename.c_str(), std::ios::out | std::ios::binary);
 
     FLUIDSIM_ASSERT(state.is_open());
 
-    int i, j, k;
-    _fluidsim->getGridDimensions(&i, &j, &k);
-    double dx = _fluidsim->getCellSize();
-    _width = i;
-    _height = j;
-    _depth = k;
-
-    // i, j, k, dx
-    _writeInt(&i, &state);
-    _writeInt(&j, &state);
-    _writeInt(&k, &state);
-    _writeDouble(&dx, &state);
-
-    // next frame to be processed
-    int currentFrame = _fluidsim->getCurrentFrame();
-    _writeInt(&currentFrame, &state);
+    _fluidsim->getGridDimensions(&_isize, &_jsize, &_ksize);
+    _dx = _fluidsim->getCellSize();
+    _currentFrame = _fluidsim->getCurrentFrame();
+    _width = _isize;
+    _height = _jsize;
+    _depth = _ksize;
 
-    // number of marker particles
-    int n = _fluidsim->getNumMarkerParticles();
-    _writeInt(&n, &state);
-
-    // number of diffuse particles
-    n = _fluidsim->getNumDiffuseParticles();
-    _writeInt(&n, &state);
+    int numMarkerParticles = _fluidsim->getNumMarkerParticles();
+    int numDiffuseParticles = _fluidsim->getNumDiffuseParticles();
+    int numSolidCells = _getNumSolidCells(_fluidsim);
+    _isFluidBrickGridEnabled = _fluidsim->isBrickOutputEnabled();
 
-    // number of solid cell indices
-    int numIndices = _getNumSolidCells(_fluidsim);
-    _writeInt(&numIndices, &state);
+    _sections.assign(_numSections, SectionInfo());
 
-    // Should a FluidBrickGrid savestate be generated
-    bool isFluidBrickGridEnabled = _fluidsim->isBrickOutputEnabled();
-    _writeBool(&isFluidBrickGridEnabled, &state);
+    // Header is rewritten with the completed section table at the end
+    _writeHeader(&state);
 
     // floats: marker particle positions in form [x1, y1, z1, x2, y2, z2, ...]
+    _beginSection(SaveStateSection::markerParticlePositions, 
+                  SaveStateElementType::vec3f, numMarkerParticles, &state);
     _writeBinaryMarkerParticlePositions(_fluidsim, &state);
+    _endSection(&state);
 
     // floats: marker particle velocities in form [x1, y1, z1, x2, y2, z2, ...]
+    _beginSection(SaveStateSection::markerParticleVelocities, 
+                  SaveStateElementType::vec3f, numMarkerParticles, &state);
     _writeBinaryMarkerParticleVelocities(_fluidsim, &state);
+    _endSection(&state);
 
     // floats: diffuse particle positions in form [x1, y1, z1, x2, y2, z2, ...]
+    _beginSection(SaveStateSection::diffuseParticlePositions, 
+                  SaveStateElementType::vec3f, numDiffuseParticles, &state);
     _writeBinaryDiffuseParticlePositions(_fluidsim, &state);
+    _endSection(&state);
 
     // floats: diffuse particle velocities in form [x1, y1, z1, x2, y2, z2, ...]
+    _beginSection(SaveStateSection::diffuseParticleVelocities, 
+                  SaveStateElementType::vec3f, numDiffuseParticles, &state);
     _writeBinaryDiffuseParticleVelocities(_fluidsim, &state);
+    _endSection(&state);
 
     // floats: diffuse particle lifetimes
+    _beginSection(SaveStateSection::diffuseParticleLifetimes, 
+                  SaveStateElementType::float32, numDiffuseParticles, &state);
     _writeBinaryDiffuseParticleLifetimes(_fluidsim, &state);
+    _endSection(&state);
 
     // chars: diffuse particle types
+    _beginSection(SaveStateSection::diffuseParticleTypes, 
+                  SaveStateElementType::byte, numDiffuseParticles, &state);
     _writeBinaryDiffuseParticleTypes(_fluidsim, &state);
+    _endSection(&state);
 
     // ints: solid cell indicies in form [i1, j1, k1, i2, j2, k2, ...]
-    _writeBinarySolidCellIndices(_fluidsim, &state);
+    //  or bits: solid cell mask in order of increasing i, then j, then k
+    if (_isCellMaskEncodingUsed(numSolidCells)) {
+        _beginSection(SaveStateSection::solidCells, SaveStateElementType::int3, 
+                      numSolidCells, SaveStateEncoding::compressedCellMask, &state);
+        _writeBinarySolidCellMask(_fluidsim, &state);
+    } else {
+        _beginSection(SaveStateSection::solidCells, 
+                      SaveStateElementType::int3, numSolidCells, &state);
+        _writeBinarySolidCellIndices(_fluidsim, &state);
+    }
+    _endSection(&state);
+
+    // bytes: FluidBrickGridSaveState file contents
+    _writeBinaryFluidBrickGrid(_fluidsim, &state);
+
+    // bytes: filename of the base save state, empty for a complete state
+    _writeBinaryBaseSaveState("", &state);
+
+    state.seekp(0, state.beg);
+    _writeHeader(&state);
 
-    if (isFluidBrickGridEnabled) {
-        _writeBinaryFluidBrickGrid(_fluidsim, &state);
+    FLUIDSIM_ASSERT(state.good());
+    state.close();
+}
+
+void FluidSimulationSaveState::saveState(std::string filename, 
+                                         FluidSimulationSaveStateSnapshot &snapshot) {
+    std::vector<SaveStateSection> referencedSections;
+    saveState(filename, snapshot, "", referencedSections);
+}
+
+void FluidSimulationSaveState::saveState(std::string filename, 
+                                         FluidSimulationSaveStateSnapshot &snapshot,
+                                         std::string baseFilename,
+                                         std::vector<SaveStateSection> &referencedSections) {
+    FLUIDSIM_ASSERT(snapshot.markerParticlePositions.size() == 
+                    snapshot.markerParticleVelocities.size());
+
+    FluidSimulationSaveState base;
+    std::vector<bool> isSectionReferenced(_numSections, false);
+    if (!referencedSections.empty()) {
+        FLUIDSIM_ASSERT(!baseFilename.empty());
+        FLUIDSIM_ASSERT(_getDirectory(baseFilename) == _getDirectory(filename));
+
+        bool success = base._openState(baseFilename);
+        FLUIDSIM_ASSERT(success);
+        FLUIDSIM_ASSERT(!base.isDeltaState());
+
+        for (size_t i = 0; i < referencedSections.size(); i++) {
+            SaveStateSection type = referencedSections[i];
+            FLUIDSIM_ASSERT(type != SaveStateSection::baseSaveState);
+            isSectionReferenced[(int)type] = true;
+        }
+    } else {
+        baseFilename = "";
     }
 
+    std::ofstream state(filename.c_str(), std::ios::out | std::ios::binary);
+    FLUIDSIM_ASSERT(state.is_open());
+
+    _isize = snapshot.isize;
+    _jsize = snapshot.jsize;
+    _ksize = snapshot.ksize;
+    _dx = snapshot.dx;
+    _currentFrame = snapshot.currentFrame;
+    _width = _isize;
+    _height = _jsize;
+    _depth = _ksize;
+    _isFluidBrickGridEnabled = snapshot.isFluidBrickGridEnabled;
+
+    _sections.assign(_numSections, SectionInfo());
+
+    _writeHeader(&state);
+
+    for (int i = 0; i < _numSections; i++) {
+        SaveStateSection type = (SaveStateSection)i;
+        if (isSectionReferenced[i]) {
+            size_t numElements = _getNumSnapshotElements(type, snapshot, baseFilename);
+            _writeReferencedSection(type, numElements, base);
+        } else {
+            _writeSnapshotSection(type, snapshot, baseFilename, &state);
+        }
+    }
+
+    state.seekp(0, state.beg);
+    _writeHeader(&state);
+
+    FLUIDSIM_ASSERT(state.good());
     state.close();
 }
 
 bool FluidSimulationSaveState::loadState(std::string filename) {
-
-    _loadState.open(filename.c_str(), std::ios::in | std::ios::binary);
-    
-    if (!_loadState.is_open()) {
+    if (!_openState(filename)) {
         return false;
     }
 
-    bool success = _readInt(&_isize, &_loadState) &&
-                   _readInt(&_jsize, &_loadState) &&
-                   _readInt(&_ksize, &_loadState) &&
-                   _readDouble(&_dx, &_loadState) &&
-                   _readInt(&_currentFrame, &_loadState) &&
-                   _readInt(&_numMarkerParticles, &_loadState) &&
-                   _readInt(&_numDiffuseParticles, &_loadState) &&
-                   _readInt(&_numSolidCells, &_loadState) &&
-                   _readBool(&_isFluidBrickGridEnabled, &_loadState);
-
-    if (!success) {
+    // Sections are verified up front so that a corrupted or truncated file 
+    // is reported here rather than when its data is first accessed
+    if (!verifyChecksums()) {
+        closeState();
         return false;
     }
 
-    _mpPositionOffset = _loadState.tellg();
-    _mpVelocityOffset = _mpPositionOffset + _numMarkerParticles*(3*sizeof(float));
-    _dpPositionOffset = _mpVelocityOffset + _numMarkerParticles*(3*sizeof(float));
-    _dpVelocityOffset = _dpPositionOffset + _numDiffuseParticles*(3*sizeof(float));
-    _dpLifetimeOffset = _dpVelocityOffset + _numDiffuseParticles*(3*sizeof(float));
-    _dpTypeOffset = _dpLifetimeOffset + _numDiffuseParticles*(sizeof(float));
-    _solidCellOffset = _dpTypeOffset + _numDiffuseParticles*sizeof(char);
+    return true;
+}
 
-    if (_isFluidBrickGridEnabled) {
-        unsigned int startoffset = _solidCellOffset + _numSolidCells*(3*sizeof(int));
+bool FluidSimulationSaveState::_openState(std::string filename) {
+    closeState();
+
+    if (_mappedFile.open(filename)) {
+        _fileSize = _mappedFile.getSize();
+    } else {
+        // Fall back to reading through a file stream if the file 
+        // cannot be mapped
+        _loadState.open(filename.c_str(), std::ios::in | std::ios::binary);
+        if (!_loadState.is_open()) {
+            return false;
+        }
+
+        _loadState.seekg(0, _loadState.end);
+        _fileSize = (size_t)_loadState.tellg();
+        _loadState.seekg(0, _loadState.beg);
+    }
 
-        _loadState.seekg (0, _loadState.end);
-        unsigned int endoffset = _loadState.tellg();
-        _loadState.seekg (startoffset, _loadState.beg);
+    char magic[sizeof(SAVESTATE_MAGIC)];
+    bool isVersion2 = _readLoadState(0, magic, sizeof(magic)) && 
+                      memcmp(magic, SAVESTATE_MAGIC, sizeof(magic)) == 0;
 
-        _initializeTempFluidBrickGridFile(startoffset, endoffset);
+    bool success;
+    if (isVersion2) {
+        success = _loadStateVersion2();
+    } else {
+        success = _loadStateVersion1();
     }
 
-    _loadState.seekg(0, _loadState.beg);
-    _currentOffset = _loadState.tellg();
+    if (success) {
+        success = _initializeBaseState(filename);
+    }
+
+    if (!success) {
+        closeState();
+        return false;
+    }
 
     _isLoadStateInitialized = true;
     return true;
 }
 
 void FluidSimulationSaveState::closeState() {
+    _mappedFile.close();
     if (_loadState.is_open()) {
         _loadState.close();
-        _isLoadStateInitialized = false;
     }
 
-    if (_isTempFileInUse) {
-        remove(_tempFilename.c_str());
-        _isTempFileInUse = false;
+    if (_baseState != nullptr) {
+        delete _baseState;
+        _baseState = nullptr;
     }
+
+    _fluidBrickGridData.clear();
+    _fluidBrickGridData.shrink_to_fit();
+    _sections.clear();
+    _sections.shrink_to_fit();
+    _fileSize = 0;
+    _version = 0;
+    _isLoadStateInitialized = false;
+}
+
+void FluidSimulationSaveState::enableCompression() {
+    _isCompressionEnabled = true;
+}
+
+void FluidSimulationSaveState::disableCompression() {
+    _isCompressionEnabled = false;
+}
+
+bool FluidSimulationSaveState::isCompressionEnabled() {
+    return _isCompressionEnabled;
+}
+
+int FluidSimulationSaveState::getVersion() {
+    FLUIDSIM_ASSERT(_isLoadStateInitialized);
+    return _version;
 }
 
 void FluidSimulationSaveState::getGridDimensions(int *i, int *j, int *k) {
@@ -224,16 +372,16 @@ std::vector<vmath::vec3> FluidSimulationSaveState::getMarkerParticlePositions(
     }
 
     FLUIDSIM_ASSERT(_isLoadStateInitialized);
-    FLUIDSIM_ASSERT(endidx >= 0 && endidx <= _numMarkerParticles);
+    FLUIDSIM_ASSERT(startidx >= 0 && endidx <= _numMarkerParticles);
 
-    unsigned int foffset = _mpPositionOffset + startidx*(3*sizeof(float));
-    _setLoadStateFileOffset(foffset);
+    SaveStateSection type = SaveStateSection::markerParticlePositions;
+    _assertSectionVerified(type);
 
     int n = endidx - startidx;
-    std::vector<vmath::vec3> positions;
-    positions.reserve(n);
+    std::vector<vmath::vec3> positions(n);
 
-    bool success = _readParticleVectors(positions, n, &_loadState);
+    size_t offset = startidx*(3*sizeof(float));
+    bool success = _readSectionData(type, offset, (char *)positions.data(), n*(3*sizeof(float)));
     FLUIDSIM_ASSERT(success);
 
     return positions;
@@ -246,16 +394,16 @@ std::vector<vmath::vec3> FluidSimulationSaveState::getMarkerParticleVelocities(
     }
 
     FLUIDSIM_ASSERT(_isLoadStateInitialized);
-    FLUIDSIM_ASSERT(endidx >= 0 && endidx <= _numMarkerParticles);
+    FLUIDSIM_ASSERT(startidx >= 0 && endidx <= _numMarkerParticles);
 
-    unsigned int foffset = _mpVelocityOffset + startidx*(3*sizeof(float));
-    _setLoadStateFileOffset(foffset);
+    SaveStateSection type = SaveStateSection::markerParticleVelocities;
+    _assertSectionVerified(type);
 
     int n = endidx - startidx;
-    std::vector<vmath::vec3> velocities;
-    velocities.reserve(n);
+    std::vector<vmath::vec3> velocities(n);
 
-    bool success = _readParticleVectors(velocities, n, &_loadState);
+    size_t offset = startidx*(3*sizeof(float));
+    bool success = _readSectionData(type, offset, (char *)velocities.data(), n*(3*sizeof(float)));
     FLUIDSIM_ASSERT(success);
 
     return velocities;
@@ -268,16 +416,16 @@ std::vector<vmath::vec3> FluidSimulationSaveState::getDiffuseParticlePositions(
     }
 
     FLUIDSIM_ASSERT(_isLoadStateInitialized);
-    FLUIDSIM_ASSERT(endidx >= 0 && endidx <= _numDiffuseParticles);
+    FLUIDSIM_ASSERT(startidx >= 0 && endidx <= _numDiffuseParticles);
 
-    unsigned int foffset = _dpPositionOffset + startidx*(3*sizeof(float));
-    _setLoadStateFileOffset(foffset);
+    SaveStateSection type = SaveStateSection::diffuseParticlePositions;
+    _assertSectionVerified(type);
 
     int n = endidx - startidx;
-    std::vector<vmath::vec3> positions;
-    positions.reserve(n);
+    std::vector<vmath::vec3> positions(n);
 
-    bool success = _readParticleVectors(positions, n, &_loadState);
+    size_t offset = startidx*(3*sizeof(float));
+    bool success = _readSectionData(type, offset, (char *)positions.data(), n*(3*sizeof(float)));
     FLUIDSIM_ASSERT(success);
 
     return positions;
@@ -290,16 +438,16 @@ std::vector<vmath::vec3> FluidSimulationSaveState::getDiffuseParticleVelocities(
     }
 
     FLUIDSIM_ASSERT(_isLoadStateInitialized);
-    FLUIDSIM_ASSERT(endidx >= 0 && endidx <= _numDiffuseParticles);
+    FLUIDSIM_ASSERT(startidx >= 0 && endidx <= _numDiffuseParticles);
 
-    unsigned int foffset = _dpVelocityOffset + startidx*(3*sizeof(float));
-    _setLoadStateFileOffset(foffset);
+    SaveStateSection type = SaveStateSection::diffuseParticleVelocities;
+    _assertSectionVerified(type);
 
     int n = endidx - startidx;
-    std::vector<vmath::vec3> velocities;
-    velocities.reserve(n);
+    std::vector<vmath::vec3> velocities(n);
 
-    bool success = _readParticleVectors(velocities, n, &_loadState);
+    size_t offset = startidx*(3*sizeof(float));
+    bool success = _readSectionData(type, offset, (char *)velocities.data(), n*(3*sizeof(float)));
     FLUIDSIM_ASSERT(success);
 
     return velocities;
@@ -312,17 +460,16 @@ std::vector<float> FluidSimulationSaveState::getDiffuseParticleLifetimes(
     }
 
     FLUIDSIM_ASSERT(_isLoadStateInitialized);
-    FLUIDSIM_ASSERT(startidx <= endidx);
-    FLUIDSIM_ASSERT(endidx >= 0 && endidx <= _numDiffuseParticles);
+    FLUIDSIM_ASSERT(startidx >= 0 && endidx <= _numDiffuseParticles);
 
-    unsigned int foffset = _dpLifetimeOffset + startidx*sizeof(float);
-    _setLoadStateFileOffset(foffset);
+    SaveStateSection type = SaveStateSection::diffuseParticleLifetimes;
+    _assertSectionVerified(type);
 
     int n = endidx - startidx;
-    std::vector<float> lifetimes;
-    lifetimes.reserve(n);
+    std::vector<float> lifetimes(n);
 
-    bool success = _readParticleLifetimes(lifetimes, n, &_loadState);
+    size_t offset = startidx*sizeof(float);
+    bool success = _readSectionData(type, offset, (char *)lifetimes.data(), n*sizeof(float));
     FLUIDSIM_ASSERT(success);
 
     return lifetimes;
@@ -330,23 +477,21 @@ std::vector<float> FluidSimulationSaveState::getDiffuseParticleLifetimes(
 
 std::vector<char> FluidSimulationSaveState::getDiffuseParticleTypes(
                                                         int startidx, int endidx) {
-
     if (startidx > endidx) {
         return std::vector<char>();
     }
 
     FLUIDSIM_ASSERT(_isLoadStateInitialized);
-    FLUIDSIM_ASSERT(startidx <= endidx);
-    FLUIDSIM_ASSERT(endidx >= 0 && endidx <= _numDiffuseParticles);
+    FLUIDSIM_ASSERT(startidx >= 0 && endidx <= _numDiffuseParticles);
 
-    unsigned int foffset = _dpTypeOffset + startidx*sizeof(char);
-    _setLoadStateFileOffset(foffset);
+    SaveStateSection type = SaveStateSection::diffuseParticleTypes;
+    _assertSectionVerified(type);
 
     int n = endidx - startidx;
-    std::vector<char> types;
-    types.reserve(n);
+    std::vector<char> types(n);
 
-    bool success = _readParticleTypes(types, n, &_loadState);
+    size_t offset = startidx*sizeof(char);
+    bool success = _readSectionData(type, offset, types.data(), n*sizeof(char));
     FLUIDSIM_ASSERT(success);
 
     return types;
@@ -359,19 +504,47 @@ std::vector<GridIndex> FluidSimulationSaveState::getSolidCells(
     }
 
     FLUIDSIM_ASSERT(_isLoadStateInitialized);
-    FLUIDSIM_ASSERT(endidx >= 0 && endidx <= _numSolidCells);
+    FLUIDSIM_ASSERT(startidx >= 0 && endidx <= _numSolidCells);
 
-    unsigned int foffset = _solidCellOffset + startidx*(3*sizeof(int));
-    _setLoadStateFileOffset(foffset);
+    SaveStateSection type = SaveStateSection::solidCells;
+    _assertSectionVerified(type);
 
     int n = endidx - startidx;
-    std::vector<GridIndex> cells;
-    cells.reserve(n);
+    std::vector<GridIndex> indices(n);
 
-    bool success = _readSolidCells(cells, n, &_loadState);
+    size_t offset = startidx*(3*sizeof(int));
+    bool success = _readSectionData(type, offset, (char *)indices.data(), n*(3*sizeof(int)));
     FLUIDSIM_ASSERT(success);
 
-    return cells;
+    return indices;
+}
+
+const vmath::vec3* FluidSimulationSaveState::getMarkerParticlePositionData() {
+    return (const vmath::vec3 *)_getSectionData(SaveStateSection::markerParticlePositions);
+}
+
+const vmath::vec3* FluidSimulationSaveState::getMarkerParticleVelocityData() {
+    return (const vmath::vec3 *)_getSectionData(SaveStateSection::markerParticleVelocities);
+}
+
+const vmath::vec3* FluidSimulationSaveState::getDiffuseParticlePositionData() {
+    return (const vmath::vec3 *)_getSectionData(SaveStateSection::diffuseParticlePositions);
+}
+
+const vmath::vec3* FluidSimulationSaveState::getDiffuseParticleVelocityData() {
+    return (const vmath::vec3 *)_getSectionData(SaveStateSection::diffuseParticleVelocities);
+}
+
+const float* FluidSimulationSaveState::getDiffuseParticleLifetimeData() {
+    return (const float *)_getSectionData(SaveStateSection::diffuseParticleLifetimes);
+}
+
+const char* FluidSimulationSaveState::getDiffuseParticleTypeData() {
+    return _getSectionData(SaveStateSection::diffuseParticleTypes);
+}
+
+const GridIndex* FluidSimulationSaveState::getSolidCellData() {
+    return (const GridIndex *)_getSectionData(SaveStateSection::solidCells);
 }
 
 bool FluidSimulationSaveState::isFluidBrickGridEnabled() {
@@ -382,8 +555,21 @@ bool FluidSimulationSaveState::isFluidBrickGridEnabled() {
 void FluidSimulationSaveState::getFluidBrickGridSaveState(FluidBrickGridSaveState &state) {
     FLUIDSIM_ASSERT(_isLoadStateInitialized);
     FLUIDSIM_ASSERT(_isFluidBrickGridEnabled);
-    FLUIDSIM_ASSERT(_isTempFileInUse);
-    bool success = state.loadState(_tempFilename);
+
+    SaveStateSection type = SaveStateSection::fluidBrickGrid;
+    _assertSectionVerified(type);
+
+    SectionInfo *info = &(_sections[(int)type]);
+    const char *data = _getSectionData(type);
+    if (data == nullptr) {
+        _fluidBrickGridData.resize(info->decodedBytes);
+        bool success = _readSectionData(type, 0, _fluidBrickGridData.data(), 
+                                        info->decodedBytes);
+        FLUIDSIM_ASSERT(success);
+        data = _fluidBrickGridData.data();
+    }
+
+    bool success = state.loadState(data, info->decodedBytes);
     FLUIDSIM_ASSERT(success);
     FLUIDSIM_ASSERT(state.isLoadStateInitialized());
 }
@@ -392,6 +578,345 @@ bool FluidSimulationSaveState::isLoadStateInitialized() {
     return _isLoadStateInitialized;
 }
 
+bool FluidSimulationSaveState::verifyChecksums() {
+    FLUIDSIM_ASSERT(_isLoadStateInitialized);
+    for (int i = 0; i < _numSections; i++) {
+        if (!_verifySection((SaveStateSection)i)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool FluidSimulationSaveState::isDeltaState() {
+    FLUIDSIM_ASSERT(_isLoadStateInitialized);
+    return _baseState != nullptr;
+}
+
+void FluidSimulationSaveState::Checksum::update(const char *data, size_t numBytes) {
+    while (_tailSize > 0 && _tailSize < 4 && numBytes > 0) {
+        _tail[_tailSize] = *data;
+        _tailSize++;
+        data++;
+        numBytes--;
+    }
+
+    if (_tailSize == 4) {
+        _addWords(_tail, 1);
+        _tailSize = 0;
+    }
+
+    size_t numWords = numBytes / 4;
+    _addWords(data, numWords);
+    data += 4*numWords;
+    numBytes -= 4*numWords;
+
+    for (size_t i = 0; i < numBytes; i++) {
+        _tail[_tailSize] = data[i];
+        _tailSize++;
+    }
+}
+
+unsigned long long FluidSimulationSaveState::Checksum::finish() {
+    if (_tailSize > 0) {
+        for (size_t i = _tailSize; i < 4; i++) {
+            _tail[i] = 0;
+        }
+        _addWords(_tail, 1);
+        _tailSize = 0;
+    }
+
+    return (_sum2 << 32) | _sum1;
+}
+
+/*
+    The modulo is deferred over blocks of words. Block size is chosen so 
+    that the sums cannot overflow 64 bits before they are reduced.
+*/
+void FluidSimulationSaveState::Checksum::_addWords(const char *data, size_t numWords) {
+    const unsigned long long modulus = 0xFFFFFFFFULL;
+    const size_t blockSize = 65536;
+
+    unsigned long long sum1 = _sum1;
+    unsigned long long sum2 = _sum2;
+    while (numWords > 0) {
+        size_t n = std::min(numWords, blockSize);
+        for (size_t i = 0; i < n; i++) {
+            unsigned int word;
+            memcpy(&word, data + 4*i, sizeof(unsigned int));
+            sum1 += word;
+            sum2 += sum1;
+        }
+        sum1 %= modulus;
+        sum2 %= modulus;
+
+        data += 4*n;
+        numWords -= n;
+    }
+
+    _sum1 = sum1;
+    _sum2 = sum2;
+}
+
+void FluidSimulationSaveState::_writeHeader(std::ofstream *state) {
+    std::ostringstream header(std::ios::out | std::ios::binary);
+
+    int version = SAVESTATE_VERSION;
+    int numSections = _numSections;
+    char isBrickGridEnabled[4] = {(char)_isFluidBrickGridEnabled, 0, 0, 0};
+
+    header.write(SAVESTATE_MAGIC, sizeof(SAVESTATE_MAGIC));
+    header.write((char *)&version, sizeof(int));
+    header.write((char *)&_isize, sizeof(int));
+    header.write((char *)&_jsize, sizeof(int));
+    header.write((char *)&_ksize, sizeof(int));
+    header.write((char *)&_dx, sizeof(double));
+    header.write((char *)&_currentFrame, sizeof(int));
+    header.write((char *)&numSections, sizeof(int));
+    header.write(isBrickGridEnabled, sizeof(isBrickGridEnabled));
+
+    for (int i = 0; i < _numSections; i++) {
+        SectionInfo *info = &(_sections[i]);
+        int type = i;
+        int elementType = (int)info->elementType;
+        int encoding = (int)info->encoding;
+        int reserved = 0;
+        unsigned long long offset = info->offset;
+        unsigned long long numElements = info->numElements;
+        unsigned long long numBytes = info->numBytes;
+        unsigned long long decodedBytes = info->decodedBytes;
+        unsigned long long checksum = info->checksum;
+
+        header.write((char *)&type, sizeof(int));
+        header.write((char *)&elementType, sizeof(int));
+        header.write((char *)&encoding, sizeof(int));
+        header.write((char *)&reserved, sizeof(int));
+        header.write((char *)&offset, sizeof(unsigned long long));
+        header.write((char *)&numElements, sizeof(unsigned long long));
+        header.write((char *)&numBytes, sizeof(unsigned long long));
+        header.write((char *)&decodedBytes, sizeof(unsigned long long));
+        header.write((char *)&checksum, sizeof(unsigned long long));
+    }
+
+    std::string data = header.str();
+    Checksum headerChecksum;
+    headerChecksum.update(data.data(), data.size());
+    unsigned long long checksum = headerChecksum.finish();
+
+    state->write(data.data(), data.size());
+    state->write((char *)&checksum, sizeof(unsigned long long));
+}
+
+void FluidSimulationSaveState::_beginSection(SaveStateSection type, 
+                                             SaveStateElementType elementType,
+                                             size_t numElements, 
+                                             std::ofstream *state) {
+    SaveStateEncoding encoding = SaveStateEncoding::raw;
+    if (_isCompressionEnabled) {
+        encoding = SaveStateEncoding::compressed;
+    }
+
+    _beginSection(type, elementType, numElements, encoding, state);
+}
+
+void FluidSimulationSaveState::_beginSection(SaveStateSection type, 
+                                             SaveStateElementType elementType,
+                                             size_t numElements, 
+                                             SaveStateEncoding encoding,
+                                             std::ofstream *state) {
+    FLUIDSIM_ASSERT(_currentSection == -1);
+
+    size_t position = (size_t)state->tellp();
+    size_t padding = (_sectionAlignment - position % _sectionAlignment) % _sectionAlignment;
+    char zeros[_sectionAlignment] = {0};
+    state->write(zeros, padding);
+
+    SectionInfo *info = &(_sections[(int)type]);
+    info->type = type;
+    info->elementType = elementType;
+    info->encoding = encoding;
+    info->offset = position + padding;
+    info->numElements = numElements;
+    info->numBytes = 0;
+    info->decodedBytes = 0;
+
+    _currentSection = (int)type;
+    _currentChecksum = Checksum();
+    _compressionBuffer.clear();
+    _compressedBlockSizes.clear();
+}
+
+/*
+    A compressed section ends with a footer holding the stored size of each
+    block followed by the block size and number of blocks. The footer is 
+    written last so that blocks can be written as soon as they are 
+    compressed.
+*/
+void FluidSimulationSaveState::_endSection(std::ofstream *state) {
+    FLUIDSIM_ASSERT(_currentSection != -1);
+
+    SectionInfo *info = &(_sections[_currentSection]);
+    if (info->encoding != SaveStateEncoding::raw) {
+        _compressBlocks(true, state);
+
+        unsigned int blockSize = (unsigned int)_compressionBlockSize;
+        unsigned int numBlocks = (unsigned int)_compressedBlockSizes.size();
+        _writeStoredData((char *)_compressedBlockSizes.data(), 
+                         numBlocks*sizeof(unsigned int), state);
+        _writeStoredData((char *)&blockSize, sizeof(unsigned int), state);
+        _writeStoredData((char *)&numBlocks, sizeof(unsigned int), state);
+        _compressedBlockSizes.clear();
+    }
+
+    FLUIDSIM_ASSERT(state->good());
+
+    if (info->encoding == SaveStateEncoding::compressedCellMask) {
+        FLUIDSIM_ASSERT(info->decodedBytes == _getCellMaskSize());
+    } else {
+        size_t elementSize = _getElementSize(info->elementType);
+        FLUIDSIM_ASSERT(info->decodedBytes == info->numElements*elementSize);
+    }
+
+    info->checksum = _currentChecksum.finish();
+    _currentSection = -1;
+}
+
+void FluidSimulationSaveState::_writeSectionData(const char *data, size_t numBytes, 
+                                                 std::ofstream *state) {
+    FLUIDSIM_ASSERT(_currentSection != -1);
+    if (numBytes == 0) {
+        return;
+    }
+
+    SectionInfo *info = &(_sections[_currentSection]);
+    info->decodedBytes += numBytes;
+    if (info->encoding == SaveStateEncoding::raw) {
+        _writeStoredData(data, numBytes, state);
+        return;
+    }
+
+    _compressionBuffer.insert(_compressionBuffer.end(), data, data + numBytes);
+
+    int numThreads = _threadPool == nullptr ? 1 : _threadPool->getNumThreads();
+    size_t batchSize = numThreads*_compressionBlockSize;
+    if (_compressionBuffer.size() >= batchSize) {
+        _compressBlocks(false, state);
+    }
+}
+
+void FluidSimulationSaveState::_writeStoredData(const char *data, size_t numBytes, 
+                                                std::ofstream *state) {
+    if (numBytes == 0) {
+        return;
+    }
+
+    state->write(data, numBytes);
+    _currentChecksum.update(data, numBytes);
+    _sections[_currentSection].numBytes += numBytes;
+}
+
+/*
+    Compresses the full blocks in the compression buffer in parallel and 
+    writes them in order. If isFinalBlock is true, the remaining partial 
+    block is also written. A block that does not compress is stored raw.
+*/
+void FluidSimulationSaveState::_compressBlocks(bool isFinalBlock, std::ofstream *state) {
+    size_t blockSize = _compressionBlockSize;
+    size_t bufferSize = _compressionBuffer.size();
+    size_t numBlocks = bufferSize / blockSize;
+    if (isFinalBlock) {
+        numBlocks = (bufferSize + blockSize - 1) / blockSize;
+    }
+
+    if (numBlocks == 0) {
+        return;
+    }
+
+    size_t wordSize = _getShuffleWordSize(_sections[_currentSection]);
+    const char *buffer = _compressionBuffer.data();
+    std::vector<std::vector<char> > blocks(numBlocks);
+    std::vector<bool> isRawBlock(numBlocks, false);
+    _runTasks((int)numBlocks, 
+        [&blocks, &isRawBlock, buffer, bufferSize, blockSize, wordSize](int idx) {
+            size_t start = idx*blockSize;
+            size_t n = std::min(blockSize, bufferSize - start);
+
+            std::vector<char> shuffled(n);
+            BlockCompression::shuffle(buffer + start, shuffled.data(), n, wordSize);
+
+            std::vector<char> &block = blocks[idx];
+            block.resize(n);
+            size_t size = BlockCompression::compress(shuffled.data(), n, block.data(), n);
+            if (size == 0) {
+                block.assign(buffer + start, buffer + start + n);
+                isRawBlock[idx] = true;
+            } else {
+                block.resize(size);
+            }
+        }
+    );
+
+    for (size_t i = 0; i < numBlocks; i++) {
+        _writeStoredData(blocks[i].data(), blocks[i].size(), state);
+
+        unsigned int storedSize = (unsigned int)blocks[i].size();
+        if (isRawBlock[i]) {
+            storedSize |= SAVESTATE_RAW_BLOCK_FLAG;
+        }
+        _compressedBlockSizes.push_back(storedSize);
+    }
+
+    size_t numCompressed = std::min(numBlocks*blockSize, bufferSize);
+    _compressionBuffer.erase(_compressionBuffer.begin(), 
+                             _compressionBuffer.begin() + numCompressed);
+}
+
+size_t FluidSimulationSaveState::_getElementSize(SaveStateElementType elementType) {
+    if (elementType == SaveStateElementType::float32) {
+        return sizeof(float);
+    } else if (elementType == SaveStateElementType::vec3f) {
+        return 3*sizeof(float);
+    } else if (elementType == SaveStateElementType::int3) {
+        return 3*sizeof(int);
+    }
+
+    return sizeof(char);
+}
+
+/*
+    Float and int data is shuffled by 4 byte words so that the bytes of 
+    equal significance, such as the sign and exponent bytes of floats, are 
+    compressed together.
+*/
+size_t FluidSimulationSaveState::_getShuffleWordSize(SectionInfo &info) {
+    if (info.encoding == SaveStateEncoding::compressedCellMask ||
+            info.elementType == SaveStateElementType::byte) {
+        return 1;
+    }
+
+    return 4;
+}
+
+size_t FluidSimulationSaveState::_getCellMaskSize() {
+    if (_isize <= 0 || _jsize <= 0 || _ksize <= 0) {
+        return 0;
+    }
+
+    size_t numCells = (size_t)_isize*(size_t)_jsize*(size_t)_ksize;
+    return (numCells + 7) / 8;
+}
+
+bool FluidSimulationSaveState::_isCellMaskEncodingUsed(int numSolidCells) {
+    size_t listSize = (size_t)numSolidCells*3*sizeof(int);
+    return _isCompressionEnabled && _getCellMaskSize() < listSize;
+}
+
+void FluidSimulationSaveState::_setCellMaskBit(std::vector<char> &mask, GridIndex g) {
+    size_t flatidx = (size_t)g.i + (size_t)_isize*((size_t)g.j + (size_t)_jsize*(size_t)g.k);
+    mask[flatidx / 8] |= (char)(1 << (flatidx % 8));
+}
+
 void FluidSimulationSaveState::_writeBinaryMarkerParticlePositions(FluidSimulation *_fluidsim,
                                                                    std::ofstream *state) {
     int n = _fluidsim->getNumMarkerParticles();
@@ -572,246 +1097,878 @@ void FluidSimulationSaveState::_writeBinarySolidCellIndices(FluidSimulation *_fl
 
 }
 
-void FluidSimulationSaveState::_writeBinaryFluidBrickGrid(FluidSimulation *_fluidsim, 
-                                                          std::ofstream *state) {
-    FLUIDSIM_ASSERT(_fluidsim->isBrickOutputEnabled());
-    FluidBrickGrid *brickGrid = _fluidsim->getFluidBrickGrid();
+void FluidSimulationSaveState::_writeBinarySolidCellMask(FluidSimulation *_fluidsim, 
+                                                         std::ofstream *state) {
+    std::vector<char> mask(_getCellMaskSize(), 0);
+    for (int k = 0; k < _depth; k++) {
+        for (int j = 0; j < _height; j++) {
+            for (int i = 0; i < _width; i++) {
+                if (_fluidsim->getMaterial(i, j, k) == Material::solid) {
+                    _setCellMaskBit(mask, GridIndex(i, j, k));
+                }
+            }
+        }
+    }
+
+    _writeSectionData(mask.data(), mask.size(), state);
+}
+
+void FluidSimulationSaveState::_writeBinarySolidCells(std::vector<GridIndex> &cells, 
+                                                      std::ofstream *state) {
+    int numSolidCells = (int)cells.size();
+    if (!_isCellMaskEncodingUsed(numSolidCells)) {
+        _beginSection(SaveStateSection::solidCells, 
+                      SaveStateElementType::int3, numSolidCells, state);
+        _writeBinaryVectorGridIndex(cells, state);
+        _endSection(state);
+        return;
+    }
+
+    std::vector<char> mask(_getCellMaskSize(), 0);
+    for (size_t i = 0; i < cells.size(); i++) {
+        _setCellMaskBit(mask, cells[i]);
+    }
 
-    std::string tempfilename = _getTemporaryFilename();
-    FluidBrickGridSaveState brickstate;
-    brickstate.saveState(tempfilename, brickGrid);
+    _beginSection(SaveStateSection::solidCells, SaveStateElementType::int3, 
+                  numSolidCells, SaveStateEncoding::compressedCellMask, state);
+    _writeSectionData(mask.data(), mask.size(), state);
+    _endSection(state);
+}
 
-    _appendFileToSaveState(tempfilename, state);
+void FluidSimulationSaveState::_writeBinaryFluidBrickGrid(FluidSimulation *_fluidsim, 
+                                                          std::ofstream *state) {
+    std::string data;
+    if (_isFluidBrickGridEnabled) {
+        std::ostringstream brickdata(std::ios::out | std::ios::binary);
+        FluidBrickGridSaveState brickstate;
+        brickstate.saveState(&brickdata, _fluidsim->getFluidBrickGrid());
+        data = brickdata.str();
+    }
 
-    int error = remove(tempfilename.c_str());
-    FLUIDSIM_ASSERT(error == 0);
+    _beginSection(SaveStateSection::fluidBrickGrid, 
+                  SaveStateElementType::byte, data.size(), state);
+    _writeSectionData(data.data(), data.size(), state);
+    _endSection(state);
 }
 
-void FluidSimulationSaveState::_appendFileToSaveState(std::string filename, 
-                                                      std::ofstream *state) {
-    std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
-    *state << file.rdbuf();
-    FLUIDSIM_ASSERT(file.good() && state->good());
+void FluidSimulationSaveState::_writeBinaryBaseSaveState(std::string baseFilename, 
+                                                         std::ofstream *state) {
+    std::string name = baseFilename.empty() ? "" : _getFilename(baseFilename);
+    _beginSection(SaveStateSection::baseSaveState, SaveStateElementType::byte, 
+                  name.size(), SaveStateEncoding::raw, state);
+    _writeSectionData(name.data(), name.size(), state);
+    _endSection(state);
 }
 
-std::string FluidSimulationSaveState::_getTemporaryFilename() {
-    int filenamelen = 16;
-    std::string filepath = Config::getTempDirectory();
-    std::string tfile = filepath + "/" + _getRandomString(filenamelen);
+void FluidSimulationSaveState::_writeSnapshotSection(SaveStateSection type, 
+                                                     FluidSimulationSaveStateSnapshot &snapshot,
+                                                     std::string baseFilename,
+                                                     std::ofstream *state) {
+    size_t n = _getNumSnapshotElements(type, snapshot, baseFilename);
+
+    switch (type) {
+        case SaveStateSection::markerParticlePositions:
+            _beginSection(type, SaveStateElementType::vec3f, n, state);
+            _writeBinaryVector3f(snapshot.markerParticlePositions, state);
+            _endSection(state);
+            break;
+
+        case SaveStateSection::markerParticleVelocities:
+            _beginSection(type, SaveStateElementType::vec3f, n, state);
+            _writeBinaryVector3f(snapshot.markerParticleVelocities, state);
+            _endSection(state);
+            break;
+
+        case SaveStateSection::diffuseParticlePositions:
+        case SaveStateSection::diffuseParticleVelocities:
+            _beginSection(type, SaveStateElementType::vec3f, n, state);
+            _writeBinaryDiffuseParticles(snapshot.diffuseParticles, type, state);
+            _endSection(state);
+            break;
+
+        case SaveStateSection::diffuseParticleLifetimes:
+            _beginSection(type, SaveStateElementType::float32, n, state);
+            _writeBinaryDiffuseParticles(snapshot.diffuseParticles, type, state);
+            _endSection(state);
+            break;
+
+        case SaveStateSection::diffuseParticleTypes:
+            _beginSection(type, SaveStateElementType::byte, n, state);
+            _writeBinaryDiffuseParticles(snapshot.diffuseParticles, type, state);
+            _endSection(state);
+            break;
+
+        case SaveStateSection::solidCells:
+            _writeBinarySolidCells(snapshot.solidCells, state);
+            break;
+
+        case SaveStateSection::fluidBrickGrid:
+            _beginSection(type, SaveStateElementType::byte, n, state);
+            _writeSectionData(snapshot.fluidBrickGridData.data(), n, state);
+            _endSection(state);
+            break;
+
+        case SaveStateSection::baseSaveState:
+            _writeBinaryBaseSaveState(baseFilename, state);
+            break;
+    }
+}
 
-    int numtries = 0;
-    while (std::ifstream(tfile)) {
-        tfile = _getRandomString(filenamelen);
-        numtries++;
-        FLUIDSIM_ASSERT(numtries < 100);
+size_t FluidSimulationSaveState::_getNumSnapshotElements(
+                                        SaveStateSection type, 
+                                        FluidSimulationSaveStateSnapshot &snapshot,
+                                        std::string baseFilename) {
+    switch (type) {
+        case SaveStateSection::markerParticlePositions:
+        case SaveStateSection::markerParticleVelocities:
+            return snapshot.markerParticlePositions.size();
+
+        case SaveStateSection::diffuseParticlePositions:
+        case SaveStateSection::diffuseParticleVelocities:
+        case SaveStateSection::diffuseParticleLifetimes:
+        case SaveStateSection::diffuseParticleTypes:
+            return snapshot.diffuseParticles.size();
+
+        case SaveStateSection::solidCells:
+            return snapshot.solidCells.size();
+
+        case SaveStateSection::fluidBrickGrid:
+            return snapshot.isFluidBrickGridEnabled ? snapshot.fluidBrickGridData.size() : 0;
+
+        case SaveStateSection::baseSaveState:
+            return baseFilename.empty() ? 0 : _getFilename(baseFilename).size();
     }
 
-    return tfile;
+    return 0;
+}
+
+/*
+    A referenced section stores no data. Its entry holds the checksum of the
+    base section so that the base can be validated when the delta is loaded.
+*/
+void FluidSimulationSaveState::_writeReferencedSection(SaveStateSection type, 
+                                                       size_t numElements,
+                                                       FluidSimulationSaveState &base) {
+    FLUIDSIM_ASSERT(_currentSection == -1);
+
+    SectionInfo *baseInfo = &(base._sections[(int)type]);
+    FLUIDSIM_ASSERT(baseInfo->numElements == numElements);
+
+    SectionInfo *info = &(_sections[(int)type]);
+    info->type = type;
+    info->elementType = baseInfo->elementType;
+    info->encoding = SaveStateEncoding::referenced;
+    info->offset = 0;
+    info->numElements = numElements;
+    info->numBytes = 0;
+    info->decodedBytes = baseInfo->decodedBytes;
+    info->checksum = baseInfo->checksum;
 }
 
-std::string FluidSimulationSaveState::_getRandomString(int len) {
-    char chars[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+void FluidSimulationSaveState::_writeBinaryDiffuseParticles(std::vector<DiffuseParticle> &particles,
+                                                            SaveStateSection type,
+                                                            std::ofstream *state) {
+    int n = (int)particles.size();
+    int chunksize = _writeChunkSize;
 
-    std::string str;
-    for (int i = 0; i < len; i++) {
-        str += chars[rand() % (sizeof(chars) - 1)];
-    }
+    std::vector<vmath::vec3> vectors;
+    std::vector<float> lifetimes;
+    std::vector<char> types;
+    for (int startidx = 0; startidx < n; startidx += chunksize) {
+        int endidx = std::min(startidx + chunksize, n);
 
-    return str;
+        if (type == SaveStateSection::diffuseParticlePositions) {
+            vectors.clear();
+            for (int i = startidx; i < endidx; i++) {
+                vectors.push_back(particles[i].position);
+            }
+            _writeBinaryVector3f(vectors, state);
+        } else if (type == SaveStateSection::diffuseParticleVelocities) {
+            vectors.clear();
+            for (int i = startidx; i < endidx; i++) {
+                vectors.push_back(particles[i].velocity);
+            }
+            _writeBinaryVector3f(vectors, state);
+        } else if (type == SaveStateSection::diffuseParticleLifetimes) {
+            lifetimes.clear();
+            for (int i = startidx; i < endidx; i++) {
+                lifetimes.push_back(particles[i].lifetime);
+            }
+            _writeBinaryVectorf(lifetimes, state);
+        } else if (type == SaveStateSection::diffuseParticleTypes) {
+            types.clear();
+            for (int i = startidx; i < endidx; i++) {
+                types.push_back((char)particles[i].type);
+            }
+            _writeBinaryVectorc(types, state);
+        }
+    }
 }
 
-void FluidSimulationSaveState::_writeBinaryVector3f(std::vector<vmath::vec3> &vectors, std::ofstream *state) {
-    int binsize = 3 * (int)vectors.size() * sizeof(float);
-    state->write((char *)&vectors[0], binsize);
+void FluidSimulationSaveState::_writeBinaryVector3f(std::vector<vmath::vec3> &vectors, 
+                                                    std::ofstream *state) {
+    size_t binsize = 3 * vectors.size() * sizeof(float);
+    _writeSectionData((char *)vectors.data(), binsize, state);
 }
 
-void FluidSimulationSaveState::_writeBinaryVectorf(std::vector<float> &floats, std::ofstream *state) {
-    int binsize = (int)floats.size() * sizeof(float);
-    state->write((char *)&floats[0], binsize);
+void FluidSimulationSaveState::_writeBinaryVectorf(std::vector<float> &floats, 
+                                                   std::ofstream *state) {
+    size_t binsize = floats.size() * sizeof(float);
+    _writeSectionData((char *)floats.data(), binsize, state);
 }
 
-void FluidSimulationSaveState::_writeBinaryVectorc(std::vector<char> &chars, std::ofstream *state) {
-    int binsize = (int)chars.size() * sizeof(char);
-    state->write((char *)&chars[0], binsize);
+void FluidSimulationSaveState::_writeBinaryVectorc(std::vector<char> &chars, 
+                                                   std::ofstream *state) {
+    size_t binsize = chars.size() * sizeof(char);
+    _writeSectionData(chars.data(), binsize, state);
 }
 
 void FluidSimulationSaveState::_writeBinaryVectorGridIndex(std::vector<GridIndex> &indices, 
                                                            std::ofstream *state) {
-    int binsize = 3*(int)indices.size()*sizeof(int);
-    state->write((char *)&indices[0], binsize);
+    size_t binsize = 3 * indices.size() * sizeof(int);
+    _writeSectionData((char *)indices.data(), binsize, state);
 }
 
-void FluidSimulationSaveState::_writeInt(int *value, std::ofstream *state) {
-    state->write((char *)value, sizeof(int));
-}
+/*
+    Version 1 save states have no header or section table. Section offsets 
+    follow from the particle and cell counts, and the brick grid save state 
+    extends to the end of the file.
+*/
+bool FluidSimulationSaveState::_loadStateVersion1() {
+    size_t offset = 0;
+    bool success = _readHeaderInt(&_isize, &offset) &&
+                   _readHeaderInt(&_jsize, &offset) &&
+                   _readHeaderInt(&_ksize, &offset) &&
+                   _readHeaderDouble(&_dx, &offset) &&
+                   _readHeaderInt(&_currentFrame, &offset) &&
+                   _readHeaderInt(&_numMarkerParticles, &offset) &&
+                   _readHeaderInt(&_numDiffuseParticles, &offset) &&
+                   _readHeaderInt(&_numSolidCells, &offset) &&
+                   _readHeaderBool(&_isFluidBrickGridEnabled, &offset);
+
+    if (!success || _numMarkerParticles < 0 || 
+            _numDiffuseParticles < 0 || _numSolidCells < 0) {
+        return false;
+    }
+
+    size_t nm = _numMarkerParticles;
+    size_t nd = _numDiffuseParticles;
+    size_t ns = _numSolidCells;
+
+    struct {
+        SaveStateSection type;
+        SaveStateElementType elementType;
+        size_t numElements;
+        size_t elementSize;
+    } layout[] = {
+        {SaveStateSection::markerParticlePositions,   SaveStateElementType::vec3f,   nm, 3*sizeof(float)},
+        {SaveStateSection::markerParticleVelocities,  SaveStateElementType::vec3f,   nm, 3*sizeof(float)},
+        {SaveStateSection::diffuseParticlePositions,  SaveStateElementType::vec3f,   nd, 3*sizeof(float)},
+        {SaveStateSection::diffuseParticleVelocities, SaveStateElementType::vec3f,   nd, 3*sizeof(float)},
+        {SaveStateSection::diffuseParticleLifetimes,  SaveStateElementType::float32, nd, sizeof(float)},
+        {SaveStateSection::diffuseParticleTypes,      SaveStateElementType::byte,    nd, sizeof(char)},
+        {SaveStateSection::solidCells,                SaveStateElementType::int3,    ns, 3*sizeof(int)}
+    };
+
+    _sections.assign(_numSections, SectionInfo());
+    for (unsigned int i = 0; i < sizeof(layout) / sizeof(layout[0]); i++) {
+        SectionInfo *info = &(_sections[(int)layout[i].type]);
+        info->type = layout[i].type;
+        info->elementType = layout[i].elementType;
+        info->offset = offset;
+        info->numElements = layout[i].numElements;
+        info->numBytes = layout[i].numElements * layout[i].elementSize;
+        info->decodedBytes = info->numBytes;
+        info->isVerified = true;
+        offset += info->numBytes;
+    }
+
+    if (offset > _fileSize) {
+        return false;
+    }
 
-void FluidSimulationSaveState::_writeDouble(double *value, std::ofstream *state) {
-    state->write((char *)value, sizeof(double));
+    SectionInfo *info = &(_sections[(int)SaveStateSection::fluidBrickGrid]);
+    info->type = SaveStateSection::fluidBrickGrid;
+    info->elementType = SaveStateElementType::byte;
+    info->offset = offset;
+    info->numElements = _isFluidBrickGridEnabled ? _fileSize - offset : 0;
+    info->numBytes = info->numElements;
+    info->decodedBytes = info->numBytes;
+    info->isVerified = true;
+
+    info = &(_sections[(int)SaveStateSection::baseSaveState]);
+    info->type = SaveStateSection::baseSaveState;
+    info->elementType = SaveStateElementType::byte;
+    info->offset = _fileSize;
+    info->isVerified = true;
+
+    _version = 1;
+
+    return true;
 }
 
-void FluidSimulationSaveState::_writeBool(bool *value, std::ofstream *state) {
-    state->write((char *)value, sizeof(bool));
+/*
+    Loads save states in the version 2 and later formats. Version 2 section
+    table entries have no encoding or decoded size and hold raw data.
+*/
+bool FluidSimulationSaveState::_loadStateVersion2() {
+    size_t offset = sizeof(SAVESTATE_MAGIC);
+    int version, numSections;
+    char isBrickGridEnabled[4];
+    bool success = _readHeaderInt(&version, &offset) &&
+                   _readHeaderInt(&_isize, &offset) &&
+                   _readHeaderInt(&_jsize, &offset) &&
+                   _readHeaderInt(&_ksize, &offset) &&
+                   _readHeaderDouble(&_dx, &offset) &&
+                   _readHeaderInt(&_currentFrame, &offset) &&
+                   _readHeaderInt(&numSections, &offset) &&
+                   _readHeaderData(isBrickGridEnabled, sizeof(isBrickGridEnabled), &offset);
+
+    if (!success || version < 2 || version > SAVESTATE_VERSION || 
+            numSections < 0 || numSections > 1024) {
+        return false;
+    }
+    _isFluidBrickGridEnabled = isBrickGridEnabled[0] != 0;
+
+    size_t entrySize = SAVESTATE_SECTION_ENTRY_SIZE;
+    if (version == 2) {
+        entrySize = SAVESTATE_SECTION_ENTRY_SIZE_V2;
+    }
+
+    std::vector<char> header(SAVESTATE_HEADER_SIZE + numSections*entrySize);
+    unsigned long long checksum;
+    size_t checksumOffset = header.size();
+    if (!_readLoadState(0, header.data(), header.size()) ||
+            !_readHeaderData((char *)&checksum, sizeof(unsigned long long), &checksumOffset)) {
+        return false;
+    }
+
+    Checksum headerChecksum;
+    headerChecksum.update(header.data(), header.size());
+    if (headerChecksum.finish() != checksum) {
+        return false;
+    }
+
+    _sections.assign(_numSections, SectionInfo());
+    std::vector<bool> isSectionFound(_numSections, false);
+    for (int i = 0; i < numSections; i++) {
+        int type, elementType;
+        int encoding = (int)SaveStateEncoding::raw;
+        int reserved = 0;
+        unsigned long long sectionOffset, numElements, numBytes, sectionChecksum;
+        unsigned long long decodedBytes = 0;
+        success = _readHeaderInt(&type, &offset) &&
+                  _readHeaderInt(&elementType, &offset);
+        if (success && version >= 3) {
+            success = _readHeaderInt(&encoding, &offset) &&
+                      _readHeaderInt(&reserved, &offset);
+        }
+        success = success &&
+                  _readHeaderData((char *)&sectionOffset, sizeof(unsigned long long), &offset) &&
+                  _readHeaderData((char *)&numElements, sizeof(unsigned long long), &offset) &&
+                  _readHeaderData((char *)&numBytes, sizeof(unsigned long long), &offset);
+        if (success && version >= 3) {
+            success = _readHeaderData((char *)&decodedBytes, sizeof(unsigned long long), &offset);
+        } else {
+            decodedBytes = numBytes;
+        }
+        success = success &&
+                  _readHeaderData((char *)&sectionChecksum, sizeof(unsigned long long), &offset);
+        if (!success) {
+            return false;
+        }
+
+        // Sections added by later versions are skipped
+        if (type < 0 || type >= _numSections) {
+            continue;
+        }
+
+        SectionInfo *info = &(_sections[type]);
+        info->type = (SaveStateSection)type;
+        info->elementType = (SaveStateElementType)elementType;
+        info->encoding = (SaveStateEncoding)encoding;
+        info->offset = sectionOffset;
+        info->numElements = numElements;
+        info->numBytes = numBytes;
+        info->decodedBytes = decodedBytes;
+        info->checksum = sectionChecksum;
+        info->isVerified = false;
+        isSectionFound[type] = true;
+    }
+
+    for (int i = 0; i < _numSections; i++) {
+        if (!isSectionFound[i] && i != (int)SaveStateSection::baseSaveState) {
+            return false;
+        }
+    }
+
+    // Save states before version 4 have no base save state section
+    SectionInfo *baseInfo = &(_sections[(int)SaveStateSection::baseSaveState]);
+    if (!isSectionFound[(int)SaveStateSection::baseSaveState]) {
+        baseInfo->type = SaveStateSection::baseSaveState;
+        baseInfo->elementType = SaveStateElementType::byte;
+        baseInfo->isVerified = true;
+    }
+
+    SectionInfo *sections = _sections.data();
+    success = 
+        _isSectionValid(sections[(int)SaveStateSection::markerParticlePositions], 
+                        SaveStateElementType::vec3f, 3*sizeof(float)) &&
+        _isSectionValid(sections[(int)SaveStateSection::markerParticleVelocities], 
+                        SaveStateElementType::vec3f, 3*sizeof(float)) &&
+        _isSectionValid(sections[(int)SaveStateSection::diffuseParticlePositions], 
+                        SaveStateElementType::vec3f, 3*sizeof(float)) &&
+        _isSectionValid(sections[(int)SaveStateSection::diffuseParticleVelocities], 
+                        SaveStateElementType::vec3f, 3*sizeof(float)) &&
+        _isSectionValid(sections[(int)SaveStateSection::diffuseParticleLifetimes], 
+                        SaveStateElementType::float32, sizeof(float)) &&
+        _isSectionValid(sections[(int)SaveStateSection::diffuseParticleTypes], 
+                        SaveStateElementType::byte, sizeof(char)) &&
+        _isSectionValid(sections[(int)SaveStateSection::solidCells], 
+                        SaveStateElementType::int3, 3*sizeof(int)) &&
+        _isSectionValid(sections[(int)SaveStateSection::fluidBrickGrid], 
+                        SaveStateElementType::byte, sizeof(char)) &&
+        _isSectionValid(sections[(int)SaveStateSection::baseSaveState], 
+                        SaveStateElementType::byte, sizeof(char)) &&
+        sections[(int)SaveStateSection::baseSaveState].encoding == SaveStateEncoding::raw;
+    if (!success) {
+        return false;
+    }
+
+    size_t nm = sections[(int)SaveStateSection::markerParticlePositions].numElements;
+    size_t nd = sections[(int)SaveStateSection::diffuseParticlePositions].numElements;
+    size_t ns = sections[(int)SaveStateSection::solidCells].numElements;
+    if (nm > INT_MAX || nd > INT_MAX || ns > INT_MAX ||
+            sections[(int)SaveStateSection::markerParticleVelocities].numElements != nm ||
+            sections[(int)SaveStateSection::diffuseParticleVelocities].numElements != nd ||
+            sections[(int)SaveStateSection::diffuseParticleLifetimes].numElements != nd ||
+            sections[(int)SaveStateSection::diffuseParticleTypes].numElements != nd) {
+        return false;
+    }
+
+    _numMarkerParticles = (int)nm;
+    _numDiffuseParticles = (int)nd;
+    _numSolidCells = (int)ns;
+    _version = version;
+
+    return true;
 }
 
-void FluidSimulationSaveState::_setLoadStateFileOffset(unsigned int foffset) {
-    if (foffset != _currentOffset) {
-        _loadState.seekg(foffset);
-        _currentOffset = _loadState.tellg();
+std::string FluidSimulationSaveState::getBaseStateFilename(std::string filename) {
+    FluidSimulationSaveState state;
+    state._isBaseStateLoadingEnabled = false;
+
+    std::string baseFilename;
+    if (state._openState(filename)) {
+        state._readBaseStateFilename(filename, &baseFilename);
     }
+    state.closeState();
+
+    return baseFilename;
 }
 
-bool FluidSimulationSaveState::_readInt(int *value, std::ifstream *state) {
-    char bin[sizeof(int)];
-    state->read(bin, sizeof(int));
-    _currentOffset = _loadState.tellg();
+/*
+    The base filename of a delta save state is stored relative to the 
+    directory of the delta. The base filename is empty if the state does 
+    not reference a base.
+*/
+bool FluidSimulationSaveState::_readBaseStateFilename(std::string filename, 
+                                                     std::string *baseFilename) {
+    SaveStateSection baseType = SaveStateSection::baseSaveState;
+    SectionInfo *baseInfo = &(_sections[(int)baseType]);
+
+    bool isDeltaState = false;
+    for (int i = 0; i < _numSections; i++) {
+        if (_sections[i].encoding == SaveStateEncoding::referenced) {
+            isDeltaState = true;
+        }
+    }
 
-    if (!state->good()) {
+    *baseFilename = "";
+    if (!isDeltaState) {
+        return true;
+    }
+
+    if (baseInfo->numElements == 0 || !_verifySection(baseType)) {
         return false;
     }
 
-    memcpy(value, bin, sizeof(int));
+    std::string basename(baseInfo->numBytes, '\0');
+    if (!_readSectionData(baseType, 0, &basename[0], baseInfo->numBytes)) {
+        return false;
+    }
 
+    *baseFilename = _getDirectory(filename) + "/" + basename;
     return true;
 }
 
-bool FluidSimulationSaveState::_readDouble(double *value, std::ifstream *state) {
-    char bin[sizeof(double)];
-    state->read(bin, sizeof(double));
-    _currentOffset = _loadState.tellg();
+/*
+    Loads the base save state of a delta save state. Each referenced section 
+    must match the corresponding section of the base, which must be a 
+    complete save state of the same grid.
+*/
+bool FluidSimulationSaveState::_initializeBaseState(std::string filename) {
+    std::string baseFilename;
+    if (!_readBaseStateFilename(filename, &baseFilename)) {
+        return false;
+    }
+
+    if (baseFilename.empty() || !_isBaseStateLoadingEnabled) {
+        return true;
+    }
+
+    // Deltas of deltas are not supported, which also prevents cycles
+    if (!_isDeltaStateAllowed) {
+        return false;
+    }
+
+    _baseState = new FluidSimulationSaveState();
+    _baseState->_isDeltaStateAllowed = false;
+    _baseState->_threadPool = _threadPool;
+    if (!_baseState->_openState(baseFilename) ||
+            _baseState->isDeltaState()) {
+        return false;
+    }
 
-    if (!state->good()) {
+    if (_baseState->_isize != _isize || _baseState->_jsize != _jsize || 
+            _baseState->_ksize != _ksize || _baseState->_dx != _dx) {
         return false;
     }
 
-    memcpy(value, bin, sizeof(double));
+    for (int i = 0; i < _numSections; i++) {
+        SectionInfo *info = &(_sections[i]);
+        if (info->encoding != SaveStateEncoding::referenced) {
+            continue;
+        }
+
+        SectionInfo *base = &(_baseState->_sections[i]);
+        if (base->elementType != info->elementType ||
+                base->numElements != info->numElements ||
+                base->checksum != info->checksum) {
+            return false;
+        }
+
+        info->decodedBytes = base->decodedBytes;
+        info->isVerified = true;
+    }
 
     return true;
 }
 
-bool FluidSimulationSaveState::_readBool(bool *value, std::ifstream *state) {
-    char bin[sizeof(bool)];
-    state->read(bin, sizeof(bool));
-    _currentOffset = _loadState.tellg();
+std::string FluidSimulationSaveState::_getDirectory(std::string filename) {
+    size_t dirpos = filename.find_last_of("/\\");
+    if (dirpos == std::string::npos) {
+        return ".";
+    }
 
-    if (!state->good()) {
-        return false;
+    return filename.substr(0, dirpos);
+}
+
+std::string FluidSimulationSaveState::_getFilename(std::string filename) {
+    size_t dirpos = filename.find_last_of("/\\");
+    if (dirpos == std::string::npos) {
+        return filename;
     }
 
-    memcpy(value, bin, sizeof(bool));
+    return filename.substr(dirpos + 1);
+}
+
+bool FluidSimulationSaveState::_readHeaderInt(int *value, size_t *offset) {
+    return _readHeaderData((char *)value, sizeof(int), offset);
+}
+
+bool FluidSimulationSaveState::_readHeaderDouble(double *value, size_t *offset) {
+    return _readHeaderData((char *)value, sizeof(double), offset);
+}
+
+bool FluidSimulationSaveState::_readHeaderBool(bool *value, size_t *offset) {
+    return _readHeaderData((char *)value, sizeof(bool), offset);
+}
+
+bool FluidSimulationSaveState::_readHeaderData(char *dest, size_t numBytes, size_t *offset) {
+    if (!_readLoadState(*offset, dest, numBytes)) {
+        return false;
+    }
+    *offset += numBytes;
 
     return true;
 }
 
-bool FluidSimulationSaveState::_initializeTempFluidBrickGridFile(unsigned int startoffset,
-                                                                 unsigned int endoffset) {
-    _tempFilename = _getTemporaryFilename();
-    std::ofstream tempFile(_tempFilename.c_str(), std::ios::out | std::ios::binary);
-    _isTempFileInUse = true;
+bool FluidSimulationSaveState::_isSectionValid(SectionInfo &info, 
+                                               SaveStateElementType elementType, 
+                                               size_t elementSize) {
+    if (info.elementType != elementType || 
+            info.offset > _fileSize || info.numBytes > _fileSize - info.offset) {
+        return false;
+    }
 
-    _setLoadStateFileOffset(startoffset);
-    unsigned int filesize = endoffset - startoffset;
+    if (info.encoding == SaveStateEncoding::raw) {
+        return info.numBytes == info.numElements * elementSize &&
+               info.decodedBytes == info.numBytes;
+    } else if (info.encoding == SaveStateEncoding::compressed) {
+        return info.decodedBytes == info.numElements * elementSize;
+    } else if (info.encoding == SaveStateEncoding::compressedCellMask) {
+        return info.type == SaveStateSection::solidCells &&
+               info.decodedBytes == _getCellMaskSize() &&
+               info.numElements <= 8*info.decodedBytes;
+    } else if (info.encoding == SaveStateEncoding::referenced) {
+        // Sizes are validated against the base save state
+        return info.numBytes == 0;
+    }
 
-    int chunkSize = _writeChunkSize;
-    char *bin = new char[chunkSize];
-    for (unsigned int i = 0; i < filesize; i += chunkSize) {
-        int size = chunkSize;
-        if (i + size > filesize) {
-            size = filesize - i;
-        }
+    return false;
+}
+
+bool FluidSimulationSaveState::_readLoadState(size_t offset, char *dest, size_t numBytes) {
+    if (offset > _fileSize || numBytes > _fileSize - offset) {
+        return false;
+    }
+
+    if (numBytes == 0) {
+        return true;
+    }
 
-        _loadState.read(bin, size);
-        tempFile.write(bin, size);
+    if (_mappedFile.getData() != nullptr) {
+        memcpy(dest, _mappedFile.getData() + offset, numBytes);
+        return true;
     }
-    delete[] bin;
 
-    _currentOffset = _loadState.tellg();
+    _loadState.clear();
+    _loadState.seekg((std::streamoff)offset, _loadState.beg);
+    _loadState.read(dest, numBytes);
 
-    return _loadState.good() && tempFile.good();
+    return _loadState.good();
 }
 
-bool FluidSimulationSaveState::_readParticleVectors(std::vector<vmath::vec3> &vectors, 
-                                                    int numParticles,
-                                                    std::ifstream *state) {
-    int binsize = 3*numParticles*sizeof(float);
-    char *bin = new char[binsize];
+bool FluidSimulationSaveState::_readSectionData(SaveStateSection type, size_t offset, 
+                                                char *dest, size_t numBytes) {
+    SectionInfo *info = &(_sections[(int)type]);
+    if (info->encoding == SaveStateEncoding::referenced) {
+        return _baseState->_readSectionData(type, offset, dest, numBytes);
+    }
 
-    state->read(bin, binsize);
-    _currentOffset = _loadState.tellg();
+    if (info->encoding == SaveStateEncoding::raw) {
+        if (offset > info->numBytes || numBytes > info->numBytes - offset) {
+            return false;
+        }
+        return _readLoadState(info->offset + offset, dest, numBytes);
+    }
 
-    if (!state->good()) {
-        delete[] bin;
+    _assertSectionDecoded(type);
+    if (offset > info->decodedData.size() || numBytes > info->decodedData.size() - offset) {
         return false;
     }
 
-    vmath::vec3 *positions = (vmath::vec3 *)bin;
-    vectors.assign(positions, positions + numParticles);
-    delete[] bin;
+    if (numBytes > 0) {
+        memcpy(dest, info->decodedData.data() + offset, numBytes);
+    }
 
     return true;
 }
 
-bool FluidSimulationSaveState::_readParticleLifetimes(std::vector<float> &pls, 
-                                                      int numParticles,
-                                                      std::ifstream *state) {
-    int binsize = numParticles*sizeof(float);
-    char *bin = new char[binsize];
+const char* FluidSimulationSaveState::_getSectionData(SaveStateSection type) {
+    FLUIDSIM_ASSERT(_isLoadStateInitialized);
+    SectionInfo *info = &(_sections[(int)type]);
+    if (info->encoding == SaveStateEncoding::referenced) {
+        return _baseState->_getSectionData(type);
+    }
 
-    state->read(bin, binsize);
-    _currentOffset = _loadState.tellg();
+    if (info->encoding != SaveStateEncoding::raw) {
+        _assertSectionVerified(type);
+        _assertSectionDecoded(type);
+        return info->decodedData.data();
+    }
 
-    if (!state->good()) {
-        delete[] bin;
-        return false;
+    if (_mappedFile.getData() == nullptr) {
+        return nullptr;
     }
 
-    float *lifetimes = (float *)bin;
-    pls.assign(lifetimes, lifetimes + numParticles);
-    delete[] bin;
+    _assertSectionVerified(type);
+    return _mappedFile.getData() + _sections[(int)type].offset;
+}
 
-    return true;
+bool FluidSimulationSaveState::_verifySection(SaveStateSection type) {
+    SectionInfo *info = &(_sections[(int)type]);
+    if (info->encoding == SaveStateEncoding::referenced) {
+        return _baseState->_verifySection(type);
+    }
+
+    if (info->isVerified) {
+        return true;
+    }
+
+    Checksum checksum;
+    if (_mappedFile.getData() != nullptr) {
+        checksum.update(_mappedFile.getData() + info->offset, info->numBytes);
+    } else {
+        std::vector<char> chunk(std::min(info->numBytes, (size_t)_writeChunkSize*sizeof(float)));
+        for (size_t i = 0; i < info->numBytes; i += chunk.size()) {
+            size_t numBytes = std::min(chunk.size(), info->numBytes - i);
+            if (!_readLoadState(info->offset + i, chunk.data(), numBytes)) {
+                return false;
+            }
+            checksum.update(chunk.data(), numBytes);
+        }
+    }
+
+    info->isVerified = checksum.finish() == info->checksum;
+    return info->isVerified;
 }
 
-bool FluidSimulationSaveState::_readParticleTypes(std::vector<char> &types, 
-                                                  int numParticles,
-                                                  std::ifstream *state) {
-    int binsize = numParticles*sizeof(char);
-    char *bin = new char[binsize];
+void FluidSimulationSaveState::_assertSectionVerified(SaveStateSection type) {
+    bool isVerified = _verifySection(type);
+    FLUIDSIM_ASSERT(isVerified);
+}
 
-    state->read(bin, binsize);
-    _currentOffset = _loadState.tellg();
+/*
+    Decompresses a section into its decoded data buffer. A solid cell mask 
+    is expanded into a list of cell indices.
+*/
+bool FluidSimulationSaveState::_decodeSection(SaveStateSection type) {
+    SectionInfo *info = &(_sections[(int)type]);
+    if (info->encoding == SaveStateEncoding::raw || 
+            info->encoding == SaveStateEncoding::referenced || info->isDecoded) {
+        return true;
+    }
 
-    if (!state->good()) {
-        delete[] bin;
-        return false;
+    std::vector<char> storedData;
+    const char *data = nullptr;
+    if (_mappedFile.getData() != nullptr) {
+        data = _mappedFile.getData() + info->offset;
+    } else {
+        storedData.resize(info->numBytes);
+        if (!_readLoadState(info->offset, storedData.data(), info->numBytes)) {
+            return false;
+        }
+        data = storedData.data();
     }
 
-    for (int i = 0; i < numParticles; i++) {
-        types.push_back(bin[i]);
+    std::vector<char> decoded;
+    size_t wordSize = _getShuffleWordSize(*info);
+    if (!_decompressBlocks(data, info->numBytes, info->decodedBytes, wordSize, decoded)) {
+        return false;
     }
 
-    delete[] bin;
+    if (info->encoding == SaveStateEncoding::compressedCellMask) {
+        if (!_expandCellMask(decoded, info->numElements, info->decodedData)) {
+            return false;
+        }
+    } else {
+        info->decodedData.swap(decoded);
+    }
 
+    info->isDecoded = true;
     return true;
 }
 
-bool FluidSimulationSaveState::_readSolidCells(std::vector<GridIndex> &indices, 
-                                               int numIndices,
-                                               std::ifstream *state) {
+bool FluidSimulationSaveState::_decompressBlocks(const char *data, size_t numBytes, 
+                                                 size_t decodedBytes, size_t wordSize,
+                                                 std::vector<char> &decoded) {
+    unsigned int blockSize, numBlocks;
+    size_t footerSize = 2*sizeof(unsigned int);
+    if (numBytes < footerSize) {
+        return false;
+    }
+    memcpy(&blockSize, data + numBytes - 2*sizeof(unsigned int), sizeof(unsigned int));
+    memcpy(&numBlocks, data + numBytes - sizeof(unsigned int), sizeof(unsigned int));
 
-    int binsize = 3*numIndices*sizeof(int);
-    char *bin = new char[binsize];
+    if (blockSize == 0 || numBlocks != (decodedBytes + blockSize - 1) / blockSize) {
+        return false;
+    }
 
-    state->read(bin, binsize);
-    _currentOffset = _loadState.tellg();
+    footerSize += (size_t)numBlocks*sizeof(unsigned int);
+    if (numBytes < footerSize) {
+        return false;
+    }
+
+    const char *sizeData = data + numBytes - footerSize;
+    std::vector<size_t> blockOffsets(numBlocks + 1, 0);
+    std::vector<bool> isRawBlock(numBlocks, false);
+    for (unsigned int i = 0; i < numBlocks; i++) {
+        unsigned int storedSize;
+        memcpy(&storedSize, sizeData + i*sizeof(unsigned int), sizeof(unsigned int));
+        isRawBlock[i] = (storedSize & SAVESTATE_RAW_BLOCK_FLAG) != 0;
+        blockOffsets[i + 1] = blockOffsets[i] + (storedSize & ~SAVESTATE_RAW_BLOCK_FLAG);
+    }
 
-    if (!state->good()) {
-        delete[] bin;
+    if (blockOffsets[numBlocks] != numBytes - footerSize) {
         return false;
     }
 
-    GridIndex *data = (GridIndex *)bin;
-    indices.assign(data, data + numIndices);
-    delete[] bin;
+    decoded.resize(decodedBytes);
+    char *dest = decoded.data();
+    std::vector<char> isBlockValid(numBlocks, 0);
+    _runTasks((int)numBlocks, 
+        [&blockOffsets, &isRawBlock, &isBlockValid, data, dest, 
+         decodedBytes, blockSize, wordSize](int idx) {
+            size_t start = (size_t)idx*blockSize;
+            size_t n = std::min((size_t)blockSize, decodedBytes - start);
+            const char *src = data + blockOffsets[idx];
+            size_t storedSize = blockOffsets[idx + 1] - blockOffsets[idx];
+
+            if (isRawBlock[idx]) {
+                if (storedSize == n) {
+                    memcpy(dest + start, src, n);
+                    isBlockValid[idx] = 1;
+                }
+                return;
+            }
+
+            std::vector<char> shuffled(n);
+            if (BlockCompression::decompress(src, storedSize, shuffled.data(), n)) {
+                BlockCompression::unshuffle(shuffled.data(), dest + start, n, wordSize);
+                isBlockValid[idx] = 1;
+            }
+        }
+    );
+
+    for (unsigned int i = 0; i < numBlocks; i++) {
+        if (!isBlockValid[i]) {
+            return false;
+        }
+    }
 
     return true;
-}
\ No newline at end of file
+}
+
+bool FluidSimulationSaveState::_expandCellMask(std::vector<char> &mask, size_t numCells,
+                                               std::vector<char> &cells) {
+    cells.resize(numCells*3*sizeof(int));
+    GridIndex *indices = (GridIndex *)cells.data();
+
+    size_t count = 0;
+    for (int k = 0; k < _ksize; k++) {
+        for (int j = 0; j < _jsize; j++) {
+            for (int i = 0; i < _isize; i++) {
+                size_t flatidx = (size_t)i + (size_t)_isize*((size_t)j + (size_t)_jsize*(size_t)k);
+                if (!(mask[flatidx / 8] & (1 << (flatidx % 8)))) {
+                    continue;
+                }
+
+                if (count == numCells) {
+                    return false;
+                }
+                indices[count] = GridIndex(i, j, k);
+                count++;
+            }
+        }
+    }
+
+    return count == numCells;
+}
+
+void FluidSimulationSaveState::_assertSectionDecoded(SaveStateSection type) {
+    bool isDecoded = _decodeSection(type);
+    FLUIDSIM_ASSERT(isDecoded);
+}
+
+void FluidSimulationSaveState::_runTasks(int numTasks, std::function<void(int)> func) {
+    if (_threadPool == nullptr) {
+        for (int i = 0; i < numTasks; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    _threadPool->run(numTasks, func);
+}
@@ -23,27 +23,135 @@ freely, subject to the following restrictions:
 #include <vector>
 #include <fstream>
 #include <stdio.h>
+#include <string>
 
 #include "fluidbrickgridsavestate.h"
 #include "macvelocityfield.h"
 #include "fluidmaterialgrid.h"
+#include "diffuseparticle.h"
 #include "array3d.h"
 #include "vmath.h"
 #include "config.h"
 #include "fluidsimassert.h"
+#include "memorymappedfile.h"
+#include "threadpool.h"
 
 class FluidSimulation;
 
+/*
+    A copy of the simulation data that is stored in a save state.
+
+    A snapshot is filled by the simulation thread and can then be written
+    to a save state file from any thread while the simulation continues. The
+    fluid brick grid is stored in its serialized save state form.
+*/
+struct FluidSimulationSaveStateSnapshot {
+    int isize = 0;
+    int jsize = 0;
+    int ksize = 0;
+    double dx = 0.0;
+    int currentFrame = 0;
+
+    std::vector<vmath::vec3> markerParticlePositions;
+    std::vector<vmath::vec3> markerParticleVelocities;
+    std::vector<DiffuseParticle> diffuseParticles;
+    std::vector<GridIndex> solidCells;
+
+    bool isFluidBrickGridEnabled = false;
+    std::string fluidBrickGridData;
+};
+
+/*
+    Save states are written in the version 4 format:
+
+        header:        magic "FLUIDSS2", format version, grid dimensions, 
+                       cell size, current frame and a section table
+        section table: for each section, the section type, element type, 
+                       encoding, file offset, number of elements, stored 
+                       size in bytes, decoded size in bytes and a Fletcher-64 
+                       checksum of the stored section data
+        sections:      section data, each starting on a 64 byte boundary
+
+    Files are loaded through a memory mapping, so loading a state only reads 
+    the header and the data of a section is paged in when it is accessed. 
+    The get...Data() methods return pointers directly into the mapping. A 
+    section's checksum is verified the first time its data is accessed.
+
+    If compression is enabled, section data is split into blocks that are 
+    byte shuffled and LZ compressed in parallel. Compression is lossless. 
+    Solid cells are stored as a compressed bitmask over the grid when the 
+    mask is smaller than the list of cell indices. A compressed section is 
+    decompressed in parallel the first time its data is accessed and the 
+    get...Data() methods return pointers to the decompressed data.
+
+    A delta save state stores some of its sections by reference to a base 
+    save state in the same directory. The base must be a complete save 
+    state. When a delta is loaded, the base is loaded with it and the data 
+    of a referenced section is read from the base. The checksum of each 
+    referenced section is compared with the base so that a delta cannot be
+    loaded against a different base with the same filename.
+
+    Save states in the version 2 and 3 formats and in the original unversioned 
+    format (version 1) can still be loaded. Version 1 files have no 
+    checksums.
+*/
 class FluidSimulationSaveState
 {
 public:
+    enum class SaveStateSection : char { 
+        markerParticlePositions   = 0x00, 
+        markerParticleVelocities  = 0x01, 
+        diffuseParticlePositions  = 0x02, 
+        diffuseParticleVelocities = 0x03, 
+        diffuseParticleLifetimes  = 0x04, 
+        diffuseParticleTypes      = 0x05, 
+        solidCells                = 0x06, 
+        fluidBrickGrid            = 0x07,
+        baseSaveState             = 0x08
+    };
+
     FluidSimulationSaveState();
     ~FluidSimulationSaveState();
 
     void saveState(std::string filename, FluidSimulation *fluidsim);
+
+    /*
+        Writes a save state file from a snapshot. The file is identical to
+        one written from the simulation at the time the snapshot was taken.
+    */
+    void saveState(std::string filename, FluidSimulationSaveStateSnapshot &snapshot);
+
+    /*
+        Writes a delta save state from a snapshot. The referenced sections 
+        are not stored and are read from the base save state when the delta 
+        is loaded. The caller guarantees that the referenced sections of the
+        snapshot are identical to those of the base. The base must be a 
+        complete save state in the same directory as the delta.
+    */
+    void saveState(std::string filename, FluidSimulationSaveStateSnapshot &snapshot,
+                   std::string baseFilename, 
+                   std::vector<SaveStateSection> &referencedSections);
+
+    /*
+        Loads a save state and verifies the checksum of every section. 
+        Returns false if the file cannot be read or is corrupted. A delta 
+        save state also fails to load if its base is missing or if a 
+        referenced section of the base is corrupted.
+    */
     bool loadState(std::string filename);
     void closeState();
 
+    /*
+        Thread pool used to compress and decompress blocks of compressed
+        save states. Blocks are processed serially if no pool is set.
+    */
+    void setThreadPool(ThreadPool *pool);
+
+    void enableCompression();
+    void disableCompression();
+    bool isCompressionEnabled();
+
+    int getVersion();
     void getGridDimensions(int *i, int *j, int *k);
     double getCellSize();
     int getCurrentFrame();
@@ -64,15 +172,112 @@ public:
     std::vector<float> getDiffuseParticleLifetimes(int startidx, int endidx);
     std::vector<char> getDiffuseParticleTypes(int startidx, int endidx);
     std::vector<GridIndex> getSolidCells(int startidx, int endidx);
+
+    /*
+        Zero-copy access to the data of a loaded save state. The returned
+        pointers are valid until the state is closed. If the file could not 
+        be memory mapped and the section is not compressed, nullptr is 
+        returned and the data must be read with the methods above.
+    */
+    const vmath::vec3* getMarkerParticlePositionData();
+    const vmath::vec3* getMarkerParticleVelocityData();
+    const vmath::vec3* getDiffuseParticlePositionData();
+    const vmath::vec3* getDiffuseParticleVelocityData();
+    const float* getDiffuseParticleLifetimeData();
+    const char* getDiffuseParticleTypeData();
+    const GridIndex* getSolidCellData();
+
     bool isFluidBrickGridEnabled();
     void getFluidBrickGridSaveState(FluidBrickGridSaveState &state);
     bool isLoadStateInitialized();
 
+    /*
+        Verifies the checksum of every section. Returns true for version 1
+        save states, which do not store checksums.
+    */
+    bool verifyChecksums();
+
+    /*
+        Returns true if this is a delta save state with sections stored by 
+        reference to a base save state.
+    */
+    bool isDeltaState();
+
+    /*
+        Returns the filename of the base save state referenced by a delta 
+        save state, or an empty string if the file is not a readable delta
+        save state. Only the header of the file is read and the base save 
+        state does not need to exist.
+    */
+    static std::string getBaseStateFilename(std::string filename);
+
 private:
 
-    void _writeInt(int *value, std::ofstream *state);
-    void _writeDouble(double *value, std::ofstream *state);
-    void _writeBool(bool *value, std::ofstream *state);
+    enum class SaveStateElementType : char { 
+        byte    = 0x00, 
+        float32 = 0x01, 
+        vec3f   = 0x02, 
+        int3    = 0x03
+    };
+
+    enum class SaveStateEncoding : char { 
+        raw                = 0x00, 
+        compressed         = 0x01, 
+        compressedCellMask = 0x02,
+        referenced         = 0x03
+    };
+
+    struct SectionInfo {
+        SaveStateSection type;
+        SaveStateElementType elementType;
+        SaveStateEncoding encoding = SaveStateEncoding::raw;
+        size_t offset = 0;
+        size_t numElements = 0;
+        size_t numBytes = 0;
+        size_t decodedBytes = 0;
+        unsigned long long checksum = 0;
+        bool isVerified = false;
+        bool isDecoded = false;
+        std::vector<char> decodedData;
+    };
+
+    /*
+        Fletcher-64 checksum over little-endian 32-bit words. Data that does
+        not end on a word boundary is padded with zeros.
+    */
+    class Checksum {
+    public:
+        void update(const char *data, size_t numBytes);
+        unsigned long long finish();
+
+    private:
+        void _addWords(const char *data, size_t numWords);
+
+        unsigned long long _sum1 = 0;
+        unsigned long long _sum2 = 0;
+        char _tail[4];
+        size_t _tailSize = 0;
+    };
+
+    static const int _numSections = 9;
+    static const size_t _sectionAlignment = 64;
+    static const size_t _compressionBlockSize = 1 << 20;
+
+    void _writeHeader(std::ofstream *state);
+    void _beginSection(SaveStateSection type, SaveStateElementType elementType,
+                       size_t numElements, std::ofstream *state);
+    void _beginSection(SaveStateSection type, SaveStateElementType elementType,
+                       size_t numElements, SaveStateEncoding encoding,
+                       std::ofstream *state);
+    void _endSection(std::ofstream *state);
+    void _writeSectionData(const char *data, size_t numBytes, std::ofstream *state);
+    void _writeStoredData(const char *data, size_t numBytes, std::ofstream *state);
+    void _compressBlocks(bool isFinalBlock, std::ofstream *state);
+    size_t _getElementSize(SaveStateElementType elementType);
+    size_t _getShuffleWordSize(SectionInfo &info);
+    size_t _getCellMaskSize();
+    bool _isCellMaskEncodingUsed(int numSolidCells);
+    void _setCellMaskBit(std::vector<char> &mask, GridIndex g);
     void _writeBinaryMarkerParticlePositions(FluidSimulation *_fluidsim,
                                              std::ofstream *state);
     void _writeBinaryMarkerParticleVelocities(FluidSimulation *_fluidsim,
@@ -88,45 +293,75 @@ private:
     int _getNumSolidCells(FluidSimulation *sim);
     void _writeBinarySolidCellIndices(FluidSimulation *_fluidsim, 
                                       std::ofstream *state);
+    void _writeBinarySolidCellMask(FluidSimulation *_fluidsim, 
+                                   std::ofstream *state);
+    void _writeBinarySolidCells(std::vector<GridIndex> &cells, 
+                                std::ofstream *state);
     void _writeBinaryFluidBrickGrid(FluidSimulation *_fluidsim, 
                                     std::ofstream *state);
-    void _appendFileToSaveState(std::string filename, std::ofstream *state);
-    std::string _getTemporaryFilename();
-    std::string _getRandomString(int len);
+    void _writeBinaryBaseSaveState(std::string baseFilename, std::ofstream *state);
+    void _writeSnapshotSection(SaveStateSection type, 
+                               FluidSimulationSaveStateSnapshot &snapshot,
+                               std::string baseFilename,
+                               std::ofstream *state);
+    size_t _getNumSnapshotElements(SaveStateSection type, 
+                                   FluidSimulationSaveStateSnapshot &snapshot,
+                                   std::string baseFilename);
+    void _writeReferencedSection(SaveStateSection type, size_t numElements,
+                                 FluidSimulationSaveState &base);
+    void _writeBinaryDiffuseParticles(std::vector<DiffuseParticle> &particles,
+                                      SaveStateSection type,
+                                      std::ofstream *state);
 
     void _writeBinaryVector3f(std::vector<vmath::vec3> &vectors, std::ofstream *state);
     void _writeBinaryVectorf(std::vector<float> &floats, std::ofstream *state);
     void _writeBinaryVectorc(std::vector<char> &chars, std::ofstream *state);
-    void _writeBinaryVectorGridIndex(std::vector<GridIndex> &floats, 
+    void _writeBinaryVectorGridIndex(std::vector<GridIndex> &indices, 
                                      std::ofstream *state);
 
-    void _setLoadStateFileOffset(unsigned int foffset);
-    bool _readInt(int *value, std::ifstream *state);
-    bool _readDouble(double *value, std::ifstream *state);
-    bool _readBool(bool *value, std::ifstream *state);
-    bool _readParticleVectors(std::vector<vmath::vec3> &particles, 
-                              int numParticles,
-                              std::ifstream *state);
-    bool _readParticleLifetimes(std::vector<float> &lifetimes, 
-                                int numParticles,
-                                std::ifstream *state);
-    bool _readParticleTypes(std::vector<char> &types, 
-                            int numParticles,
-                            std::ifstream *state);
-    bool _readSolidCells(std::vector<GridIndex> &indices, 
-                         int numIndices,
-                        std::ifstream *state);
-    bool _initializeTempFluidBrickGridFile(unsigned int startoffset,
-                                           unsigned int endoffset);
+    bool _openState(std::string filename);
+    bool _loadStateVersion1();
+    bool _loadStateVersion2();
+    bool _initializeBaseState(std::string filename);
+    bool _readBaseStateFilename(std::string filename, std::string *baseFilename);
+    std::string _getDirectory(std::string filename);
+    std::string _getFilename(std::string filename);
+    bool _readHeaderInt(int *value, size_t *offset);
+    bool _readHeaderDouble(double *value, size_t *offset);
+    bool _readHeaderBool(bool *value, size_t *offset);
+    bool _readHeaderData(char *dest, size_t numBytes, size_t *offset);
+    bool _isSectionValid(SectionInfo &info, SaveStateElementType elementType, 
+                         size_t elementSize);
+    bool _readLoadState(size_t offset, char *dest, size_t numBytes);
+    bool _readSectionData(SaveStateSection type, size_t offset, 
+                          char *dest, size_t numBytes);
+    const char* _getSectionData(SaveStateSection type);
+    bool _verifySection(SaveStateSection type);
+    void _assertSectionVerified(SaveStateSection type);
+    bool _decodeSection(SaveStateSection type);
+    bool _decompressBlocks(const char *data, size_t numBytes, size_t decodedBytes,
+                           size_t wordSize, std::vector<char> &decoded);
+    bool _expandCellMask(std::vector<char> &mask, size_t numCells, 
+                         std::vector<char> &cells);
+    void _assertSectionDecoded(SaveStateSection type);
+    void _runTasks(int numTasks, std::function<void(int)> func);
 
     bool _isLoadStateInitialized = false;
     int _width, _height, _depth;
 
     int _writeChunkSize = 50000;
+    bool _isCompressionEnabled = false;
+    ThreadPool *_threadPool = nullptr;
+    std::vector<char> _compressionBuffer;
+    std::vector<unsigned int> _compressedBlockSizes;
 
+    int _version = 0;
+    MemoryMappedFile _mappedFile;
+    FluidSimulationSaveState *_baseState = nullptr;
+    bool _isDeltaStateAllowed = true;
+    bool _isBaseStateLoadingEnabled = true;
     std::ifstream _loadState;
-    bool _isTempFileInUse = false;
-    std::string _tempFilename;
+    std::vector<char> _fluidBrickGridData;
 
     int _isize = 0;
     int _jsize = 0;
@@ -139,15 +374,10 @@ private:
     int _numSolidCells = 0;
     bool _isFluidBrickGridEnabled = false;
 
-    unsigned int _mpPositionOffset = 0;
-    unsigned int _mpVelocityOffset = 0;
-    unsigned int _dpPositionOffset = 0;
-    unsigned int _dpVelocityOffset = 0;
-    unsigned int _dpLifetimeOffset = 0;
-    unsigned int _dpTypeOffset = 0;
-    unsigned int _solidCellOffset = 0;
-    unsigned int _currentOffset = 0;
-
+    std::vector<SectionInfo> _sections;
+    int _currentSection = -1;
+    Checksum _currentChecksum;
+    size_t _fileSize = 0;
 };
 
 #endif
@@ -46,7 +46,32 @@ void IsotropicParticleMesher::setNumPolygonizationSlices(int n) {
     _numPolygonizationSlices = n;
 }
 
-TriangleMesh IsotropicParticleMesher::meshParticles(FragmentedVector<MarkerParticle> &particles, 
+void IsotropicParticleMesher::setMaxPolygonizationMemory(long long bytes) {
+    FLUIDSIM_ASSERT(bytes >= 0);
+    _maxPolygonizationMemory = bytes;
+}
+
+long long IsotropicParticleMesher::getMaxPolygonizationMemory() {
+    return _maxPolygonizationMemory;
+}
+
+void IsotropicParticleMesher::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
+}
+
+void IsotropicParticleMesher::enableSparseScalarField() {
+    _isSparseScalarFieldEnabled = true;
+}
+
+void IsotropicParticleMesher::disableSparseScalarField() {
+    _isSparseScalarFieldEnabled = false;
+}
+
+bool IsotropicParticleMesher::isSparseScalarFieldEnabled() {
+    return _isSparseScalarFieldEnabled;
+}
+
+TriangleMesh IsotropicParticleMesher::meshParticles(MarkerParticleVector &particles, 
                                                     FluidMaterialGrid &materialGrid,
                                                     double particleRadius) {
 
@@ -57,10 +82,6 @@ TriangleMesh IsotropicParticleMesher::meshParticles(FragmentedVector<MarkerParti
 
     _particleRadius = particleRadius;
 
-    if (_numPolygonizationSlices == 1) {
-        return _polygonizeAll(particles, materialGrid);
-    }
-
     return _polygonizeSlices(particles, materialGrid);
 }
 
@@ -107,7 +128,7 @@ TriangleMesh IsotropicParticleMesher::getPreviewMesh() {
     return polygonizer.polygonizeSurface();
 }
 
-TriangleMesh IsotropicParticleMesher::_polygonizeAll(FragmentedVector<MarkerParticle> &particles, 
+TriangleMesh IsotropicParticleMesher::_polygonizeAll(MarkerParticleVector &particles, 
                                                      FluidMaterialGrid &materialGrid) {
     int subd = _subdivisionLevel;
     int width = _isize*subd;
@@ -115,7 +136,7 @@ TriangleMesh IsotropicParticleMesher::_polygonizeAll(FragmentedVector<MarkerPart
     int depth = _ksize*subd;
     double dx = _dx / (double)subd;
 
-    ScalarField field(width + 1, height + 1, depth + 1, dx);
+    ScalarField field(width + 1, height + 1, depth + 1, dx, _getScalarFieldStorage());
 
     int origsubd = materialGrid.getSubdivisionLevel();
     materialGrid.setSubdivisionLevel(subd);
@@ -134,39 +155,100 @@ TriangleMesh IsotropicParticleMesher::_polygonizeAll(FragmentedVector<MarkerPart
     return polygonizer.polygonizeSurface();
 }
 
-TriangleMesh IsotropicParticleMesher::_polygonizeSlices(FragmentedVector<MarkerParticle> &particles, 
+TriangleMesh IsotropicParticleMesher::_polygonizeSlices(MarkerParticleVector &particles, 
                                                         FluidMaterialGrid &materialGrid) {
     int width, height, depth;
     double dx;
     _getSubdividedGridDimensions(&width, &height, &depth, &dx);
 
-    int sliceWidth = ceil((double)width / (double)_numPolygonizationSlices);
+    int sliceWidth = _getPolygonizationSliceWidth();
     int numSlices = ceil((double)width / (double)sliceWidth);
 
     if (numSlices == 1) {
         return _polygonizeAll(particles, materialGrid);
     }
 
-    TriangleMesh mesh;
-    for (int i = 0; i < numSlices; i++) {
-        int startidx = i*sliceWidth;
-        int endidx = startidx + sliceWidth - 1;
-        endidx = endidx < width ? endidx : width - 1;
+    int origsubd = materialGrid.getSubdivisionLevel();
+    materialGrid.setSubdivisionLevel(_subdivisionLevel);
 
-        TriangleMesh sliceMesh = _polygonizeSlice(startidx, endidx, particles, materialGrid);
+    std::vector<TriangleMesh> sliceMeshes;
+    sliceMeshes.reserve(numSlices);
 
-        vmath::vec3 offset = _getSliceGridPositionOffset(startidx, endidx);
-        sliceMesh.translate(offset);
-        mesh.join(sliceMesh);
+    int batchSize = _getNumConcurrentSlices();
+    for (int batchidx = 0; batchidx < numSlices; batchidx += batchSize) {
+        std::vector<int> sliceStarts;
+        std::vector<int> sliceEnds;
+        for (int i = batchidx; i < numSlices && i < batchidx + batchSize; i++) {
+            int startidx = i*sliceWidth;
+            int endidx = startidx + sliceWidth - 1;
+            endidx = endidx < width ? endidx : width - 1;
+
+            sliceStarts.push_back(startidx);
+            sliceEnds.push_back(endidx);
+        }
+
+        _polygonizeSliceBatch(sliceStarts, sliceEnds, particles, materialGrid, sliceMeshes);
+    }
+
+    materialGrid.setSubdivisionLevel(origsubd);
+
+    TriangleMesh mesh;
+    for (unsigned int i = 0; i < sliceMeshes.size(); i++) {
+        mesh.join(sliceMeshes[i]);
     }
 
     return mesh;
 }
 
-TriangleMesh IsotropicParticleMesher::_polygonizeSlice(int startidx, int endidx, 
-                                                        FragmentedVector<MarkerParticle> &particles, 
-                                                        FluidMaterialGrid &materialGrid) {
+void IsotropicParticleMesher::_polygonizeSliceBatch(std::vector<int> &sliceStarts, 
+                                                    std::vector<int> &sliceEnds,
+                                                    MarkerParticleVector &particles, 
+                                                    FluidMaterialGrid &materialGrid,
+                                                    std::vector<TriangleMesh> &sliceMeshes) {
+    int width, height, depth;
+    double dx;
+    _getSubdividedGridDimensions(&width, &height, &depth, &dx);
+
+    int numSlices = (int)sliceStarts.size();
+    std::vector<ScalarField> fields(numSlices);
+
+    // The scalar field accelerator parallelizes each point addition itself 
+    // and is not shared between threads
+    bool isParallel = !_isScalarFieldAcceleratorEnabled();
+    _runSliceTasks(numSlices, isParallel, [&](int idx) {
+        _initializeSliceScalarField(sliceStarts[idx], sliceEnds[idx], fields[idx]);
+        _computeSliceScalarField(sliceStarts[idx], sliceEnds[idx], 
+                                 particles, materialGrid, fields[idx]);
+    });
+
+    // Seam values are passed between slices in order so that neighbouring
+    // slices polygonize identical field values along their shared boundary
+    for (int idx = 0; idx < numSlices; idx++) {
+        if (sliceStarts[idx] != 0) {
+            _applyScalarFieldSliceSeamData(fields[idx]);
+        }
+        if (sliceEnds[idx] != width - 1) {
+            _saveScalarFieldSliceSeamData(fields[idx]);
+        }
+        if (_isPreviewMesherEnabled) {
+            _addScalarFieldSliceToPreviewField(sliceStarts[idx], sliceEnds[idx], fields[idx]);
+        }
+    }
 
+    std::vector<TriangleMesh> meshes(numSlices);
+    _runSliceTasks(numSlices, true, [&](int idx) {
+        meshes[idx] = _polygonizeSlice(sliceStarts[idx], sliceEnds[idx], fields[idx]);
+        fields[idx] = ScalarField();
+    });
+
+    for (int idx = 0; idx < numSlices; idx++) {
+        sliceMeshes.push_back(TriangleMesh());
+        std::swap(sliceMeshes.back(), meshes[idx]);
+    }
+}
+
+void IsotropicParticleMesher::_initializeSliceScalarField(int startidx, int endidx, 
+                                                          ScalarField &field) {
     int width, height, depth;
     double dx;
     _getSubdividedGridDimensions(&width, &height, &depth, &dx);
@@ -184,20 +266,83 @@ TriangleMesh IsotropicParticleMesher::_polygonizeSlice(int startidx, int endidx,
         gridWidth += 2;
     }
 
-    ScalarField field(gridWidth + 1, gridHeight + 1, gridDepth + 1, dx);
-    _computeSliceScalarField(startidx, endidx, particles, materialGrid, field);
+    field = ScalarField(gridWidth + 1, gridHeight + 1, gridDepth + 1, dx, 
+                        _getScalarFieldStorage());
+}
 
-    if (_isPreviewMesherEnabled) {
-        _addScalarFieldSliceToPreviewField(startidx, endidx, field);
+TriangleMesh IsotropicParticleMesher::_polygonizeSlice(int startidx, int endidx, 
+                                                        ScalarField &field) {
+    GridIndex gmin, gmax;
+    _getSliceCellBounds(startidx, endidx, field, &gmin, &gmax);
+
+    Polygonizer3d polygonizer(&field);
+    polygonizer.setSurfaceCellBounds(gmin, gmax);
+
+    TriangleMesh sliceMesh = polygonizer.polygonizeSurface();
+    sliceMesh.translate(_getSliceGridPositionOffset(startidx, endidx));
+
+    return sliceMesh;
+}
+
+int IsotropicParticleMesher::_getNumConcurrentSlices() {
+    if (_threadPool == nullptr) {
+        return 1;
     }
+    return _threadPool->getNumThreads();
+}
 
-    Array3d<bool> mask(gridWidth, gridHeight, gridDepth);
-    _getSliceMask(startidx, endidx, mask);
+int IsotropicParticleMesher::_getPolygonizationSliceWidth() {
+    int width, height, depth;
+    double dx;
+    _getSubdividedGridDimensions(&width, &height, &depth, &dx);
 
-    Polygonizer3d polygonizer(&field);
-    polygonizer.setSurfaceCellMask(&mask);
+    // Split the grid between threads without making slices so thin that 
+    // their overlapping seam cells dominate
+    int numThreads = _getNumConcurrentSlices();
+    int threadSliceWidth = ceil((double)width / (double)numThreads);
+    threadSliceWidth = (int)fmax(threadSliceWidth, _minPolygonizationSliceWidth);
 
-    return polygonizer.polygonizeSurface();
+    int sliceWidth = ceil((double)width / (double)_numPolygonizationSlices);
+    sliceWidth = (int)fmin(sliceWidth, threadSliceWidth);
+
+    if (_maxPolygonizationMemory > 0) {
+        while (sliceWidth > 1 && 
+                numThreads*_getSliceMemoryUsage(sliceWidth) > _maxPolygonizationMemory) {
+            sliceWidth--;
+        }
+    }
+
+    return sliceWidth;
+}
+
+long long IsotropicParticleMesher::_getSliceMemoryUsage(int sliceWidth) {
+    int width, height, depth;
+    double dx;
+    _getSubdividedGridDimensions(&width, &height, &depth, &dx);
+
+    // Per grid node: slice material and, for a dense field, the scalar 
+    // field value and solid and set flags. Sparse field and polygonizer 
+    // edge memory scale with the particle-occupied volume and surface area
+    // rather than the slice volume.
+    long long bytesPerNode = sizeof(Material);
+    if (_getScalarFieldStorage() == ScalarFieldStorage::dense) {
+        bytesPerNode += sizeof(float) + 2*sizeof(bool);
+    }
+    long long numNodes = (long long)(sliceWidth + 3)*(height + 1)*(depth + 1);
+
+    return bytesPerNode*numNodes;
+}
+
+void IsotropicParticleMesher::_runSliceTasks(int numTasks, bool isParallel, 
+                                             std::function<void(int)> func) {
+    if (!isParallel || _threadPool == nullptr) {
+        for (int i = 0; i < numTasks; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    _threadPool->run(numTasks, func);
 }
 
 void IsotropicParticleMesher::_getSubdividedGridDimensions(int *i, int *j, int *k, double *dx) {
@@ -208,7 +353,7 @@ void IsotropicParticleMesher::_getSubdividedGridDimensions(int *i, int *j, int *
 }
 
 void IsotropicParticleMesher::_computeSliceScalarField(int startidx, int endidx, 
-                                                       FragmentedVector<MarkerParticle> &markerParticles,
+                                                       MarkerParticleVector &markerParticles,
                                                        FluidMaterialGrid &materialGrid,
                                                        ScalarField &field) {
     
@@ -228,7 +373,6 @@ void IsotropicParticleMesher::_computeSliceScalarField(int startidx, int endidx,
     field.setPointRadius(_particleRadius);
 
     _addPointsToScalarField(sliceParticles, field);
-    _updateScalarFieldSeam(startidx, endidx, field);
 }
 
 vmath::vec3 IsotropicParticleMesher::_getSliceGridPositionOffset(int startidx, int endidx) {
@@ -250,12 +394,13 @@ vmath::vec3 IsotropicParticleMesher::_getSliceGridPositionOffset(int startidx, i
 }
 
 void IsotropicParticleMesher::_getSliceParticles(int startidx, int endidx, 
-                                                 FragmentedVector<MarkerParticle> &markerParticles,
+                                                 MarkerParticleVector &markerParticles,
                                                  FragmentedVector<vmath::vec3> &sliceParticles) {
     AABB bbox = _getSliceAABB(startidx, endidx);
-    for (unsigned int i = 0; i < markerParticles.size(); i++) {
-        if (bbox.isPointInside(markerParticles[i].position)) {
-            sliceParticles.push_back(markerParticles[i].position);
+    std::vector<vmath::vec3> *positions = markerParticles.getPositions();
+    for (unsigned int i = 0; i < positions->size(); i++) {
+        if (bbox.isPointInside(positions->at(i))) {
+            sliceParticles.push_back(positions->at(i));
         }
     }
 }
@@ -264,20 +409,18 @@ void IsotropicParticleMesher::_getSliceMaterialGrid(int startidx, int endidx,
                                FluidMaterialGrid &materialGrid,
                                FluidMaterialGrid &sliceMaterialGrid) {
     (void)endidx;
-    int origsubd = materialGrid.getSubdivisionLevel();
-    materialGrid.setSubdivisionLevel(_subdivisionLevel);
-    
+
+    // Slices after the first start one cell before startidx
+    int offseti = startidx == 0 ? 0 : startidx - 1;
     Material m;
     for (int k = 0; k < sliceMaterialGrid.depth; k++) {
         for (int j = 0; j < sliceMaterialGrid.height; j++) {
             for (int i = 0; i < sliceMaterialGrid.width; i++) {
-                m = materialGrid(startidx + i, j, k);
+                m = materialGrid(offseti + i, j, k);
                 sliceMaterialGrid.set(i, j, k, m);
             }
         }
     }
-
-    materialGrid.setSubdivisionLevel(origsubd);
 }
 
 AABB IsotropicParticleMesher::_getSliceAABB(int startidx, int endidx) {
@@ -309,7 +452,7 @@ AABB IsotropicParticleMesher::_getSliceAABB(int startidx, int endidx) {
 void IsotropicParticleMesher::_addPointsToScalarField(FragmentedVector<vmath::vec3> &points,
                                                       ScalarField &field) {
     
-    if (_isScalarFieldAcceleratorSet) {
+    if (_isScalarFieldAcceleratorEnabled()) {
         _addPointsToScalarFieldAccelerator(points, field);
     } else {
         for (unsigned int i = 0; i < points.size(); i++) {
@@ -318,13 +461,14 @@ void IsotropicParticleMesher::_addPointsToScalarField(FragmentedVector<vmath::ve
     }
 }
 
-void IsotropicParticleMesher::_addPointsToScalarField(FragmentedVector<MarkerParticle> &points,
+void IsotropicParticleMesher::_addPointsToScalarField(MarkerParticleVector &points,
                                                       ScalarField &field) {
-    if (_isScalarFieldAcceleratorSet) {
+    if (_isScalarFieldAcceleratorEnabled()) {
         _addPointsToScalarFieldAccelerator(points, field);
     } else {
-        for (unsigned int i = 0; i < points.size(); i++) {
-            field.addPoint(points[i].position);
+        std::vector<vmath::vec3> *positions = points.getPositions();
+        for (unsigned int i = 0; i < positions->size(); i++) {
+            field.addPoint(positions->at(i));
         }
     }
 }
@@ -360,28 +504,26 @@ void IsotropicParticleMesher::_addPointsToScalarFieldAccelerator(FragmentedVecto
     }
 }
 
-void IsotropicParticleMesher::_addPointsToScalarFieldAccelerator(FragmentedVector<MarkerParticle> &points,
+void IsotropicParticleMesher::_addPointsToScalarFieldAccelerator(MarkerParticleVector &points,
                                                                  ScalarField &field) {
     bool isThresholdSet = _scalarFieldAccelerator->isMaxScalarFieldValueThresholdSet();
     double origThreshold = _scalarFieldAccelerator->getMaxScalarFieldValueThreshold();
     _scalarFieldAccelerator->setMaxScalarFieldValueThreshold(_maxScalarFieldValueThreshold);
 
+    // The position array is passed to the accelerator directly unless it 
+    // must be split into multiple additions
     int n = _maxParticlesPerScalarFieldAddition;
-    std::vector<vmath::vec3> positions;
-    positions.reserve(fmin(n, points.size()));
-
-    for (int startidx = 0; startidx < (int)points.size(); startidx += n) {
-        int endidx = startidx + n - 1;
-        if (endidx >= (int)points.size()) {
-            endidx = points.size() - 1;
-        }
-
-        positions.clear();
-        for (int i = startidx; i <= endidx; i++) {
-            positions.push_back(points[i].position);
+    if ((int)points.size() <= n) {
+        _scalarFieldAccelerator->addPoints(*(points.getPositions()), field);
+    } else {
+        std::vector<vmath::vec3> positions;
+        positions.reserve(n);
+        for (int startidx = 0; startidx < (int)points.size(); startidx += n) {
+            int endidx = (int)fmin(startidx + n, points.size());
+            positions.clear();
+            points.getPositions(startidx, endidx, positions);
+            _scalarFieldAccelerator->addPoints(positions, field);
         }
-
-        _scalarFieldAccelerator->addPoints(positions, field);
     }
 
     if (!isThresholdSet) {
@@ -391,23 +533,6 @@ void IsotropicParticleMesher::_addPointsToScalarFieldAccelerator(FragmentedVecto
     }
 }
 
-void IsotropicParticleMesher::_updateScalarFieldSeam(int startidx, int endidx,
-                                                     ScalarField &field) {
-    int width, height, depth;
-    double dx;
-    _getSubdividedGridDimensions(&width, &height, &depth, &dx);
-
-    bool isStartSlice = startidx == 0;
-    bool isEndSlice = endidx == width - 1;
-
-    if (!isStartSlice) {
-        _applyScalarFieldSliceSeamData(field);
-    }
-    if (!isEndSlice) {
-        _saveScalarFieldSliceSeamData(field);
-    }
-}
-
 void IsotropicParticleMesher::_applyScalarFieldSliceSeamData(ScalarField &field) {
     int width, height, depth;
     field.getGridDimensions(&width, &height, &depth);
@@ -415,7 +540,12 @@ void IsotropicParticleMesher::_applyScalarFieldSliceSeamData(ScalarField &field)
     for (int k = 0; k < depth; k++) {
         for (int j = 0; j < height; j++) {
             for (int i = 0; i <= 2; i++) {
-                field.setScalarFieldValue(i, j, k, _scalarFieldSeamData(i, j, k));
+                // Skip unchanged values so that a sparse field does not 
+                // allocate empty blocks along the seam
+                float value = _scalarFieldSeamData(i, j, k);
+                if (value != field.getRawScalarFieldValue(i, j, k)) {
+                    field.setScalarFieldValue(i, j, k, value);
+                }
             }
         }
     }
@@ -435,33 +565,37 @@ void IsotropicParticleMesher::_saveScalarFieldSliceSeamData(ScalarField &field)
     }
 }
 
-void IsotropicParticleMesher::_getSliceMask(int startidx, int endidx, Array3d<bool> &mask) {
-    mask.fill(true);
-
+void IsotropicParticleMesher::_getSliceCellBounds(int startidx, int endidx, 
+                                                  ScalarField &field,
+                                                  GridIndex *gmin, GridIndex *gmax) {
     int width, height, depth;
     double dx;
     _getSubdividedGridDimensions(&width, &height, &depth, &dx);
 
+    int fieldWidth, fieldHeight, fieldDepth;
+    field.getGridDimensions(&fieldWidth, &fieldHeight, &fieldDepth);
+
+    // The first and last cell columns of a slice overlap its neighbours 
+    // and are polygonized by them
     bool isStartSlice = startidx == 0;
     bool isEndSlice = endidx == width - 1;
+    int imin = isStartSlice ? 0 : 1;
+    int imax = isEndSlice ? fieldWidth - 2 : fieldWidth - 3;
 
-    if (!isStartSlice) {
-        int idx = 0;
-        for (int k = 0; k < mask.depth; k++) {
-            for (int j = 0; j < mask.height; j++) {
-                mask.set(idx, j, k, false);
-            }
-        }
-    }
+    *gmin = GridIndex(imin, 0, 0);
+    *gmax = GridIndex(imax, fieldHeight - 2, fieldDepth - 2);
+}
 
-    if (!isEndSlice) {
-        int idx = mask.width - 1;
-        for (int k = 0; k < mask.depth; k++) {
-            for (int j = 0; j < mask.height; j++) {
-                mask.set(idx, j, k, false);
-            }
-        }
+ScalarFieldStorage IsotropicParticleMesher::_getScalarFieldStorage() {
+    if (_isSparseScalarFieldEnabled) {
+        return ScalarFieldStorage::sparse;
     }
+    return ScalarFieldStorage::dense;
+}
+
+bool IsotropicParticleMesher::_isScalarFieldAcceleratorEnabled() {
+    // The scalar field accelerator writes to the dense field grid directly
+    return _isScalarFieldAcceleratorSet && !_isSparseScalarFieldEnabled;
 }
 
 void IsotropicParticleMesher::_initializePreviewMesher(double pdx) {
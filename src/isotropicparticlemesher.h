@@ -25,7 +25,7 @@ freely, subject to the following restrictions:
 #include <vector>
 
 #include "fragmentedvector.h"
-#include "markerparticle.h"
+#include "markerparticlevector.h"
 #include "fluidmaterialgrid.h"
 #include "trianglemesh.h"
 #include "scalarfield.h"
@@ -34,6 +34,7 @@ freely, subject to the following restrictions:
 #include "aabb.h"
 #include "vmath.h"
 #include "fluidsimassert.h"
+#include "threadpool.h"
 
 class IsotropicParticleMesher {
 
@@ -45,7 +46,33 @@ public:
     void setSubdivisionLevel(int n);
     void setNumPolygonizationSlices(int n);
 
-    TriangleMesh meshParticles(FragmentedVector<MarkerParticle> &particles, 
+    /*
+        Upper bound in bytes on the scalar field and polygonizer data of the
+        slices that are polygonized at the same time. The grid is split into
+        more slices when the concurrent slices would exceed the limit. A 
+        value of 0 removes the limit.
+    */
+    void setMaxPolygonizationMemory(long long bytes);
+    long long getMaxPolygonizationMemory();
+
+    /*
+        Thread pool used to polygonize slices concurrently. Slices are 
+        processed one at a time if no pool is set.
+    */
+    void setThreadPool(ThreadPool *pool);
+
+    /*
+        Store the scalar field in blocks that are only allocated near
+        particles. Memory then scales with the particle-occupied volume 
+        instead of the subdivided grid volume. The scalar field accelerator
+        requires dense storage and is not used while the sparse field is
+        enabled.
+    */
+    void enableSparseScalarField();
+    void disableSparseScalarField();
+    bool isSparseScalarFieldEnabled();
+
+    TriangleMesh meshParticles(MarkerParticleVector &particles, 
                                FluidMaterialGrid &materialGrid,
                                double particleRadius);
 
@@ -58,22 +85,29 @@ public:
 
 private:
 
-    TriangleMesh _polygonizeAll(FragmentedVector<MarkerParticle> &particles,
+    TriangleMesh _polygonizeAll(MarkerParticleVector &particles,
                                 FluidMaterialGrid &materialGrid);
 
-    TriangleMesh _polygonizeSlices(FragmentedVector<MarkerParticle> &particles,
+    TriangleMesh _polygonizeSlices(MarkerParticleVector &particles,
                                    FluidMaterialGrid &materialGrid);
-    TriangleMesh _polygonizeSlice(int startidx, int endidx, 
-                                  FragmentedVector<MarkerParticle> &particles, 
-                                  FluidMaterialGrid &materialGrid);
+    void _polygonizeSliceBatch(std::vector<int> &sliceStarts, std::vector<int> &sliceEnds,
+                               MarkerParticleVector &particles, 
+                               FluidMaterialGrid &materialGrid,
+                               std::vector<TriangleMesh> &sliceMeshes);
+    void _initializeSliceScalarField(int startidx, int endidx, ScalarField &field);
+    TriangleMesh _polygonizeSlice(int startidx, int endidx, ScalarField &field);
     void _getSubdividedGridDimensions(int *i, int *j, int *k, double *dx);
+    int _getNumConcurrentSlices();
+    int _getPolygonizationSliceWidth();
+    long long _getSliceMemoryUsage(int sliceWidth);
+    void _runSliceTasks(int numTasks, bool isParallel, std::function<void(int)> func);
     void _computeSliceScalarField(int startidx, int endidx, 
-                                  FragmentedVector<MarkerParticle> &particles,
+                                  MarkerParticleVector &particles,
                                   FluidMaterialGrid &materialGrid,
                                   ScalarField &field);
     vmath::vec3 _getSliceGridPositionOffset(int startidx, int endidx);
     void _getSliceParticles(int startidx, int endidx, 
-                            FragmentedVector<MarkerParticle> &markerParticles,
+                            MarkerParticleVector &markerParticles,
                             FragmentedVector<vmath::vec3> &sliceParticles);
     void _getSliceMaterialGrid(int startidx, int endidx,
                                FluidMaterialGrid &materialGrid,
@@ -81,16 +115,18 @@ private:
     AABB _getSliceAABB(int startidx, int endidx);
     void _addPointsToScalarField(FragmentedVector<vmath::vec3> &points,
                                  ScalarField &field);
-    void _addPointsToScalarField(FragmentedVector<MarkerParticle> &points,
+    void _addPointsToScalarField(MarkerParticleVector &points,
                                  ScalarField &field);
     void _addPointsToScalarFieldAccelerator(FragmentedVector<vmath::vec3> &points,
                                             ScalarField &field);
-    void _addPointsToScalarFieldAccelerator(FragmentedVector<MarkerParticle> &points,
+    void _addPointsToScalarFieldAccelerator(MarkerParticleVector &points,
                                             ScalarField &field);
-    void _updateScalarFieldSeam(int startidx, int endidx, ScalarField &field);
     void _applyScalarFieldSliceSeamData(ScalarField &field);
     void _saveScalarFieldSliceSeamData(ScalarField &field);
-    void _getSliceMask(int startidx, int endidx, Array3d<bool> &mask);
+    void _getSliceCellBounds(int startidx, int endidx, ScalarField &field,
+                             GridIndex *gmin, GridIndex *gmax);
+    ScalarFieldStorage _getScalarFieldStorage();
+    bool _isScalarFieldAcceleratorEnabled();
 
     void _initializePreviewMesher(double dx);
     void _addScalarFieldToPreviewField(ScalarField &field);
@@ -107,6 +143,10 @@ private:
 
     int _subdivisionLevel = 1;
     int _numPolygonizationSlices = 1;
+    long long _maxPolygonizationMemory = 0;
+    int _minPolygonizationSliceWidth = 8;
+    ThreadPool *_threadPool = nullptr;
+    bool _isSparseScalarFieldEnabled = false;
 
     double _particleRadius = 0.0;
     double _maxScalarFieldValueThreshold = 1.0;
@@ -0,0 +1,209 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "jacobisvd.h"
+
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    #define JACOBISVD_AVX512
+    #include <immintrin.h>
+#elif defined(__AVX2__)
+    #define JACOBISVD_AVX2
+    #include <immintrin.h>
+#else
+    #include <math.h>
+#endif
+
+namespace {
+
+#if defined(JACOBISVD_AVX512)
+
+    const int NUM_LANES = 16;
+    typedef __m512 vfloat;
+    typedef __mmask16 vmask;
+
+    inline vfloat vSet(float v) { return _mm512_set1_ps(v); }
+    inline vfloat vLoad(const float *src) { return _mm512_loadu_ps(src); }
+    inline void vStore(float *dst, vfloat a) { _mm512_storeu_ps(dst, a); }
+    inline vfloat vAdd(vfloat a, vfloat b) { return _mm512_add_ps(a, b); }
+    inline vfloat vSub(vfloat a, vfloat b) { return _mm512_sub_ps(a, b); }
+    inline vfloat vMul(vfloat a, vfloat b) { return _mm512_mul_ps(a, b); }
+    inline vfloat vDiv(vfloat a, vfloat b) { return _mm512_div_ps(a, b); }
+    inline vfloat vSqrt(vfloat a) { return _mm512_maskz_sqrt_ps(0xFFFF, a); }
+    inline vfloat vAbs(vfloat a) { return _mm512_abs_ps(a); }
+    inline vmask vEqual(vfloat a, vfloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+    inline vmask vLess(vfloat a, vfloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    inline vfloat vSelect(vmask m, vfloat a, vfloat b) { return _mm512_mask_blend_ps(m, b, a); }
+
+#elif defined(JACOBISVD_AVX2)
+
+    const int NUM_LANES = 8;
+    typedef __m256 vfloat;
+    typedef __m256 vmask;
+
+    inline vfloat vSet(float v) { return _mm256_set1_ps(v); }
+    inline vfloat vLoad(const float *src) { return _mm256_loadu_ps(src); }
+    inline void vStore(float *dst, vfloat a) { _mm256_storeu_ps(dst, a); }
+    inline vfloat vAdd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+    inline vfloat vSub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+    inline vfloat vMul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+    inline vfloat vDiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+    inline vfloat vSqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+    inline vfloat vAbs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    inline vmask vEqual(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    inline vmask vLess(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    inline vfloat vSelect(vmask m, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, m); }
+
+#else
+
+    const int NUM_LANES = 1;
+    typedef float vfloat;
+    typedef bool vmask;
+
+    inline vfloat vSet(float v) { return v; }
+    inline vfloat vLoad(const float *src) { return *src; }
+    inline void vStore(float *dst, vfloat a) { *dst = a; }
+    inline vfloat vAdd(vfloat a, vfloat b) { return a + b; }
+    inline vfloat vSub(vfloat a, vfloat b) { return a - b; }
+    inline vfloat vMul(vfloat a, vfloat b) { return a * b; }
+    inline vfloat vDiv(vfloat a, vfloat b) { return a / b; }
+    inline vfloat vSqrt(vfloat a) { return sqrtf(a); }
+    inline vfloat vAbs(vfloat a) { return fabsf(a); }
+    inline vmask vEqual(vfloat a, vfloat b) { return a == b; }
+    inline vmask vLess(vfloat a, vfloat b) { return a < b; }
+    inline vfloat vSelect(vmask m, vfloat a, vfloat b) { return m ? a : b; }
+
+#endif
+
+// A fixed sweep count keeps every lane in step. Cyclic Jacobi converges 
+// quadratically, so a 3x3 matrix reaches float precision well within 
+// this many sweeps.
+const int NUM_SWEEPS = 6;
+
+/*
+    Applies the Jacobi rotation that zeroes the off-diagonal element of 
+    the symmetric matrix at (p, q). The diagonal is stored in d, the 
+    off-diagonal elements (0, 1), (0, 2), (1, 2) in o, and the remaining 
+    row r is referenced by the off-diagonal indices rp = (r, p) and 
+    rq = (r, q). The rotation is accumulated into the columns of v.
+
+    Rotation method from Numerical Recipes, section 11.1
+*/
+inline void jacobiRotate(vfloat d[3], vfloat o[3], vfloat v[3][3], 
+                         int p, int q, int pq, int rp, int rq) {
+    vfloat zero = vSet(0.0f);
+    vfloat one = vSet(1.0f);
+
+    vfloat apq = o[pq];
+    vmask isDiagonal = vEqual(apq, zero);
+    vfloat safeapq = vSelect(isDiagonal, one, apq);
+    vfloat theta = vDiv(vSub(d[q], d[p]), vMul(vSet(2.0f), safeapq));
+    vfloat sgn = vSelect(vLess(theta, zero), vSet(-1.0f), one);
+    vfloat abstheta = vAbs(theta);
+    vfloat t = vDiv(sgn, vAdd(abstheta, vSqrt(vAdd(vMul(abstheta, abstheta), one))));
+    t = vSelect(isDiagonal, zero, t);
+    vfloat c = vDiv(one, vSqrt(vAdd(vMul(t, t), one)));
+    vfloat s = vMul(t, c);
+
+    d[p] = vSub(d[p], vMul(t, apq));
+    d[q] = vAdd(d[q], vMul(t, apq));
+    o[pq] = zero;
+
+    vfloat arp = o[rp];
+    vfloat arq = o[rq];
+    o[rp] = vSub(vMul(c, arp), vMul(s, arq));
+    o[rq] = vAdd(vMul(s, arp), vMul(c, arq));
+
+    for (int i = 0; i < 3; i++) {
+        vfloat vip = v[i][p];
+        vfloat viq = v[i][q];
+        v[i][p] = vSub(vMul(c, vip), vMul(s, viq));
+        v[i][q] = vAdd(vMul(s, vip), vMul(c, viq));
+    }
+}
+
+}
+
+void JacobiSVD::decomposeSymmetric(vmath::mat3 *matrices, int n, 
+                                   vmath::mat3 *eigenvectors, 
+                                   vmath::vec3 *eigenvalues) {
+
+    // Lane storage in structure of arrays form. Elements 0-2 hold the 
+    // diagonal, 3-5 the off-diagonal (0, 1), (0, 2), (1, 2) and 6-14 the
+    // eigenvector matrix in row-major order.
+    float lanes[15][NUM_LANES];
+    vfloat d[3], o[3], v[3][3];
+
+    for (int startidx = 0; startidx < n; startidx += NUM_LANES) {
+        int count = n - startidx < NUM_LANES ? n - startidx : NUM_LANES;
+
+        // mat3 is column-major, m[3*col + row]
+        for (int lane = 0; lane < NUM_LANES; lane++) {
+            vmath::mat3 A = lane < count ? matrices[startidx + lane] : vmath::mat3();
+            lanes[0][lane] = A.m[0];
+            lanes[1][lane] = A.m[4];
+            lanes[2][lane] = A.m[8];
+            lanes[3][lane] = A.m[3];
+            lanes[4][lane] = A.m[6];
+            lanes[5][lane] = A.m[7];
+        }
+
+        for (int i = 0; i < 3; i++) {
+            d[i] = vLoad(lanes[i]);
+            o[i] = vLoad(lanes[3 + i]);
+            for (int j = 0; j < 3; j++) {
+                v[i][j] = vSet(i == j ? 1.0f : 0.0f);
+            }
+        }
+
+        for (int sweep = 0; sweep < NUM_SWEEPS; sweep++) {
+            jacobiRotate(d, o, v, 0, 1, 0, 1, 2);
+            jacobiRotate(d, o, v, 0, 2, 1, 0, 2);
+            jacobiRotate(d, o, v, 1, 2, 2, 0, 1);
+        }
+
+        for (int i = 0; i < 3; i++) {
+            vStore(lanes[i], d[i]);
+            for (int j = 0; j < 3; j++) {
+                vStore(lanes[6 + 3*i + j], v[i][j]);
+            }
+        }
+
+        for (int lane = 0; lane < count; lane++) {
+            int idx = startidx + lane;
+            eigenvalues[idx] = vmath::vec3(lanes[0][lane], lanes[1][lane], lanes[2][lane]);
+
+            vmath::mat3 &V = eigenvectors[idx];
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    V.m[3*j + i] = lanes[6 + 3*i + j][lane];
+                }
+            }
+        }
+    }
+}
+
+const char* JacobiSVD::getInstructionSet() {
+    #if defined(JACOBISVD_AVX512)
+        return "AVX-512";
+    #elif defined(JACOBISVD_AVX2)
+        return "AVX2";
+    #else
+        return "none";
+    #endif
+}
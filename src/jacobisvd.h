@@ -0,0 +1,48 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef JACOBISVD_H
+#define JACOBISVD_H
+
+#include "vmath.h"
+
+namespace JacobiSVD {
+
+    /*
+        Decomposes each symmetric 3x3 matrix A into A = V*D*transpose(V) 
+        using cyclic Jacobi rotations. Column k of eigenvectors[i] is the 
+        eigenvector for eigenvalues[i][k]. For symmetric positive 
+        semi-definite matrices, such as covariance matrices, this is also 
+        the singular value decomposition.
+
+        Matrices are processed in groups that fill the SIMD lanes of the 
+        target instruction set. Eigenvalues are not sorted.
+    */
+    extern void decomposeSymmetric(vmath::mat3 *matrices, int n, 
+                                   vmath::mat3 *eigenvectors, 
+                                   vmath::vec3 *eigenvalues);
+
+    /*
+        Returns the name of the instruction set that the batched 
+        decomposition was compiled for, or "none" for the scalar path.
+    */
+    extern const char* getInstructionSet();
+}
+
+#endif
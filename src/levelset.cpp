@@ -23,23 +23,78 @@ LevelSet::LevelSet() {
 }
 
 LevelSet::LevelSet(int i, int j, int k, double dx) : 
-                                 _isize(i), _jsize(j), _ksize(k), _dx(dx),
-                                 _signedDistance(i, j, k, 0.0f),
-                                 _indexGrid(i, j, k, -1),
-                                 _isDistanceSet(i, j, k, false) {
+                                 _isize(i), _jsize(j), _ksize(k), _dx(dx) {
+    _bandCells = SparseArray3d<BandCell>(i, j, k, _getUnsetBandCell());
+    _bandCells.getBlockGridDimensions(&_bisize, &_bjsize, &_bksize);
+    _blockSigns = Array3d<char>(_bisize, _bjsize, _bksize, 0);
 }
 
 LevelSet::~LevelSet() {
 }
 
+void LevelSet::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
+}
+
+void LevelSet::enableFastSweeping() {
+    _isFastSweepingEnabled = true;
+}
+
+void LevelSet::disableFastSweeping() {
+    _isFastSweepingEnabled = false;
+}
+
+bool LevelSet::isFastSweepingEnabled() {
+    return _isFastSweepingEnabled;
+}
+
 void LevelSet::setSurfaceMesh(TriangleMesh m) {
     _surfaceMesh = m;
 }
 
+Array3d<float> LevelSet::getSignedDistanceField() {
+    Array3d<float> field(_isize, _jsize, _ksize, 0.0f);
+    for (int k = 0; k < _ksize; k++) {
+        for (int j = 0; j < _jsize; j++) {
+            for (int i = 0; i < _isize; i++) {
+                field.set(i, j, k, _getSignedDistanceValue(i, j, k));
+            }
+        }
+    }
+
+    return field;
+}
+
+void LevelSet::_parallelForRange(int begin, int end, int grainSize,
+                                 std::function<void(int, int)> func) {
+    if (_threadPool == nullptr) {
+        if (end > begin) {
+            func(begin, end);
+        }
+        return;
+    }
+
+    _threadPool->parallelForRange(begin, end, grainSize, func);
+}
+
 void LevelSet::_resetSignedDistanceField() {
-    _signedDistance.fill(0.0);
-    _indexGrid.fill(-1);
-    _isDistanceSet.fill(false);
+    _blockSigns.fill(0);
+    _bandCells.fill(_getUnsetBandCell());
+}
+
+LevelSet::BandCell LevelSet::_getUnsetBandCell() {
+    BandCell c;
+    c.distance = 0.0f;
+    c.tidx = -1;
+    c.layer = _unsetCellLayer;
+    return c;
+}
+
+void LevelSet::_getBlockCellRange(GridIndex b, GridIndex *gmin, GridIndex *gmax) {
+    *gmin = GridIndex(b.i*_blockSize, b.j*_blockSize, b.k*_blockSize);
+    *gmax = GridIndex((int)fmin(gmin->i + _blockSize, _isize),
+                      (int)fmin(gmin->j + _blockSize, _jsize),
+                      (int)fmin(gmin->k + _blockSize, _ksize));
 }
 
 void LevelSet::_getTriangleGridCellOverlap(Triangle t, GridIndexVector &cells) {
@@ -56,27 +111,53 @@ void LevelSet::_getTriangleGridCellOverlap(Triangle t, GridIndexVector &cells) {
     }
 }
 
-void LevelSet::_calculateDistancesSquaredForTriangle(int index) {
+void LevelSet::_calculateDistancesSquaredForTriangle(int index, 
+                                                     std::vector<SurfaceCellDistance> &distances) {
     Triangle t = _surfaceMesh.triangles[index];
 
     GridIndexVector cells(_isize, _jsize, _ksize);
     _getTriangleGridCellOverlap(t, cells);
 
-    GridIndex g;
-    double distsq;
+    SurfaceCellDistance d;
+    d.tidx = index;
     for (unsigned int i = 0; i < cells.size(); i++) {
-        g = cells[i];
-        distsq = _minDistToTriangleSquared(g, index);
-
-        if (!_isDistanceSet(g) || distsq < _signedDistance(g)) {
-            _setLevelSetCell(g, distsq, index);
-        }
+        d.g = cells[i];
+        d.distsq = (float)_minDistToTriangleSquared(d.g, index);
+        distances.push_back(d);
     }
 }
 
-void LevelSet::_calculateUnsignedSurfaceDistanceSquared() {
-    for (unsigned int i = 0; i < _surfaceMesh.triangles.size(); i++) {
-        _calculateDistancesSquaredForTriangle(i);
+void LevelSet::_calculateUnsignedSurfaceDistanceSquared(std::vector<GridIndex> &surfaceCells) {
+    int numTriangles = (int)_surfaceMesh.triangles.size();
+    int numRanges = (numTriangles + _triangleGrainSize - 1) / _triangleGrainSize;
+    std::vector<std::vector<SurfaceCellDistance> > rangeDistances(numRanges);
+
+    _parallelForRange(0, numTriangles, _triangleGrainSize, 
+                      [this, &rangeDistances](int begin, int end) {
+        std::vector<SurfaceCellDistance> &distances = rangeDistances[begin / _triangleGrainSize];
+        for (int tidx = begin; tidx < end; tidx++) {
+            _calculateDistancesSquaredForTriangle(tidx, distances);
+        }
+    });
+
+    // Ranges are merged in triangle order so that ties are resolved in 
+    // favour of the lowest triangle index regardless of the thread count
+    for (unsigned int ridx = 0; ridx < rangeDistances.size(); ridx++) {
+        std::vector<SurfaceCellDistance> &distances = rangeDistances[ridx];
+        for (unsigned int i = 0; i < distances.size(); i++) {
+            SurfaceCellDistance d = distances[i];
+            BandCell c = _bandCells(d.g);
+            if (c.layer == _unsetCellLayer) {
+                c.layer = 0;
+                surfaceCells.push_back(d.g);
+            } else if (!(d.distsq < c.distance)) {
+                continue;
+            }
+
+            c.distance = d.distsq;
+            c.tidx = d.tidx;
+            _bandCells.set(d.g, c);
+        }
     }
 }
 
@@ -89,118 +170,261 @@ void LevelSet::_getNeighbourGridIndices6(GridIndex g, GridIndex n[6]) {
     n[5] = GridIndex(g.i, g.j, g.k+1);
 }
 
-void LevelSet::_getLayerCells(int idx, GridIndexVector &layer, 
-                                       GridIndexVector &nextLayer,
-                                       Array3d<int> &layerGrid) {
+void LevelSet::_getLayerCells(int layerIndex, std::vector<GridIndex> &layer, 
+                                              std::vector<GridIndex> &nextLayer) {
     GridIndex ns[6];
-    GridIndex g, n;
+    GridIndex n;
     for (unsigned int i = 0; i < layer.size(); i++) {
-        g = layer[i];
-        _getNeighbourGridIndices6(g, ns);
+        _getNeighbourGridIndices6(layer[i], ns);
         for (int j = 0; j < 6; j++) {
             n = ns[j];
-            if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
-                    layerGrid(n) == -1) {
+            if (!Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize)) {
+                continue;
+            }
+
+            BandCell c = _bandCells(n);
+            if (c.layer == _unsetCellLayer) {
+                c.layer = layerIndex;
+                _bandCells.set(n, c);
                 nextLayer.push_back(n);
-                layerGrid.set(n, idx);
             }
         }
     }
 }
 
-void LevelSet::_getCellLayers(std::vector<GridIndexVector> &layers) {
-    Array3d<int> layerGrid(_isize, _jsize, _ksize, -1);
+double LevelSet::_getClosestNeighbourTriangle(GridIndex g, int minLayer, int maxLayer, 
+                                              int *tidx) {
+    vmath::vec3 p = Grid3d::GridIndexToCellCenter(g, _dx);
+    double mindistsq = _minDistToTriangleSquared(p, *tidx);
 
-    GridIndexVector layer(_isize, _jsize, _ksize);
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    layer.push_back(i, j, k);
-                    layerGrid.set(i, j, k, 0);
-                }
-            }
+    GridIndex ns[6];
+    _getNeighbourGridIndices6(g, ns);
+    for (int i = 0; i < 6; i++) {
+        if (!Grid3d::isGridIndexInRange(ns[i], _isize, _jsize, _ksize)) {
+            continue;
+        }
+
+        BandCell n = _bandCells(ns[i]);
+        if (n.layer < minLayer || n.layer > maxLayer || n.tidx == *tidx) {
+            continue;
+        }
+
+        double distsq = _minDistToTriangleSquared(p, n.tidx);
+        if (distsq < mindistsq) {
+            mindistsq = distsq;
+            *tidx = n.tidx;
         }
     }
 
-    GridIndexVector q(_isize, _jsize, _ksize);
-    layers.push_back(q);
-    _getLayerCells(1, layer, layers[0], layerGrid);
+    return mindistsq;
+}
+
+void LevelSet::_calculateUnsignedDistanceSquaredForLayer(int layerIndex, 
+                                                         std::vector<GridIndex> &layer) {
+    // Cells in a layer first take the closest of the triangles found in the 
+    // previous layer. Triangles are then exchanged between neighbours within 
+    // the layer until no cell finds a closer triangle. Each pass reads values
+    // from the previous pass so that the layer can be split between threads.
+    //
+    // Surface cells already hold the closest of their overlapping triangles
+    // and only exchange triangles within the surface layer.
+    int numCells = (int)layer.size();
+    std::vector<int> triangles(numCells, -1);
+    std::vector<float> distances(numCells, 0.0f);
+    int minLayer = (int)fmax(layerIndex - 1, 0);
+    int maxLayer = minLayer;
+
+    for (int iter = 0; iter <= _maxLayerRelaxationIterations; iter++) {
+        std::vector<char> isChanged(numCells, 0);
+        _parallelForRange(0, numCells, _layerGrainSize, 
+                          [&](int begin, int end) {
+            for (int lidx = begin; lidx < end; lidx++) {
+                int tidx = _bandCells(layer[lidx]).tidx;
+                int oldtidx = tidx;
+                distances[lidx] = (float)_getClosestNeighbourTriangle(layer[lidx], minLayer, 
+                                                                      maxLayer, &tidx);
+                triangles[lidx] = tidx;
+                isChanged[lidx] = tidx != oldtidx;
+            }
+        });
+
+        bool isLayerChanged = false;
+        for (int lidx = 0; lidx < numCells; lidx++) {
+            BandCell c = _bandCells(layer[lidx]);
+            c.distance = distances[lidx];
+            c.tidx = triangles[lidx];
+            _bandCells.set(layer[lidx], c);
+            isLayerChanged |= isChanged[lidx] != 0;
+        }
 
-    for (int i = 2; layers[i-2].size() > 0 && i < _numLayers; i++) {
-        GridIndexVector q(_isize, _jsize, _ksize);
-        layers.push_back(q);
-        _getLayerCells(i, layers[i - 2], layers[i - 1], layerGrid);
+        if (!isLayerChanged) {
+            break;
+        }
+        maxLayer = layerIndex;
     }
 }
 
-void LevelSet::_setLevelSetCell(GridIndex g, double dist, int tidx) {
-    _signedDistance.set(g, (float)dist);
-    _indexGrid.set(g, tidx);
-    _isDistanceSet.set(g, true);
+void LevelSet::_calculateUnsignedDistanceSquared(std::vector<GridIndex> &surfaceCells,
+                                                 std::vector<GridIndex> &outerLayer) {
+    int maxLayer = (int)fmax(_numLayers - 1, 1);
+
+    outerLayer = surfaceCells;
+    std::vector<GridIndex> nextLayer;
+    for (int i = 1; i <= maxLayer && !outerLayer.empty(); i++) {
+        nextLayer.clear();
+        _getLayerCells(i, outerLayer, nextLayer);
+        _calculateUnsignedDistanceSquaredForLayer(i, nextLayer);
+        outerLayer.swap(nextLayer);
+    }
 }
 
-void LevelSet::_resetLevelSetCell(GridIndex g) {
-    _signedDistance.set(g, 0.0);
-    _indexGrid.set(g, -1);
-    _isDistanceSet.set(g, false);
+void LevelSet::_getBandCells(std::vector<GridIndex> &surfaceCells,
+                             std::vector<GridIndex> &bandCells,
+                             std::vector<GridIndex> &outerLayer) {
+    int maxLayer = (int)fmax(_numLayers - 1, 1);
+
+    outerLayer = surfaceCells;
+    std::vector<GridIndex> nextLayer;
+    for (int i = 1; i <= maxLayer && !outerLayer.empty(); i++) {
+        nextLayer.clear();
+        _getLayerCells(i, outerLayer, nextLayer);
+        bandCells.insert(bandCells.end(), nextLayer.begin(), nextLayer.end());
+        outerLayer.swap(nextLayer);
+    }
 }
 
-void LevelSet::_calculateUnsignedDistanceSquaredForLayer(GridIndexVector &q) {
+void LevelSet::_sortCellsBySweepPlane(std::vector<GridIndex> &cells, int dj, int dk,
+                                      std::vector<GridIndex> &sortedCells,
+                                      std::vector<int> &planeOffsets) {
+    // Cells are bucketed by the diagonal plane i + dj*j + dk*k
+    int joffset = dj < 0 ? _jsize - 1 : 0;
+    int koffset = dk < 0 ? _ksize - 1 : 0;
+    int numPlanes = _isize + _jsize + _ksize - 2;
 
-    GridIndex g, n;
-    GridIndex ns[6];
-    double distsq;
+    planeOffsets.assign(numPlanes + 1, 0);
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        GridIndex g = cells[i];
+        planeOffsets[g.i + dj*g.j + joffset + dk*g.k + koffset + 1]++;
+    }
 
-    double eps = 1e-6;
-    while (!q.empty()) {
-        g = q.back();
-        q.pop_back();
+    for (int i = 0; i < numPlanes; i++) {
+        planeOffsets[i + 1] += planeOffsets[i];
+    }
 
-        _getNeighbourGridIndices6(g, ns);
-        for (int j = 0; j < 6; j++) {
-            n = ns[j];
-            if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
-                    _isDistanceSet(n)) {
-                int tidx = _indexGrid(n);
-                distsq = _minDistToTriangleSquared(n, tidx);
+    std::vector<int> planeCounts(planeOffsets.begin(), planeOffsets.end() - 1);
+    sortedCells.resize(cells.size());
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        GridIndex g = cells[i];
+        int plane = g.i + dj*g.j + joffset + dk*g.k + koffset;
+        sortedCells[planeCounts[plane]++] = g;
+    }
+}
 
-                if (!_isDistanceSet(g) || distsq < _signedDistance(g)) {
-                    _setLevelSetCell(g, distsq, tidx);
-                }
+void LevelSet::_sweepCell(GridIndex g, int di, int dj, int dk) {
+    BandCell c = _bandCells(g);
+    int tidx = c.tidx;
+    vmath::vec3 p = Grid3d::GridIndexToCellCenter(g, _dx);
+    double mindistsq = tidx == -1 ? std::numeric_limits<double>::infinity() : 
+                                    c.distance;
+
+    GridIndex ns[3] = {GridIndex(g.i - di, g.j, g.k),
+                       GridIndex(g.i, g.j - dj, g.k),
+                       GridIndex(g.i, g.j, g.k - dk)};
+    for (int i = 0; i < 3; i++) {
+        if (!Grid3d::isGridIndexInRange(ns[i], _isize, _jsize, _ksize)) {
+            continue;
+        }
 
-                if (distsq < _signedDistance(n) && fabs(distsq - _signedDistance(n)) > eps) {
-                    _resetLevelSetCell(n);
-                    q.push_back(n);
-                }
-            }
+        int ntidx = _bandCells(ns[i]).tidx;
+        if (ntidx == -1 || ntidx == tidx) {
+            continue;
+        }
+
+        double distsq = _minDistToTriangleSquared(p, ntidx);
+        if (distsq < mindistsq) {
+            mindistsq = distsq;
+            tidx = ntidx;
         }
+    }
 
-        if (!_isDistanceSet(g)) {
-            q.push_back(g);
+    if (tidx != c.tidx) {
+        c.distance = (float)mindistsq;
+        c.tidx = tidx;
+        _bandCells.set(g, c);
+    }
+}
+
+void LevelSet::_sweepPlanes(std::vector<GridIndex> &sortedCells, 
+                            std::vector<int> &planeOffsets, int di, int dj, int dk) {
+    // Upwind neighbours of a cell all lie on the previous sweep plane, so the
+    // cells of a plane can be updated in parallel
+    auto sweepfunc = [this, &sortedCells, di, dj, dk](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            _sweepCell(sortedCells[i], di, dj, dk);
+        }
+    };
+
+    int numPlanes = (int)planeOffsets.size() - 1;
+    for (int pidx = 0; pidx < numPlanes; pidx++) {
+        int plane = di > 0 ? pidx : numPlanes - 1 - pidx;
+        int begin = planeOffsets[plane];
+        int end = planeOffsets[plane + 1];
+        if (end - begin <= _layerGrainSize) {
+            sweepfunc(begin, end);
+        } else {
+            _parallelForRange(begin, end, _layerGrainSize, sweepfunc);
         }
     }
 }
 
-void LevelSet::_calculateUnsignedDistanceSquared() {
-    std::vector<GridIndexVector> cellLayers;
-    _getCellLayers(cellLayers);
+void LevelSet::_fastSweepUnsignedDistanceSquared(std::vector<GridIndex> &surfaceCells,
+                                                 std::vector<GridIndex> &outerLayer) {
+    // Surface cells hold exact distances and are only read from. The 
+    // remaining band cells are swept in each of the eight octant directions. 
+    // Opposite directions share a plane ordering that is traversed in reverse.
+    std::vector<GridIndex> bandCells;
+    _getBandCells(surfaceCells, bandCells, outerLayer);
+
+    int planeDirections[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    std::vector<GridIndex> sortedCells[4];
+    std::vector<int> planeOffsets[4];
+    for (int i = 0; i < 4; i++) {
+        _sortCellsBySweepPlane(bandCells, planeDirections[i][0], planeDirections[i][1], 
+                               sortedCells[i], planeOffsets[i]);
+    }
 
-    for (unsigned int i = 0; i < cellLayers.size(); i++) {
-        _calculateUnsignedDistanceSquaredForLayer(cellLayers[i]);
+    for (int iter = 0; iter < _numFastSweepingIterations; iter++) {
+        for (int i = 0; i < 4; i++) {
+            int dj = planeDirections[i][0];
+            int dk = planeDirections[i][1];
+            _sweepPlanes(sortedCells[i], planeOffsets[i], 1, dj, dk);
+            _sweepPlanes(sortedCells[i], planeOffsets[i], -1, -dj, -dk);
+        }
     }
 }
 
 void LevelSet::_squareRootDistanceField() {
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    _signedDistance.set(i, j, k, sqrt(_signedDistance(i, j, k)));
+    std::vector<GridIndex> bandBlocks;
+    _bandCells.getAllocatedBlocks(bandBlocks);
+
+    _parallelForRange(0, (int)bandBlocks.size(), _blockGrainSize, 
+                      [this, &bandBlocks](int begin, int end) {
+        GridIndex gmin, gmax;
+        for (int bidx = begin; bidx < end; bidx++) {
+            _getBlockCellRange(bandBlocks[bidx], &gmin, &gmax);
+            for (int k = gmin.k; k < gmax.k; k++) {
+                for (int j = gmin.j; j < gmax.j; j++) {
+                    for (int i = gmin.i; i < gmax.i; i++) {
+                        BandCell c = _bandCells(i, j, k);
+                        if (c.layer != _unsetCellLayer) {
+                            c.distance = sqrt(c.distance);
+                            _bandCells.set(i, j, k, c);
+                        }
+                    }
                 }
             }
         }
-    }
+    });
 }
 
 void LevelSet::_updateCellSign(GridIndex g, std::vector<vmath::vec3> &triangleCenters, 
@@ -209,14 +433,15 @@ void LevelSet::_updateCellSign(GridIndex g, std::vector<vmath::vec3> &triangleCe
     //     outside mesh, signed distance is negative
     //     inside mesh, signed distance is positive
 
-    int tidx = _indexGrid(g);
+    BandCell c = _bandCells(g);
     vmath::vec3 p =  Grid3d::GridIndexToCellCenter(g, _dx);
-    vmath::vec3 ct = triangleCenters[tidx];
-    vmath::vec3 n = triangleDirections[tidx];
+    vmath::vec3 ct = triangleCenters[c.tidx];
+    vmath::vec3 n = triangleDirections[c.tidx];
     vmath::vec3 v = ct - p;
 
     if (vmath::dot(v, n) < 0) {
-        _signedDistance.set(g, (float)-1.0f*_signedDistance(g));
+        c.distance = -c.distance;
+        _bandCells.set(g, c);
     }
 }
 
@@ -231,63 +456,122 @@ void LevelSet::_calculateDistanceFieldSigns() {
         triangleFaceCenters.push_back(_surfaceMesh.getTriangleCenter(i));
     }
 
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    _updateCellSign(GridIndex(i, j, k), triangleFaceCenters,
-                                                        triangleFaceDirections);
+    std::vector<GridIndex> bandBlocks;
+    _bandCells.getAllocatedBlocks(bandBlocks);
+
+    _parallelForRange(0, (int)bandBlocks.size(), _blockGrainSize, 
+                      [&](int begin, int end) {
+        GridIndex gmin, gmax;
+        for (int bidx = begin; bidx < end; bidx++) {
+            _getBlockCellRange(bandBlocks[bidx], &gmin, &gmax);
+            for (int k = gmin.k; k < gmax.k; k++) {
+                for (int j = gmin.j; j < gmax.j; j++) {
+                    for (int i = gmin.i; i < gmax.i; i++) {
+                        if (_bandCells(i, j, k).layer != _unsetCellLayer) {
+                            _updateCellSign(GridIndex(i, j, k), triangleFaceCenters,
+                                                                triangleFaceDirections);
+                        }
+                    }
                 }
             }
         }
+    });
+}
+
+void LevelSet::_floodFillCell(GridIndex g, char sign, std::vector<GridIndex> &cellQueue,
+                                                      std::vector<GridIndex> &blockQueue) {
+    if (!_bandCells.isElementAllocated(g)) {
+        GridIndex b(g.i / _blockSize, g.j / _blockSize, g.k / _blockSize);
+        if (_blockSigns(b) == 0) {
+            _blockSigns.set(b, sign);
+            blockQueue.push_back(b);
+        }
+        return;
+    }
+
+    if (_bandCells(g).layer != _unsetCellLayer) {
+        return;
     }
+
+    BandCell c;
+    c.distance = sign*std::numeric_limits<float>::infinity();
+    c.tidx = -1;
+    c.layer = _farCellLayer;
+    _bandCells.set(g, c);
+    cellQueue.push_back(g);
 }
 
-void LevelSet::_floodFillWithDistance(GridIndex seed, double val) {
-    GridIndexVector queue(_isize, _jsize, _ksize);
-    queue.push_back(seed);
-    _isDistanceSet.set(seed, true);
+void LevelSet::_floodFillBlockFace(GridIndex b, GridIndex nb, char sign, 
+                                   std::vector<GridIndex> &cellQueue,
+                                   std::vector<GridIndex> &blockQueue) {
+    if (!_bandCells.isBlockAllocated(nb)) {
+        if (_blockSigns(nb) == 0) {
+            _blockSigns.set(nb, sign);
+            blockQueue.push_back(nb);
+        }
+        return;
+    }
 
-    GridIndex g;
-    GridIndex ns[6];
-    while (!queue.empty()) {
-        g = queue[(int)queue.size() - 1];
-        queue.pop_back();
-
-        Grid3d::getNeighbourGridIndices6(g, ns);
-        for (int i = 0; i < 6; i++) {
-            if (Grid3d::isGridIndexInRange(ns[i], _isize, _jsize, _ksize) && 
-                    !_isDistanceSet(ns[i])) {
-                queue.push_back(ns[i]);
-                _isDistanceSet.set(ns[i], true);
+    // Only the cells of the band block that face block b are adjacent to it
+    GridIndex gmin, gmax;
+    _getBlockCellRange(nb, &gmin, &gmax);
+    if (nb.i < b.i) { gmin.i = gmax.i - 1; }
+    if (nb.i > b.i) { gmax.i = gmin.i + 1; }
+    if (nb.j < b.j) { gmin.j = gmax.j - 1; }
+    if (nb.j > b.j) { gmax.j = gmin.j + 1; }
+    if (nb.k < b.k) { gmin.k = gmax.k - 1; }
+    if (nb.k > b.k) { gmax.k = gmin.k + 1; }
+
+    for (int k = gmin.k; k < gmax.k; k++) {
+        for (int j = gmin.j; j < gmax.j; j++) {
+            for (int i = gmin.i; i < gmax.i; i++) {
+                _floodFillCell(GridIndex(i, j, k), sign, cellQueue, blockQueue);
             }
         }
-
-        _setLevelSetCell(g, val, -1);
     }
 }
 
-void LevelSet::_floodFillMissingSignedDistances() {
+void LevelSet::_floodFillMissingSignedDistances(std::vector<GridIndex> &outerLayer) {
+    // Cells beyond the narrow band take the sign of the band cells that 
+    // border them. Only the outermost layer can border cells outside of the 
+    // band, and blocks without band cells are filled as a whole.
+    std::vector<GridIndex> cellQueue;
+    std::vector<GridIndex> blockQueue;
     GridIndex ns[6];
-    GridIndex n;
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    Grid3d::getNeighbourGridIndices6(i, j, k, ns);
-                    for (int idx = 0; idx < 6; idx++) {
-                        n = ns[idx];
-                        if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
-                                !_isDistanceSet(n)) {
-                            double dist;
-                            if (_signedDistance(i, j, k) > 0.0) {
-                                dist = std::numeric_limits<double>::infinity();
-                            } else {
-                                dist = -std::numeric_limits<double>::infinity();
-                            }
-                            _floodFillWithDistance(n, dist);
-                        }
-                    }
+    for (unsigned int i = 0; i < outerLayer.size(); i++) {
+        GridIndex g = outerLayer[i];
+        char sign = _bandCells(g).distance > 0.0 ? 1 : -1;
+        _getNeighbourGridIndices6(g, ns);
+        for (int j = 0; j < 6; j++) {
+            if (Grid3d::isGridIndexInRange(ns[j], _isize, _jsize, _ksize)) {
+                _floodFillCell(ns[j], sign, cellQueue, blockQueue);
+            }
+        }
+    }
+
+    while (!cellQueue.empty() || !blockQueue.empty()) {
+        while (!cellQueue.empty()) {
+            GridIndex g = cellQueue.back();
+            cellQueue.pop_back();
+
+            char sign = _bandCells(g).distance > 0.0 ? 1 : -1;
+            _getNeighbourGridIndices6(g, ns);
+            for (int j = 0; j < 6; j++) {
+                if (Grid3d::isGridIndexInRange(ns[j], _isize, _jsize, _ksize)) {
+                    _floodFillCell(ns[j], sign, cellQueue, blockQueue);
+                }
+            }
+        }
+
+        while (!blockQueue.empty()) {
+            GridIndex b = blockQueue.back();
+            blockQueue.pop_back();
+
+            char sign = _blockSigns(b);
+            _getNeighbourGridIndices6(b, ns);
+            for (int j = 0; j < 6; j++) {
+                if (Grid3d::isGridIndexInRange(ns[j], _bisize, _bjsize, _bksize)) {
+                    _floodFillBlockFace(b, ns[j], sign, cellQueue, blockQueue);
                 }
             }
         }
@@ -300,12 +584,20 @@ void LevelSet::calculateSignedDistanceField() {
 
 void LevelSet::calculateSignedDistanceField(int numLayers) {
     _numLayers = numLayers;
+
+    std::vector<GridIndex> surfaceCells;
+    std::vector<GridIndex> outerLayer;
     _resetSignedDistanceField();
-    _calculateUnsignedSurfaceDistanceSquared();
-    _calculateUnsignedDistanceSquared();
+    _calculateUnsignedSurfaceDistanceSquared(surfaceCells);
+    _calculateUnsignedDistanceSquaredForLayer(0, surfaceCells);
+    if (_isFastSweepingEnabled) {
+        _fastSweepUnsignedDistanceSquared(surfaceCells, outerLayer);
+    } else {
+        _calculateUnsignedDistanceSquared(surfaceCells, outerLayer);
+    }
     _squareRootDistanceField();
     _calculateDistanceFieldSigns();
-    _floodFillMissingSignedDistances();
+    _floodFillMissingSignedDistances(outerLayer);
 }
 
 double LevelSet::_minDistToTriangleSquared(GridIndex g, int tidx) {
@@ -343,7 +635,7 @@ vmath::vec3 LevelSet::_findClosestPointOnSurface(GridIndex g) {
     FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(g, _isize, _jsize, _ksize) && _isDistanceSet(g));
 
     vmath::vec3 tri[3];
-    _surfaceMesh.getTrianglePosition(_indexGrid(g), tri);
+    _surfaceMesh.getTrianglePosition(_getTriangleIndex(g), tri);
     vmath::vec3 p0 =  Grid3d::GridIndexToCellCenter(g, _dx);
     
     return Collision::findClosestPointOnTriangle(p0, tri[0], tri[1], tri[2]);
@@ -365,7 +657,7 @@ vmath::vec3 LevelSet::_findClosestPointOnSurface(vmath::vec3 p) {
         if (Grid3d::isGridIndexInRange(g, _isize, _jsize, _ksize) && 
                 _isDistanceSet(n)) {
             vmath::vec3 surfacePoint;
-            int tidx = _indexGrid(n);
+            int tidx = _getTriangleIndex(n);
 
             if (tidx < 0) {
                 continue;
@@ -400,12 +692,12 @@ vmath::vec3 LevelSet::_findClosestPointOnSurface(vmath::vec3 p, int *tidx) {
         if (Grid3d::isGridIndexInRange(g, _isize, _jsize, _ksize) && 
                 _isDistanceSet(n)) {
             vmath::vec3 surfacePoint;
-            double distsq = _minDistToTriangleSquared(p, _indexGrid(n), &surfacePoint);
+            double distsq = _minDistToTriangleSquared(p, _getTriangleIndex(n), &surfacePoint);
 
             if (distsq < mindistsq) {
                 mindistsq = distsq;
                 minpoint = surfacePoint;
-                mint = _indexGrid(n);
+                mint = _getTriangleIndex(n);
             }
         }
     }
@@ -646,28 +938,28 @@ double LevelSet::_linearInterpolateSignedDistance(vmath::vec3 p) {
 
     double points[8] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
     if (Grid3d::isGridIndexInRange(g.i,   g.j,   g.k, _isize, _jsize, _ksize))   { 
-        points[0] = _signedDistance(g.i,   g.j,   g.k); 
+        points[0] = _getSignedDistanceValue(g.i,   g.j,   g.k); 
     }
     if (Grid3d::isGridIndexInRange(g.i+1, g.j,   g.k, _isize, _jsize, _ksize))   { 
-        points[1] = _signedDistance(g.i+1, g.j,   g.k); 
+        points[1] = _getSignedDistanceValue(g.i+1, g.j,   g.k); 
     }
     if (Grid3d::isGridIndexInRange(g.i,   g.j+1, g.k, _isize, _jsize, _ksize))   { 
-        points[2] = _signedDistance(g.i,   g.j+1, g.k); 
+        points[2] = _getSignedDistanceValue(g.i,   g.j+1, g.k); 
     }
     if (Grid3d::isGridIndexInRange(g.i,   g.j,   g.k+1, _isize, _jsize, _ksize)) {
-        points[3] = _signedDistance(g.i,   g.j,   g.k+1); 
+        points[3] = _getSignedDistanceValue(g.i,   g.j,   g.k+1); 
     }
     if (Grid3d::isGridIndexInRange(g.i+1, g.j,   g.k+1, _isize, _jsize, _ksize)) { 
-        points[4] = _signedDistance(g.i+1, g.j,   g.k+1); 
+        points[4] = _getSignedDistanceValue(g.i+1, g.j,   g.k+1); 
     }
     if (Grid3d::isGridIndexInRange(g.i,   g.j+1, g.k+1, _isize, _jsize, _ksize)) { 
-        points[5] = _signedDistance(g.i,   g.j+1, g.k+1); 
+        points[5] = _getSignedDistanceValue(g.i,   g.j+1, g.k+1); 
     }
     if (Grid3d::isGridIndexInRange(g.i+1, g.j+1, g.k, _isize, _jsize, _ksize))   { 
-        points[6] = _signedDistance(g.i+1, g.j+1, g.k); 
+        points[6] = _getSignedDistanceValue(g.i+1, g.j+1, g.k); 
     }
     if (Grid3d::isGridIndexInRange(g.i+1, g.j+1, g.k+1, _isize, _jsize, _ksize)) { 
-        points[7] = _signedDistance(g.i+1, g.j+1, g.k+1); 
+        points[7] = _getSignedDistanceValue(g.i+1, g.j+1, g.k+1); 
     }
 
     return Interpolation::trilinearInterpolate(points, ix, iy, iz);
@@ -702,8 +994,9 @@ double LevelSet::_cubicInterpolateSignedDistance(vmath::vec3 p) {
     for (int pk = 0; pk < 4; pk++) {
         for (int pj = 0; pj < 4; pj++) {
             for (int pi = 0; pi < 4; pi++) {
-                if (_signedDistance.isIndexInRange(pi + refi, pj + refj, pk + refk)) {
-                    points[pi][pj][pk] = _signedDistance(pi + refi, pj + refj, pk + refk);
+                if (Grid3d::isGridIndexInRange(pi + refi, pj + refj, pk + refk, 
+                                               _isize, _jsize, _ksize)) {
+                    points[pi][pj][pk] = _getSignedDistanceValue(pi + refi, pj + refj, pk + refk);
 
                     if (points[pi][pj][pk] < min) {
                         min = points[pi][pj][pk];
@@ -756,7 +1049,7 @@ double LevelSet::getDistance(GridIndex g) {
         return std::numeric_limits<double>::infinity();
     }
 
-    return fabs(_signedDistance(g));
+    return fabs(_getSignedDistanceValue(g));
 }
 
 double LevelSet::getSignedDistance(GridIndex g) {
@@ -766,7 +1059,7 @@ double LevelSet::getSignedDistance(GridIndex g) {
         return std::numeric_limits<double>::infinity();
     }
 
-    return _signedDistance(g);
+    return _getSignedDistanceValue(g);
 }
 
 bool LevelSet::isPointInInsideCell(vmath::vec3 p) {
@@ -775,7 +1068,7 @@ bool LevelSet::isPointInInsideCell(vmath::vec3 p) {
     GridIndex g = Grid3d::positionToGridIndex(p, _dx);
     FLUIDSIM_ASSERT(_isDistanceSet(g));
 
-    return _signedDistance(g) > 0.0;
+    return _getSignedDistanceValue(g) > 0.0;
 }
 
 bool LevelSet::_isPointInsideSurface(vmath::vec3 p) {
@@ -784,10 +1077,10 @@ bool LevelSet::_isPointInsideSurface(vmath::vec3 p) {
 
 bool LevelSet::_isCellInsideSurface(GridIndex g) {
     FLUIDSIM_ASSERT(_isDistanceSet(g));
-    return _signedDistance(g) > 0.0;
+    return _getSignedDistanceValue(g) > 0.0;
 }
 
 bool LevelSet::_isCellInsideSurface(int i, int j, int k) {
     FLUIDSIM_ASSERT(_isDistanceSet(i, j, k));
-    return _signedDistance(i, j, k) > 0.0;
+    return _getSignedDistanceValue(i, j, k) > 0.0;
 }
\ No newline at end of file
@@ -25,9 +25,12 @@ freely, subject to the following restrictions:
 #include <string>
 #include <vector>
 #include <queue>
+#include <functional>
+#include <limits>
 
 #include "vmath.h"
 #include "array3d.h"
+#include "sparsearray3d.h"
 #include "grid3d.h"
 #include "interpolation.h"
 #include "collision.h"
@@ -35,6 +38,7 @@ freely, subject to the following restrictions:
 #include "macvelocityfield.h"
 #include "gridindexvector.h"
 #include "fluidsimassert.h"
+#include "threadpool.h"
 
 class LevelSet
 {
@@ -43,6 +47,28 @@ public:
     LevelSet(int i, int j, int k, double dx);
     ~LevelSet();
 
+    /*
+        Thread pool used to distribute surface triangles and distance
+        layers when computing the signed distance field. The field is
+        computed serially if no pool is set.
+    */
+    void setThreadPool(ThreadPool *pool);
+
+    /*
+        Enable/disable computing distances within the narrow band by fast 
+        sweeping instead of propagating layer by layer outwards from the 
+        surface.
+
+        Fast sweeping passes closest triangles along diagonal sweep planes
+        in all eight octant directions. Cells on a sweep plane only depend
+        on the previous plane and are split between threads.
+
+        Disabled by default.
+    */
+    void enableFastSweeping();
+    void disableFastSweeping();
+    bool isFastSweepingEnabled();
+
     void setSurfaceMesh(TriangleMesh mesh);
     void calculateSignedDistanceField();
     void calculateSignedDistanceField(int numLayers);
@@ -50,7 +76,7 @@ public:
     double getSurfaceCurvature(vmath::vec3 p);
     double getSurfaceCurvature(vmath::vec3 p, vmath::vec3 *normal);
     double getSurfaceCurvature(unsigned int tidx);
-    Array3d<float> getSignedDistanceField() { return _signedDistance; }
+    Array3d<float> getSignedDistanceField();
     vmath::vec3 getClosestPointOnSurface(vmath::vec3 p);
     vmath::vec3 getClosestPointOnSurface(vmath::vec3 p, int *tidx);
     double getDistance(vmath::vec3 p);
@@ -60,25 +86,90 @@ public:
     bool isPointInInsideCell(vmath::vec3 p);
 
 private:
+    struct SurfaceCellDistance {
+        GridIndex g;
+        float distsq;
+        int tidx;
+    };
+
+    struct BandCell {
+        float distance;
+        int tidx;
+        int layer;
+    };
+
     void _resetSignedDistanceField();
-    void _calculateUnsignedSurfaceDistanceSquared();
-    void _calculateDistancesSquaredForTriangle(int triangleIndex);
+    BandCell _getUnsetBandCell();
+    void _getBlockCellRange(GridIndex b, GridIndex *gmin, GridIndex *gmax);
+    void _calculateUnsignedSurfaceDistanceSquared(std::vector<GridIndex> &surfaceCells);
+    void _calculateDistancesSquaredForTriangle(int triangleIndex, 
+                                               std::vector<SurfaceCellDistance> &distances);
     void _getTriangleGridCellOverlap(Triangle t, GridIndexVector &cells);
-    void _calculateUnsignedDistanceSquared();
-    void _getCellLayers(std::vector<GridIndexVector> &layers);
+    void _calculateUnsignedDistanceSquared(std::vector<GridIndex> &surfaceCells,
+                                           std::vector<GridIndex> &outerLayer);
     void _getNeighbourGridIndices6(GridIndex g, GridIndex n[6]);
-    void _getLayerCells(int idx, GridIndexVector &layer, 
-                                 GridIndexVector &nextLayer,
-                                 Array3d<int> &layerGrid);
-    void _calculateUnsignedDistanceSquaredForLayer(GridIndexVector &q);
-    void _setLevelSetCell(GridIndex g, double dist, int tidx);
-    void _resetLevelSetCell(GridIndex g);
+    void _getLayerCells(int layerIndex, std::vector<GridIndex> &layer, 
+                                        std::vector<GridIndex> &nextLayer);
+    void _getBandCells(std::vector<GridIndex> &surfaceCells,
+                       std::vector<GridIndex> &bandCells,
+                       std::vector<GridIndex> &outerLayer);
+    void _fastSweepUnsignedDistanceSquared(std::vector<GridIndex> &surfaceCells,
+                                           std::vector<GridIndex> &outerLayer);
+    void _sortCellsBySweepPlane(std::vector<GridIndex> &cells, int dj, int dk,
+                                std::vector<GridIndex> &sortedCells,
+                                std::vector<int> &planeOffsets);
+    void _sweepPlanes(std::vector<GridIndex> &sortedCells, 
+                      std::vector<int> &planeOffsets, int di, int dj, int dk);
+    void _sweepCell(GridIndex g, int di, int dj, int dk);
+    void _calculateUnsignedDistanceSquaredForLayer(int layerIndex, 
+                                                   std::vector<GridIndex> &layer);
+    double _getClosestNeighbourTriangle(GridIndex g, int minLayer, int maxLayer, 
+                                        int *tidx);
     void _squareRootDistanceField();
     void _calculateDistanceFieldSigns();
     void _updateCellSign(GridIndex g, std::vector<vmath::vec3> &triangleCenters, 
                                       std::vector<vmath::vec3> &triangleDirections);
-    void _floodFillMissingSignedDistances();
-    void _floodFillWithDistance(GridIndex g, double val);
+    void _floodFillMissingSignedDistances(std::vector<GridIndex> &outerLayer);
+    void _floodFillCell(GridIndex g, char sign, std::vector<GridIndex> &cellQueue,
+                                                std::vector<GridIndex> &blockQueue);
+    void _floodFillBlockFace(GridIndex b, GridIndex nb, char sign, 
+                             std::vector<GridIndex> &cellQueue,
+                             std::vector<GridIndex> &blockQueue);
+    void _parallelForRange(int begin, int end, int grainSize,
+                           std::function<void(int, int)> func);
+
+    inline bool _isDistanceSet(int i, int j, int k) {
+        if (!_bandCells.isElementAllocated(i, j, k)) {
+            return _blockSigns(i / _blockSize, j / _blockSize, k / _blockSize) != 0;
+        }
+        return _bandCells(i, j, k).layer != _unsetCellLayer;
+    }
+
+    inline bool _isDistanceSet(GridIndex g) {
+        return _isDistanceSet(g.i, g.j, g.k);
+    }
+
+    inline float _getSignedDistanceValue(int i, int j, int k) {
+        if (_bandCells.isElementAllocated(i, j, k)) {
+            return _bandCells(i, j, k).distance;
+        }
+
+        char sign = _blockSigns(i / _blockSize, j / _blockSize, k / _blockSize);
+        if (sign > 0) {
+            return std::numeric_limits<float>::infinity();
+        } else if (sign < 0) {
+            return -std::numeric_limits<float>::infinity();
+        }
+        return 0.0f;
+    }
+
+    inline float _getSignedDistanceValue(GridIndex g) {
+        return _getSignedDistanceValue(g.i, g.j, g.k);
+    }
+
+    inline int _getTriangleIndex(GridIndex g) {
+        return _bandCells(g).tidx;
+    }
 
     vmath::vec3 _findClosestPointOnSurface(GridIndex g);
     vmath::vec3 _findClosestPointOnSurface(vmath::vec3 p);
@@ -111,9 +202,31 @@ private:
 
     TriangleMesh _surfaceMesh;
 
-    Array3d<float> _signedDistance;
-    Array3d<int> _indexGrid;
-    Array3d<bool> _isDistanceSet;
+    /*
+        Distances are only stored in a narrow band around the surface. The
+        band cells are held in a sparse grid that allocates the blocks 
+        containing band cells. Blocks outside of the band only record 
+        whether they are inside or outside of the surface.
+        Blocks are only allocated by the serial passes of the calculation, 
+        so the parallel passes may read and write cells of allocated blocks.
+    */
+    static const int _unsetCellLayer = -1;
+    static const int _farCellLayer = -2;
+
+    int _blockSize = SparseArray3d<BandCell>::getBlockSize();
+    int _bisize = 0;
+    int _bjsize = 0;
+    int _bksize = 0;
+    Array3d<char> _blockSigns;
+    SparseArray3d<BandCell> _bandCells;
+
+    ThreadPool *_threadPool = nullptr;
+    int _triangleGrainSize = 256;
+    int _layerGrainSize = 1024;
+    int _blockGrainSize = 4;
+    int _maxLayerRelaxationIterations = 1;
+    bool _isFastSweepingEnabled = false;
+    int _numFastSweepingIterations = 1;
 
     std::vector<double> _vertexCurvatures;
     double _surfaceCurvatureSampleRadius = 6.0;  // radius in # of cells
@@ -0,0 +1,45 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "markerparticlevector.h"
+
+MarkerParticleVector::MarkerParticleVector() {
+}
+
+MarkerParticleVector::~MarkerParticleVector() {
+}
+
+MarkerParticle MarkerParticleVector::operator[](int i) {
+    FLUIDSIM_ASSERT(i >= 0 && i < (int)_positions.size());
+    return MarkerParticle(_positions[i], _velocities[i]);
+}
+
+void MarkerParticleVector::getPositions(int startidx, int endidx, 
+                                        std::vector<vmath::vec3> &positions) {
+    FLUIDSIM_ASSERT(startidx >= 0 && startidx <= endidx && endidx <= (int)_positions.size());
+    positions.insert(positions.end(), _positions.begin() + startidx, 
+                                      _positions.begin() + endidx);
+}
+
+void MarkerParticleVector::getVelocities(int startidx, int endidx, 
+                                         std::vector<vmath::vec3> &velocities) {
+    FLUIDSIM_ASSERT(startidx >= 0 && startidx <= endidx && endidx <= (int)_velocities.size());
+    velocities.insert(velocities.end(), _velocities.begin() + startidx, 
+                                        _velocities.begin() + endidx);
+}
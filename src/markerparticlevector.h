@@ -0,0 +1,170 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef MARKERPARTICLEVECTOR_H
+#define MARKERPARTICLEVECTOR_H
+
+#include <vector>
+
+#include "markerparticle.h"
+#include "vmath.h"
+#include "fluidsimassert.h"
+
+/*
+    Stores MarkerParticles as separate contiguous arrays of positions and 
+    velocities. 
+
+    Consumers that only require a single attribute (ParticleAdvector, 
+    CLScalarField, ScalarField) can use the array returned by getPositions() 
+    or getVelocities() directly without first copying the attribute out of 
+    each particle. Both arrays always have the same size.
+*/
+class MarkerParticleVector
+{
+public:
+    MarkerParticleVector();
+    ~MarkerParticleVector();
+
+    inline size_t size() {
+        return _positions.size();
+    }
+
+    inline bool empty() {
+        return _positions.empty();
+    }
+
+    inline void reserve(size_t n) {
+        _positions.reserve(n);
+        _velocities.reserve(n);
+    }
+
+    inline void shrink_to_fit() {
+        _positions.shrink_to_fit();
+        _velocities.shrink_to_fit();
+    }
+
+    MarkerParticle operator[](int i);
+
+    inline MarkerParticle at(int i) {
+        FLUIDSIM_ASSERT(i >= 0 && i < (int)_positions.size());
+        return MarkerParticle(_positions[i], _velocities[i]);
+    }
+
+    inline vmath::vec3 getPosition(int i) {
+        FLUIDSIM_ASSERT(i >= 0 && i < (int)_positions.size());
+        return _positions[i];
+    }
+
+    inline vmath::vec3 getVelocity(int i) {
+        FLUIDSIM_ASSERT(i >= 0 && i < (int)_velocities.size());
+        return _velocities[i];
+    }
+
+    inline void setPosition(int i, vmath::vec3 p) {
+        FLUIDSIM_ASSERT(i >= 0 && i < (int)_positions.size());
+        _positions[i] = p;
+    }
+
+    inline void setVelocity(int i, vmath::vec3 v) {
+        FLUIDSIM_ASSERT(i >= 0 && i < (int)_velocities.size());
+        _velocities[i] = v;
+    }
+
+    inline void push_back(MarkerParticle p) {
+        _positions.push_back(p.position);
+        _velocities.push_back(p.velocity);
+    }
+
+    inline void push_back(vmath::vec3 p, vmath::vec3 v) {
+        _positions.push_back(p);
+        _velocities.push_back(v);
+    }
+
+    inline void pop_back() {
+        FLUIDSIM_ASSERT(!_positions.empty());
+        _positions.pop_back();
+        _velocities.pop_back();
+    }
+
+    inline void swap(int i, int j) {
+        FLUIDSIM_ASSERT(i >= 0 && i < (int)_positions.size());
+        FLUIDSIM_ASSERT(j >= 0 && j < (int)_positions.size());
+        vmath::vec3 temp = _positions[i];
+        _positions[i] = _positions[j];
+        _positions[j] = temp;
+
+        temp = _velocities[i];
+        _velocities[i] = _velocities[j];
+        _velocities[j] = temp;
+    }
+
+    inline void clear() {
+        _positions.clear();
+        _velocities.clear();
+    }
+
+    /*
+        Contiguous attribute arrays. Elements may be read and modified in 
+        place, but the arrays must not be resized through these pointers.
+    */
+    inline std::vector<vmath::vec3>* getPositions() {
+        return &_positions;
+    }
+
+    inline std::vector<vmath::vec3>* getVelocities() {
+        return &_velocities;
+    }
+
+    /*
+        Copies the attribute values of particles in the range 
+        [startidx, endidx) into the end of the output vector.
+    */
+    void getPositions(int startidx, int endidx, std::vector<vmath::vec3> &positions);
+    void getVelocities(int startidx, int endidx, std::vector<vmath::vec3> &velocities);
+
+    /*
+        Removes all particles i where isRemoved[i] is true. The relative 
+        order of the remaining particles is preserved.
+    */
+    template<class T>
+    void removeParticles(std::vector<T> &isRemoved) {
+        FLUIDSIM_ASSERT(_positions.size() == isRemoved.size());
+
+        size_t currentidx = 0;
+        for (size_t i = 0; i < _positions.size(); i++) {
+            if (!isRemoved[i]) {
+                _positions[currentidx] = _positions[i];
+                _velocities[currentidx] = _velocities[i];
+                currentidx++;
+            }
+        }
+
+        _positions.resize(currentidx);
+        _velocities.resize(currentidx);
+        shrink_to_fit();
+    }
+
+private:
+
+    std::vector<vmath::vec3> _positions;
+    std::vector<vmath::vec3> _velocities;
+
+};
+
+#endif
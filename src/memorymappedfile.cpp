@@ -0,0 +1,159 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "memorymappedfile.h"
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+MemoryMappedFile::MemoryMappedFile() {
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MemoryMappedFile::open(std::string filename) {
+    close();
+
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER filesize;
+    if (!GetFileSizeEx(file, &filesize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    _fileHandle = file;
+    _size = (size_t)filesize.QuadPart;
+    _isOpen = true;
+    if (_size == 0) {
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        close();
+        return false;
+    }
+    _mappingHandle = mapping;
+
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        close();
+        return false;
+    }
+    _data = (const char *)data;
+
+    return true;
+}
+
+void MemoryMappedFile::close() {
+    if (_data != nullptr) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mappingHandle != nullptr) {
+        CloseHandle((HANDLE)_mappingHandle);
+    }
+    if (_fileHandle != nullptr) {
+        CloseHandle((HANDLE)_fileHandle);
+    }
+
+    _data = nullptr;
+    _mappingHandle = nullptr;
+    _fileHandle = nullptr;
+    _size = 0;
+    _isOpen = false;
+}
+
+#else
+
+bool MemoryMappedFile::open(std::string filename) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat filestat;
+    if (fstat(fd, &filestat) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    _fd = fd;
+    _size = (size_t)filestat.st_size;
+    _isOpen = true;
+    if (_size == 0) {
+        return true;
+    }
+
+    void *data = mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close();
+        return false;
+    }
+    _data = (const char *)data;
+
+    return true;
+}
+
+void MemoryMappedFile::close() {
+    if (_data != nullptr) {
+        munmap((void *)_data, _size);
+    }
+    if (_fd != -1) {
+        ::close(_fd);
+    }
+
+    _data = nullptr;
+    _fd = -1;
+    _size = 0;
+    _isOpen = false;
+}
+
+#endif
+
+bool MemoryMappedFile::isOpen() {
+    return _isOpen;
+}
+
+const char* MemoryMappedFile::getData() {
+    return _data;
+}
+
+size_t MemoryMappedFile::getSize() {
+    return _size;
+}
@@ -0,0 +1,64 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef MEMORYMAPPEDFILE_H
+#define MEMORYMAPPEDFILE_H
+
+#include <string>
+#include <stddef.h>
+
+/*
+    Read-only view of a file mapped into memory.
+
+    The contents of the file are paged in by the operating system as they 
+    are accessed, so opening a large file is fast and data that is never 
+    read is never loaded. The data pointer remains valid until the file is 
+    closed.
+*/
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile();
+    ~MemoryMappedFile();
+
+    bool open(std::string filename);
+    void close();
+    bool isOpen();
+
+    const char* getData();
+    size_t getSize();
+
+private:
+
+    MemoryMappedFile(const MemoryMappedFile &) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile &) = delete;
+
+    const char *_data = nullptr;
+    size_t _size = 0;
+    bool _isOpen = false;
+
+    // POSIX file descriptor
+    int _fd = -1;
+
+    // Windows file and file mapping handles
+    void *_fileHandle = nullptr;
+    void *_mappingHandle = nullptr;
+};
+
+#endif
@@ -0,0 +1,401 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "multigridpreconditioner.h"
+
+MultigridPreconditioner::MultigridPreconditioner() {
+}
+
+MultigridPreconditioner::~MultigridPreconditioner() {
+}
+
+void MultigridPreconditioner::initialize(FluidMaterialGrid *materialGrid, 
+                                         GridIndexVector *fluidCells,
+                                         ThreadPool *threadPool) {
+    _fluidCells = fluidCells;
+    _threadPool = threadPool;
+    _initializeLevels(materialGrid);
+}
+
+void MultigridPreconditioner::apply(std::vector<double> &residual, 
+                                    std::vector<double> &result) {
+    FLUIDSIM_ASSERT(residual.size() == _fluidCells->size() &&
+                    result.size() == _fluidCells->size());
+
+    if (_levels.empty()) {
+        return;
+    }
+
+    MultigridLevel *finest = &(_levels[0]);
+    for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
+        finest->b[_fluidCells->getFlatIndex(idx)] = (float)residual[idx];
+    }
+
+    _vcycle(0);
+
+    for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
+        result[idx] = (double)finest->x[_fluidCells->getFlatIndex(idx)];
+    }
+}
+
+int MultigridPreconditioner::getNumLevels() {
+    return (int)_levels.size();
+}
+
+void MultigridPreconditioner::_initializeLevels(FluidMaterialGrid *materialGrid) {
+    _levels.clear();
+    _levels.reserve(_maxNumLevels);
+
+    _levels.push_back(MultigridLevel());
+    MultigridLevel &finest = _levels.back();
+    finest.isize = materialGrid->width;
+    finest.jsize = materialGrid->height;
+    finest.ksize = materialGrid->depth;
+    finest.materials = std::vector<Material>(finest.isize*finest.jsize*finest.ksize);
+    _parallelForRows(finest, [this, &finest, materialGrid](int begin, int end) {
+        for (int row = begin; row < end; row++) {
+            int j = row % finest.jsize;
+            int k = row / finest.jsize;
+            for (int i = 0; i < finest.isize; i++) {
+                finest.materials[_getFlatIndex(finest, i, j, k)] = (*materialGrid)(i, j, k);
+            }
+        }
+    });
+    _initializeLevelStencil(finest);
+
+    while ((int)_levels.size() < _maxNumLevels) {
+        MultigridLevel *fine = &(_levels.back());
+        if ((fine->isize + 1) / 2 < _minLevelDimension || 
+                (fine->jsize + 1) / 2 < _minLevelDimension || 
+                (fine->ksize + 1) / 2 < _minLevelDimension ||
+                _getNumUnknowns(*fine) <= _minLevelUnknowns) {
+            break;
+        }
+
+        _levels.push_back(MultigridLevel());
+        fine = &(_levels[_levels.size() - 2]);
+        MultigridLevel &coarse = _levels.back();
+        _initializeCoarseLevel(*fine, coarse);
+        if (_getNumUnknowns(coarse) == 0) {
+            _levels.pop_back();
+            break;
+        }
+    }
+}
+
+void MultigridPreconditioner::_initializeCoarseLevel(MultigridLevel &fine, 
+                                                     MultigridLevel &coarse) {
+    coarse.isize = (fine.isize + 1) / 2;
+    coarse.jsize = (fine.jsize + 1) / 2;
+    coarse.ksize = (fine.ksize + 1) / 2;
+    coarse.materials = std::vector<Material>(coarse.isize*coarse.jsize*coarse.ksize);
+
+    _parallelForRows(coarse, [this, &fine, &coarse](int begin, int end) {
+        for (int row = begin; row < end; row++) {
+            int cj = row % coarse.jsize;
+            int ck = row / coarse.jsize;
+            for (int ci = 0; ci < coarse.isize; ci++) {
+                bool isAir = false;
+                bool isFluid = false;
+                for (int k = 2*ck; k <= 2*ck + 1 && k < fine.ksize; k++) {
+                    for (int j = 2*cj; j <= 2*cj + 1 && j < fine.jsize; j++) {
+                        for (int i = 2*ci; i <= 2*ci + 1 && i < fine.isize; i++) {
+                            Material m = fine.materials[_getFlatIndex(fine, i, j, k)];
+                            isAir = isAir || m == Material::air;
+                            isFluid = isFluid || m == Material::fluid;
+                        }
+                    }
+                }
+
+                Material m = Material::solid;
+                if (isAir) {
+                    m = Material::air;
+                } else if (isFluid) {
+                    m = Material::fluid;
+                }
+                coarse.materials[_getFlatIndex(coarse, ci, cj, ck)] = m;
+            }
+        }
+    });
+
+    _initializeLevelStencil(coarse);
+}
+
+void MultigridPreconditioner::_initializeLevelStencil(MultigridLevel &level) {
+    int n = level.isize*level.jsize*level.ksize;
+    level.diag = std::vector<unsigned char>(n, 0);
+    level.neighbourMasks = std::vector<unsigned char>(n, 0);
+    level.x = std::vector<float>(n, 0.0f);
+    level.b = std::vector<float>(n, 0.0f);
+    level.r = std::vector<float>(n, 0.0f);
+
+    _parallelForRows(level, [this, &level](int begin, int end) {
+        GridIndex nbs[6];
+        for (int row = begin; row < end; row++) {
+            int j = row % level.jsize;
+            int k = row / level.jsize;
+            for (int i = 0; i < level.isize; i++) {
+                int flatidx = _getFlatIndex(level, i, j, k);
+                if (level.materials[flatidx] != Material::fluid) {
+                    continue;
+                }
+
+                unsigned char diag = 0;
+                unsigned char mask = 0;
+                Grid3d::getNeighbourGridIndices6(i, j, k, nbs);
+                for (int nidx = 0; nidx < 6; nidx++) {
+                    GridIndex g = nbs[nidx];
+                    if (!Grid3d::isGridIndexInRange(g, level.isize, level.jsize, level.ksize)) {
+                        continue;
+                    }
+
+                    Material m = level.materials[_getFlatIndex(level, g.i, g.j, g.k)];
+                    if (m != Material::solid) {
+                        diag++;
+                    }
+                    if (m == Material::fluid) {
+                        mask |= (unsigned char)(1 << nidx);
+                    }
+                }
+
+                level.diag[flatidx] = diag;
+                level.neighbourMasks[flatidx] = mask;
+            }
+        }
+    });
+}
+
+int MultigridPreconditioner::_getNumUnknowns(MultigridLevel &level) {
+    int count = 0;
+    for (unsigned int i = 0; i < level.diag.size(); i++) {
+        if (level.diag[i] != 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void MultigridPreconditioner::_vcycle(int levelidx) {
+    MultigridLevel *level = &(_levels[levelidx]);
+    std::fill(level->x.begin(), level->x.end(), 0.0f);
+
+    if (levelidx == (int)_levels.size() - 1) {
+        for (int i = 0; i < _numCoarseSmoothingIterations; i++) {
+            _smooth(*level, 0);
+            _smooth(*level, 1);
+        }
+        for (int i = 0; i < _numCoarseSmoothingIterations; i++) {
+            _smooth(*level, 1);
+            _smooth(*level, 0);
+        }
+        return;
+    }
+
+    for (int i = 0; i < _numPreSmoothingIterations; i++) {
+        _smooth(*level, 0);
+        _smooth(*level, 1);
+    }
+
+    _computeResidual(*level);
+    _restrict(*level, _levels[levelidx + 1]);
+    _vcycle(levelidx + 1);
+    _prolongateAndCorrect(_levels[levelidx + 1], *level);
+
+    // Post smoothing is done in reverse color order to keep the
+    // V-cycle symmetric
+    for (int i = 0; i < _numPostSmoothingIterations; i++) {
+        _smooth(*level, 1);
+        _smooth(*level, 0);
+    }
+}
+
+void MultigridPreconditioner::_smooth(MultigridLevel &level, int color) {
+    int offsets[6] = {-1, 1, -level.isize, level.isize, 
+                      -level.isize*level.jsize, level.isize*level.jsize};
+
+    _parallelForRows(level, [this, &level, &offsets, color](int begin, int end) {
+        for (int row = begin; row < end; row++) {
+            int j = row % level.jsize;
+            int k = row / level.jsize;
+            int rowidx = _getFlatIndex(level, 0, j, k);
+            for (int i = (color + j + k) & 1; i < level.isize; i += 2) {
+                int flatidx = rowidx + i;
+                unsigned char diag = level.diag[flatidx];
+                if (diag == 0) {
+                    continue;
+                }
+
+                unsigned char mask = level.neighbourMasks[flatidx];
+                float sum = level.b[flatidx];
+                for (int nidx = 0; nidx < 6; nidx++) {
+                    if (mask & (1 << nidx)) {
+                        sum += level.x[flatidx + offsets[nidx]];
+                    }
+                }
+                level.x[flatidx] = sum / (float)diag;
+            }
+        }
+    });
+}
+
+void MultigridPreconditioner::_computeResidual(MultigridLevel &level) {
+    int offsets[6] = {-1, 1, -level.isize, level.isize, 
+                      -level.isize*level.jsize, level.isize*level.jsize};
+
+    _parallelForRows(level, [this, &level, &offsets](int begin, int end) {
+        for (int row = begin; row < end; row++) {
+            int j = row % level.jsize;
+            int k = row / level.jsize;
+            int rowidx = _getFlatIndex(level, 0, j, k);
+            for (int i = 0; i < level.isize; i++) {
+                int flatidx = rowidx + i;
+                unsigned char diag = level.diag[flatidx];
+                if (diag == 0) {
+                    level.r[flatidx] = 0.0f;
+                    continue;
+                }
+
+                unsigned char mask = level.neighbourMasks[flatidx];
+                float sum = 0.0f;
+                for (int nidx = 0; nidx < 6; nidx++) {
+                    if (mask & (1 << nidx)) {
+                        sum += level.x[flatidx + offsets[nidx]];
+                    }
+                }
+                level.r[flatidx] = level.b[flatidx] - ((float)diag*level.x[flatidx] - sum);
+            }
+        }
+    });
+}
+
+/*
+    Trilinear restriction. Each coarse cell gathers the residual of the 
+    4x4x4 block of fine cells centered on its children with 1D weights 
+    (1, 3, 3, 1) / 8. The restricted residual is scaled by 4 to account for
+    the doubled cell width of the coarse level.
+*/
+void MultigridPreconditioner::_restrict(MultigridLevel &fine, MultigridLevel &coarse) {
+    const float weights[4] = {0.125f, 0.375f, 0.375f, 0.125f};
+
+    _parallelForRows(coarse, [this, &fine, &coarse, &weights](int begin, int end) {
+        for (int row = begin; row < end; row++) {
+            int cj = row % coarse.jsize;
+            int ck = row / coarse.jsize;
+            for (int ci = 0; ci < coarse.isize; ci++) {
+                int cflatidx = _getFlatIndex(coarse, ci, cj, ck);
+                if (coarse.diag[cflatidx] == 0) {
+                    continue;
+                }
+
+                float sum = 0.0f;
+                for (int kk = 0; kk < 4; kk++) {
+                    int k = 2*ck - 1 + kk;
+                    if (k < 0 || k >= fine.ksize) {
+                        continue;
+                    }
+                    for (int jj = 0; jj < 4; jj++) {
+                        int j = 2*cj - 1 + jj;
+                        if (j < 0 || j >= fine.jsize) {
+                            continue;
+                        }
+
+                        float wjk = weights[jj]*weights[kk];
+                        int rowidx = _getFlatIndex(fine, 0, j, k);
+                        for (int ii = 0; ii < 4; ii++) {
+                            int i = 2*ci - 1 + ii;
+                            if (i < 0 || i >= fine.isize) {
+                                continue;
+                            }
+                            sum += wjk*weights[ii]*fine.r[rowidx + i];
+                        }
+                    }
+                }
+
+                coarse.b[cflatidx] = 4.0f*sum;
+            }
+        }
+    });
+}
+
+/*
+    Trilinear prolongation. Each fine cell interpolates the coarse 
+    correction from its parent (weight 3/4 per dimension) and the adjacent 
+    coarse cell on the side of the fine cell (weight 1/4 per dimension).
+*/
+void MultigridPreconditioner::_prolongateAndCorrect(MultigridLevel &coarse, 
+                                                    MultigridLevel &fine) {
+    _parallelForRows(fine, [this, &fine, &coarse](int begin, int end) {
+        int cis[2], cjs[2], cks[2];
+        float wis[2], wjs[2], wks[2];
+        for (int row = begin; row < end; row++) {
+            int j = row % fine.jsize;
+            int k = row / fine.jsize;
+            int rowidx = _getFlatIndex(fine, 0, j, k);
+
+            cjs[0] = j / 2; cjs[1] = j % 2 == 0 ? j / 2 - 1 : j / 2 + 1;
+            cks[0] = k / 2; cks[1] = k % 2 == 0 ? k / 2 - 1 : k / 2 + 1;
+            wjs[0] = 0.75f; wjs[1] = (cjs[1] >= 0 && cjs[1] < coarse.jsize) ? 0.25f : 0.0f;
+            wks[0] = 0.75f; wks[1] = (cks[1] >= 0 && cks[1] < coarse.ksize) ? 0.25f : 0.0f;
+
+            for (int i = 0; i < fine.isize; i++) {
+                int flatidx = rowidx + i;
+                if (fine.diag[flatidx] == 0) {
+                    continue;
+                }
+
+                cis[0] = i / 2; cis[1] = i % 2 == 0 ? i / 2 - 1 : i / 2 + 1;
+                wis[0] = 0.75f; wis[1] = (cis[1] >= 0 && cis[1] < coarse.isize) ? 0.25f : 0.0f;
+
+                float sum = 0.0f;
+                for (int kk = 0; kk < 2; kk++) {
+                    if (wks[kk] == 0.0f) {
+                        continue;
+                    }
+                    for (int jj = 0; jj < 2; jj++) {
+                        if (wjs[jj] == 0.0f) {
+                            continue;
+                        }
+                        float wjk = wjs[jj]*wks[kk];
+                        int crowidx = _getFlatIndex(coarse, 0, cjs[jj], cks[kk]);
+                        for (int ii = 0; ii < 2; ii++) {
+                            if (wis[ii] == 0.0f) {
+                                continue;
+                            }
+                            sum += wjk*wis[ii]*coarse.x[crowidx + cis[ii]];
+                        }
+                    }
+                }
+
+                fine.x[flatidx] += sum;
+            }
+        }
+    });
+}
+
+void MultigridPreconditioner::_parallelForRows(MultigridLevel &level, 
+                                               std::function<void(int, int)> func) {
+    int numRows = level.jsize*level.ksize;
+    if (_threadPool == nullptr || numRows < 2*_minRowsPerTask) {
+        func(0, numRows);
+        return;
+    }
+
+    int grainSize = std::max(_minRowsPerTask, numRows / (4*_threadPool->getNumThreads()) + 1);
+    _threadPool->parallelForRange(0, numRows, grainSize, func);
+}
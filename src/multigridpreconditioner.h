@@ -0,0 +1,116 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef MULTIGRIDPRECONDITIONER_H
+#define MULTIGRIDPRECONDITIONER_H
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+
+#include "fluidmaterialgrid.h"
+#include "gridindexvector.h"
+#include "grid3d.h"
+#include "threadpool.h"
+#include "fluidsimassert.h"
+
+/*
+    One level of the multigrid hierarchy. Values are stored densely over the
+    full level dimensions and indexed by flat grid index.
+
+    diag holds the number of non-solid neighbours of an unknown cell and is 
+    zero for cells that are not unknowns. Bit n of a cell's neighbour mask 
+    is set if the nth neighbour (in the order of 
+    Grid3d::getNeighbourGridIndices6) is an unknown.
+*/
+struct MultigridLevel {
+    int isize = 0;
+    int jsize = 0;
+    int ksize = 0;
+
+    std::vector<Material> materials;
+    std::vector<unsigned char> diag;
+    std::vector<unsigned char> neighbourMasks;
+    std::vector<float> x;
+    std::vector<float> b;
+    std::vector<float> r;
+};
+
+/*
+    Geometric multigrid V-cycle used as a preconditioner for the pressure 
+    system. The finest level matches the dimensions of the FluidMaterialGrid.
+    A coarse cell is an air cell if any of its children are air, a fluid 
+    cell if any of its remaining children are fluid, and a solid cell 
+    otherwise.
+
+    Smoothing is done with red-black Gauss-Seidel and grid transfers use
+    trilinear restriction with prolongation equal to its scaled transpose,
+    so that the V-cycle is a symmetric operator suitable for use within 
+    conjugate gradient.
+
+    apply() approximately solves L*z = r, where L is the unscaled Poisson 
+    matrix with integer diagonal entries equal to the number of non-solid 
+    neighbours and off diagonal entries of -1 between fluid cells.
+*/
+class MultigridPreconditioner
+{
+public:
+    MultigridPreconditioner();
+    ~MultigridPreconditioner();
+
+    void initialize(FluidMaterialGrid *materialGrid, 
+                    GridIndexVector *fluidCells,
+                    ThreadPool *threadPool);
+    void apply(std::vector<double> &residual, std::vector<double> &result);
+    int getNumLevels();
+
+private:
+
+    void _initializeLevels(FluidMaterialGrid *materialGrid);
+    void _initializeCoarseLevel(MultigridLevel &fine, MultigridLevel &coarse);
+    void _initializeLevelStencil(MultigridLevel &level);
+    int _getNumUnknowns(MultigridLevel &level);
+
+    void _vcycle(int levelidx);
+    void _smooth(MultigridLevel &level, int color);
+    void _computeResidual(MultigridLevel &level);
+    void _restrict(MultigridLevel &fine, MultigridLevel &coarse);
+    void _prolongateAndCorrect(MultigridLevel &coarse, MultigridLevel &fine);
+
+    void _parallelForRows(MultigridLevel &level, std::function<void(int, int)> func);
+
+    inline int _getFlatIndex(MultigridLevel &level, int i, int j, int k) {
+        return i + level.isize*(j + level.jsize*k);
+    }
+
+    int _maxNumLevels = 10;
+    int _minLevelDimension = 4;
+    int _minLevelUnknowns = 512;
+    int _numPreSmoothingIterations = 2;
+    int _numPostSmoothingIterations = 2;
+    int _numCoarseSmoothingIterations = 20;
+    int _minRowsPerTask = 16;
+
+    std::vector<MultigridLevel> _levels;
+    GridIndexVector *_fluidCells;
+    ThreadPool *_threadPool = nullptr;
+
+};
+
+#endif
@@ -0,0 +1,406 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifdef __GNUC__
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+#include "opencldevice.h"
+
+OpenCLDevice::OpenCLDevice() {
+}
+
+OpenCLDevice::~OpenCLDevice() {
+}
+
+bool OpenCLDevice::isOpenCLAvailable() {
+    #if CONFIG_WITH_OPENCL
+        return true;
+    #else
+        return false;
+    #endif
+}
+
+bool OpenCLDevice::isInitialized() {
+    return _isInitialized;
+}
+
+#if CONFIG_WITH_OPENCL
+
+bool OpenCLDevice::initialize() {
+    cl_int err;
+    cl::Context context = _getCLContext(&err);
+    if (err != CL_SUCCESS) {
+        return false;
+    }
+
+    cl::Device device = _getCLDevice(context, &err);
+    if (err != CL_SUCCESS) {
+        return false;
+    }
+    _CLContext = context;
+    _CLDevice = device;
+    _deviceInfo = _initializeDeviceInfo(device);
+
+    err = _initializeCLCommandQueue();
+    if (err != CL_SUCCESS) {
+        return false;
+    }
+
+    _isInitialized = true;
+    return true;
+}
+
+void OpenCLDevice::setDevicePreference(std::string devtype) {
+    std::transform(devtype.begin(), devtype.end(), devtype.begin(), ::tolower);
+
+    if (devtype == "gpu") {
+        setDevicePreferenceGPU();
+    } else if (devtype == "cpu") {
+        setDevicePreferenceCPU();
+    }
+}
+
+void OpenCLDevice::setDevicePreferenceGPU() {
+    _devicePreference1 = CL_DEVICE_TYPE_GPU;
+    _devicePreference2 = CL_DEVICE_TYPE_CPU;
+}
+
+void OpenCLDevice::setDevicePreferenceCPU() {
+    _devicePreference1 = CL_DEVICE_TYPE_CPU;
+    _devicePreference2 = CL_DEVICE_TYPE_GPU;
+}
+
+void OpenCLDevice::printDeviceInfo() {
+    if (!_isInitialized) {
+        return;
+    }
+
+    std::cout << getDeviceInfo();
+}
+
+std::string OpenCLDevice::getDeviceInfo() {
+    std::ostringstream ss;
+    if (!_isInitialized) {
+        return ss.str();
+    }
+
+    ss << "CL_DEVICE_NAME:                " << 
+          _deviceInfo.cl_device_name << std::endl;
+    ss << "CL_DEVICE_VENDOR:              " << 
+          _deviceInfo.cl_device_vendor << std::endl;
+    ss << "CL_DEVICE_VERSION:             " << 
+          _deviceInfo.cl_device_version << std::endl;
+    ss << "CL_DRIVER_VERSION:             " << 
+           _deviceInfo.cl_driver_version << std::endl;
+    ss << "CL_DEVICE_OPENCL_C_VERSION:    " << 
+          _deviceInfo.cl_device_opencl_c_version << std::endl;
+
+    std::string type;
+    switch (_deviceInfo.device_type) {
+        case CL_DEVICE_TYPE_CPU:
+            type = "CPU";
+            break;
+        case CL_DEVICE_TYPE_GPU:
+            type = "GPU";
+            break;
+        case CL_DEVICE_TYPE_ACCELERATOR:
+            type = "ACCELERATOR";
+            break;
+        case CL_DEVICE_TYPE_DEFAULT:
+            type = "DEFAULT";
+            break;
+        default:
+            break;
+    }
+    ss << "CL_DEVICE_TYPE:                " << 
+          type << std::endl;
+    ss << "CL_DEVICE_MAX_CLOCK_FREQUENCY: " << 
+          _deviceInfo.cl_device_max_clock_frequency << "MHz" << std::endl;
+    ss << "CL_DEVICE_GLOBAL_MEM_SIZE:     " << 
+          _deviceInfo.cl_device_global_mem_size << std::endl;
+    ss << "CL_DEVICE_LOCAL_MEM_SIZE:      " << 
+          _deviceInfo.cl_device_local_mem_size << std::endl;
+    ss << "CL_DEVICE_MAX_MEM_ALLOC_SIZE:  " << 
+          _deviceInfo.cl_device_max_mem_alloc_size << std::endl;
+    ss << "CL_DEVICE_MAX_WORK_GROUP_SIZE: " << 
+          _deviceInfo.cl_device_max_work_group_size << std::endl;
+
+    GridIndex g = _deviceInfo.cl_device_max_work_item_sizes;
+    ss << "CL_DEVICE_MAX_WORK_ITEM_SIZES: " << g.i << " x " << 
+                                               g.j << " x " << 
+                                               g.k << std::endl;
+    return ss.str();
+}
+
+bool OpenCLDevice::isUsingGPU() {
+    if (!_isInitialized) {
+        return false;
+    }
+    return _deviceInfo.device_type == CL_DEVICE_TYPE_GPU;
+}
+
+bool OpenCLDevice::isUsingCPU() {
+    if (!_isInitialized) {
+        return false;
+    }
+    return _deviceInfo.device_type == CL_DEVICE_TYPE_CPU;
+}
+
+cl::Context& OpenCLDevice::getContext() {
+    FLUIDSIM_ASSERT(_isInitialized);
+    return _CLContext;
+}
+
+cl::Device& OpenCLDevice::getDevice() {
+    FLUIDSIM_ASSERT(_isInitialized);
+    return _CLDevice;
+}
+
+cl::CommandQueue& OpenCLDevice::getCommandQueue() {
+    FLUIDSIM_ASSERT(_isInitialized);
+    return _CLQueue;
+}
+
+OpenCLDevice::CLDeviceInfo OpenCLDevice::getCLDeviceInfo() {
+    FLUIDSIM_ASSERT(_isInitialized);
+    return _deviceInfo;
+}
+
+cl_int OpenCLDevice::buildKernels(std::string programSource, 
+                                  std::vector<std::string> &kernelNames,
+                                  std::vector<cl::Kernel> &kernels) {
+    FLUIDSIM_ASSERT(_isInitialized);
+
+    std::string prog = programSource;
+    cl::Program::Sources source(1, std::make_pair(prog.c_str(), prog.length()+1));
+    cl::Program program(_CLContext, source);
+
+    std::vector<cl::Device> devices = _CLContext.getInfo<CL_CONTEXT_DEVICES>();
+
+    cl_int err = program.build(devices, "");
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+
+    kernels.clear();
+    for (unsigned int i = 0; i < kernelNames.size(); i++) {
+        cl::Kernel kernel(program, kernelNames[i].c_str(), &err);
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+        kernels.push_back(kernel);
+    }
+
+    return CL_SUCCESS;
+}
+
+OpenCLDevice::CLKernelInfo OpenCLDevice::getKernelInfo(cl::Kernel &kernel) {
+    CLKernelInfo info;
+
+    kernel.getInfo(CL_KERNEL_FUNCTION_NAME, &(info.cl_kernel_function_name));
+    kernel.getInfo(CL_KERNEL_ATTRIBUTES, &(info.cl_kernel_attributes));
+
+    clGetKernelInfo (kernel(), CL_KERNEL_NUM_ARGS,
+                     sizeof(cl_ulong), &(info.cl_kernel_num_args), NULL);
+    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_WORK_GROUP_SIZE,
+                             sizeof(size_t), &(info.cl_kernel_work_group_size), NULL);
+    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_LOCAL_MEM_SIZE,
+                             sizeof(cl_ulong), &(info.cl_kernel_local_mem_size), NULL);
+    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_PRIVATE_MEM_SIZE,
+                             sizeof(cl_ulong), &(info.cl_kernel_private_mem_size), NULL);
+    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                             sizeof(size_t), &(info.cl_kernel_preferred_work_group_size_multiple), NULL);
+    return info;
+}
+
+std::string OpenCLDevice::getKernelInfoString(CLKernelInfo &info) {
+    std::ostringstream ss;
+    if (!_isInitialized) {
+        return ss.str();
+    }
+
+    ss << "CL_KERNEL_FUNCTION_NAME:                      " << 
+          info.cl_kernel_function_name << std::endl;
+    ss << "CL_KERNEL_ATTRIBUTES:                        " << 
+          info.cl_kernel_attributes << std::endl;
+
+    ss << "CL_KERNEL_NUM_ARGS:                           " << 
+          info.cl_kernel_num_args << std::endl;
+    ss << "CL_KERNEL_WORK_GROUP_SIZE:                    " << 
+          info.cl_kernel_work_group_size << std::endl;
+    ss << "CL_KERNEL_LOCAL_MEM_SIZE:                     " << 
+          info.cl_kernel_local_mem_size << std::endl;
+    ss << "CL_KERNEL_PRIVATE_MEM_SIZE:                   " << 
+          info.cl_kernel_private_mem_size << std::endl;
+    ss << "CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE: " << 
+          info.cl_kernel_preferred_work_group_size_multiple << std::endl;
+
+    return ss.str();
+}
+
+void OpenCLDevice::checkError(cl_int err, const char * name) {
+    if (err != CL_SUCCESS) {
+        std::cerr << "ERROR: " << name  << " (" << err << ")" << std::endl;
+        FLUIDSIM_ASSERT(err == CL_SUCCESS);
+    }
+}
+
+cl::Context OpenCLDevice::_getCLContext(cl_int *err) {
+    cl::Context context;
+
+    std::vector< cl::Platform > platforms;
+    cl::Platform::get(&platforms);
+
+    if (platforms.size() == 0) {
+        *err = -1;
+        return context;
+    }
+
+    // Try to find a platform with first device preference
+    for (unsigned int i = 0; i < platforms.size(); i++) {
+        cl_context_properties p = (cl_context_properties)(platforms[i]());
+
+        cl_context_properties cprops[3] = {CL_CONTEXT_PLATFORM, p, 0};
+        context = cl::Context(_devicePreference1, cprops, NULL, NULL, err);
+
+        if (*err == CL_SUCCESS) {
+            return context;
+        }
+    }
+
+    // If first preference device not found, try to find a platform with 
+    // second device preference.
+    for (unsigned int i = 0; i < platforms.size(); i++) {
+        cl_context_properties p = (cl_context_properties)(platforms[i]());
+
+        cl_context_properties cprops[3] = {CL_CONTEXT_PLATFORM, p, 0};
+        context = cl::Context(_devicePreference2, cprops, NULL, NULL, err);
+
+        if (*err == CL_SUCCESS) {
+            return context;
+        }
+    }
+
+    *err = -1;
+
+    return context;
+}
+
+cl::Device OpenCLDevice::_getCLDevice(cl::Context &context, cl_int *err) {
+    std::vector<cl::Device> devices;
+    devices = context.getInfo<CL_CONTEXT_DEVICES>();
+
+    if (devices.size() == 0) {
+        *err = -1;
+        return cl::Device();
+    }
+
+    *err = CL_SUCCESS;
+    return devices[0];
+}
+
+OpenCLDevice::CLDeviceInfo OpenCLDevice::_initializeDeviceInfo(cl::Device &device) {
+    CLDeviceInfo info;
+
+    device.getInfo(CL_DEVICE_NAME, &(info.cl_device_name));
+    device.getInfo(CL_DEVICE_VENDOR, &(info.cl_device_vendor));
+    device.getInfo(CL_DEVICE_VERSION, &(info.cl_device_version));
+    device.getInfo(CL_DRIVER_VERSION, &(info.cl_driver_version));
+    device.getInfo(CL_DEVICE_OPENCL_C_VERSION, &(info.cl_device_opencl_c_version));
+
+    clGetDeviceInfo(device(), CL_DEVICE_TYPE, 
+                    sizeof(cl_device_type), &(info.device_type), NULL);
+    clGetDeviceInfo(device(), CL_DEVICE_MAX_CLOCK_FREQUENCY, 
+                    sizeof(cl_uint), &(info.cl_device_max_clock_frequency), NULL);
+    clGetDeviceInfo(device(), CL_DEVICE_GLOBAL_MEM_SIZE, 
+                    sizeof(cl_ulong), &(info.cl_device_global_mem_size), NULL);
+    clGetDeviceInfo(device(), CL_DEVICE_LOCAL_MEM_SIZE, 
+                    sizeof(cl_ulong), &(info.cl_device_local_mem_size), NULL);
+    clGetDeviceInfo(device(), CL_DEVICE_MAX_MEM_ALLOC_SIZE, 
+                    sizeof(cl_ulong), &(info.cl_device_max_mem_alloc_size), NULL);
+    clGetDeviceInfo(device(), CL_DEVICE_MAX_WORK_GROUP_SIZE, 
+                    sizeof(size_t), &(info.cl_device_max_work_group_size), NULL);
+
+    std::vector<size_t> workItemSizes;
+    device.getInfo(CL_DEVICE_MAX_WORK_ITEM_SIZES, &workItemSizes);
+
+    GridIndex groupdims(1, 1, 1);
+    if (workItemSizes.size() >= 1) {
+        groupdims.i = (int)workItemSizes[0];
+    }
+    if (workItemSizes.size() >= 2) {
+        groupdims.j = (int)workItemSizes[1];
+    }
+    if (workItemSizes.size() >= 3) {
+        groupdims.k = (int)workItemSizes[2];
+    }
+    info.cl_device_max_work_item_sizes = groupdims;
+
+    return info;
+}
+
+cl_int OpenCLDevice::_initializeCLCommandQueue() {
+    cl_int err;
+    cl::CommandQueue queue(_CLContext, _CLDevice, 0, &err);
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+
+    _CLQueue = queue;
+
+    return CL_SUCCESS;
+}
+
+#else
+
+bool OpenCLDevice::initialize() {
+    return false;
+}
+
+void OpenCLDevice::setDevicePreference(std::string) {
+}
+
+void OpenCLDevice::setDevicePreferenceGPU() {
+}
+
+void OpenCLDevice::setDevicePreferenceCPU() {
+}
+
+void OpenCLDevice::printDeviceInfo() {
+}
+
+std::string OpenCLDevice::getDeviceInfo() {
+    return std::string();
+}
+
+bool OpenCLDevice::isUsingGPU() {
+    return false;
+}
+
+bool OpenCLDevice::isUsingCPU() {
+    return false;
+}
+
+#endif
+
+#ifdef __GNUC__
+    #pragma GCC diagnostic pop
+#endif
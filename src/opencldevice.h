@@ -0,0 +1,159 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef OPENCLDEVICE_H
+#define OPENCLDEVICE_H
+
+#include "config.h"
+
+#if CONFIG_WITH_OPENCL
+
+#ifdef __GNUC__
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+#ifdef _MSC_VER 
+    #pragma warning(push)
+    #pragma warning(disable : 4996 4512 4510 4512 4610 )
+#endif
+
+#if defined(__APPLE__) || defined(__MACOSX)
+    #include <OpenCL/cl.hpp>
+#else
+    #include <CL/cl.hpp>
+#endif
+
+#ifdef _MSC_VER 
+    #pragma warning(pop)
+#endif
+
+#ifdef __GNUC__
+    #pragma GCC diagnostic pop
+#endif
+
+#endif
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+#include "array3d.h"
+#include "fluidsimassert.h"
+
+/*
+    OpenCL context, device, and command queue shared by the objects that
+    run OpenCL kernels.
+
+    If the library is built without OpenCL support, the device can not be
+    initialized and isOpenCLAvailable() returns false.
+*/
+class OpenCLDevice
+{
+public:
+    OpenCLDevice();
+    ~OpenCLDevice();
+
+    bool initialize();
+    bool isInitialized();
+    static bool isOpenCLAvailable();
+
+    void setDevicePreference(std::string devtype);
+    void setDevicePreferenceGPU();
+    void setDevicePreferenceCPU();
+
+    void printDeviceInfo();
+    std::string getDeviceInfo();
+    bool isUsingGPU();
+    bool isUsingCPU();
+
+#if CONFIG_WITH_OPENCL
+
+    struct CLDeviceInfo {
+        char cl_device_name[4096];
+        char cl_device_vendor[4096];
+        char cl_device_version[4096];
+        char cl_driver_version[4096];
+        char cl_device_opencl_c_version[4096];
+
+        cl_device_type device_type;
+        cl_uint cl_device_max_clock_frequency;
+        cl_ulong cl_device_global_mem_size;
+        cl_ulong cl_device_local_mem_size;
+        cl_ulong cl_device_max_mem_alloc_size;
+        size_t cl_device_max_work_group_size;
+        GridIndex cl_device_max_work_item_sizes;
+    };
+
+    struct CLKernelInfo {
+        char cl_kernel_function_name[4096];
+        char cl_kernel_attributes[4096];
+
+        cl_ulong cl_kernel_num_args;
+        size_t cl_kernel_work_group_size;
+        cl_ulong cl_kernel_local_mem_size;
+        cl_ulong cl_kernel_private_mem_size;
+        size_t cl_kernel_preferred_work_group_size_multiple;
+    };
+
+    cl::Context& getContext();
+    cl::Device& getDevice();
+    cl::CommandQueue& getCommandQueue();
+    CLDeviceInfo getCLDeviceInfo();
+
+    /*
+        Compiles the program source and creates kernels for each of the
+        kernel names. Kernels are returned in the same order as the names.
+    */
+    cl_int buildKernels(std::string programSource, 
+                        std::vector<std::string> &kernelNames,
+                        std::vector<cl::Kernel> &kernels);
+    CLKernelInfo getKernelInfo(cl::Kernel &kernel);
+    std::string getKernelInfoString(CLKernelInfo &info);
+
+    static void checkError(cl_int err, const char * name);
+
+#endif
+
+private:
+
+#if CONFIG_WITH_OPENCL
+
+    cl::Context _getCLContext(cl_int *err);
+    cl::Device _getCLDevice(cl::Context &context, cl_int *err);
+    CLDeviceInfo _initializeDeviceInfo(cl::Device &device);
+    cl_int _initializeCLCommandQueue();
+
+    cl_device_type _devicePreference1 = CL_DEVICE_TYPE_GPU;
+    cl_device_type _devicePreference2 = CL_DEVICE_TYPE_CPU;
+
+    CLDeviceInfo _deviceInfo;
+    cl::Context _CLContext;
+    cl::Device _CLDevice;
+    cl::CommandQueue _CLQueue;
+
+#endif
+
+    bool _isInitialized = false;
+    
+};
+
+#endif
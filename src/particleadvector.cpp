@@ -25,118 +25,38 @@ freely, subject to the following restrictions:
 #include "particleadvector.h"
 
 ParticleAdvector::ParticleAdvector() {
-}
-
-bool ParticleAdvector::initialize() {
-    cl_int err;
-    cl::Context context = _getCLContext(&err);
-    if (err != CL_SUCCESS) {
-        return false;
-    }
-
-    cl::Device device = _getCLDevice(context, &err);
-    if (err != CL_SUCCESS) {
-        return false;
+    if (OpenCLDevice::isOpenCLAvailable()) {
+        _computeBackend = ComputeBackend::opencl;
     }
-    _CLContext = context;
-    _CLDevice = device;
-    _deviceInfo = _initializeDeviceInfo(device);
-    
-    err = _initializeCLKernel();
-    if (err != CL_SUCCESS) {
-        return false;
-    }
-    _kernelInfo = _initializeKernelInfo(_CLKernel);
-
-    err = _initializeCLCommandQueue();
-    if (err != CL_SUCCESS) {
-        return false;
-    }
-
-    _isInitialized = true;
-    return true;
 }
 
-void ParticleAdvector::setDevicePreference(std::string devtype) {
-    std::transform(devtype.begin(), devtype.end(), devtype.begin(), ::tolower);
+bool ParticleAdvector::initialize(OpenCLDevice *device) {
+    _isInitialized = false;
 
-    if (devtype == "gpu") {
-        setDevicePreferenceGPU();
-    } else if (devtype == "cpu") {
-        setDevicePreferenceCPU();
-    }
-}
+    #if CONFIG_WITH_OPENCL
+        if (device == nullptr || !device->isInitialized()) {
+            return false;
+        }
+        _device = device;
+        _deviceInfo = device->getCLDeviceInfo();
+        
+        cl_int err = _initializeCLKernel();
+        if (err != CL_SUCCESS) {
+            return false;
+        }
+        _kernelInfo = device->getKernelInfo(_CLKernel);
+        _bufferPool.initialize(device);
 
-void ParticleAdvector::setDevicePreferenceGPU() {
-    _devicePreference1 = CL_DEVICE_TYPE_GPU;
-    _devicePreference2 = CL_DEVICE_TYPE_CPU;
-}
+        _isInitialized = true;
+    #else
+        (void)device;
+    #endif
 
-void ParticleAdvector::setDevicePreferenceCPU() {
-    _devicePreference1 = CL_DEVICE_TYPE_CPU;
-    _devicePreference2 = CL_DEVICE_TYPE_GPU;
+    return _isInitialized;
 }
 
-void ParticleAdvector::printDeviceInfo() {
-    if (!_isInitialized) {
-        return;
-    }
-
-    std::cout << getDeviceInfo();
-}
-
-std::string ParticleAdvector::getDeviceInfo() {
-    std::ostringstream ss;
-    if (!_isInitialized) {
-        return ss.str();
-    }
-
-    ss << "CL_DEVICE_NAME:                " << 
-          _deviceInfo.cl_device_name << std::endl;
-    ss << "CL_DEVICE_VENDOR:              " << 
-          _deviceInfo.cl_device_vendor << std::endl;
-    ss << "CL_DEVICE_VERSION:             " << 
-          _deviceInfo.cl_device_version << std::endl;
-    ss << "CL_DRIVER_VERSION:             " << 
-           _deviceInfo.cl_driver_version << std::endl;
-    ss << "CL_DEVICE_OPENCL_C_VERSION:    " << 
-          _deviceInfo.cl_device_opencl_c_version << std::endl;
-
-    std::string type;
-    switch (_deviceInfo.device_type) {
-        case CL_DEVICE_TYPE_CPU:
-            type = "CPU";
-            break;
-        case CL_DEVICE_TYPE_GPU:
-            type = "GPU";
-            break;
-        case CL_DEVICE_TYPE_ACCELERATOR:
-            type = "ACCELERATOR";
-            break;
-        case CL_DEVICE_TYPE_DEFAULT:
-            type = "DEFAULT";
-            break;
-        default:
-            break;
-    }
-    ss << "CL_DEVICE_TYPE:                " << 
-          type << std::endl;
-    ss << "CL_DEVICE_MAX_CLOCK_FREQUENCY: " << 
-          _deviceInfo.cl_device_max_clock_frequency << "MHz" << std::endl;
-    ss << "CL_DEVICE_GLOBAL_MEM_SIZE:     " << 
-          _deviceInfo.cl_device_global_mem_size << std::endl;
-    ss << "CL_DEVICE_LOCAL_MEM_SIZE:      " << 
-          _deviceInfo.cl_device_local_mem_size << std::endl;
-    ss << "CL_DEVICE_MAX_MEM_ALLOC_SIZE:  " << 
-          _deviceInfo.cl_device_max_mem_alloc_size << std::endl;
-    ss << "CL_DEVICE_MAX_WORK_GROUP_SIZE: " << 
-          _deviceInfo.cl_device_max_work_group_size << std::endl;
-
-    GridIndex g = _deviceInfo.cl_device_max_work_item_sizes;
-    ss << "CL_DEVICE_MAX_WORK_ITEM_SIZES: " << g.i << " x " << 
-                                               g.j << " x " << 
-                                               g.k << std::endl;
-    return ss.str();
+bool ParticleAdvector::isInitialized() {
+    return _isInitialized;
 }
 
 void ParticleAdvector::printKernelInfo() {
@@ -148,54 +68,40 @@ void ParticleAdvector::printKernelInfo() {
 }
 
 std::string ParticleAdvector::getKernelInfo() {
-    std::ostringstream ss;
     if (!_isInitialized) {
-        return ss.str();
+        return std::string();
     }
 
-    ss << "CL_KERNEL_FUNCTION_NAME:                      " << 
-          _kernelInfo.cl_kernel_function_name << std::endl;
-    ss << "CL_KERNEL_ATTRIBUTES:                        " << 
-          _kernelInfo.cl_kernel_attributes << std::endl;
-
-    ss << "CL_KERNEL_NUM_ARGS:                           " << 
-          _kernelInfo.cl_kernel_num_args << std::endl;
-    ss << "CL_KERNEL_WORK_GROUP_SIZE:                    " << 
-          _kernelInfo.cl_kernel_work_group_size << std::endl;
-    ss << "CL_KERNEL_LOCAL_MEM_SIZE:                     " << 
-          _kernelInfo.cl_kernel_local_mem_size << std::endl;
-    ss << "CL_KERNEL_PRIVATE_MEM_SIZE:                   " << 
-          _kernelInfo.cl_kernel_private_mem_size << std::endl;
-    ss << "CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE: " << 
-          _kernelInfo.cl_kernel_preferred_work_group_size_multiple << std::endl;
-
-    return ss.str();
+    #if CONFIG_WITH_OPENCL
+        return _device->getKernelInfoString(_kernelInfo);
+    #else
+        return std::string();
+    #endif
 }
 
-bool ParticleAdvector::isUsingGPU() {
-    if (!_isInitialized) {
-        return false;
+void ParticleAdvector::setComputeBackend(ComputeBackend backend) {
+    if (backend == ComputeBackend::opencl && !OpenCLDevice::isOpenCLAvailable()) {
+        backend = ComputeBackend::threaded;
     }
-    return _deviceInfo.device_type == CL_DEVICE_TYPE_GPU;
+    _computeBackend = backend;
 }
 
-bool ParticleAdvector::isUsingCPU() {
-    if (!_isInitialized) {
-        return false;
-    }
-    return _deviceInfo.device_type == CL_DEVICE_TYPE_CPU;
+ComputeBackend ParticleAdvector::getComputeBackend() {
+    return _computeBackend;
 }
 
 void ParticleAdvector::disableOpenCL() {
-    _isOpenCLEnabled = false;
+    if (_computeBackend == ComputeBackend::opencl) {
+        _computeBackend = ComputeBackend::threaded;
+    }
 }
 
 void ParticleAdvector::enableOpenCL() {
-    _isOpenCLEnabled = true;
+    setComputeBackend(ComputeBackend::opencl);
 }
 
 bool ParticleAdvector::isOpenCLEnabled() {
-    return _isOpenCLEnabled;
+    return _computeBackend == ComputeBackend::opencl;
 }
 
 int ParticleAdvector::getKernelWorkLoadSize() {
@@ -206,11 +112,18 @@ void ParticleAdvector::setKernelWorkLoadSize(int n) {
     _kernelWorkLoadSize = n;
 }
 
+void ParticleAdvector::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
+}
+
 void ParticleAdvector::advectParticlesRK4(std::vector<vmath::vec3> &particles,
                                           MACVelocityField *vfield, 
                                           double dt,
                                           std::vector<vmath::vec3> &output) {
-    if (!_isOpenCLEnabled) {
+    if (_computeBackend == ComputeBackend::serial) {
+        _advectParticlesSerial(particles, vfield, dt, 4, output);
+        return;
+    } else if (_computeBackend == ComputeBackend::threaded) {
         _advectParticlesRK4NoCL(particles, vfield, dt, output);
         return;
     }
@@ -275,7 +188,10 @@ void ParticleAdvector::advectParticlesRK3(std::vector<vmath::vec3> &particles,
                                           MACVelocityField *vfield, 
                                           double dt,
                                           std::vector<vmath::vec3> &output) {
-    if (!_isOpenCLEnabled) {
+    if (_computeBackend == ComputeBackend::serial) {
+        _advectParticlesSerial(particles, vfield, dt, 3, output);
+        return;
+    } else if (_computeBackend == ComputeBackend::threaded) {
         _advectParticlesRK3NoCL(particles, vfield, dt, output);
         return;
     }
@@ -332,7 +248,10 @@ void ParticleAdvector::advectParticlesRK2(std::vector<vmath::vec3> &particles,
                                           MACVelocityField *vfield, 
                                           double dt,
                                           std::vector<vmath::vec3> &output) {
-    if (!_isOpenCLEnabled) {
+    if (_computeBackend == ComputeBackend::serial) {
+        _advectParticlesSerial(particles, vfield, dt, 2, output);
+        return;
+    } else if (_computeBackend == ComputeBackend::threaded) {
         _advectParticlesRK2NoCL(particles, vfield, dt, output);
         return;
     }
@@ -374,7 +293,10 @@ void ParticleAdvector::advectParticlesRK1(std::vector<vmath::vec3> &particles,
                                           MACVelocityField *vfield, 
                                           double dt,
                                           std::vector<vmath::vec3> &output) {
-    if (!_isOpenCLEnabled) {
+    if (_computeBackend == ComputeBackend::serial) {
+        _advectParticlesSerial(particles, vfield, dt, 1, output);
+        return;
+    } else if (_computeBackend == ComputeBackend::threaded) {
         _advectParticlesRK1NoCL(particles, vfield, dt, output);
         return;
     }
@@ -401,13 +323,18 @@ void ParticleAdvector::advectParticlesRK1(std::vector<vmath::vec3> &particles,
 void ParticleAdvector::tricubicInterpolate(std::vector<vmath::vec3> &particles,
                                            MACVelocityField *vfield,
                                            std::vector<vmath::vec3> &output) {
-    if (!_isOpenCLEnabled) {
+    if (_computeBackend == ComputeBackend::serial) {
+        _tricubicInterpolateSerial(particles, vfield, output);
+        return;
+    } else if (_computeBackend == ComputeBackend::threaded) {
         _tricubicInterpolateNoCL(particles, vfield, output);
         return;
     }
 
     FLUIDSIM_ASSERT(_isInitialized);
 
+    #if CONFIG_WITH_OPENCL
+
     vfield->getGridDimensions(&_isize, &_jsize, &_ksize);
     _dx = vfield->getGridCellSize();
 
@@ -426,203 +353,36 @@ void ParticleAdvector::tricubicInterpolate(std::vector<vmath::vec3> &particles,
     std::vector<DataChunkParameters> chunkParams;
     _getDataChunkParameters(vfield, particleGrid, chunkParams);
 
-    int maxChunks = _getMaxChunksPerComputation();
-    int numComputations = ceil((double)chunkParams.size() / (double) maxChunks);
-
     output.reserve(particles.size());
     for (size_t i = output.size(); i < particles.size(); i++) {
         output.push_back(vmath::vec3());
     }
 
-    std::vector<DataChunkParameters> chunks;
-    for (int i = 0; i < numComputations; i++) {
-        int begidx = i*maxChunks;
-        int endidx = begidx + maxChunks;
-        if (endidx > (int)chunkParams.size()) {
-            endidx = (int)chunkParams.size();
-        }
-
-        std::vector<DataChunkParameters>::iterator beg = chunkParams.begin() + begidx;
-        std::vector<DataChunkParameters>::iterator end = chunkParams.begin() + endidx;
-
-        chunks.clear();
-        chunks.insert(chunks.begin(), beg, end);
-
-        _tricubicInterpolateChunks(chunks, output);
-    }
+    _tricubicInterpolateChunks(chunkParams, output);
 
     _validateOutput(output);
+
+    #endif
 }
 
 void ParticleAdvector::tricubicInterpolate(std::vector<vmath::vec3> &particles,
                                            MACVelocityField *vfield) {
-    if (!_isOpenCLEnabled) {
-        _tricubicInterpolateNoCL(particles, vfield, particles);
-        return;
-    }
-
     tricubicInterpolate(particles, vfield, particles);
 }
 
-void ParticleAdvector::_checkError(cl_int err, const char * name) {
-    if (err != CL_SUCCESS) {
-        std::cerr << "ERROR: " << name  << " (" << err << ")" << std::endl;
-        FLUIDSIM_ASSERT(err == CL_SUCCESS);
-    }
-}
-
-cl::Context ParticleAdvector::_getCLContext(cl_int *err) {
-    cl::Context context;
-
-    std::vector< cl::Platform > platforms;
-    cl::Platform::get(&platforms);
-
-    if (platforms.size() == 0) {
-        *err = -1;
-        return context;
-    }
-
-    // Try to find a platform with first device preference
-    for (unsigned int i = 0; i < platforms.size(); i++) {
-        cl_context_properties p = (cl_context_properties)(platforms[i]());
-
-        cl_context_properties cprops[3] = {CL_CONTEXT_PLATFORM, p, 0};
-        context = cl::Context(_devicePreference1, cprops, NULL, NULL, err);
-
-        if (*err == CL_SUCCESS) {
-            return context;
-        }
-    }
-
-    // If first preference device not found, try to find a platform with 
-    // second device preference.
-    for (unsigned int i = 0; i < platforms.size(); i++) {
-        cl_context_properties p = (cl_context_properties)(platforms[i]());
-
-        cl_context_properties cprops[3] = {CL_CONTEXT_PLATFORM, p, 0};
-        context = cl::Context(_devicePreference2, cprops, NULL, NULL, err);
-
-        if (*err == CL_SUCCESS) {
-            return context;
-        }
-    }
-
-    *err = -1;
-
-    return context;
-}
-
-cl::Device ParticleAdvector::_getCLDevice(cl::Context &context, cl_int *err) {
-    std::vector<cl::Device> devices;
-    devices = context.getInfo<CL_CONTEXT_DEVICES>();
-
-    if (devices.size() == 0) {
-        *err = -1;
-        return cl::Device();
-    }
-
-    *err = CL_SUCCESS;
-    return devices[0];
-}
-
-ParticleAdvector::CLDeviceInfo ParticleAdvector::_initializeDeviceInfo(cl::Device &device) {
-    CLDeviceInfo info;
-
-    device.getInfo(CL_DEVICE_NAME, &(info.cl_device_name));
-    device.getInfo(CL_DEVICE_VENDOR, &(info.cl_device_vendor));
-    device.getInfo(CL_DEVICE_VERSION, &(info.cl_device_version));
-    device.getInfo(CL_DRIVER_VERSION, &(info.cl_driver_version));
-    device.getInfo(CL_DEVICE_OPENCL_C_VERSION, &(info.cl_device_opencl_c_version));
-
-    clGetDeviceInfo(device(), CL_DEVICE_TYPE, 
-                    sizeof(cl_device_type), &(info.device_type), NULL);
-    clGetDeviceInfo(device(), CL_DEVICE_MAX_CLOCK_FREQUENCY, 
-                    sizeof(cl_uint), &(info.cl_device_max_clock_frequency), NULL);
-    clGetDeviceInfo(device(), CL_DEVICE_GLOBAL_MEM_SIZE, 
-                    sizeof(cl_ulong), &(info.cl_device_global_mem_size), NULL);
-    clGetDeviceInfo(device(), CL_DEVICE_LOCAL_MEM_SIZE, 
-                    sizeof(cl_ulong), &(info.cl_device_local_mem_size), NULL);
-    clGetDeviceInfo(device(), CL_DEVICE_MAX_MEM_ALLOC_SIZE, 
-                    sizeof(cl_ulong), &(info.cl_device_max_mem_alloc_size), NULL);
-    clGetDeviceInfo(device(), CL_DEVICE_MAX_WORK_GROUP_SIZE, 
-                    sizeof(size_t), &(info.cl_device_max_work_group_size), NULL);
-
-    std::vector<size_t> workItemSizes;
-    device.getInfo(CL_DEVICE_MAX_WORK_ITEM_SIZES, &workItemSizes);
-
-    GridIndex groupdims(1, 1, 1);
-    if (workItemSizes.size() >= 1) {
-        groupdims.i = (int)workItemSizes[0];
-    }
-    if (workItemSizes.size() >= 2) {
-        groupdims.j = (int)workItemSizes[1];
-    }
-    if (workItemSizes.size() >= 3) {
-        groupdims.k = (int)workItemSizes[2];
-    }
-    info.cl_device_max_work_item_sizes = groupdims;
-
-    return info;
-}
-
-ParticleAdvector::CLKernelInfo ParticleAdvector::_initializeKernelInfo(cl::Kernel &kernel) {
-    CLKernelInfo info;
-
-    kernel.getInfo(CL_KERNEL_FUNCTION_NAME, &(info.cl_kernel_function_name));
-    kernel.getInfo(CL_KERNEL_ATTRIBUTES, &(info.cl_kernel_attributes));
-
-    clGetKernelInfo (kernel(), CL_KERNEL_NUM_ARGS,
-                     sizeof(cl_ulong), &(info.cl_kernel_num_args), NULL);
-    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_WORK_GROUP_SIZE,
-                             sizeof(size_t), &(info.cl_kernel_work_group_size), NULL);
-    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_LOCAL_MEM_SIZE,
-                             sizeof(cl_ulong), &(info.cl_kernel_local_mem_size), NULL);
-    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_PRIVATE_MEM_SIZE,
-                             sizeof(cl_ulong), &(info.cl_kernel_private_mem_size), NULL);
-    clGetKernelWorkGroupInfo(kernel(), _CLDevice(), CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
-                             sizeof(size_t), &(info.cl_kernel_preferred_work_group_size_multiple), NULL);
-    return info;
-}
+#if CONFIG_WITH_OPENCL
 
 cl_int ParticleAdvector::_initializeCLKernel() {
-    std::string prog = Kernels::tricubicinterpolateCL;
-    cl::Program::Sources source(1, std::make_pair(prog.c_str(), prog.length()+1));
-    cl::Program program(_CLContext, source);
-
-    std::vector<cl::Device> devices = _CLContext.getInfo<CL_CONTEXT_DEVICES>();
-
-    cl_int err = program.build(devices, "");
-    if (err != CL_SUCCESS) {
-        return err;
-    }
-
-    cl::Kernel kernel(program, "tricubic_interpolate_kernel", &err);
-    if (err != CL_SUCCESS) {
-        return err;
-    }
+    std::vector<std::string> names;
+    names.push_back("tricubic_interpolate_kernel");
 
-    _CLKernel = kernel;
-
-    return CL_SUCCESS;
-}
-
-std::string ParticleAdvector::_getProgramString(std::string filename) {
-    std::ifstream file(filename);
-    _checkError(file.is_open() ? CL_SUCCESS : -1, filename.c_str());
-    
-    std::string prog(std::istreambuf_iterator<char>(file), (std::istreambuf_iterator<char>()));
-
-    return prog;
-}
-
-cl_int ParticleAdvector::_initializeCLCommandQueue() {
-    cl_int err;
-    cl::CommandQueue queue(_CLContext, _CLDevice, 0, &err);
+    std::vector<cl::Kernel> kernels;
+    cl_int err = _device->buildKernels(Kernels::tricubicinterpolateCL, names, kernels);
     if (err != CL_SUCCESS) {
         return err;
     }
 
-    _CLQueue = queue;
+    _CLKernel = kernels[0];
 
     return CL_SUCCESS;
 }
@@ -802,7 +562,7 @@ void ParticleAdvector::_getDataChunkParameters(MACVelocityField *vfield,
     }
 }
 
-int ParticleAdvector::_getWorkGroupSize(CLDeviceInfo &info) {
+int ParticleAdvector::_getWorkGroupSize(OpenCLDevice::CLDeviceInfo &info) {
     return fmin(info.cl_device_max_work_group_size, _maxItemsPerWorkGroup);
 }
 
@@ -860,118 +620,156 @@ int ParticleAdvector::_getMaxChunksPerComputation() {
     return fmin(hardwareLimit, softwareLimit);
 }
 
+/*
+    Work is split into several computations so that the host can prepare 
+    the data for one computation while the device runs the kernel for 
+    another.
+*/
+int ParticleAdvector::_getChunksPerComputation(int numChunks) {
+    int n = (int)ceil((double)numChunks / (double)_minComputationsPerCall);
+    n = (int)fmax(n, _minChunksPerComputation);
+    return (int)fmin(n, _getMaxChunksPerComputation());
+}
+
 void ParticleAdvector::_tricubicInterpolateChunks(std::vector<DataChunkParameters> &chunks,
                                                   std::vector<vmath::vec3> &output) {
-    DataBuffer buffer;
-    _initializeDataBuffer(chunks, buffer);
+    DataBuffer buffers[2];
+    for (int i = 0; i < 2; i++) {
+        buffers[i].positionDataID = 3*i;
+        buffers[i].vfieldDataID = 3*i + 1;
+        buffers[i].offsetDataID = 3*i + 2;
+    }
+
+    int chunksPerComputation = _getChunksPerComputation((int)chunks.size());
+    int numComputations = ceil((double)chunks.size() / (double)chunksPerComputation);
+
+    for (int i = 0; i < numComputations; i++) {
+        int begidx = i*chunksPerComputation;
+        int endidx = (int)fmin(begidx + chunksPerComputation, chunks.size());
+
+        DataBuffer &buffer = buffers[i % 2];
+        DataBuffer &prevBuffer = buffers[(i + 1) % 2];
+        FLUIDSIM_ASSERT(!buffer.isComputing);
+
+        buffer.chunks.clear();
+        buffer.chunks.insert(buffer.chunks.begin(), 
+                             chunks.begin() + begidx, 
+                             chunks.begin() + endidx);
+        _launchComputation(buffer);
+
+        // The previous computation is read back while the device 
+        // is running the computation that was just launched
+        if (prevBuffer.isComputing) {
+            _finishComputation(prevBuffer, output);
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (buffers[i].isComputing) {
+            _finishComputation(buffers[i], output);
+        }
+    }
+}
+
+void ParticleAdvector::_launchComputation(DataBuffer &buffer) {
+    _initializeDataBuffer(buffer);
+
+    _bufferPool.unmapBuffer(buffer.positionDataID);
+    _bufferPool.unmapBuffer(buffer.vfieldDataID);
+    _bufferPool.unmapBuffer(buffer.offsetDataID);
+
     _setCLKernelArgs(buffer, _dx);
 
     int loadSize = _kernelWorkLoadSize;
     int workGroupSize = _getWorkGroupSize(_deviceInfo);
-    int numWorkItems = (int)chunks.size()*workGroupSize;
-    int numComputations = ceil((double)chunks.size() / (double)loadSize);
+    int numWorkItems = (int)buffer.chunks.size()*workGroupSize;
+    int numLaunches = ceil((double)buffer.chunks.size() / (double)loadSize);
 
-    cl::Event event;
     cl_int err;
-    for (int i = 0; i < numComputations; i++) {
+    for (int i = 0; i < numLaunches; i++) {
         int offset = i * loadSize * workGroupSize;
         int items = (int)fmin(numWorkItems - offset, loadSize * workGroupSize);
         
-        err = _CLQueue.enqueueNDRangeKernel(_CLKernel, 
+        err = _device->getCommandQueue().enqueueNDRangeKernel(_CLKernel, 
                                             cl::NDRange(offset), 
                                             cl::NDRange(items), 
                                             cl::NDRange(workGroupSize), 
                                             NULL, 
-                                            &event);    
-        _checkError(err, "CommandQueue::enqueueNDRangeKernel()");
-    }
-
-    event.wait();
-
-    int dataSize = (int)chunks.size() * _getChunkPositionDataSize();
-    err = _CLQueue.enqueueReadBuffer(buffer.positionDataCL, 
-                                     CL_TRUE, 0, 
-                                     dataSize, 
-                                     (void*)&(buffer.positionDataH[0]));
-    _checkError(err, "CommandQueue::enqueueReadBuffer()");
-
-    _setOutputData(chunks, buffer, output);
+                                            NULL);    
+        OpenCLDevice::checkError(err, "CommandQueue::enqueueNDRangeKernel()");
+    }
+
+    // The queue is in-order, so the buffers are mapped back to the host 
+    // once the kernels have completed. The position map is enqueued last
+    // and its event marks the end of the computation.
+    cl_map_flags writeFlags = CLBufferPool::getWriteMapFlags();
+    _bufferPool.mapBuffer(buffer.vfieldDataID, writeFlags, NULL);
+    _bufferPool.mapBuffer(buffer.offsetDataID, writeFlags, NULL);
+    _bufferPool.mapBuffer(buffer.positionDataID, 
+                          CL_MAP_READ | CL_MAP_WRITE, 
+                          &(buffer.event));
+    buffer.isComputing = true;
 }
 
-void ParticleAdvector::_initializeDataBuffer(std::vector<DataChunkParameters> &chunks,
-                                             DataBuffer &buffer) {
-
-    _getHostPositionDataBuffer(chunks, buffer.positionDataH);
-    _getHostVelocityDataBuffer(chunks, buffer.vfieldDataH);
-    _getHostChunkOffsetDataBuffer(chunks, buffer.offsetDataH);
+void ParticleAdvector::_finishComputation(DataBuffer &buffer, 
+                                          std::vector<vmath::vec3> &output) {
+    cl_int err = buffer.event.wait();
+    OpenCLDevice::checkError(err, "Event::wait()");
 
-    size_t positionDataBytes = buffer.positionDataH.size()*sizeof(vmath::vec3);
-    size_t vfieldDataBytes = buffer.vfieldDataH.size()*sizeof(float);
-    size_t offsetDataBytes = buffer.offsetDataH.size()*sizeof(GridIndex);
+    _setOutputData(buffer, output);
+    buffer.isComputing = false;
+}
 
-    cl_int err;
-    buffer.positionDataCL = cl::Buffer(_CLContext, 
-                                       CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, 
-                                       positionDataBytes, 
-                                       (void*)&(buffer.positionDataH[0]), 
-                                       (cl_int*)&err);
-    _checkError(err, "Creating position data buffer");
-
-    buffer.vfieldDataCL = cl::Buffer(_CLContext, 
-                                      CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
-                                      vfieldDataBytes, 
-                                      (void*)&(buffer.vfieldDataH[0]), 
-                                      &err);
-    _checkError(err, "Creating velocity field data buffer");
-
-    buffer.offsetDataCL = cl::Buffer(_CLContext, 
-                                     CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, 
-                                     offsetDataBytes, 
-                                     (void*)&(buffer.offsetDataH[0]), 
-                                     &err);
-    _checkError(err, "Creating chunk offset data buffer");
+void ParticleAdvector::_initializeDataBuffer(DataBuffer &buffer) {
+    size_t numChunks = buffer.chunks.size();
+    size_t positionDataBytes = numChunks*_getChunkPositionDataSize();
+    size_t vfieldDataBytes = numChunks*_getChunkVelocityDataSize();
+    size_t offsetDataBytes = numChunks*sizeof(GridIndex);
+
+    vmath::vec3 *positionDataH = (vmath::vec3*)_bufferPool.reserve(buffer.positionDataID, 
+                                                                    positionDataBytes, 
+                                                                    CL_MEM_READ_WRITE);
+    float *vfieldDataH = (float*)_bufferPool.reserve(buffer.vfieldDataID, 
+                                                     vfieldDataBytes, 
+                                                     CL_MEM_READ_ONLY);
+    GridIndex *offsetDataH = (GridIndex*)_bufferPool.reserve(buffer.offsetDataID, 
+                                                             offsetDataBytes, 
+                                                             CL_MEM_READ_ONLY);
+
+    _getHostPositionDataBuffer(buffer.chunks, positionDataH);
+    _getHostVelocityDataBuffer(buffer.chunks, vfieldDataH);
+    _getHostChunkOffsetDataBuffer(buffer.chunks, offsetDataH);
 }
 
 void ParticleAdvector::_getHostPositionDataBuffer(std::vector<DataChunkParameters> &chunks,
-                                                  std::vector<vmath::vec3> &buffer) {
+                                                  vmath::vec3 *buffer) {
 
     int groupSize = _getWorkGroupSize(_deviceInfo);
-    int numElements = (int)chunks.size()*groupSize;
-    buffer.reserve(numElements);
 
     DataChunkParameters c;
-    vmath::vec3 p;
     for (unsigned int i = 0; i < chunks.size(); i++) {
         c = chunks[i];
 
-        int numPoints = c.particlesEnd - c.particlesBegin;
-        int numPad = groupSize - numPoints;
-        vmath::vec3 defaultPosition = c.positionOffset;
-
-        buffer.insert(buffer.end(), c.particlesBegin, c.particlesEnd);
-        for (int i = 0; i < numPad; i++) {
-            buffer.push_back(defaultPosition);
-        }
+        vmath::vec3 *chunkBuffer = buffer + i*groupSize;
+        vmath::vec3 *padBegin = std::copy(c.particlesBegin, c.particlesEnd, chunkBuffer);
+        std::fill(padBegin, chunkBuffer + groupSize, c.positionOffset);
     }
 }
 
 void ParticleAdvector::_getHostVelocityDataBuffer(std::vector<DataChunkParameters> &chunks,
-                                                  std::vector<float> &buffer) {
-
-    int numElements = _getChunkVelocityDataSize() / sizeof(float);
-    buffer.reserve(numElements);
+                                                  float *buffer) {
     for (unsigned int i = 0; i < chunks.size(); i++) {
-        _appendChunkVelocityDataToBuffer(chunks[i], buffer);
+        buffer = _appendChunkVelocityDataToBuffer(chunks[i], buffer);
     }
 }
 
-void ParticleAdvector::_appendChunkVelocityDataToBuffer(DataChunkParameters &chunk, 
-                                                        std::vector<float> &buffer) {
+float* ParticleAdvector::_appendChunkVelocityDataToBuffer(DataChunkParameters &chunk, 
+                                                          float *buffer) {
 
     for (int k = 0; k < chunk.ufieldview.depth; k++) {
         for (int j = 0; j < chunk.ufieldview.height; j++) {
             for (int i = 0; i < chunk.ufieldview.width; i++) {
-                buffer.push_back(chunk.ufieldview(i, j, k));
+                *(buffer++) = chunk.ufieldview(i, j, k);
             }
         }
     }
@@ -979,7 +777,7 @@ void ParticleAdvector::_appendChunkVelocityDataToBuffer(DataChunkParameters &chu
     for (int k = 0; k < chunk.vfieldview.depth; k++) {
         for (int j = 0; j < chunk.vfieldview.height; j++) {
             for (int i = 0; i < chunk.vfieldview.width; i++) {
-                buffer.push_back(chunk.vfieldview(i, j, k));
+                *(buffer++) = chunk.vfieldview(i, j, k);
             }
         }
     }
@@ -987,61 +785,64 @@ void ParticleAdvector::_appendChunkVelocityDataToBuffer(DataChunkParameters &chu
     for (int k = 0; k < chunk.wfieldview.depth; k++) {
         for (int j = 0; j < chunk.wfieldview.height; j++) {
             for (int i = 0; i < chunk.wfieldview.width; i++) {
-                buffer.push_back(chunk.wfieldview(i, j, k));
+                *(buffer++) = chunk.wfieldview(i, j, k);
             }
         }
     }
+
+    return buffer;
 }
 
 void ParticleAdvector::_getHostChunkOffsetDataBuffer(std::vector<DataChunkParameters> &chunks,
-                                                     std::vector<GridIndex> &buffer) {
-    buffer.reserve(chunks.size());
+                                                     GridIndex *buffer) {
     for (unsigned int i = 0; i < chunks.size(); i++) {
-        buffer.push_back(chunks[i].chunkOffset);
+        buffer[i] = chunks[i].chunkOffset;
     }
 }
 
 void ParticleAdvector::_setCLKernelArgs(DataBuffer &buffer, double dx) {
-    cl_int err = _CLKernel.setArg(0, buffer.positionDataCL);
-    _checkError(err, "Kernel::setArg() - position data");
+    cl_int err = _CLKernel.setArg(0, _bufferPool.getBuffer(buffer.positionDataID));
+    OpenCLDevice::checkError(err, "Kernel::setArg() - position data");
 
-    err = _CLKernel.setArg(1, buffer.vfieldDataCL);
-    _checkError(err, "Kernel::setArg() - velocity field data");
+    err = _CLKernel.setArg(1, _bufferPool.getBuffer(buffer.vfieldDataID));
+    OpenCLDevice::checkError(err, "Kernel::setArg() - velocity field data");
 
-    err = _CLKernel.setArg(2, buffer.offsetDataCL);
-    _checkError(err, "Kernel::setArg() - chunk offset data");
+    err = _CLKernel.setArg(2, _bufferPool.getBuffer(buffer.offsetDataID));
+    OpenCLDevice::checkError(err, "Kernel::setArg() - chunk offset data");
 
     int vfieldLocalBytes = _getChunkVelocityDataSize();
     FLUIDSIM_ASSERT((unsigned int)vfieldLocalBytes <= _deviceInfo.cl_device_local_mem_size);
 
     err = _CLKernel.setArg(3, cl::__local(vfieldLocalBytes));
-    _checkError(err, "Kernel::setArg() - local vfield data");
+    OpenCLDevice::checkError(err, "Kernel::setArg() - local vfield data");
 
     err = _CLKernel.setArg(4, (float)dx);
-    _checkError(err, "Kernel::setArg() - dx");
+    OpenCLDevice::checkError(err, "Kernel::setArg() - dx");
 }
 
-void ParticleAdvector::_setOutputData(std::vector<DataChunkParameters> &chunks,
-                                      DataBuffer &buffer,
+void ParticleAdvector::_setOutputData(DataBuffer &buffer,
                                       std::vector<vmath::vec3> &output) {
 
     int workGroupSize = _getWorkGroupSize(_deviceInfo);
+    vmath::vec3 *positionDataH = (vmath::vec3*)_bufferPool.getHostPointer(buffer.positionDataID);
 
     DataChunkParameters chunk;
-    for (unsigned int gidx = 0; gidx < chunks.size(); gidx++) {
+    for (unsigned int gidx = 0; gidx < buffer.chunks.size(); gidx++) {
         int hostOffset = gidx*workGroupSize;
         int dataOffset = 0;
 
-        chunk = chunks[gidx];
+        chunk = buffer.chunks[gidx];
         std::vector<int>::iterator begin = chunk.referencesBegin;
         std::vector<int>::iterator end = chunk.referencesEnd;
         for (std::vector<int>::iterator it = begin; it != end; ++it) {
-            output[*it] = buffer.positionDataH[hostOffset + dataOffset];
+            output[*it] = positionDataH[hostOffset + dataOffset];
             dataOffset++;
         }
     }
 }
 
+#endif
+
 vmath::vec3 ParticleAdvector::_RK4(vmath::vec3 p0, double dt, MACVelocityField *vfield) {
     vmath::vec3 k1 = vfield->evaluateVelocityAtPosition(p0);
     vmath::vec3 k2 = vfield->evaluateVelocityAtPosition(p0 + (float)(0.5*dt)*k1);
@@ -1077,68 +878,227 @@ vmath::vec3 ParticleAdvector::_RK1(vmath::vec3 p0, double dt, MACVelocityField *
     return p1;
 }
 
-void ParticleAdvector::_advectParticlesRK4NoCL(std::vector<vmath::vec3> &particles,
-                             MACVelocityField *vfield, 
-                             double dt,
-                             std::vector<vmath::vec3> &output) {
+void ParticleAdvector::_advectParticlesSerial(std::vector<vmath::vec3> &particles,
+                                              MACVelocityField *vfield, 
+                                              double dt,
+                                              int order,
+                                              std::vector<vmath::vec3> &output) {
     output.clear();
     output.reserve(particles.size());
     for (size_t i = 0; i < particles.size(); i++) {
-        output.push_back(_RK4(particles[i], dt, vfield));
+        vmath::vec3 p = particles[i];
+        switch (order) {
+            case 4: output.push_back(_RK4(p, dt, vfield)); break;
+            case 3: output.push_back(_RK3(p, dt, vfield)); break;
+            case 2: output.push_back(_RK2(p, dt, vfield)); break;
+            default: output.push_back(_RK1(p, dt, vfield)); break;
+        }
+    }
+}
+
+void ParticleAdvector::_tricubicInterpolateSerial(std::vector<vmath::vec3> &particles,
+                                                  MACVelocityField *vfield, 
+                                                  std::vector<vmath::vec3> &output) {
+    if (output.size() < particles.size()) {
+        output.resize(particles.size());
+    }
+
+    for (size_t i = 0; i < particles.size(); i++) {
+        output[i] = vfield->evaluateVelocityAtPosition(particles[i]);
+    }
+
+    _validateOutput(output);
+}
+
+void ParticleAdvector::_parallelForParticleRange(int numParticles,
+                                                 std::function<void(int, int)> func) {
+    if (numParticles <= 0) {
+        return;
+    }
+
+    if (_threadPool == nullptr) {
+        func(0, numParticles);
+        return;
     }
+
+    int tasksPerThread = 4;
+    int numTasks = tasksPerThread*_threadPool->getNumThreads();
+    int taskSize = (numParticles + numTasks - 1) / numTasks;
+    taskSize = (int)fmax(taskSize, _minParticlesPerThreadTask);
+
+    _threadPool->parallelForRange(0, numParticles, taskSize, func);
+}
+
+/*
+    Runge-Kutta methods are evaluated over batches of _particleBatchSize
+    particles so that each velocity evaluation can be passed to the 
+    TricubicInterpolator as a contiguous block of positions.
+*/
+void ParticleAdvector::_advectParticlesRK4NoCL(std::vector<vmath::vec3> &particles,
+                             MACVelocityField *vfield, 
+                             double dt,
+                             std::vector<vmath::vec3> &output) {
+    output.resize(particles.size());
+
+    TricubicInterpolator interpolator(vfield);
+    vmath::vec3 *pdata = particles.data();
+    vmath::vec3 *odata = output.data();
+    int batchSize = _particleBatchSize;
+    _parallelForParticleRange((int)particles.size(), [&](int begin, int end) {
+        std::vector<vmath::vec3> k(batchSize);
+        std::vector<vmath::vec3> ksum(batchSize);
+        std::vector<vmath::vec3> temp(batchSize);
+        for (int startidx = begin; startidx < end; startidx += batchSize) {
+            int count = (int)fmin(batchSize, end - startidx);
+            vmath::vec3 *p0 = pdata + startidx;
+            vmath::vec3 *p1 = odata + startidx;
+
+            interpolator.interpolate(p0, count, k.data());
+            for (int i = 0; i < count; i++) {
+                ksum[i] = k[i];
+                temp[i] = p0[i] + (float)(0.5*dt)*k[i];
+            }
+
+            interpolator.interpolate(temp.data(), count, k.data());
+            for (int i = 0; i < count; i++) {
+                ksum[i] += 2.0f*k[i];
+                temp[i] = p0[i] + (float)(0.5*dt)*k[i];
+            }
+
+            interpolator.interpolate(temp.data(), count, k.data());
+            for (int i = 0; i < count; i++) {
+                ksum[i] += 2.0f*k[i];
+                temp[i] = p0[i] + (float)dt*k[i];
+            }
+
+            interpolator.interpolate(temp.data(), count, k.data());
+            for (int i = 0; i < count; i++) {
+                ksum[i] += k[i];
+                p1[i] = p0[i] + (float)(dt/6.0f)*ksum[i];
+            }
+        }
+    });
 }
 
 void ParticleAdvector::_advectParticlesRK3NoCL(std::vector<vmath::vec3> &particles,
                              MACVelocityField *vfield, 
                              double dt,
                              std::vector<vmath::vec3> &output) {
-    output.clear();
-    output.reserve(particles.size());
-    for (size_t i = 0; i < particles.size(); i++) {
-        output.push_back(_RK3(particles[i], dt, vfield));
-    }
+    output.resize(particles.size());
+
+    TricubicInterpolator interpolator(vfield);
+    vmath::vec3 *pdata = particles.data();
+    vmath::vec3 *odata = output.data();
+    int batchSize = _particleBatchSize;
+    _parallelForParticleRange((int)particles.size(), [&](int begin, int end) {
+        std::vector<vmath::vec3> k(batchSize);
+        std::vector<vmath::vec3> ksum(batchSize);
+        std::vector<vmath::vec3> temp(batchSize);
+        for (int startidx = begin; startidx < end; startidx += batchSize) {
+            int count = (int)fmin(batchSize, end - startidx);
+            vmath::vec3 *p0 = pdata + startidx;
+            vmath::vec3 *p1 = odata + startidx;
+
+            interpolator.interpolate(p0, count, k.data());
+            for (int i = 0; i < count; i++) {
+                ksum[i] = 2.0f*k[i];
+                temp[i] = p0[i] + (float)(0.5*dt)*k[i];
+            }
+
+            interpolator.interpolate(temp.data(), count, k.data());
+            for (int i = 0; i < count; i++) {
+                ksum[i] += 3.0f*k[i];
+                temp[i] = p0[i] + (float)(0.75*dt)*k[i];
+            }
+
+            interpolator.interpolate(temp.data(), count, k.data());
+            for (int i = 0; i < count; i++) {
+                ksum[i] += 4.0f*k[i];
+                p1[i] = p0[i] + (float)(dt/9.0f)*ksum[i];
+            }
+        }
+    });
 }
 
 void ParticleAdvector::_advectParticlesRK2NoCL(std::vector<vmath::vec3> &particles,
                              MACVelocityField *vfield, 
                              double dt,
                              std::vector<vmath::vec3> &output) {
-    output.clear();
-    output.reserve(particles.size());
-    for (size_t i = 0; i < particles.size(); i++) {
-        output.push_back(_RK2(particles[i], dt, vfield));
-    }
+    output.resize(particles.size());
+
+    TricubicInterpolator interpolator(vfield);
+    vmath::vec3 *pdata = particles.data();
+    vmath::vec3 *odata = output.data();
+    int batchSize = _particleBatchSize;
+    _parallelForParticleRange((int)particles.size(), [&](int begin, int end) {
+        std::vector<vmath::vec3> k(batchSize);
+        std::vector<vmath::vec3> temp(batchSize);
+        for (int startidx = begin; startidx < end; startidx += batchSize) {
+            int count = (int)fmin(batchSize, end - startidx);
+            vmath::vec3 *p0 = pdata + startidx;
+            vmath::vec3 *p1 = odata + startidx;
+
+            interpolator.interpolate(p0, count, k.data());
+            for (int i = 0; i < count; i++) {
+                temp[i] = p0[i] + (float)(0.5*dt)*k[i];
+            }
+
+            interpolator.interpolate(temp.data(), count, k.data());
+            for (int i = 0; i < count; i++) {
+                p1[i] = p0[i] + (float)dt*k[i];
+            }
+        }
+    });
 }
 
 void ParticleAdvector::_advectParticlesRK1NoCL(std::vector<vmath::vec3> &particles,
                              MACVelocityField *vfield, 
                              double dt,
                              std::vector<vmath::vec3> &output) {
-    output.clear();
-    output.reserve(particles.size());
-    for (size_t i = 0; i < particles.size(); i++) {
-        output.push_back(_RK1(particles[i], dt, vfield));
-    }
+    output.resize(particles.size());
+
+    TricubicInterpolator interpolator(vfield);
+    vmath::vec3 *pdata = particles.data();
+    vmath::vec3 *odata = output.data();
+    int batchSize = _particleBatchSize;
+    _parallelForParticleRange((int)particles.size(), [&](int begin, int end) {
+        std::vector<vmath::vec3> k(batchSize);
+        for (int startidx = begin; startidx < end; startidx += batchSize) {
+            int count = (int)fmin(batchSize, end - startidx);
+            vmath::vec3 *p0 = pdata + startidx;
+            vmath::vec3 *p1 = odata + startidx;
+
+            interpolator.interpolate(p0, count, k.data());
+            for (int i = 0; i < count; i++) {
+                p1[i] = p0[i] + (float)dt*k[i];
+            }
+        }
+    });
 }
 
 void ParticleAdvector::_tricubicInterpolateNoCL(std::vector<vmath::vec3> &particles,
                                                 MACVelocityField *vfield, 
                                                 std::vector<vmath::vec3> &output) {
-    output.reserve(particles.size());
-    for (size_t i = output.size(); i < particles.size(); i++) {
-        output.push_back(vmath::vec3());
+    if (output.size() < particles.size()) {
+        output.resize(particles.size());
     }
 
-    for (size_t i = 0; i < particles.size(); i++) {
-        output[i] = vfield->evaluateVelocityAtPosition(particles[i]);
-    }
-
-    _validateOutput(output);
+    TricubicInterpolator interpolator(vfield);
+    vmath::vec3 *pdata = particles.data();
+    vmath::vec3 *odata = output.data();
+    _parallelForParticleRange((int)particles.size(), [&](int begin, int end) {
+        interpolator.interpolate(pdata + begin, end - begin, odata + begin);
+        _validateOutput(odata + begin, end - begin);
+    });
 }
 
 void ParticleAdvector::_validateOutput(std::vector<vmath::vec3> &output) {
+    _validateOutput(output.data(), (int)output.size());
+}
+
+void ParticleAdvector::_validateOutput(vmath::vec3 *output, int n) {
     vmath::vec3 v;
-    for (unsigned int i = 0; i < output.size(); i++) {
+    for (int i = 0; i < n; i++) {
         v = output[i];
         if (std::isinf(v.x) || std::isnan(v.x) || 
                 std::isinf(v.y) || std::isnan(v.y) ||
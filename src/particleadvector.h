@@ -21,34 +21,11 @@ freely, subject to the following restrictions:
 #ifndef PARTICLEADVECTOR_H
 #define PARTICLEADVECTOR_H
 
-#ifdef __GNUC__
-    #pragma GCC diagnostic push
-    #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
-#endif
-
-#ifdef _MSC_VER 
-    #pragma warning(push)
-    #pragma warning(disable : 4996 4512 4510 4512 4610 )
-#endif
-
-#if defined(__APPLE__) || defined(__MACOSX)
-    #include <OpenCL/cl.hpp>
-#else
-    #include <CL/cl.hpp>
-#endif
-
-#ifdef _MSC_VER 
-    #pragma warning(pop)
-#endif
-
-#ifdef __GNUC__
-    #pragma GCC diagnostic pop
-#endif
-
 #include <vector>
 #include <fstream>
 #include <algorithm>
 #include <string>
+#include <functional>
 
 #include "macvelocityfield.h"
 #include "array3d.h"
@@ -58,29 +35,46 @@ freely, subject to the following restrictions:
 #include "config.h"
 #include "fluidsimassert.h"
 #include "kernels/kernels.h"
+#include "opencldevice.h"
+#include "clbufferpool.h"
+#include "computebackend.h"
+#include "tricubicinterpolator.h"
+#include "threadpool.h"
 
 class ParticleAdvector
 {
 public:
     ParticleAdvector();
 
-    bool initialize();
-    void setDevicePreference(std::string devtype);
-    void setDevicePreferenceGPU();
-    void setDevicePreferenceCPU();
+    /*
+        Compiles the OpenCL kernels on the shared device. Returns false if
+        the device is not initialized or the kernels could not be built.
+    */
+    bool initialize(OpenCLDevice *device);
+    bool isInitialized();
 
-    void printDeviceInfo();
-    std::string getDeviceInfo();
     void printKernelInfo();
     std::string getKernelInfo();
-    bool isUsingGPU();
-    bool isUsingCPU();
+
+    /*
+        Backend used to evaluate velocities and advect particles. 
+        The opencl backend requires a successful call to initialize().
+    */
+    void setComputeBackend(ComputeBackend backend);
+    ComputeBackend getComputeBackend();
     void disableOpenCL();
     void enableOpenCL();
     bool isOpenCLEnabled();
     int getKernelWorkLoadSize();
     void setKernelWorkLoadSize(int n);
 
+    /*
+        Thread pool used by the threaded compute backend. The pool is not 
+        owned by the ParticleAdvector. If no pool is set, particles are 
+        evaluated on the calling thread.
+    */
+    void setThreadPool(ThreadPool *pool);
+
     void advectParticlesRK4(std::vector<vmath::vec3> &particles,
                             MACVelocityField *vfield,
                             double dt,
@@ -111,32 +105,7 @@ public:
 
 private:
 
-    struct CLDeviceInfo {
-        char cl_device_name[4096];
-        char cl_device_vendor[4096];
-        char cl_device_version[4096];
-        char cl_driver_version[4096];
-        char cl_device_opencl_c_version[4096];
-
-        cl_device_type device_type;
-        cl_uint cl_device_max_clock_frequency;
-        cl_ulong cl_device_global_mem_size;
-        cl_ulong cl_device_local_mem_size;
-        cl_ulong cl_device_max_mem_alloc_size;
-        size_t cl_device_max_work_group_size;
-        GridIndex cl_device_max_work_item_sizes;
-    };
-
-    struct CLKernelInfo {
-        char cl_kernel_function_name[4096];
-        char cl_kernel_attributes[4096];
-
-        cl_ulong cl_kernel_num_args;
-        size_t cl_kernel_work_group_size;
-        cl_ulong cl_kernel_local_mem_size;
-        cl_ulong cl_kernel_private_mem_size;
-        size_t cl_kernel_preferred_work_group_size_multiple;
-    };
+#if CONFIG_WITH_OPENCL
 
     struct ParticleChunk {
         std::vector<vmath::vec3> particles;
@@ -158,24 +127,22 @@ private:
         vmath::vec3 positionOffset;
     };
 
+    /*
+        Identifies a set of buffers in the buffer pool and the chunks that
+        are being computed with them. Two sets are used so that the host 
+        can prepare one computation while the device runs the other.
+    */
     struct DataBuffer {
-        std::vector<vmath::vec3> positionDataH;
-        std::vector<float> vfieldDataH;
-        std::vector<GridIndex> offsetDataH;
+        int positionDataID = 0;
+        int vfieldDataID = 0;
+        int offsetDataID = 0;
 
-        cl::Buffer positionDataCL;
-        cl::Buffer vfieldDataCL;
-        cl::Buffer offsetDataCL;
+        std::vector<DataChunkParameters> chunks;
+        cl::Event event;
+        bool isComputing = false;
     };
 
-    void _checkError(cl_int err, const char * name);
-    cl::Context _getCLContext(cl_int *err);
-    cl::Device _getCLDevice(cl::Context &context, cl_int *err);
-    CLDeviceInfo _initializeDeviceInfo(cl::Device &device);
     cl_int _initializeCLKernel();
-    CLKernelInfo _initializeKernelInfo(cl::Kernel &kernel);
-    std::string _getProgramString(std::string filename);
-    cl_int _initializeCLCommandQueue();
 
     void _getParticleChunkGrid(double cwidth, double cheight, double cdepth,
                                std::vector<vmath::vec3> &particles,
@@ -188,34 +155,47 @@ private:
                                               ParticleChunk *particleChunk,
                                               std::vector<DataChunkParameters> &chunkParameters);
     
-    int _getWorkGroupSize(CLDeviceInfo &info);
+    int _getWorkGroupSize(OpenCLDevice::CLDeviceInfo &info);
     int _getChunkPositionDataSize();
     int _getChunkVelocityDataSize();
     int _getChunkOffsetDataSize();
     int _getChunkTotalDataSize();
     int _getMaxChunksPerComputation();
+    int _getChunksPerComputation(int numChunks);
 
     void _tricubicInterpolateChunks(std::vector<DataChunkParameters> &chunks,
                                     std::vector<vmath::vec3> &output);
-    void _initializeDataBuffer(std::vector<DataChunkParameters> &chunks,
-                               DataBuffer &buffer);
+    void _launchComputation(DataBuffer &buffer);
+    void _finishComputation(DataBuffer &buffer, std::vector<vmath::vec3> &output);
+    void _initializeDataBuffer(DataBuffer &buffer);
     void _getHostPositionDataBuffer(std::vector<DataChunkParameters> &chunks,
-                                    std::vector<vmath::vec3> &buffer);
+                                    vmath::vec3 *buffer);
     void _getHostVelocityDataBuffer(std::vector<DataChunkParameters> &chunks,
-                                    std::vector<float> &buffer);
-    void _appendChunkVelocityDataToBuffer(DataChunkParameters &chunk, 
-                                          std::vector<float> &buffer);
+                                    float *buffer);
+    float* _appendChunkVelocityDataToBuffer(DataChunkParameters &chunk, 
+                                            float *buffer);
     void _getHostChunkOffsetDataBuffer(std::vector<DataChunkParameters> &chunks,
-                                       std::vector<GridIndex> &buffer);
+                                       GridIndex *buffer);
     void _setCLKernelArgs(DataBuffer &buffer, double dx);
-    void _setOutputData(std::vector<DataChunkParameters> &chunks,
-                        DataBuffer &buffer,
-                        std::vector<vmath::vec3> &output);
-    
+    void _setOutputData(DataBuffer &buffer, std::vector<vmath::vec3> &output);
+
+#endif
+
     vmath::vec3 _RK4(vmath::vec3 p0, double dt, MACVelocityField *vfield);
     vmath::vec3 _RK3(vmath::vec3 p0, double dt, MACVelocityField *vfield);
     vmath::vec3 _RK2(vmath::vec3 p0, double dt, MACVelocityField *vfield);
     vmath::vec3 _RK1(vmath::vec3 p0, double dt, MACVelocityField *vfield);
+    void _advectParticlesSerial(std::vector<vmath::vec3> &particles,
+                                MACVelocityField *vfield, 
+                                double dt,
+                                int order,
+                                std::vector<vmath::vec3> &output);
+    void _tricubicInterpolateSerial(std::vector<vmath::vec3> &particles,
+                                    MACVelocityField *vfield, 
+                                    std::vector<vmath::vec3> &output);
+    
+    void _parallelForParticleRange(int numParticles, 
+                                   std::function<void(int, int)> func);
     void _advectParticlesRK4NoCL(std::vector<vmath::vec3> &particles,
                                  MACVelocityField *vfield, 
                                  double dt,
@@ -236,19 +216,19 @@ private:
                                  MACVelocityField *vfield, 
                                  std::vector<vmath::vec3> &output);
     void _validateOutput(std::vector<vmath::vec3> &output);
+    void _validateOutput(vmath::vec3 *output, int n);
 
 
     bool _isInitialized = false;
+    OpenCLDevice *_device = nullptr;
+    ComputeBackend _computeBackend = ComputeBackend::threaded;
 
-    cl_device_type _devicePreference1 = CL_DEVICE_TYPE_GPU;
-    cl_device_type _devicePreference2 = CL_DEVICE_TYPE_CPU;
-
-    CLDeviceInfo _deviceInfo;
-    CLKernelInfo _kernelInfo;
-    cl::Context _CLContext;
-    cl::Device _CLDevice;
+#if CONFIG_WITH_OPENCL
+    OpenCLDevice::CLDeviceInfo _deviceInfo;
+    OpenCLDevice::CLKernelInfo _kernelInfo;
     cl::Kernel _CLKernel;
-    cl::CommandQueue _CLQueue;
+    CLBufferPool _bufferPool;
+#endif
 
     int _isize = 0;
     int _jsize = 0;
@@ -260,8 +240,13 @@ private:
     int _dataChunkHeight = 5;
     int _dataChunkDepth = 5;
     int _maxChunksPerComputation = 15000;
+    int _minChunksPerComputation = 256;
+    int _minComputationsPerCall = 4;
     int _kernelWorkLoadSize = 1000;
-    bool _isOpenCLEnabled = true;
+
+    ThreadPool *_threadPool = nullptr;
+    int _particleBatchSize = 256;
+    int _minParticlesPerThreadTask = 2048;
     
 };
 
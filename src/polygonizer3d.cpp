@@ -360,6 +360,11 @@ bool Polygonizer3d::_isCellOnSurface(GridIndex g) {
 }
 
 void Polygonizer3d::_findSurfaceCells(GridIndexVector &surfaceCells) {
+    if (_scalarField->isSparseStorageEnabled()) {
+        _findSparseSurfaceCells(surfaceCells);
+        return;
+    }
+
     bool isEmpty = true;
     for (int k = 0; k < _ksize + 1; k++) {
         for (int j = 0; j < _jsize + 1; j++) {
@@ -382,7 +387,7 @@ void Polygonizer3d::_findSurfaceCells(GridIndexVector &surfaceCells) {
             for (int i = 0; i < _isize; i++) {
                 GridIndex cell = GridIndex(i, j, k);
 
-                if (_isSurfaceCellMaskSet && !_surfaceCellMask->get(cell)) {
+                if (!_isCellPolygonizable(cell)) {
                     continue;
                 }
 
@@ -394,6 +399,90 @@ void Polygonizer3d::_findSurfaceCells(GridIndexVector &surfaceCells) {
     }
 }
 
+void Polygonizer3d::_findSparseSurfaceCells(GridIndexVector &surfaceCells) {
+    // A surface cell has a vertex above the surface threshold, and only
+    // allocated blocks of the field hold nonzero values. Each block checks
+    // the cells that share a vertex with it.
+    std::vector<GridIndex> blocks;
+    _scalarField->getSparseBlocks(blocks);
+    int bsize = _scalarField->getSparseBlockSize();
+
+    std::vector<GridIndex> cells;
+    for (unsigned int bidx = 0; bidx < blocks.size(); bidx++) {
+        GridIndex b = blocks[bidx];
+        int imin = (int)fmax(b.i*bsize - 1, 0);
+        int jmin = (int)fmax(b.j*bsize - 1, 0);
+        int kmin = (int)fmax(b.k*bsize - 1, 0);
+        int imax = (int)fmin((b.i + 1)*bsize - 1, _isize - 1);
+        int jmax = (int)fmin((b.j + 1)*bsize - 1, _jsize - 1);
+        int kmax = (int)fmin((b.k + 1)*bsize - 1, _ksize - 1);
+
+        for (int k = kmin; k <= kmax; k++) {
+            for (int j = jmin; j <= jmax; j++) {
+                for (int i = imin; i <= imax; i++) {
+                    GridIndex cell(i, j, k);
+                    if (!_isCellPolygonizable(cell) || 
+                            !_isSparseBlockCellOwner(b, cell, bsize)) {
+                        continue;
+                    }
+
+                    if (_isCellOnSurface(cell)) {
+                        cells.push_back(cell);
+                    }
+                }
+            }
+        }
+    }
+
+    // Cells are polygonized in the same order as a dense field so that
+    // both storage modes produce identical meshes
+    std::sort(cells.begin(), cells.end(), [](const GridIndex &a, const GridIndex &b) {
+        if (a.k != b.k) {
+            return a.k < b.k;
+        }
+        if (a.j != b.j) {
+            return a.j < b.j;
+        }
+        return a.i < b.i;
+    });
+
+    surfaceCells.reserve(cells.size());
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        surfaceCells.push_back(cells[i]);
+    }
+}
+
+bool Polygonizer3d::_isSparseBlockCellOwner(GridIndex block, GridIndex cell, int bsize) {
+    // A cell on a block boundary shares vertices with up to eight blocks. 
+    // The first allocated of these blocks is responsible for the cell.
+    for (int bk = cell.k / bsize; bk <= (cell.k + 1) / bsize; bk++) {
+        for (int bj = cell.j / bsize; bj <= (cell.j + 1) / bsize; bj++) {
+            for (int bi = cell.i / bsize; bi <= (cell.i + 1) / bsize; bi++) {
+                if (_scalarField->isSparseBlockAllocated(bi, bj, bk)) {
+                    return bi == block.i && bj == block.j && bk == block.k;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+bool Polygonizer3d::_isCellPolygonizable(GridIndex g) {
+    if (_isSurfaceCellMaskSet && !_surfaceCellMask->get(g)) {
+        return false;
+    }
+
+    if (_isSurfaceCellBoundsSet && 
+            (g.i < _surfaceCellBoundsMin.i || g.i > _surfaceCellBoundsMax.i ||
+             g.j < _surfaceCellBoundsMin.j || g.j > _surfaceCellBoundsMax.j ||
+             g.k < _surfaceCellBoundsMin.k || g.k > _surfaceCellBoundsMax.k)) {
+        return false;
+    }
+
+    return true;
+}
+
 int Polygonizer3d::_calculateCubeIndex(GridIndex g) {
     GridIndex vs[8];
     Grid3d::getGridIndexVertices(g, vs);
@@ -587,6 +676,12 @@ void Polygonizer3d::setSurfaceCellMask(Array3d<bool> *mask) {
     _isSurfaceCellMaskSet = true;
 }
 
+void Polygonizer3d::setSurfaceCellBounds(GridIndex gmin, GridIndex gmax) {
+    _surfaceCellBoundsMin = gmin;
+    _surfaceCellBoundsMax = gmax;
+    _isSurfaceCellBoundsSet = true;
+}
+
 TriangleMesh Polygonizer3d::polygonizeSurface() {
     FLUIDSIM_ASSERT(_isScalarFieldSet);
 
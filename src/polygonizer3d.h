@@ -26,9 +26,11 @@ freely, subject to the following restrictions:
 #include <queue>
 #include <sstream>
 #include <fstream>
+#include <algorithm>
 
 #include "scalarfield.h"
 #include "array3d.h"
+#include "sparsearray3d.h"
 #include "grid3d.h"
 #include "trianglemesh.h"
 #include "vmath.h"
@@ -45,22 +47,30 @@ public:
     ~Polygonizer3d();
 
     void setSurfaceCellMask(Array3d<bool> *mask);
+
+    /*
+        Only cells within [gmin, gmax] are polygonized. Unlike a surface cell
+        mask, bounds do not require a grid allocated over all cells.
+    */
+    void setSurfaceCellBounds(GridIndex gmin, GridIndex gmax);
     TriangleMesh polygonizeSurface();
 
 private:
+    // Edge vertices are only created around surface cells, so the edge
+    // grids are stored sparsely
     struct EdgeGrid {
-        Array3d<int> U;         // store index to vertex
-        Array3d<int> V;
-        Array3d<int> W;
+        SparseArray3d<int> U;         // store index to vertex
+        SparseArray3d<int> V;
+        SparseArray3d<int> W;
 
-        EdgeGrid() : U(Array3d<int>(0, 0, 0)),
-                     V(Array3d<int>(0, 0, 0)),
-                     W(Array3d<int>(0, 0, 0)) {}
+        EdgeGrid() : U(SparseArray3d<int>(0, 0, 0, -1)),
+                     V(SparseArray3d<int>(0, 0, 0, -1)),
+                     W(SparseArray3d<int>(0, 0, 0, -1)) {}
 
         EdgeGrid(int i, int j, int k) : 
-                     U(Array3d<int>(i, j + 1, k + 1, -1)),
-                     V(Array3d<int>(i + 1, j, k + 1, -1)),
-                     W(Array3d<int>(i + 1, j + 1, k, -1)) {}
+                     U(SparseArray3d<int>(i, j + 1, k + 1, -1)),
+                     V(SparseArray3d<int>(i + 1, j, k + 1, -1)),
+                     W(SparseArray3d<int>(i + 1, j + 1, k, -1)) {}
     };
 
     vmath::vec3 _getVertexPosition(GridIndex v);
@@ -76,6 +86,9 @@ private:
     vmath::vec3 _vertexInterp(vmath::vec3 p1, vmath::vec3 p2, double valp1, double valp2);
     void _calculateSurfaceTriangles(GridIndexVector &surfaceCells, TriangleMesh &mesh);
     void _findSurfaceCells(GridIndexVector &surfaceCells);
+    void _findSparseSurfaceCells(GridIndexVector &surfaceCells);
+    bool _isSparseBlockCellOwner(GridIndex block, GridIndex cell, int blockSize);
+    bool _isCellPolygonizable(GridIndex g);
 
     static const int _edgeTable[256];
     static const int _triTable[256][16];
@@ -93,6 +106,10 @@ private:
     Array3d<bool> *_surfaceCellMask;
     bool _isSurfaceCellMaskSet = false;
 
+    GridIndex _surfaceCellBoundsMin;
+    GridIndex _surfaceCellBoundsMax;
+    bool _isSurfaceCellBoundsSet = false;
+
 };
 
 #endif
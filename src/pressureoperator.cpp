@@ -0,0 +1,443 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "pressureoperator.h"
+
+/*
+    The SIMD kernels are compiled with per-function target attributes and 
+    selected at runtime from the features of the processor, so the AVX2 and 
+    AVX-512 paths are available without building the whole library for a 
+    specific instruction set.
+*/
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define PRESSUREOPERATOR_SIMD
+    #define PRESSUREOPERATOR_TARGET_AVX2 __attribute__((target("avx2")))
+    #define PRESSUREOPERATOR_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512vl")))
+    #include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+    #define PRESSUREOPERATOR_SIMD
+    #define PRESSUREOPERATOR_TARGET_AVX2
+    #define PRESSUREOPERATOR_TARGET_AVX512
+    #include <immintrin.h>
+    #include <intrin.h>
+#endif
+
+namespace {
+
+enum class InstructionSet : char { 
+    none   = 0x00, 
+    avx2   = 0x01,
+    avx512 = 0x02
+};
+
+#if defined(PRESSUREOPERATOR_SIMD)
+
+InstructionSet detectInstructionSet() {
+    #if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return InstructionSet::none;
+        }
+
+        __cpuid(info, 1);
+        bool isOSXSAVESupported = (info[2] & (1 << 27)) != 0;
+        bool isAVXSupported = (info[2] & (1 << 28)) != 0;
+        if (!isOSXSAVESupported || !isAVXSupported) {
+            return InstructionSet::none;
+        }
+
+        // OS must save the YMM state (bits 1, 2) and for AVX-512 also the 
+        // opmask and ZMM state (bits 5, 6, 7)
+        unsigned long long xcr0 = _xgetbv(0);
+        bool isYMMEnabled = (xcr0 & 0x06) == 0x06;
+        bool isZMMEnabled = (xcr0 & 0xE6) == 0xE6;
+
+        __cpuidex(info, 7, 0);
+        bool isAVX2Supported = (info[1] & (1 << 5)) != 0;
+        bool isAVX512FSupported = (info[1] & (1 << 16)) != 0;
+        bool isAVX512VLSupported = (info[1] & (1 << 31)) != 0;
+
+        if (isZMMEnabled && isAVX2Supported && isAVX512FSupported && isAVX512VLSupported) {
+            return InstructionSet::avx512;
+        }
+        if (isYMMEnabled && isAVX2Supported) {
+            return InstructionSet::avx2;
+        }
+        return InstructionSet::none;
+    #else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && 
+                __builtin_cpu_supports("avx512f") && 
+                __builtin_cpu_supports("avx512vl")) {
+            return InstructionSet::avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return InstructionSet::avx2;
+        }
+        return InstructionSet::none;
+    #endif
+}
+
+#else
+
+InstructionSet detectInstructionSet() {
+    return InstructionSet::none;
+}
+
+#endif
+
+InstructionSet getInstructionSet() {
+    static InstructionSet instructionSet = detectInstructionSet();
+    return instructionSet;
+}
+
+#if defined(PRESSUREOPERATOR_SIMD)
+
+/*
+    Each SIMD kernel processes the largest multiple of the vector width 
+    starting at begin and returns the index where the scalar remainder 
+    starts.
+*/
+
+PRESSUREOPERATOR_TARGET_AVX512
+int applyAVX512(unsigned char *diag, int **nbs, double *x, double *result, 
+                double scale, int begin, int end) {
+    __m512d vzero = _mm512_setzero_pd();
+    __m512d vscale = _mm512_set1_pd(scale);
+    __m512d vnegscale = _mm512_set1_pd(-scale);
+    __m256i vinvalid = _mm256_set1_epi32(-1);
+    int idx = begin;
+    for (; idx + 8 <= end; idx += 8) {
+        __m512d sum = vzero;
+        for (int nidx = 0; nidx < 6; nidx++) {
+            __m256i vidx = _mm256_loadu_si256((__m256i*)(nbs[nidx] + idx));
+            __mmask8 mask = _mm256_cmpgt_epi32_mask(vidx, vinvalid);
+            sum = _mm512_add_pd(sum, _mm512_mask_i32gather_pd(vzero, mask, vidx, x, 8));
+        }
+
+        __m128i vdiagBytes = _mm_loadl_epi64((__m128i*)(diag + idx));
+        __m512d vdiag = _mm512_maskz_cvtepi32_pd(0xFF, _mm256_cvtepu8_epi32(vdiagBytes));
+        __m512d vx = _mm512_loadu_pd(x + idx);
+        __m512d val = _mm512_mul_pd(sum, vnegscale);
+        val = _mm512_add_pd(val, _mm512_mul_pd(_mm512_mul_pd(vdiag, vscale), vx));
+        _mm512_storeu_pd(result + idx, val);
+    }
+
+    return idx;
+}
+
+PRESSUREOPERATOR_TARGET_AVX2
+int applyAVX2(unsigned char *diag, int **nbs, double *x, double *result, 
+              double scale, int begin, int end) {
+    __m256d vzero = _mm256_setzero_pd();
+    __m256d vscale = _mm256_set1_pd(scale);
+    __m256d vnegscale = _mm256_set1_pd(-scale);
+    __m128i vinvalid = _mm_set1_epi32(-1);
+    int idx = begin;
+    for (; idx + 4 <= end; idx += 4) {
+        __m256d sum = vzero;
+        for (int nidx = 0; nidx < 6; nidx++) {
+            __m128i vidx = _mm_loadu_si128((__m128i*)(nbs[nidx] + idx));
+            __m256d mask = _mm256_castsi256_pd(
+                    _mm256_cvtepi32_epi64(_mm_cmpgt_epi32(vidx, vinvalid)));
+            sum = _mm256_add_pd(sum, _mm256_mask_i32gather_pd(vzero, x, vidx, mask, 8));
+        }
+
+        int diagBytes = (int)diag[idx] | ((int)diag[idx + 1] << 8) | 
+                        ((int)diag[idx + 2] << 16) | ((int)diag[idx + 3] << 24);
+        __m128i vdiagInts = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(diagBytes));
+        __m256d vdiag = _mm256_cvtepi32_pd(vdiagInts);
+        __m256d vx = _mm256_loadu_pd(x + idx);
+        __m256d val = _mm256_mul_pd(sum, vnegscale);
+        val = _mm256_add_pd(val, _mm256_mul_pd(_mm256_mul_pd(vdiag, vscale), vx));
+        _mm256_storeu_pd(result + idx, val);
+    }
+
+    return idx;
+}
+
+PRESSUREOPERATOR_TARGET_AVX512
+int addScaledVectorAVX512(double *v1, double *v2, double scale, int begin, int end) {
+    __m512d vscale = _mm512_set1_pd(scale);
+    int idx = begin;
+    for (; idx + 8 <= end; idx += 8) {
+        __m512d a = _mm512_loadu_pd(v1 + idx);
+        __m512d b = _mm512_loadu_pd(v2 + idx);
+        _mm512_storeu_pd(v1 + idx, _mm512_add_pd(a, _mm512_mul_pd(b, vscale)));
+    }
+
+    return idx;
+}
+
+PRESSUREOPERATOR_TARGET_AVX2
+int addScaledVectorAVX2(double *v1, double *v2, double scale, int begin, int end) {
+    __m256d vscale = _mm256_set1_pd(scale);
+    int idx = begin;
+    for (; idx + 4 <= end; idx += 4) {
+        __m256d a = _mm256_loadu_pd(v1 + idx);
+        __m256d b = _mm256_loadu_pd(v2 + idx);
+        _mm256_storeu_pd(v1 + idx, _mm256_add_pd(a, _mm256_mul_pd(b, vscale)));
+    }
+
+    return idx;
+}
+
+PRESSUREOPERATOR_TARGET_AVX512
+int addScaledVectorsAVX512(double *v1, double s1, double *v2, double s2,
+                           double *result, int begin, int end) {
+    __m512d vs1 = _mm512_set1_pd(s1);
+    __m512d vs2 = _mm512_set1_pd(s2);
+    int idx = begin;
+    for (; idx + 8 <= end; idx += 8) {
+        __m512d a = _mm512_mul_pd(_mm512_loadu_pd(v1 + idx), vs1);
+        __m512d b = _mm512_mul_pd(_mm512_loadu_pd(v2 + idx), vs2);
+        _mm512_storeu_pd(result + idx, _mm512_add_pd(a, b));
+    }
+
+    return idx;
+}
+
+PRESSUREOPERATOR_TARGET_AVX2
+int addScaledVectorsAVX2(double *v1, double s1, double *v2, double s2,
+                         double *result, int begin, int end) {
+    __m256d vs1 = _mm256_set1_pd(s1);
+    __m256d vs2 = _mm256_set1_pd(s2);
+    int idx = begin;
+    for (; idx + 4 <= end; idx += 4) {
+        __m256d a = _mm256_mul_pd(_mm256_loadu_pd(v1 + idx), vs1);
+        __m256d b = _mm256_mul_pd(_mm256_loadu_pd(v2 + idx), vs2);
+        _mm256_storeu_pd(result + idx, _mm256_add_pd(a, b));
+    }
+
+    return idx;
+}
+
+PRESSUREOPERATOR_TARGET_AVX512
+int dotAVX512(double *v1, double *v2, int begin, int end, double *sum) {
+    __m512d vsum = _mm512_setzero_pd();
+    int idx = begin;
+    for (; idx + 8 <= end; idx += 8) {
+        __m512d a = _mm512_loadu_pd(v1 + idx);
+        __m512d b = _mm512_loadu_pd(v2 + idx);
+        vsum = _mm512_add_pd(vsum, _mm512_mul_pd(a, b));
+    }
+    double lanes[8];
+    _mm512_storeu_pd(lanes, vsum);
+    *sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + 
+           ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+
+    return idx;
+}
+
+PRESSUREOPERATOR_TARGET_AVX2
+int dotAVX2(double *v1, double *v2, int begin, int end, double *sum) {
+    __m256d vsum = _mm256_setzero_pd();
+    int idx = begin;
+    for (; idx + 4 <= end; idx += 4) {
+        __m256d a = _mm256_loadu_pd(v1 + idx);
+        __m256d b = _mm256_loadu_pd(v2 + idx);
+        vsum = _mm256_add_pd(vsum, _mm256_mul_pd(a, b));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, vsum);
+    *sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+    return idx;
+}
+
+PRESSUREOPERATOR_TARGET_AVX512
+int absMaxCoeffAVX512(double *v, int begin, int end, double *max) {
+    __m512d vzero = _mm512_setzero_pd();
+    __m512d vmax = _mm512_set1_pd(*max);
+    int idx = begin;
+    for (; idx + 8 <= end; idx += 8) {
+        __m512d a = _mm512_loadu_pd(v + idx);
+        vmax = _mm512_maskz_max_pd(0xFF, vmax, _mm512_maskz_max_pd(0xFF, a, _mm512_sub_pd(vzero, a)));
+    }
+    double lanes[8];
+    _mm512_storeu_pd(lanes, vmax);
+    for (int i = 0; i < 8; i++) {
+        *max = std::max(*max, lanes[i]);
+    }
+
+    return idx;
+}
+
+PRESSUREOPERATOR_TARGET_AVX2
+int absMaxCoeffAVX2(double *v, int begin, int end, double *max) {
+    __m256d vmax = _mm256_set1_pd(*max);
+    __m256d vsignmask = _mm256_set1_pd(-0.0);
+    int idx = begin;
+    for (; idx + 4 <= end; idx += 4) {
+        __m256d a = _mm256_andnot_pd(vsignmask, _mm256_loadu_pd(v + idx));
+        vmax = _mm256_max_pd(vmax, a);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, vmax);
+    *max = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+
+    return idx;
+}
+
+#endif
+
+}
+
+PressureOperator::PressureOperator() {
+}
+
+PressureOperator::~PressureOperator() {
+}
+
+void PressureOperator::resize(int size) {
+    _diag.assign(size, 0);
+    for (int nidx = 0; nidx < 6; nidx++) {
+        _neighbours[nidx].assign(size, -1);
+    }
+}
+
+int PressureOperator::size() {
+    return (int)_diag.size();
+}
+
+const char* PressureOperator::getInstructionSet() {
+    switch (::getInstructionSet()) {
+        case InstructionSet::avx512:
+            return "AVX-512";
+        case InstructionSet::avx2:
+            return "AVX2";
+        default:
+            return "none";
+    }
+}
+
+void PressureOperator::apply(double *x, double *result, double scale, 
+                             int begin, int end) {
+    FLUIDSIM_ASSERT(begin >= 0 && end <= (int)_diag.size());
+
+    double negscale = -scale;
+    unsigned char *diag = _diag.data();
+    int *nbs[6];
+    for (int nidx = 0; nidx < 6; nidx++) {
+        nbs[nidx] = _neighbours[nidx].data();
+    }
+
+    int idx = begin;
+
+    #if defined(PRESSUREOPERATOR_SIMD)
+        InstructionSet instructionSet = ::getInstructionSet();
+        if (instructionSet == InstructionSet::avx512) {
+            idx = applyAVX512(diag, nbs, x, result, scale, begin, end);
+        } else if (instructionSet == InstructionSet::avx2) {
+            idx = applyAVX2(diag, nbs, x, result, scale, begin, end);
+        }
+    #endif
+
+    for (; idx < end; idx++) {
+        double val = 0.0;
+        for (int nidx = 0; nidx < 6; nidx++) {
+            int vidx = nbs[nidx][idx];
+            if (vidx != -1) { 
+                val += x[vidx]; 
+            }
+        }
+        val *= negscale;
+        val += (double)diag[idx] * scale * x[idx];
+        result[idx] = val;
+    }
+}
+
+void PressureOperator::addScaledVector(double *v1, double *v2, double scale, 
+                                       int begin, int end) {
+    int idx = begin;
+
+    #if defined(PRESSUREOPERATOR_SIMD)
+        InstructionSet instructionSet = ::getInstructionSet();
+        if (instructionSet == InstructionSet::avx512) {
+            idx = addScaledVectorAVX512(v1, v2, scale, begin, end);
+        } else if (instructionSet == InstructionSet::avx2) {
+            idx = addScaledVectorAVX2(v1, v2, scale, begin, end);
+        }
+    #endif
+
+    for (; idx < end; idx++) {
+        v1[idx] += v2[idx]*scale;
+    }
+}
+
+void PressureOperator::addScaledVectors(double *v1, double s1, double *v2, double s2,
+                                        double *result, int begin, int end) {
+    int idx = begin;
+
+    #if defined(PRESSUREOPERATOR_SIMD)
+        InstructionSet instructionSet = ::getInstructionSet();
+        if (instructionSet == InstructionSet::avx512) {
+            idx = addScaledVectorsAVX512(v1, s1, v2, s2, result, begin, end);
+        } else if (instructionSet == InstructionSet::avx2) {
+            idx = addScaledVectorsAVX2(v1, s1, v2, s2, result, begin, end);
+        }
+    #endif
+
+    for (; idx < end; idx++) {
+        result[idx] = v1[idx]*s1 + v2[idx]*s2;
+    }
+}
+
+double PressureOperator::dot(double *v1, double *v2, int begin, int end) {
+    int idx = begin;
+    double sum = 0.0;
+
+    #if defined(PRESSUREOPERATOR_SIMD)
+        InstructionSet instructionSet = ::getInstructionSet();
+        if (instructionSet == InstructionSet::avx512) {
+            idx = dotAVX512(v1, v2, begin, end, &sum);
+        } else if (instructionSet == InstructionSet::avx2) {
+            idx = dotAVX2(v1, v2, begin, end, &sum);
+        }
+    #endif
+
+    for (; idx < end; idx++) {
+        sum += v1[idx] * v2[idx];
+    }
+
+    return sum;
+}
+
+double PressureOperator::absMaxCoeff(double *v, int begin, int end) {
+    int idx = begin;
+    double max = -std::numeric_limits<double>::infinity();
+
+    #if defined(PRESSUREOPERATOR_SIMD)
+        InstructionSet instructionSet = ::getInstructionSet();
+        if (instructionSet == InstructionSet::avx512) {
+            idx = absMaxCoeffAVX512(v, begin, end, &max);
+        } else if (instructionSet == InstructionSet::avx2) {
+            idx = absMaxCoeffAVX2(v, begin, end, &max);
+        }
+    #endif
+
+    for (; idx < end; idx++) {
+        if (fabs(v[idx]) > max) {
+            max = fabs(v[idx]);
+        }
+    }
+
+    return max;
+}
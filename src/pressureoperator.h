@@ -0,0 +1,100 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef PRESSUREOPERATOR_H
+#define PRESSUREOPERATOR_H
+
+#include <vector>
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "fluidsimassert.h"
+
+/*
+    Matrix-free 7-point Poisson operator over the compact fluid cell 
+    ordering used by the PressureSolver.
+
+    The matrix diagonal and the vector indices of the six neighbours of each 
+    fluid cell are stored as separate arrays. Neighbour arrays are stored in 
+    the order of Grid3d::getNeighbourGridIndices6 (-i, +i, -j, +j, -k, +k). 
+    A neighbour index of -1 denotes a neighbour that is not a fluid cell.
+
+    Kernels operate on a range [begin, end) of vector indices so that they 
+    can be distributed across threads. On x86 processors with AVX2 or 
+    AVX-512 support, the kernels process four or eight rows per instruction. 
+    The instruction set is detected at runtime.
+*/
+class PressureOperator
+{
+public:
+    PressureOperator();
+    ~PressureOperator();
+
+    void resize(int size);
+    int size();
+
+    inline void setCell(int idx, int diag, int neighbours[6]) {
+        FLUIDSIM_ASSERT(idx >= 0 && idx < (int)_diag.size());
+        _diag[idx] = (unsigned char)diag;
+        for (int nidx = 0; nidx < 6; nidx++) {
+            _neighbours[nidx][idx] = neighbours[nidx];
+        }
+    }
+
+    inline void setDiagonal(int idx, int diag) {
+        FLUIDSIM_ASSERT(idx >= 0 && idx < (int)_diag.size());
+        _diag[idx] = (unsigned char)diag;
+    }
+
+    inline int getNeighbourIndex(int idx, int dir) {
+        return _neighbours[dir][idx];
+    }
+
+    /*
+        result = A*x, where A has diagonal entries diag*scale and off 
+        diagonal entries -scale between neighbouring fluid cells
+    */
+    void apply(double *x, double *result, double scale, int begin, int end);
+
+    // v1 += v2*scale
+    static void addScaledVector(double *v1, double *v2, double scale, 
+                                int begin, int end);
+
+    // result = v1*s1 + v2*s2
+    static void addScaledVectors(double *v1, double s1, double *v2, double s2,
+                                 double *result, int begin, int end);
+
+    static double dot(double *v1, double *v2, int begin, int end);
+    static double absMaxCoeff(double *v, int begin, int end);
+
+    /*
+        Name of the instruction set that the kernels use on this processor
+    */
+    static const char* getInstructionSet();
+
+private:
+
+    std::vector<unsigned char> _diag;
+    std::vector<int> _neighbours[6];
+
+};
+
+#endif
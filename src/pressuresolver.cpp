@@ -111,31 +111,87 @@ PressureSolver::PressureSolver() {
 }
 
 PressureSolver::~PressureSolver() {
+    if (_isThreadPoolOwner) {
+        delete _threadPool;
+    }
 }
 
 void PressureSolver::solve(PressureSolverParameters params, VectorXd &pressure) {
 	_initialize(params);
 
     FLUIDSIM_ASSERT(pressure.size() == (unsigned int)_matSize);
-    pressure.fill(0.0);
+    if (!_isWarmStartEnabled) {
+        pressure.fill(0.0);
+    }
 
-	_initializeGridIndexKeyMap();
+    _numIterations = 0;
+    _initialResidual = 0.0;
+    _residual = 0.0;
+    _isConverged = true;
+
+    // The keymap, the matrix and the operator neighbours only depend on the
+    // fluid cells and are kept between solves while the fluid cells do not 
+    // change. The matrix diagonal also depends on the solid cells and is 
+    // always recalculated.
+    if (!_isFluidCellCacheValid()) {
+        _initializeGridIndexKeyMap();
+        _updateFluidCellCache();
+    }
 
 	VectorXd b(_matSize);
 	_calculateNegativeDivergenceVector(b);
-	if (b.absMaxCoeff() < _pressureSolveTolerance) {
+	if (!_isWarmStartEnabled && _absMaxCoeff(b) < _pressureSolveTolerance) {
+        _initialResidual = _residual = _absMaxCoeff(b);
 		return;
 	}
 
-    MatrixCoefficients A(_matSize);
-    _calculateMatrixCoefficients(A);
+    MatrixCoefficients &A = _matrix;
+    if (_isMatrixCached) {
+        _calculateMatrixDiagonal(A);
+    } else {
+        A = MatrixCoefficients(_matSize);
+        _calculateMatrixCoefficients(A);
+        _isMatrixCached = true;
+    }
+
+    if (_isMatrixFreeOperatorEnabled) {
+        if (_isPressureOperatorCached) {
+            _updatePressureOperatorDiagonal(A);
+        } else {
+            _initializePressureOperator(A);
+            _isPressureOperatorCached = true;
+        }
+    }
 
     VectorXd precon(_matSize);
-    _calculatePreconditionerVector(A, precon);
+    if (_preconditioner == PressureSolverPreconditioner::multigrid) {
+        _multigridPreconditioner.initialize(_materialGrid, _fluidCells, _threadPool);
+    } else if (_isMultithreadingEnabled) {
+        _initializeMulticolorBlocks();
+        _calculateMulticolorPreconditionerVector(A, precon);
+    } else {
+        _calculatePreconditionerVector(A, precon);
+    }
 
     _solvePressureSystem(A, b, precon, pressure);
 }
 
+int PressureSolver::getNumIterations() {
+    return _numIterations;
+}
+
+double PressureSolver::getInitialResidual() {
+    return _initialResidual;
+}
+
+double PressureSolver::getResidual() {
+    return _residual;
+}
+
+bool PressureSolver::isConverged() {
+    return _isConverged;
+}
+
 void PressureSolver::_initialize(PressureSolverParameters params) {
 	_isize = params.materialGrid->width;
 	_jsize = params.materialGrid->height;
@@ -148,8 +204,78 @@ void PressureSolver::_initialize(PressureSolverParameters params) {
 	_vField = params.velocityField;
     _logfile = params.logfile;
 	_matSize = (int)_fluidCells->size();
+    _isMultithreadingEnabled = params.isMultithreadingEnabled;
+    _isDeterministicReductionEnabled = params.isDeterministicReductionEnabled;
+    _preconditioner = params.preconditioner;
+    _isWarmStartEnabled = params.isWarmStartEnabled;
+    _isMatrixFreeOperatorEnabled = params.isMatrixFreeOperatorEnabled;
+
+    _initializeThreadPool(params);
+}
+
+void PressureSolver::_initializeThreadPool(PressureSolverParameters params) {
+    if (!_isMultithreadingEnabled) {
+        if (_isThreadPoolOwner) {
+            delete _threadPool;
+        }
+        _threadPool = nullptr;
+        _isThreadPoolOwner = false;
+        return;
+    }
 
+    if (params.threadPool != nullptr) {
+        if (_isThreadPoolOwner) {
+            delete _threadPool;
+        }
+        _threadPool = params.threadPool;
+        _numThreads = _threadPool->getNumThreads();
+        _isThreadPoolOwner = false;
+        return;
+    }
 
+    int numThreads = params.numThreads;
+    if (numThreads < 1) {
+        numThreads = ThreadPool::getMaxThreadCount();
+    }
+
+    if (_isThreadPoolOwner && _numThreads == numThreads) {
+        return;
+    }
+
+    if (_isThreadPoolOwner) {
+        delete _threadPool;
+    }
+    _threadPool = new ThreadPool(numThreads);
+    _numThreads = numThreads;
+    _isThreadPoolOwner = true;
+}
+
+bool PressureSolver::_isFluidCellCacheValid() {
+    if (_cacheIsize != _isize || _cacheJsize != _jsize || _cacheKsize != _ksize ||
+            _cachedFluidCells.size() != _fluidCells->size()) {
+        return false;
+    }
+
+    for (unsigned int idx = 0; idx < _cachedFluidCells.size(); idx++) {
+        if (_cachedFluidCells[idx] != _fluidCells->getFlatIndex(idx)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void PressureSolver::_updateFluidCellCache() {
+    _cacheIsize = _isize;
+    _cacheJsize = _jsize;
+    _cacheKsize = _ksize;
+    _cachedFluidCells.resize(_fluidCells->size());
+    for (unsigned int idx = 0; idx < _cachedFluidCells.size(); idx++) {
+        _cachedFluidCells[idx] = _fluidCells->getFlatIndex(idx);
+    }
+
+    _isMatrixCached = false;
+    _isPressureOperatorCached = false;
 }
 
 void PressureSolver::_initializeGridIndexKeyMap() {
@@ -159,51 +285,157 @@ void PressureSolver::_initializeGridIndexKeyMap() {
 	}
 }
 
-void PressureSolver::_calculateNegativeDivergenceVector(VectorXd &b) {
-
-	double scale = 1.0f / (float)_dx;
+/*
+    Partitions the fluid cells into cubic blocks of _preconditionerBlockSize
+    cells per side. Blocks are colored by the parity of their block 
+    coordinates and ordered by color so that blocks of the same color are 
+    never adjacent. Cells within a block keep their relative order in the 
+    fluid cell list.
+*/
+void PressureSolver::_initializeMulticolorBlocks() {
+    int bsize = _preconditionerBlockSize;
+    int bi = (_isize + bsize - 1) / bsize;
+    int bj = (_jsize + bsize - 1) / bsize;
+    int bk = (_ksize + bsize - 1) / bsize;
+    int numBlocks = bi*bj*bk;
+
+    std::vector<int> cellBlocks(_matSize);
+    std::vector<int> blockCounts(numBlocks, 0);
+    GridIndex g;
     for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
+        g = _fluidCells->at(idx);
+        int blockidx = Grid3d::getFlatIndex(g.i / bsize, g.j / bsize, g.k / bsize, bi, bj);
+        cellBlocks[idx] = blockidx;
+        blockCounts[blockidx]++;
+    }
 
-        double value = -scale * (double)(_vField->U(i + 1, j, k) - _vField->U(i, j, k) +
-                                         _vField->V(i, j + 1, k) - _vField->V(i, j, k) +
-                                         _vField->W(i, j, k + 1) - _vField->W(i, j, k));
-        
-        b[_GridToVectorIndex(i, j, k)] = value;
+    std::vector<int> blockStarts(numBlocks, -1);
+    _blockOffsets.clear();
+    _colorBlockOffsets.assign(_numPreconditionerColors + 1, 0);
+    int offset = 0;
+    for (int color = 0; color < _numPreconditionerColors; color++) {
+        _colorBlockOffsets[color] = (int)_blockOffsets.size();
+        for (int k = 0; k < bk; k++) {
+            for (int j = 0; j < bj; j++) {
+                for (int i = 0; i < bi; i++) {
+                    int blockidx = Grid3d::getFlatIndex(i, j, k, bi, bj);
+                    if (_getBlockColor(i, j, k) != color || blockCounts[blockidx] == 0) {
+                        continue;
+                    }
+                    blockStarts[blockidx] = offset;
+                    _blockOffsets.push_back(offset);
+                    offset += blockCounts[blockidx];
+                }
+            }
+        }
     }
+    _colorBlockOffsets[_numPreconditionerColors] = (int)_blockOffsets.size();
+    _blockOffsets.push_back(offset);
 
-    // No functionality for moving solid cells, so velocity is 0
-    float usolid = 0.0;
-    float vsolid = 0.0;
-    float wsolid = 0.0;
+    _blockCells.resize(_matSize);
     for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
-        int vidx = _GridToVectorIndex(i, j, k);
+        int blockidx = cellBlocks[idx];
+        _blockCells[blockStarts[blockidx]] = idx;
+        blockStarts[blockidx]++;
+    }
 
-        if (_materialGrid->isCellSolid(i-1, j, k)) {
-            b[vidx] -= (float)scale*(_vField->U(i, j, k) - usolid);
-        }
-        if (_materialGrid->isCellSolid(i+1, j, k)) {
-            b[vidx] += (float)scale*(_vField->U(i+1, j, k) - usolid);
+    // Bit n of a cell's mask is set if its nth neighbour is a fluid cell 
+    // that is ordered before it
+    _lowerNeighbourMasks.assign(_matSize, 0x00);
+    _parallelForRange(_matSize, [this](int begin, int end) {
+        GridIndex nbs[6];
+        for (int idx = begin; idx < end; idx++) {
+            GridIndex g = _fluidCells->at(idx);
+            Grid3d::getNeighbourGridIndices6(g, nbs);
+
+            unsigned char mask = 0x00;
+            for (int nidx = 0; nidx < 6; nidx++) {
+                if (_keymap.find(nbs[nidx]) != -1 && _isCellOrderedBefore(nbs[nidx], g)) {
+                    mask |= (unsigned char)(1 << nidx);
+                }
+            }
+            _lowerNeighbourMasks[idx] = mask;
         }
+    });
+}
 
-        if (_materialGrid->isCellSolid(i, j-1, k)) {
-            b[vidx] -= (float)scale*(_vField->V(i, j, k) - vsolid);
+void PressureSolver::_updatePressureOperatorDiagonal(MatrixCoefficients &A) {
+    _parallelForRange(_matSize, [this, &A](int begin, int end) {
+        for (int idx = begin; idx < end; idx++) {
+            _pressureOperator.setDiagonal(idx, A.cells[idx].diag);
         }
-        if (_materialGrid->isCellSolid(i, j+1, k)) {
-            b[vidx] += (float)scale*(_vField->V(i, j+1, k) - vsolid);
+    });
+}
+
+void PressureSolver::_initializePressureOperator(MatrixCoefficients &A) {
+    _pressureOperator.resize(_matSize);
+    _parallelForRange(_matSize, [this, &A](int begin, int end) {
+        GridIndex nbs[6];
+        int neighbours[6];
+        for (int idx = begin; idx < end; idx++) {
+            Grid3d::getNeighbourGridIndices6(_fluidCells->at(idx), nbs);
+            for (int nidx = 0; nidx < 6; nidx++) {
+                neighbours[nidx] = _keymap.find(nbs[nidx]);
+            }
+            _pressureOperator.setCell(idx, A.cells[idx].diag, neighbours);
         }
+    });
+}
+
+void PressureSolver::_calculateNegativeDivergenceVector(VectorXd &b) {
 
-        if (_materialGrid->isCellSolid(i, j, k-1)) {
-            b[vidx] -=  (float)scale*(_vField->W(i, j, k) - wsolid);
+	double scale = 1.0f / (float)_dx;
+    _parallelForRange(_matSize, [this, &b, scale](int begin, int end) {
+        for (int idx = begin; idx < end; idx++) {
+            int i = _fluidCells->at(idx).i;
+            int j = _fluidCells->at(idx).j;
+            int k = _fluidCells->at(idx).k;
+
+            double value = -scale * (double)(_vField->U(i + 1, j, k) - _vField->U(i, j, k) +
+                                             _vField->V(i, j + 1, k) - _vField->V(i, j, k) +
+                                             _vField->W(i, j, k + 1) - _vField->W(i, j, k));
+            
+            b[_GridToVectorIndex(i, j, k)] = value;
         }
-        if (_materialGrid->isCellSolid(i, j, k+1)) {
-            b[vidx] += (float)scale*(_vField->W(i, j, k+1) - wsolid);
+    });
+
+    // No functionality for moving solid cells, so velocity is 0
+    _parallelForRange(_matSize, [this, &b, scale](int begin, int end) {
+        for (int idx = begin; idx < end; idx++) {
+            _addSolidCellDivergence(idx, scale, b);
         }
+    });
+}
+
+void PressureSolver::_addSolidCellDivergence(int idx, double scale, VectorXd &b) {
+    float usolid = 0.0;
+    float vsolid = 0.0;
+    float wsolid = 0.0;
+
+    int i = _fluidCells->at(idx).i;
+    int j = _fluidCells->at(idx).j;
+    int k = _fluidCells->at(idx).k;
+    int vidx = _GridToVectorIndex(i, j, k);
+
+    if (_materialGrid->isCellSolid(i-1, j, k)) {
+        b[vidx] -= (float)scale*(_vField->U(i, j, k) - usolid);
+    }
+    if (_materialGrid->isCellSolid(i+1, j, k)) {
+        b[vidx] += (float)scale*(_vField->U(i+1, j, k) - usolid);
+    }
+
+    if (_materialGrid->isCellSolid(i, j-1, k)) {
+        b[vidx] -= (float)scale*(_vField->V(i, j, k) - vsolid);
+    }
+    if (_materialGrid->isCellSolid(i, j+1, k)) {
+        b[vidx] += (float)scale*(_vField->V(i, j+1, k) - vsolid);
+    }
+
+    if (_materialGrid->isCellSolid(i, j, k-1)) {
+        b[vidx] -=  (float)scale*(_vField->W(i, j, k) - wsolid);
+    }
+    if (_materialGrid->isCellSolid(i, j, k+1)) {
+        b[vidx] += (float)scale*(_vField->W(i, j, k+1) - wsolid);
     }
 }
 
@@ -220,27 +452,40 @@ int PressureSolver::_getNumFluidOrAirCellNeighbours(int i, int j, int k) {
 }
 
 void PressureSolver::_calculateMatrixCoefficients(MatrixCoefficients &A) {
-    for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
-        int vidx = _GridToVectorIndex(i, j, k);
-
-        int n = _getNumFluidOrAirCellNeighbours(i, j, k);
-        A.cells[vidx].diag = (char)n;
-
-        if (_materialGrid->isCellFluid(i + 1, j, k)) {
-            A.cells[vidx].plusi = 0x01;
-        }
-
-        if (_materialGrid->isCellFluid(i, j + 1, k)) {
-            A.cells[vidx].plusj = 0x01;
+    _parallelForRange(_matSize, [this, &A](int begin, int end) {
+        for (int idx = begin; idx < end; idx++) {
+            int i = _fluidCells->at(idx).i;
+            int j = _fluidCells->at(idx).j;
+            int k = _fluidCells->at(idx).k;
+            int vidx = _GridToVectorIndex(i, j, k);
+
+            int n = _getNumFluidOrAirCellNeighbours(i, j, k);
+            A.cells[vidx].diag = (char)n;
+
+            if (_materialGrid->isCellFluid(i + 1, j, k)) {
+                A.cells[vidx].plusi = 0x01;
+            }
+
+            if (_materialGrid->isCellFluid(i, j + 1, k)) {
+                A.cells[vidx].plusj = 0x01;
+            }
+
+            if (_materialGrid->isCellFluid(i, j, k + 1)) {
+                A.cells[vidx].plusk = 0x01;
+            }
         }
+    });
+}
 
-        if (_materialGrid->isCellFluid(i, j, k + 1)) {
-            A.cells[vidx].plusk = 0x01;
+void PressureSolver::_calculateMatrixDiagonal(MatrixCoefficients &A) {
+    _parallelForRange(_matSize, [this, &A](int begin, int end) {
+        for (int idx = begin; idx < end; idx++) {
+            int i = _fluidCells->at(idx).i;
+            int j = _fluidCells->at(idx).j;
+            int k = _fluidCells->at(idx).k;
+            A.cells[idx].diag = (char)_getNumFluidOrAirCellNeighbours(i, j, k);
         }
-    }
+    });
 }
 
 void PressureSolver::_calculatePreconditionerVector(MatrixCoefficients &A, VectorXd &precon) {
@@ -385,52 +630,268 @@ void PressureSolver::_applyPreconditioner(MatrixCoefficients &A,
     }
 }
 
+/*
+    Block multicolor ordered MIC(0). The factorization and triangular solves
+    process blocks one color at a time. Blocks of the same color do not 
+    share any neighbouring cells, so they can be processed in parallel, 
+    while cells within a block are processed sequentially as in the 
+    natural ordering MIC(0) preconditioner.
+
+    The preconditioner vector stores the inverse pivot of each cell.
+*/
+void PressureSolver::_calculateMulticolorPreconditionerVector(MatrixCoefficients &A, 
+                                                              VectorXd &precon) {
+    FLUIDSIM_ASSERT(A.size() == precon.size());
+
+    double scale = _deltaTime / (_density*_dx*_dx);
+    double tau = 0.97;      // Tuning constant
+    double sigma = 0.25;    // safety constant
+
+    for (int color = 0; color < _numPreconditionerColors; color++) {
+        int blockBegin = _colorBlockOffsets[color];
+        int blockEnd = _colorBlockOffsets[color + 1];
+        _parallelForBlocks(blockBegin, blockEnd, 
+                           [this, &A, &precon, scale, tau, sigma](int bidx) {
+            GridIndex nbs[6];
+            GridIndex mbs[6];
+            for (int cidx = _blockOffsets[bidx]; cidx < _blockOffsets[bidx + 1]; cidx++) {
+                int vidx = _blockCells[cidx];
+                GridIndex g = _fluidCells->at(vidx);
+                Grid3d::getNeighbourGridIndices6(g, nbs);
+
+                unsigned char mask = _lowerNeighbourMasks[vidx];
+
+                double diag = (double)A[vidx].diag*scale;
+                double e = diag;
+                for (int nidx = 0; nidx < 6; nidx++) {
+                    if (!(mask & (1 << nidx))) {
+                        continue;
+                    }
+                    GridIndex n = nbs[nidx];
+                    int pidx = _keymap.find(n);
+
+                    // Fill-in between this cell and the cells that follow 
+                    // the previous neighbour is dropped and compensated for 
+                    // on the diagonal
+                    int nfill = 0;
+                    unsigned char nmask = _lowerNeighbourMasks[pidx];
+                    Grid3d::getNeighbourGridIndices6(n, mbs);
+                    for (int midx = 0; midx < 6; midx++) {
+                        GridIndex m = mbs[midx];
+                        if (m == g || (nmask & (1 << midx)) || _keymap.find(m) == -1) {
+                            continue;
+                        }
+                        nfill++;
+                    }
+
+                    e -= scale*scale*(1.0 + tau*nfill)*precon[pidx];
+                }
+
+                if (e < sigma*diag) {
+                    e = diag;
+                }
+
+                precon[vidx] = fabs(e) > 10e-9 ? 1.0 / e : 0.0;
+            }
+        });
+    }
+}
+
+/*
+    Same as _applyPreconditioner, with neighbour lookups resolved through 
+    the pressure operator. The off diagonal coefficient between two 
+    neighbouring fluid cells is always -scale.
+*/
+void PressureSolver::_applyMatrixFreePreconditioner(VectorXd &precon,
+                                                    VectorXd &residual,
+                                                    VectorXd &vect) {
+    double negscale = -(_deltaTime / (_density*_dx*_dx));
+    double *p = precon._vector.data();
+    double *r = residual._vector.data();
+    double *z = vect._vector.data();
+
+    // Solve A*q = residual
+    std::vector<double> q(_matSize);
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        double t = r[vidx];
+        for (int nidx = 0; nidx < 6; nidx += 2) {
+            int n = _pressureOperator.getNeighbourIndex(vidx, nidx);
+            if (n != -1) {
+                t -= negscale * p[n] * q[n];
+            }
+        }
+        q[vidx] = t*p[vidx];
+    }
+
+    // Solve transpose(A)*z = q
+    for (int vidx = _matSize - 1; vidx >= 0; vidx--) {
+        double preconval = p[vidx];
+        double t = q[vidx];
+        for (int nidx = 1; nidx < 6; nidx += 2) {
+            int n = _pressureOperator.getNeighbourIndex(vidx, nidx);
+            if (n != -1) {
+                t -= negscale * preconval * z[n];
+            }
+        }
+        z[vidx] = t*preconval;
+    }
+}
+
+void PressureSolver::_applyMulticolorPreconditioner(VectorXd &precon,
+                                                    VectorXd &residual,
+                                                    VectorXd &vect) {
+    double scale = _deltaTime / (_density*_dx*_dx);
+
+    // Solve lower triangular system in color order
+    for (int color = 0; color < _numPreconditionerColors; color++) {
+        int blockBegin = _colorBlockOffsets[color];
+        int blockEnd = _colorBlockOffsets[color + 1];
+        _parallelForBlocks(blockBegin, blockEnd, 
+                           [this, &precon, &residual, &vect, scale](int bidx) {
+            GridIndex nbs[6];
+            for (int cidx = _blockOffsets[bidx]; cidx < _blockOffsets[bidx + 1]; cidx++) {
+                int vidx = _blockCells[cidx];
+                GridIndex g = _fluidCells->at(vidx);
+                Grid3d::getNeighbourGridIndices6(g, nbs);
+
+                unsigned char mask = _lowerNeighbourMasks[vidx];
+
+                double sum = 0.0;
+                for (int nidx = 0; nidx < 6; nidx++) {
+                    if (mask & (1 << nidx)) {
+                        sum += vect._vector[_getNeighbourVectorIndex(vidx, nidx, nbs[nidx])];
+                    }
+                }
+
+                vect._vector[vidx] = (residual._vector[vidx] + scale*sum)*precon._vector[vidx];
+            }
+        });
+    }
+
+    // Solve upper triangular system in reverse color order
+    for (int color = _numPreconditionerColors - 1; color >= 0; color--) {
+        int blockBegin = _colorBlockOffsets[color];
+        int blockEnd = _colorBlockOffsets[color + 1];
+        _parallelForBlocks(blockBegin, blockEnd, 
+                           [this, &precon, &vect, scale](int bidx) {
+            GridIndex nbs[6];
+            for (int cidx = _blockOffsets[bidx + 1] - 1; cidx >= _blockOffsets[bidx]; cidx--) {
+                int vidx = _blockCells[cidx];
+                GridIndex g = _fluidCells->at(vidx);
+                Grid3d::getNeighbourGridIndices6(g, nbs);
+
+                unsigned char mask = _lowerNeighbourMasks[vidx];
+
+                double sum = 0.0;
+                for (int nidx = 0; nidx < 6; nidx++) {
+                    if (mask & (1 << nidx)) {
+                        continue;
+                    }
+                    int pidx = _getNeighbourVectorIndex(vidx, nidx, nbs[nidx]);
+                    if (pidx != -1) {
+                        sum += vect._vector[pidx];
+                    }
+                }
+
+                vect._vector[vidx] += scale*sum*precon._vector[vidx];
+            }
+        });
+    }
+}
+
+void PressureSolver::_applyMultigridPreconditioner(VectorXd &residual, VectorXd &vect) {
+    _multigridPreconditioner.apply(residual._vector, vect._vector);
+
+    // The multigrid V-cycle inverts the unscaled Poisson matrix
+    double invscale = (_density*_dx*_dx) / _deltaTime;
+    _parallelForRange((int)vect.size(), [&vect, invscale](int begin, int end) {
+        for (int idx = begin; idx < end; idx++) {
+            vect._vector[idx] *= invscale;
+        }
+    });
+}
+
+void PressureSolver::_precondition(MatrixCoefficients &A, 
+                                   VectorXd &precon,
+                                   VectorXd &residual,
+                                   VectorXd &vect) {
+    if (_preconditioner == PressureSolverPreconditioner::multigrid) {
+        _applyMultigridPreconditioner(residual, vect);
+    } else if (_isMultithreadingEnabled) {
+        _applyMulticolorPreconditioner(precon, residual, vect);
+    } else if (_isMatrixFreeOperatorEnabled) {
+        _applyMatrixFreePreconditioner(precon, residual, vect);
+    } else {
+        _applyPreconditioner(A, precon, residual, vect);
+    }
+}
+
 void PressureSolver::_applyMatrix(MatrixCoefficients &A, VectorXd &x, VectorXd &result) {
     FLUIDSIM_ASSERT(A.size() == x.size() && x.size() == result.size());
 
     double scale = _deltaTime / (_density*_dx*_dx);
     double negscale = -scale;
 
-    for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
+    if (_isMatrixFreeOperatorEnabled) {
+        _parallelForRange(_matSize, [this, &x, &result, scale](int begin, int end) {
+            _pressureOperator.apply(x._vector.data(), result._vector.data(), 
+                                    scale, begin, end);
+        });
+        return;
+    }
 
-        // val = dot product of column vector x and idxth row of matrix A
-        double val = 0.0;
-        int vidx = _GridToVectorIndex(i - 1, j, k);
-        if (vidx != -1) { val += x._vector[vidx]; }
+    _parallelForRange(_matSize, [this, &A, &x, &result, scale, negscale](int begin, int end) {
+        for (int idx = begin; idx < end; idx++) {
+            int i = _fluidCells->at(idx).i;
+            int j = _fluidCells->at(idx).j;
+            int k = _fluidCells->at(idx).k;
 
-        vidx = _GridToVectorIndex(i + 1, j, k);
-        if (vidx != -1) { val += x._vector[vidx]; }
+            // val = dot product of column vector x and idxth row of matrix A
+            double val = 0.0;
+            int vidx = _GridToVectorIndex(i - 1, j, k);
+            if (vidx != -1) { val += x._vector[vidx]; }
 
-        vidx = _GridToVectorIndex(i, j - 1, k);
-        if (vidx != -1) { val += x._vector[vidx]; }
+            vidx = _GridToVectorIndex(i + 1, j, k);
+            if (vidx != -1) { val += x._vector[vidx]; }
 
-        vidx = _GridToVectorIndex(i, j + 1, k);
-        if (vidx != -1) { val += x._vector[vidx]; }
+            vidx = _GridToVectorIndex(i, j - 1, k);
+            if (vidx != -1) { val += x._vector[vidx]; }
 
-        vidx = _GridToVectorIndex(i, j, k - 1);
-        if (vidx != -1) { val += x._vector[vidx]; }
+            vidx = _GridToVectorIndex(i, j + 1, k);
+            if (vidx != -1) { val += x._vector[vidx]; }
 
-        vidx = _GridToVectorIndex(i, j, k + 1);
-        if (vidx != -1) { val += x._vector[vidx]; }
+            vidx = _GridToVectorIndex(i, j, k - 1);
+            if (vidx != -1) { val += x._vector[vidx]; }
 
-        val *= negscale;
+            vidx = _GridToVectorIndex(i, j, k + 1);
+            if (vidx != -1) { val += x._vector[vidx]; }
 
-        vidx = _GridToVectorIndex(i, j, k);
-        val += (double)A.cells[vidx].diag * scale * x._vector[vidx];
+            val *= negscale;
 
-        result._vector[vidx] = val;
-    }
+            vidx = _GridToVectorIndex(i, j, k);
+            val += (double)A.cells[vidx].diag * scale * x._vector[vidx];
+
+            result._vector[vidx] = val;
+        }
+    });
 }
 
 // v1 += v2*scale
 void PressureSolver::_addScaledVector(VectorXd &v1, VectorXd &v2, double scale) {
     FLUIDSIM_ASSERT(v1.size() == v2.size());
-    for (unsigned int idx = 0; idx < v1.size(); idx++) {
-        v1._vector[idx] += v2._vector[idx]*scale;
+    if (_isMatrixFreeOperatorEnabled) {
+        _parallelForRange((int)v1.size(), [&v1, &v2, scale](int begin, int end) {
+            PressureOperator::addScaledVector(v1._vector.data(), v2._vector.data(), 
+                                              scale, begin, end);
+        });
+        return;
     }
+
+    _parallelForRange((int)v1.size(), [&v1, &v2, scale](int begin, int end) {
+        for (int idx = begin; idx < end; idx++) {
+            v1._vector[idx] += v2._vector[idx]*scale;
+        }
+    });
 }
 
 // result = v1*s1 + v2*s2
@@ -438,48 +899,187 @@ void PressureSolver::_addScaledVectors(VectorXd &v1, double s1,
                                        VectorXd &v2, double s2,
                                        VectorXd &result) {
     FLUIDSIM_ASSERT(v1.size() == v2.size() && v2.size() == result.size());
-    for (unsigned int idx = 0; idx < v1.size(); idx++) {
-        result._vector[idx] = v1._vector[idx]*s1 + v2._vector[idx]*s2;
+    if (_isMatrixFreeOperatorEnabled) {
+        _parallelForRange((int)v1.size(), [&v1, s1, &v2, s2, &result](int begin, int end) {
+            PressureOperator::addScaledVectors(v1._vector.data(), s1, 
+                                               v2._vector.data(), s2,
+                                               result._vector.data(), begin, end);
+        });
+        return;
+    }
+
+    _parallelForRange((int)v1.size(), [&v1, s1, &v2, s2, &result](int begin, int end) {
+        for (int idx = begin; idx < end; idx++) {
+            result._vector[idx] = v1._vector[idx]*s1 + v2._vector[idx]*s2;
+        }
+    });
+}
+
+double PressureSolver::_dot(VectorXd &v1, VectorXd &v2) {
+    FLUIDSIM_ASSERT(v1.size() == v2.size());
+    if (_isMatrixFreeOperatorEnabled) {
+        return _parallelSum((int)v1.size(), [&v1, &v2](int begin, int end) {
+            return PressureOperator::dot(v1._vector.data(), v2._vector.data(), begin, end);
+        });
+    }
+
+    return _parallelSum((int)v1.size(), [&v1, &v2](int begin, int end) {
+        double sum = 0.0;
+        for (int idx = begin; idx < end; idx++) {
+            sum += v1._vector[idx] * v2._vector[idx];
+        }
+        return sum;
+    });
+}
+
+double PressureSolver::_absMaxCoeff(VectorXd &v) {
+    if (_isMatrixFreeOperatorEnabled) {
+        return _parallelMax((int)v.size(), [&v](int begin, int end) {
+            return PressureOperator::absMaxCoeff(v._vector.data(), begin, end);
+        });
+    }
+
+    return _parallelMax((int)v.size(), [&v](int begin, int end) {
+        double max = -std::numeric_limits<double>::infinity();
+        for (int idx = begin; idx < end; idx++) {
+            if (fabs(v._vector[idx]) > max) {
+                max = fabs(v._vector[idx]);
+            }
+        }
+        return max;
+    });
+}
+
+void PressureSolver::_parallelForRange(int size, std::function<void(int, int)> func) {
+    if (_threadPool == nullptr || size < 2*_minRangeSize) {
+        func(0, size);
+        return;
+    }
+
+    int grainSize = std::max(_minRangeSize, size / (4*_numThreads) + 1);
+    _threadPool->parallelForRange(0, size, grainSize, func);
+}
+
+/*
+    With deterministic reductions the range is split into fixed size blocks
+    independent of the thread count and partial sums are added in block
+    order. Otherwise each thread accumulates into the total as it finishes.
+*/
+double PressureSolver::_parallelSum(int size, std::function<double(int, int)> func) {
+    if (_threadPool == nullptr) {
+        return func(0, size);
     }
+
+    if (_isDeterministicReductionEnabled) {
+        int blockSize = _reductionBlockSize;
+        int numBlocks = (size + blockSize - 1) / blockSize;
+        std::vector<double> partialSums(numBlocks, 0.0);
+        _threadPool->parallelForRange(0, size, blockSize, 
+                                      [&partialSums, &func, blockSize](int begin, int end) {
+            partialSums[begin / blockSize] = func(begin, end);
+        });
+
+        double sum = 0.0;
+        for (unsigned int i = 0; i < partialSums.size(); i++) {
+            sum += partialSums[i];
+        }
+        return sum;
+    }
+
+    if (size < 2*_minRangeSize) {
+        return func(0, size);
+    }
+
+    double sum = 0.0;
+    std::mutex sumMutex;
+    int grainSize = size / _numThreads + 1;
+    _threadPool->parallelForRange(0, size, grainSize, 
+                                  [&sum, &sumMutex, &func](int begin, int end) {
+        double partial = func(begin, end);
+        std::lock_guard<std::mutex> lock(sumMutex);
+        sum += partial;
+    });
+
+    return sum;
+}
+
+void PressureSolver::_parallelForBlocks(int begin, int end, std::function<void(int)> func) {
+    if (_threadPool == nullptr) {
+        for (int bidx = begin; bidx < end; bidx++) {
+            func(bidx);
+        }
+        return;
+    }
+
+    _threadPool->run(end - begin, [begin, &func](int taskid) {
+        func(begin + taskid);
+    });
+}
+
+double PressureSolver::_parallelMax(int size, std::function<double(int, int)> func) {
+    if (_threadPool == nullptr || size < 2*_minRangeSize) {
+        return func(0, size);
+    }
+
+    int grainSize = size / _numThreads + 1;
+    int numRanges = (size + grainSize - 1) / grainSize;
+    std::vector<double> partialMax(numRanges, -std::numeric_limits<double>::infinity());
+    _threadPool->parallelForRange(0, size, grainSize, 
+                                  [&partialMax, &func, grainSize](int begin, int end) {
+        partialMax[begin / grainSize] = func(begin, end);
+    });
+
+    return *std::max_element(partialMax.begin(), partialMax.end());
 }
 
 // Solve (A*pressure = b) with Modified Incomplete Cholesky 
-// Conjugate Gradient method (MICCG(0))
+// Conjugate Gradient method (MICCG(0)), or with multigrid preconditioned
+// Conjugate Gradient (MGPCG) if the multigrid preconditioner is selected
 void PressureSolver::_solvePressureSystem(MatrixCoefficients &A, 
                                           VectorXd &b, 
                                           VectorXd &precon,
                                           VectorXd &pressure) {
 
     double tol = _pressureSolveTolerance;
-    if (b.absMaxCoeff() < tol) {
-        return;
-    }
 
     VectorXd residual(b);
     VectorXd auxillary(_matSize);
-    _applyPreconditioner(A, precon, residual, auxillary);
+    if (_isWarmStartEnabled) {
+        _applyMatrix(A, pressure, auxillary);
+        _addScaledVector(residual, auxillary, -1.0);
+    }
+
+    _initialResidual = _absMaxCoeff(residual);
+    _residual = _initialResidual;
+    if (_initialResidual < tol) {
+        return;
+    }
+
+    _precondition(A, precon, residual, auxillary);
 
     VectorXd search(auxillary);
 
     double alpha = 0.0;
     double beta = 0.0;
-    double sigma = auxillary.dot(residual);
+    double sigma = _dot(auxillary, residual);
     double sigmaNew = 0.0;
     int iterationNumber = 0;
 
     while (iterationNumber < _maxCGIterations) {
         _applyMatrix(A, search, auxillary);
-        alpha = sigma / auxillary.dot(search);
+        alpha = sigma / _dot(auxillary, search);
         _addScaledVector(pressure, search, alpha);
         _addScaledVector(residual, auxillary, -alpha);
 
-        if (residual.absMaxCoeff() < tol) {
-            _logfile->log("CG Iterations: ", iterationNumber, 1);
+        _residual = _absMaxCoeff(residual);
+        if (_residual < tol) {
+            _numIterations = iterationNumber + 1;
+            _logfile->log("CG Iterations: ", _numIterations, 1);
             return;
         }
 
-        _applyPreconditioner(A, precon, residual, auxillary);
-        sigmaNew = auxillary.dot(residual);
+        _precondition(A, precon, residual, auxillary);
+        sigmaNew = _dot(auxillary, residual);
         beta = sigmaNew / sigma;
         _addScaledVectors(auxillary, 1.0, search, beta, search);
         sigma = sigmaNew;
@@ -489,11 +1089,13 @@ void PressureSolver::_solvePressureSystem(MatrixCoefficients &A,
         if (iterationNumber % 10 == 0) {
             std::ostringstream ss;
             ss << "\tIteration #: " << iterationNumber <<
-                  "\tEstimated Error: " << residual.absMaxCoeff() << std::endl;
+                  "\tEstimated Error: " << _absMaxCoeff(residual) << std::endl;
             _logfile->print(ss.str());
         }
     }
 
+    _numIterations = iterationNumber;
+    _isConverged = false;
     _logfile->log("Iterations limit reached.\t Estimated error : ",
-                  residual.absMaxCoeff(), 1);
+                  _residual, 1);
 }
\ No newline at end of file
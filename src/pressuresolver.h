@@ -25,6 +25,8 @@ freely, subject to the following restrictions:
 #include <iostream>
 #include <limits>
 #include <algorithm>
+#include <functional>
+#include <mutex>
 
 #include "macvelocityfield.h"
 #include "gridindexkeymap.h"
@@ -34,6 +36,14 @@ freely, subject to the following restrictions:
 #include "fluidmaterialgrid.h"
 #include "gridindexvector.h"
 #include "fluidsimassert.h"
+#include "threadpool.h"
+#include "multigridpreconditioner.h"
+#include "pressureoperator.h"
+
+enum class PressureSolverPreconditioner : char { 
+    mic       = 0x00, 
+    multigrid = 0x01
+};
 
 struct PressureSolverParameters {
     double cellwidth;
@@ -44,6 +54,32 @@ struct PressureSolverParameters {
     FluidMaterialGrid *materialGrid;
     MACVelocityField *velocityField;
     LogFile *logfile;
+
+    // When multithreading is enabled, vector operations are split across
+    // numThreads threads and the sequential MIC(0) preconditioner is replaced
+    // by a block multicolor ordered variant that can be applied in parallel.
+    // Deterministic reductions sum partial results in a fixed block order
+    // so that results do not depend on thread scheduling. If threadPool is 
+    // set, its threads are used instead of creating a pool of numThreads 
+    // threads.
+    bool isMultithreadingEnabled = false;
+    bool isDeterministicReductionEnabled = true;
+    int numThreads = 1;
+    ThreadPool *threadPool = nullptr;
+
+    // The multigrid preconditioner keeps CG iteration counts roughly 
+    // independent of grid resolution at a higher cost per iteration.
+    PressureSolverPreconditioner preconditioner = PressureSolverPreconditioner::mic;
+
+    // When warm start is enabled, the values in the pressure vector passed
+    // to PressureSolver::solve() are used as the initial guess.
+    bool isWarmStartEnabled = false;
+
+    // When the matrix-free operator is enabled, the neighbours of each fluid
+    // cell are resolved once per solve into flat index arrays and the matrix 
+    // and vector kernels run on these arrays instead of performing grid 
+    // lookups on every iteration.
+    bool isMatrixFreeOperatorEnabled = false;
 };
 
 /********************************************************************************
@@ -116,8 +152,21 @@ public:
 
     void solve(PressureSolverParameters params, VectorXd &pressure);
 
+    /*
+        Statistics of the most recent solve. Residuals are the maximum
+        absolute value of the residual vector before the first and after 
+        the last iteration.
+    */
+    int getNumIterations();
+    double getInitialResidual();
+    double getResidual();
+    bool isConverged();
+
 private:
 
+    PressureSolver(const PressureSolver &) = delete;
+    PressureSolver& operator=(const PressureSolver &) = delete;
+
     inline int _GridToVectorIndex(GridIndex g) {
         return _keymap.find(g);
     }
@@ -127,13 +176,43 @@ private:
     inline GridIndex _VectorToGridIndex(int i) {
         return _fluidCells->at(i);
     }
+    inline int _getNeighbourVectorIndex(int vidx, int dir, GridIndex n) {
+        if (_isMatrixFreeOperatorEnabled) {
+            return _pressureOperator.getNeighbourIndex(vidx, dir);
+        }
+        return _keymap.find(n);
+    }
+    inline int _getBlockColor(int bi, int bj, int bk) {
+        return (bi & 1) | ((bj & 1) << 1) | ((bk & 1) << 2);
+    }
+
+    // Ordering of two neighbouring cells in the block multicolor 
+    // preconditioner
+    inline bool _isCellOrderedBefore(GridIndex g1, GridIndex g2) {
+        int bsize = _preconditionerBlockSize;
+        int bi1 = g1.i / bsize, bj1 = g1.j / bsize, bk1 = g1.k / bsize;
+        int bi2 = g2.i / bsize, bj2 = g2.j / bsize, bk2 = g2.k / bsize;
+        if (bi1 == bi2 && bj1 == bj2 && bk1 == bk2) {
+            return g1.i + g1.j + g1.k < g2.i + g2.j + g2.k;
+        }
+        return _getBlockColor(bi1, bj1, bk1) < _getBlockColor(bi2, bj2, bk2);
+    }
 
     void _initialize(PressureSolverParameters params);
+    void _initializeThreadPool(PressureSolverParameters params);
+    bool _isFluidCellCacheValid();
+    void _updateFluidCellCache();
     void _initializeGridIndexKeyMap();
+    void _initializeMulticolorBlocks();
+    void _initializePressureOperator(MatrixCoefficients &A);
+    void _updatePressureOperatorDiagonal(MatrixCoefficients &A);
     void _calculateNegativeDivergenceVector(VectorXd &b);
+    void _addSolidCellDivergence(int idx, double scale, VectorXd &b);
     void _calculateMatrixCoefficients(MatrixCoefficients &A);
+    void _calculateMatrixDiagonal(MatrixCoefficients &A);
     int _getNumFluidOrAirCellNeighbours(int i, int j, int k);
     void _calculatePreconditionerVector(MatrixCoefficients &A, VectorXd &precon);
+    void _calculateMulticolorPreconditionerVector(MatrixCoefficients &A, VectorXd &precon);
     void _solvePressureSystem(MatrixCoefficients &A, 
                               VectorXd &b, 
                               VectorXd &precon,
@@ -142,11 +221,29 @@ private:
                               VectorXd &precon,
                               VectorXd &residual,
                               VectorXd &vect);
+    void _applyMatrixFreePreconditioner(VectorXd &precon,
+                                        VectorXd &residual,
+                                        VectorXd &vect);
+    void _applyMulticolorPreconditioner(VectorXd &precon,
+                                        VectorXd &residual,
+                                        VectorXd &vect);
+    void _applyMultigridPreconditioner(VectorXd &residual, VectorXd &vect);
+    void _precondition(MatrixCoefficients &A, 
+                       VectorXd &precon,
+                       VectorXd &residual,
+                       VectorXd &vect);
     void _applyMatrix(MatrixCoefficients &A, VectorXd &x, VectorXd &result);
     void _addScaledVector(VectorXd &v1, VectorXd &v2, double scale);
     void _addScaledVectors(VectorXd &v1, double s1, 
                            VectorXd &v2, double s2,
                            VectorXd &result);
+    double _dot(VectorXd &v1, VectorXd &v2);
+    double _absMaxCoeff(VectorXd &v);
+
+    void _parallelForRange(int size, std::function<void(int, int)> func);
+    double _parallelSum(int size, std::function<double(int, int)> func);
+    double _parallelMax(int size, std::function<double(int, int)> func);
+    void _parallelForBlocks(int begin, int end, std::function<void(int)> func);
 
     int _isize = 0;
     int _jsize = 0;
@@ -159,12 +256,47 @@ private:
     double _pressureSolveTolerance = 1e-6;
     int _maxCGIterations = 200;
 
+    bool _isWarmStartEnabled = false;
+    int _numIterations = 0;
+    double _initialResidual = 0.0;
+    double _residual = 0.0;
+    bool _isConverged = true;
+
+    bool _isMultithreadingEnabled = false;
+    bool _isDeterministicReductionEnabled = true;
+    int _numThreads = 1;
+    int _minRangeSize = 2048;
+    int _reductionBlockSize = 4096;
+    ThreadPool *_threadPool = nullptr;
+    bool _isThreadPoolOwner = false;
+
+    int _numPreconditionerColors = 8;
+    int _preconditionerBlockSize = 8;
+    std::vector<int> _blockCells;
+    std::vector<int> _blockOffsets;
+    std::vector<int> _colorBlockOffsets;
+    std::vector<unsigned char> _lowerNeighbourMasks;
+
+    bool _isMatrixFreeOperatorEnabled = false;
+    PressureOperator _pressureOperator;
+
+    PressureSolverPreconditioner _preconditioner = PressureSolverPreconditioner::mic;
+    MultigridPreconditioner _multigridPreconditioner;
+
     GridIndexVector *_fluidCells;
     FluidMaterialGrid *_materialGrid;
     MACVelocityField *_vField;
     LogFile *_logfile;
     GridIndexKeyMap _keymap;
 
+    MatrixCoefficients _matrix;
+    std::vector<unsigned int> _cachedFluidCells;
+    int _cacheIsize = 0;
+    int _cacheJsize = 0;
+    int _cacheKsize = 0;
+    bool _isMatrixCached = false;
+    bool _isPressureOperatorCached = false;
+
 };
 
 #endif
\ No newline at end of file
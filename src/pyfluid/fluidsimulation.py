@@ -1,5 +1,5 @@
 import ctypes
-from ctypes import c_void_p, c_char_p, c_char, c_int, c_float, c_double, byref
+from ctypes import c_void_p, c_char_p, c_char, c_int, c_longlong, c_float, c_double, byref
 import numbers
 
 from .pyfluid import pyfluid as lib
@@ -243,6 +243,34 @@ class FluidSimulation(object):
         pb.init_lib_func(libfunc, [c_void_p, c_int, c_void_p], None)
         pb.execute_lib_func(libfunc, [self(), slices])
 
+    @property
+    def max_polygonizer_memory(self):
+        libfunc = lib.FluidSimulation_get_max_polygonizer_memory
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_longlong)
+        return pb.execute_lib_func(libfunc, [self()])
+
+    @max_polygonizer_memory.setter
+    @decorators.check_ge_zero
+    def max_polygonizer_memory(self, nbytes):
+        libfunc = lib.FluidSimulation_set_max_polygonizer_memory
+        pb.init_lib_func(libfunc, [c_void_p, c_longlong, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self(), nbytes])
+
+    @property
+    def enable_sparse_surface_reconstruction(self):
+        libfunc = lib.FluidSimulation_is_sparse_surface_reconstruction_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_sparse_surface_reconstruction.setter
+    def enable_sparse_surface_reconstruction(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_sparse_surface_reconstruction
+        else:
+            libfunc = lib.FluidSimulation_disable_sparse_surface_reconstruction
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
     @property
     def min_polyhedron_triangle_count(self):
         libfunc = lib.FluidSimulation_get_min_polyhedron_triangle_count
@@ -344,6 +372,21 @@ class FluidSimulation(object):
         pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
         pb.execute_lib_func(libfunc, [self()])
 
+    @property
+    def enable_levelset_fast_sweeping(self):
+        libfunc = lib.FluidSimulation_is_levelset_fast_sweeping_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_levelset_fast_sweeping.setter
+    def enable_levelset_fast_sweeping(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_levelset_fast_sweeping
+        else:
+            libfunc = lib.FluidSimulation_disable_levelset_fast_sweeping
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
     @property
     def enable_diffuse_material_output(self):
         libfunc = lib.FluidSimulation_is_diffuse_material_output_enabled
@@ -508,6 +551,130 @@ class FluidSimulation(object):
         pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
         pb.execute_lib_func(libfunc, [self()])
 
+    @property
+    def enable_asynchronous_autosave(self):
+        libfunc = lib.FluidSimulation_is_asynchronous_autosave_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_asynchronous_autosave.setter
+    def enable_asynchronous_autosave(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_asynchronous_autosave
+        else:
+            libfunc = lib.FluidSimulation_disable_asynchronous_autosave
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    def flush_autosave(self):
+        libfunc = lib.FluidSimulation_flush_autosave
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    @property
+    def num_autosave_checkpoints(self):
+        libfunc = lib.FluidSimulation_get_num_autosave_checkpoints
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return pb.execute_lib_func(libfunc, [self()])
+
+    @num_autosave_checkpoints.setter
+    @decorators.check_ge(1)
+    def num_autosave_checkpoints(self, n):
+        libfunc = lib.FluidSimulation_set_num_autosave_checkpoints
+        pb.init_lib_func(libfunc, [c_void_p, c_int, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self(), n])
+
+    @property
+    def enable_incremental_autosave(self):
+        libfunc = lib.FluidSimulation_is_incremental_autosave_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_incremental_autosave.setter
+    def enable_incremental_autosave(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_incremental_autosave
+        else:
+            libfunc = lib.FluidSimulation_disable_incremental_autosave
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    @property
+    def autosave_full_checkpoint_interval(self):
+        libfunc = lib.FluidSimulation_get_autosave_full_checkpoint_interval
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return pb.execute_lib_func(libfunc, [self()])
+
+    @autosave_full_checkpoint_interval.setter
+    @decorators.check_ge(1)
+    def autosave_full_checkpoint_interval(self, n):
+        libfunc = lib.FluidSimulation_set_autosave_full_checkpoint_interval
+        pb.init_lib_func(libfunc, [c_void_p, c_int, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self(), n])
+
+    @property
+    def enable_savestate_compression(self):
+        libfunc = lib.FluidSimulation_is_savestate_compression_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_savestate_compression.setter
+    def enable_savestate_compression(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_savestate_compression
+        else:
+            libfunc = lib.FluidSimulation_disable_savestate_compression
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    @property
+    def enable_asynchronous_output(self):
+        libfunc = lib.FluidSimulation_is_asynchronous_output_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_asynchronous_output.setter
+    def enable_asynchronous_output(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_asynchronous_output
+        else:
+            libfunc = lib.FluidSimulation_disable_asynchronous_output
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    def flush_output(self):
+        libfunc = lib.FluidSimulation_flush_output
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    @property
+    def max_output_queue_size(self):
+        libfunc = lib.FluidSimulation_get_max_output_queue_size
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return pb.execute_lib_func(libfunc, [self()])
+
+    @max_output_queue_size.setter
+    @decorators.check_ge_zero
+    def max_output_queue_size(self, megabytes):
+        libfunc = lib.FluidSimulation_set_max_output_queue_size
+        pb.init_lib_func(libfunc, [c_void_p, c_int, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self(), megabytes])
+
+    def set_compute_backend_as_opencl(self):
+        libfunc = lib.FluidSimulation_set_compute_backend_as_opencl
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    def set_compute_backend_as_threaded(self):
+        libfunc = lib.FluidSimulation_set_compute_backend_as_threaded
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    def set_compute_backend_as_serial(self):
+        libfunc = lib.FluidSimulation_set_compute_backend_as_serial
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
     @property
     def enable_opencl_particle_advection(self):
         libfunc = lib.FluidSimulation_is_opencl_particle_advection_enabled
@@ -564,6 +731,109 @@ class FluidSimulation(object):
         pb.init_lib_func(libfunc, [c_void_p, c_int, c_void_p], None)
         pb.execute_lib_func(libfunc, [self(), size])
 
+    @property
+    def num_threads(self):
+        libfunc = lib.FluidSimulation_get_num_threads
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return pb.execute_lib_func(libfunc, [self()])
+
+    @num_threads.setter
+    @decorators.check_ge(1)
+    def num_threads(self, n):
+        libfunc = lib.FluidSimulation_set_num_threads
+        pb.init_lib_func(libfunc, [c_void_p, c_int, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self(), n])
+
+    @property
+    def enable_multithreaded_pressure_solver(self):
+        libfunc = lib.FluidSimulation_is_multithreaded_pressure_solver_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_multithreaded_pressure_solver.setter
+    def enable_multithreaded_pressure_solver(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_multithreaded_pressure_solver
+        else:
+            libfunc = lib.FluidSimulation_disable_multithreaded_pressure_solver
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    @property
+    def enable_deterministic_pressure_solver_reduction(self):
+        libfunc = lib.FluidSimulation_is_deterministic_pressure_solver_reduction_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_deterministic_pressure_solver_reduction.setter
+    def enable_deterministic_pressure_solver_reduction(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_deterministic_pressure_solver_reduction
+        else:
+            libfunc = lib.FluidSimulation_disable_deterministic_pressure_solver_reduction
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    @property
+    def enable_multigrid_pressure_solver(self):
+        libfunc = lib.FluidSimulation_is_multigrid_pressure_solver_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_multigrid_pressure_solver.setter
+    def enable_multigrid_pressure_solver(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_multigrid_pressure_solver
+        else:
+            libfunc = lib.FluidSimulation_disable_multigrid_pressure_solver
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    @property
+    def enable_pressure_solver_warm_start(self):
+        libfunc = lib.FluidSimulation_is_pressure_solver_warm_start_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_pressure_solver_warm_start.setter
+    def enable_pressure_solver_warm_start(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_pressure_solver_warm_start
+        else:
+            libfunc = lib.FluidSimulation_disable_pressure_solver_warm_start
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
+    def get_pressure_solver_iteration_count(self):
+        libfunc = lib.FluidSimulation_get_pressure_solver_iteration_count
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return pb.execute_lib_func(libfunc, [self()])
+
+    def get_pressure_solver_initial_residual(self):
+        libfunc = lib.FluidSimulation_get_pressure_solver_initial_residual
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_double)
+        return pb.execute_lib_func(libfunc, [self()])
+
+    def get_pressure_solver_residual(self):
+        libfunc = lib.FluidSimulation_get_pressure_solver_residual
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_double)
+        return pb.execute_lib_func(libfunc, [self()])
+
+    @property
+    def enable_matrix_free_pressure_operator(self):
+        libfunc = lib.FluidSimulation_is_matrix_free_pressure_operator_enabled
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @enable_matrix_free_pressure_operator.setter
+    def enable_matrix_free_pressure_operator(self, boolval):
+        if boolval:
+            libfunc = lib.FluidSimulation_enable_matrix_free_pressure_operator
+        else:
+            libfunc = lib.FluidSimulation_disable_matrix_free_pressure_operator
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], None)
+        pb.execute_lib_func(libfunc, [self()])
+
     @decorators.xyz_or_vector
     def add_body_force(self, fx, fy, fz):
         libfunc = lib.FluidSimulation_add_body_force
@@ -201,6 +201,24 @@ class FluidSimulationSaveState(object):
         pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
         return bool(pb.execute_lib_func(libfunc, [self()]))
 
+    @_check_load_state_initialized
+    def get_version(self):
+        libfunc = lib.FluidSimulationSaveState_get_version
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return pb.execute_lib_func(libfunc, [self()])
+
+    @_check_load_state_initialized
+    def verify_checksums(self):
+        libfunc = lib.FluidSimulationSaveState_verify_checksums
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
+    @_check_load_state_initialized
+    def is_delta_state(self):
+        libfunc = lib.FluidSimulationSaveState_is_delta_state
+        pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
+        return bool(pb.execute_lib_func(libfunc, [self()]))
+
     def is_load_state_initialized(self):
         libfunc = lib.FluidSimulationSaveState_is_load_state_initialized
         pb.init_lib_func(libfunc, [c_void_p, c_void_p], c_int)
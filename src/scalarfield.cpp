@@ -30,11 +30,29 @@ ScalarField::ScalarField(int i, int j, int k, double dx) :
                                                        _isVertexSet(i, j, k, false) {
 }
 
+ScalarField::ScalarField(int i, int j, int k, double dx, ScalarFieldStorage storage) :
+                                                       _isize(i), _jsize(j), _ksize(k), _dx(dx) {
+    if (storage == ScalarFieldStorage::sparse) {
+        _isSparseStorageEnabled = true;
+        _sparseField = SparseArray3d<float>(i, j, k, 0.0f);
+        _sparseIsVertexSolid = SparseArray3d<bool>(i, j, k, false);
+        _sparseIsVertexSet = SparseArray3d<bool>(i, j, k, false);
+    } else {
+        _field = Array3d<float>(i, j, k, 0.0f);
+        _isVertexSolid = Array3d<bool>(i, j, k, false);
+        _isVertexSet = Array3d<bool>(i, j, k, false);
+    }
+}
+
 ScalarField::~ScalarField() {
 }
 
 void ScalarField::clear() {
-    _field.fill(0.0);
+    if (_isSparseStorageEnabled) {
+        _sparseField.fill(0.0f);
+    } else {
+        _field.fill(0.0);
+    }
 }
 
 void ScalarField::setPointRadius(double r) {
@@ -79,7 +97,11 @@ void ScalarField::enableWeightField() {
         return;
     }
 
-    _weightField = Array3d<float>(_isize, _jsize, _ksize, 0.0f);
+    if (_isSparseStorageEnabled) {
+        _sparseWeightField = SparseArray3d<float>(_isize, _jsize, _ksize, 0.0f);
+    } else {
+        _weightField = Array3d<float>(_isize, _jsize, _ksize, 0.0f);
+    }
     _isWeightFieldEnabled = true;
 }
 
@@ -92,6 +114,31 @@ void ScalarField::applyWeightField() {
         return;
     }
 
+    if (_isSparseStorageEnabled) {
+        // Weights are only nonzero within allocated weight blocks
+        std::vector<GridIndex> blocks;
+        _sparseWeightField.getAllocatedBlocks(blocks);
+        int bsize = _sparseWeightField.getBlockSize();
+        for (unsigned int bidx = 0; bidx < blocks.size(); bidx++) {
+            GridIndex b = blocks[bidx];
+            int imax = (int)fmin((b.i + 1)*bsize, _isize);
+            int jmax = (int)fmin((b.j + 1)*bsize, _jsize);
+            int kmax = (int)fmin((b.k + 1)*bsize, _ksize);
+            for (int k = b.k*bsize; k < kmax; k++) {
+                for (int j = b.j*bsize; j < jmax; j++) {
+                    for (int i = b.i*bsize; i < imax; i++) {
+                        float weight = _sparseWeightField(i, j, k);
+                        if (weight > 0.0) {
+                            float v = _sparseField(i, j, k) / weight;
+                            setScalarFieldValue(i, j, k, v);
+                        }
+                    }
+                }
+            }
+        }
+        return;
+    }
+
     for (int k = 0; k < _ksize; k++) {
         for (int j = 0; j < _jsize; j++) {
             for (int i = 0; i < _isize; i++) {
@@ -114,8 +161,8 @@ double ScalarField::getWeight(int i, int j, int k) {
         return 0.0;
     }
 
-    FLUIDSIM_ASSERT(_weightField.isIndexInRange(i, j, k));
-    return _weightField(i, j, k);
+    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _isize, _jsize, _ksize));
+    return _getWeightValue(i, j, k);
 }
 
 void ScalarField::addPoint(vmath::vec3 p, double r) {
@@ -138,7 +185,8 @@ void ScalarField::addPoint(vmath::vec3 p) {
         for (int j = gmin.j; j <= gmax.j; j++) {
             for (int i = gmin.i; i <= gmax.i; i++) {
 
-                if (_isMaxScalarFieldThresholdSet && _field(i, j, k) > _maxScalarFieldThreshold) {
+                if (_isMaxScalarFieldThresholdSet && 
+                        _getFieldValue(i, j, k) > _maxScalarFieldThreshold) {
                     continue;
                 }
 
@@ -150,7 +198,7 @@ void ScalarField::addPoint(vmath::vec3 p) {
                     addScalarFieldValue(i, j, k, weight);
 
                     if (_isWeightFieldEnabled) {
-                        _weightField.add(i, j, k, (float)weight);
+                        _addWeightValue(i, j, k, (float)weight);
                     }
                 }
             }
@@ -179,7 +227,8 @@ void ScalarField::addPointValue(vmath::vec3 p, double scale) {
         for (int j = gmin.j; j <= gmax.j; j++) {
             for (int i = gmin.i; i <= gmax.i; i++) {
 
-                if (_isMaxScalarFieldThresholdSet && _field(i, j, k) > _maxScalarFieldThreshold) {
+                if (_isMaxScalarFieldThresholdSet && 
+                        _getFieldValue(i, j, k) > _maxScalarFieldThreshold) {
                     continue;
                 }
 
@@ -191,7 +240,7 @@ void ScalarField::addPointValue(vmath::vec3 p, double scale) {
                     addScalarFieldValue(i, j, k, weight*scale);
 
                     if (_isWeightFieldEnabled) {
-                        _weightField.add(i, j, k, (float)weight);
+                        _addWeightValue(i, j, k, (float)weight);
                     }
                 }
             }
@@ -213,7 +262,8 @@ void ScalarField::addCuboid(vmath::vec3 pos, double w, double h, double d) {
         for (int j = gmin.j; j <= gmax.j; j++) {
             for (int i = gmin.i; i <= gmax.i; i++) {
 
-                if (_isMaxScalarFieldThresholdSet && _field(i, j, k) > _maxScalarFieldThreshold) {
+                if (_isMaxScalarFieldThresholdSet && 
+                        _getFieldValue(i, j, k) > _maxScalarFieldThreshold) {
                     continue;
                 }
 
@@ -222,7 +272,7 @@ void ScalarField::addCuboid(vmath::vec3 pos, double w, double h, double d) {
                     addScalarFieldValue(i, j, k, _surfaceThreshold + eps);
 
                     if (_isWeightFieldEnabled) {
-                        _weightField.add(i, j, k, (float)(_surfaceThreshold + eps));
+                        _addWeightValue(i, j, k, (float)(_surfaceThreshold + eps));
                     }
                 }
             }
@@ -250,7 +300,8 @@ void ScalarField::addEllipsoid(vmath::vec3 p, vmath::mat3 G) {
         for (int j = gmin.j; j <= gmax.j; j++) {
             for (int i = gmin.i; i <= gmax.i; i++) {
 
-                if (_isMaxScalarFieldThresholdSet && _field(i, j, k) > _maxScalarFieldThreshold) {
+                if (_isMaxScalarFieldThresholdSet && 
+                        _getFieldValue(i, j, k) > _maxScalarFieldThreshold) {
                     continue;
                 }
 
@@ -265,7 +316,7 @@ void ScalarField::addEllipsoid(vmath::vec3 p, vmath::mat3 G) {
                     addScalarFieldValue(i, j, k, weight);
 
                     if (_isWeightFieldEnabled) {
-                        _weightField.add(i, j, k, (float)weight);
+                        _addWeightValue(i, j, k, (float)weight);
                     }
                 }
             }
@@ -292,7 +343,8 @@ void ScalarField::addEllipsoidValue(vmath::vec3 p, vmath::mat3 G, double scale)
     for (int k = gmin.k; k <= gmax.k; k++) {
         for (int j = gmin.j; j <= gmax.j; j++) {
             for (int i = gmin.i; i <= gmax.i; i++) {
-                if (_isMaxScalarFieldThresholdSet && _field(i, j, k) > _maxScalarFieldThreshold) {
+                if (_isMaxScalarFieldThresholdSet && 
+                        _getFieldValue(i, j, k) > _maxScalarFieldThreshold) {
                     continue;
                 }
 
@@ -308,7 +360,7 @@ void ScalarField::addEllipsoidValue(vmath::vec3 p, vmath::mat3 G, double scale)
                     addScalarFieldValue(i, j, k, weight*scale);
 
                     if (_isWeightFieldEnabled) {
-                        _weightField.add(i, j, k, (float)weight);
+                        _addWeightValue(i, j, k, (float)weight);
                     }
                 }
             }
@@ -329,7 +381,7 @@ void ScalarField::setMaterialGrid(GridIndexVector &solidCells) {
         FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(g, _isize-1, _jsize-1, _ksize-1));
         Grid3d::getGridIndexVertices(g, vertices);
         for (int idx = 0; idx < 8; idx++) {
-            _isVertexSolid.set(vertices[idx], true);
+            _setVertexSolid(vertices[idx].i, vertices[idx].j, vertices[idx].k);
         }
     }
 }
@@ -339,19 +391,30 @@ void ScalarField::setMaterialGrid(FluidMaterialGrid &matGrid) {
            matGrid.height == _jsize-1 && 
            matGrid.depth == _ksize-1);
 
-    GridIndex vertices[8];
-    for (int k = 0; k < _ksize-1; k++) {
-        for (int j = 0; j < _jsize-1; j++) {
-            for (int i = 0; i < _isize-1; i++) {
-                if (matGrid.isCellSolid(i, j, k)) {
-                    Grid3d::getGridIndexVertices(i, j, k, vertices);
-                    for (int idx = 0; idx < 8; idx++) {
-                        _isVertexSolid.set(vertices[idx], true);
+    // A subdivided material grid is solid in whole blocks of subcells, so
+    // the solid vertices are marked from the cells of the base grid
+    int subd = matGrid.getSubdivisionLevel();
+    matGrid.setSubdivisionLevel(1);
+
+    for (int k = 0; k < matGrid.depth; k++) {
+        for (int j = 0; j < matGrid.height; j++) {
+            for (int i = 0; i < matGrid.width; i++) {
+                if (!matGrid.isCellSolid(i, j, k)) {
+                    continue;
+                }
+
+                for (int vk = k*subd; vk <= (k + 1)*subd; vk++) {
+                    for (int vj = j*subd; vj <= (j + 1)*subd; vj++) {
+                        for (int vi = i*subd; vi <= (i + 1)*subd; vi++) {
+                            _setVertexSolid(vi, vj, vk);
+                        }
                     }
                 }
             }
         }
     }
+
+    matGrid.setSubdivisionLevel(subd);
 }
 
 void ScalarField::getWeightField(Array3d<float> &field) {
@@ -359,30 +422,30 @@ void ScalarField::getWeightField(Array3d<float> &field) {
         return;
     }
 
-    FLUIDSIM_ASSERT(field.width == _field.width && 
-           field.height == _field.height && 
-           field.depth == _field.depth);
+    FLUIDSIM_ASSERT(field.width == _isize && 
+           field.height == _jsize && 
+           field.depth == _ksize);
 
     for (int k = 0; k < field.depth; k++) {
         for (int j = 0; j < field.height; j++) {
             for (int i = 0; i < field.width; i++) {
-                field.set(i, j, k, _weightField(i, j, k));
+                field.set(i, j, k, _getWeightValue(i, j, k));
             }
         }
     }
 }
 
 void ScalarField::getScalarField(Array3d<float> &field) {
-    FLUIDSIM_ASSERT(field.width == _field.width && 
-           field.height == _field.height && 
-           field.depth == _field.depth);
+    FLUIDSIM_ASSERT(field.width == _isize && 
+           field.height == _jsize && 
+           field.depth == _ksize);
 
     double val;
     for (int k = 0; k < field.depth; k++) {
         for (int j = 0; j < field.height; j++) {
             for (int i = 0; i < field.width; i++) {
-                val = _field(i, j, k);
-                if (_isVertexSolid(i, j, k) && val > _surfaceThreshold) {
+                val = _getFieldValue(i, j, k);
+                if (val > _surfaceThreshold && _isVertexSolidValue(i, j, k)) {
                     val = _surfaceThreshold;
                 } 
 
@@ -397,10 +460,10 @@ double ScalarField::getScalarFieldValue(GridIndex g) {
 }
 
 double ScalarField::getScalarFieldValue(int i, int j, int k) {
-    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _field.width, _field.height, _field.depth));
+    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _isize, _jsize, _ksize));
 
-    double val = _field(i, j, k);
-    if (_isVertexSolid(i, j, k) && val > _surfaceThreshold) {
+    double val = _getFieldValue(i, j, k);
+    if (val > _surfaceThreshold && _isVertexSolidValue(i, j, k)) {
         val = _surfaceThreshold;
     } 
 
@@ -412,9 +475,9 @@ double ScalarField::getScalarFieldValueAtCellCenter(GridIndex g) {
 }
 
 double ScalarField::getScalarFieldValueAtCellCenter(int i, int j, int k) {
-    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _field.width - 1, 
-                                                        _field.height - 1, 
-                                                        _field.depth - 1));
+    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _isize - 1, 
+                                                        _jsize - 1, 
+                                                        _ksize - 1));
     double sum = 0.0;
     sum += getScalarFieldValue(i,     j,     k);
     sum += getScalarFieldValue(i + 1, j,     k);
@@ -433,19 +496,19 @@ double ScalarField::getRawScalarFieldValue(GridIndex g) {
 }
 
 double ScalarField::getRawScalarFieldValue(int i, int j, int k) {
-    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _field.width, _field.height, _field.depth));
-    return _field(i, j, k);
+    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _isize, _jsize, _ksize));
+    return _getFieldValue(i, j, k);
 }
 
 void ScalarField::getSetScalarFieldValues(Array3d<bool> &isVertexSet) {
-    FLUIDSIM_ASSERT(isVertexSet.width == _isVertexSet.width && 
-           isVertexSet.height == _isVertexSet.height && 
-           isVertexSet.depth == _isVertexSet.depth);
+    FLUIDSIM_ASSERT(isVertexSet.width == _isize && 
+           isVertexSet.height == _jsize && 
+           isVertexSet.depth == _ksize);
 
     for (int k = 0; k < isVertexSet.depth; k++) {
         for (int j = 0; j < isVertexSet.height; j++) {
             for (int i = 0; i < isVertexSet.width; i++) {
-                isVertexSet.set(i, j, k, _isVertexSet(i, j, k));
+                isVertexSet.set(i, j, k, _isVertexSetValue(i, j, k));
             }
         }
     }
@@ -456,14 +519,13 @@ bool ScalarField::isScalarFieldValueSet(GridIndex g) {
 }
 
 bool ScalarField::isScalarFieldValueSet(int i, int j, int k) {
-    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _field.width, _field.height, _field.depth));
-    return _isVertexSet(i, j, k);
+    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _isize, _jsize, _ksize));
+    return _isVertexSetValue(i, j, k);
 }
 
 void ScalarField::setScalarFieldValue(int i, int j, int k, double value) {
-    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _field.width, _field.height, _field.depth));
-    _field.set(i, j, k, value);
-    _isVertexSet.set(i, j, k, true);
+    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _isize, _jsize, _ksize));
+    _setFieldValue(i, j, k, value);
 }
 
 void ScalarField::setScalarFieldValue(GridIndex g, double value) {
@@ -471,9 +533,8 @@ void ScalarField::setScalarFieldValue(GridIndex g, double value) {
 }
 
 void ScalarField::addScalarFieldValue(int i, int j, int k, double value) {
-    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _field.width, _field.height, _field.depth));
-    _field.add(i, j, k, value);
-    _isVertexSet.set(i, j, k, true);
+    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _isize, _jsize, _ksize));
+    _addFieldValue(i, j, k, value);
 }
 
 void ScalarField::addScalarFieldValue(GridIndex g, double value) {
@@ -481,12 +542,11 @@ void ScalarField::addScalarFieldValue(GridIndex g, double value) {
 }
 
 void ScalarField::addCellFieldValues(int i, int j, int k, double value) {
-    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _field.width-1, _field.height-1, _field.depth-1));
+    FLUIDSIM_ASSERT(Grid3d::isGridIndexInRange(i, j, k, _isize-1, _jsize-1, _ksize-1));
     GridIndex vertices[8];
     Grid3d::getGridIndexVertices(i, j, k, vertices);
-    for (int i = 0; i < 8; i++) {
-        _field.set(vertices[i], value);
-        _isVertexSet.set(i, j, k, true);
+    for (int idx = 0; idx < 8; idx++) {
+        _setFieldValue(vertices[idx].i, vertices[idx].j, vertices[idx].k, value);
     }
 }
 
@@ -519,8 +579,9 @@ double ScalarField::tricubicInterpolation(vmath::vec3 p) {
     for (int pk = 0; pk < 4; pk++) {
         for (int pj = 0; pj < 4; pj++) {
             for (int pi = 0; pi < 4; pi++) {
-                if (_field.isIndexInRange(pi + refi, pj + refj, pk + refk)) {
-                    points[pi][pj][pk] = _field(pi + refi, pj + refj, pk + refk);
+                if (Grid3d::isGridIndexInRange(pi + refi, pj + refj, pk + refk, 
+                                               _isize, _jsize, _ksize)) {
+                    points[pi][pj][pk] = _getFieldValue(pi + refi, pj + refj, pk + refk);
 
                     if (points[pi][pj][pk] < min) {
                         min = points[pi][pj][pk];
@@ -558,14 +619,56 @@ vmath::vec3 ScalarField::getOffset() {
 }
 
 Array3d<float>* ScalarField::getPointerToScalarField() {
+    FLUIDSIM_ASSERT(!_isSparseStorageEnabled);
     return &_field;
 }
 
 Array3d<float>* ScalarField::getPointerToWeightField() {
-    FLUIDSIM_ASSERT(_isWeightFieldEnabled);
+    FLUIDSIM_ASSERT(_isWeightFieldEnabled && !_isSparseStorageEnabled);
     return &_weightField;
 }
 
+bool ScalarField::isSparseStorageEnabled() {
+    return _isSparseStorageEnabled;
+}
+
+int ScalarField::getSparseBlockSize() {
+    return SparseArray3d<float>::getBlockSize();
+}
+
+void ScalarField::getSparseBlocks(std::vector<GridIndex> &blocks) {
+    FLUIDSIM_ASSERT(_isSparseStorageEnabled);
+    _sparseField.getAllocatedBlocks(blocks);
+}
+
+bool ScalarField::isSparseBlockAllocated(int bi, int bj, int bk) {
+    FLUIDSIM_ASSERT(_isSparseStorageEnabled);
+    return _sparseField.isBlockAllocated(bi, bj, bk);
+}
+
+bool ScalarField::isSparseBlockAllocated(GridIndex b) {
+    return isSparseBlockAllocated(b.i, b.j, b.k);
+}
+
+long long ScalarField::getMemoryUsage() {
+    if (_isSparseStorageEnabled) {
+        long long bytes = _sparseField.getMemoryUsage() + 
+                          _sparseIsVertexSolid.getMemoryUsage() +
+                          _sparseIsVertexSet.getMemoryUsage();
+        if (_isWeightFieldEnabled) {
+            bytes += _sparseWeightField.getMemoryUsage();
+        }
+        return bytes;
+    }
+
+    long long numNodes = (long long)_isize*_jsize*_ksize;
+    long long bytesPerNode = sizeof(float) + 2*sizeof(bool);
+    if (_isWeightFieldEnabled) {
+        bytesPerNode += sizeof(float);
+    }
+    return numNodes*bytesPerNode;
+}
+
 double ScalarField::_evaluateTricubicFieldFunctionForRadiusSquared(double rsq) {
     return 1.0 - _coef1*rsq*rsq*rsq + _coef2*rsq*rsq - _coef3*rsq;
 }
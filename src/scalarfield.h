@@ -23,20 +23,39 @@ freely, subject to the following restrictions:
 #include <stdio.h>
 #include <iostream>
 #include <limits>
+#include <vector>
 
 #include "vmath.h"
 #include "array3d.h"
+#include "sparsearray3d.h"
 #include "grid3d.h"
 #include "interpolation.h"
 #include "aabb.h"
 #include "fluidmaterialgrid.h"
 #include "fluidsimassert.h"
 
+/*
+    Storage of the scalar field grids.
+
+    dense  - field, weight and solid vertex grids are allocated over the
+             full grid dimensions.
+    sparse - grids are stored in 8x8x8 blocks that are allocated when a
+             value within the block is first written. Unwritten values
+             are zero, so memory scales with the volume covered by added
+             points rather than the grid volume. Raw grid pointers are
+             not available in this mode.
+*/
+enum class ScalarFieldStorage : char { 
+    dense  = 0x00, 
+    sparse = 0x01
+};
+
 class ScalarField
 {
 public:
     ScalarField();
     ScalarField(int i, int j, int k, double dx);
+    ScalarField(int i, int j, int k, double dx, ScalarFieldStorage storage);
     ~ScalarField();
 
     void getGridDimensions(int *i, int *j, int *k) { *i = _isize; *j = _jsize; *k = _ksize; }
@@ -96,10 +115,76 @@ public:
     Array3d<float>* getPointerToScalarField();
     Array3d<float>* getPointerToWeightField();
 
+    bool isSparseStorageEnabled();
+
+    /*
+        Blocks of the sparse field that hold written values. Block (bi, bj, bk)
+        covers grid nodes [bi*blocksize, (bi + 1)*blocksize) in each 
+        dimension. Nodes outside of allocated blocks have a value of zero.
+    */
+    int getSparseBlockSize();
+    void getSparseBlocks(std::vector<GridIndex> &blocks);
+    bool isSparseBlockAllocated(int bi, int bj, int bk);
+    bool isSparseBlockAllocated(GridIndex b);
+
+    long long getMemoryUsage();
+
 private:
 
     double _evaluateTricubicFieldFunctionForRadiusSquared(double rsq);
 
+    inline float _getFieldValue(int i, int j, int k) {
+        return _isSparseStorageEnabled ? _sparseField.get(i, j, k) : _field(i, j, k);
+    }
+
+    inline void _setFieldValue(int i, int j, int k, float value) {
+        if (_isSparseStorageEnabled) {
+            _sparseField.set(i, j, k, value);
+            _sparseIsVertexSet.set(i, j, k, true);
+        } else {
+            _field.set(i, j, k, value);
+            _isVertexSet.set(i, j, k, true);
+        }
+    }
+
+    inline void _addFieldValue(int i, int j, int k, float value) {
+        if (_isSparseStorageEnabled) {
+            _sparseField.add(i, j, k, value);
+            _sparseIsVertexSet.set(i, j, k, true);
+        } else {
+            _field.add(i, j, k, value);
+            _isVertexSet.set(i, j, k, true);
+        }
+    }
+
+    inline bool _isVertexSetValue(int i, int j, int k) {
+        return _isSparseStorageEnabled ? _sparseIsVertexSet.get(i, j, k) : _isVertexSet(i, j, k);
+    }
+
+    inline bool _isVertexSolidValue(int i, int j, int k) {
+        return _isSparseStorageEnabled ? _sparseIsVertexSolid.get(i, j, k) : _isVertexSolid(i, j, k);
+    }
+
+    inline void _setVertexSolid(int i, int j, int k) {
+        if (_isSparseStorageEnabled) {
+            _sparseIsVertexSolid.set(i, j, k, true);
+        } else {
+            _isVertexSolid.set(i, j, k, true);
+        }
+    }
+
+    inline float _getWeightValue(int i, int j, int k) {
+        return _isSparseStorageEnabled ? _sparseWeightField.get(i, j, k) : _weightField(i, j, k);
+    }
+
+    inline void _addWeightValue(int i, int j, int k, float value) {
+        if (_isSparseStorageEnabled) {
+            _sparseWeightField.add(i, j, k, value);
+        } else {
+            _weightField.add(i, j, k, value);
+        }
+    }
+
     int _isize = 0;
     int _jsize = 0;
     int _ksize = 0;
@@ -120,6 +205,12 @@ private:
     Array3d<float> _weightField;
     Array3d<bool> _isVertexSet;
 
+    bool _isSparseStorageEnabled = false;
+    SparseArray3d<float> _sparseField;
+    SparseArray3d<bool> _sparseIsVertexSolid;
+    SparseArray3d<float> _sparseWeightField;
+    SparseArray3d<bool> _sparseIsVertexSet;
+
     bool _isWeightFieldEnabled = false;
 
     vmath::vec3 _gridOffset;
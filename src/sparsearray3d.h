@@ -0,0 +1,226 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef SPARSEARRAY3D_H
+#define SPARSEARRAY3D_H
+
+#include <vector>
+
+#include "array3d.h"
+#include "fluidsimassert.h"
+
+/*
+    Grid of values stored in 8x8x8 blocks that are allocated the first 
+    time one of their elements is written. Elements in unallocated blocks 
+    read as the background value, so memory usage scales with the number
+    of blocks that have been written to rather than the grid volume.
+*/
+template <class T>
+class SparseArray3d
+{
+public:
+    SparseArray3d() {
+    }
+
+    SparseArray3d(int i, int j, int k) : width(i), height(j), depth(k) {
+        _initializeBlockGrid();
+    }
+
+    SparseArray3d(int i, int j, int k, T backgroundValue) : 
+                                        width(i), height(j), depth(k),
+                                        _backgroundValue(backgroundValue) {
+        _initializeBlockGrid();
+    }
+
+    ~SparseArray3d() {
+    }
+
+    /*
+        Sets all elements to value by deallocating every block. The block 
+        storage keeps its capacity so that blocks written after a fill reuse 
+        the memory of the previous blocks.
+    */
+    void fill(T value) {
+        _backgroundValue = value;
+        _blockIndices.fill(-1);
+        _blocks.clear();
+        _data.clear();
+    }
+
+    T operator()(int i, int j, int k) {
+        return get(i, j, k);
+    }
+
+    T operator()(GridIndex g) {
+        return get(g.i, g.j, g.k);
+    }
+
+    T get(int i, int j, int k) {
+        FLUIDSIM_ASSERT(_isIndexInRange(i, j, k));
+        int blockidx = _blockIndices(i >> _blockBits, j >> _blockBits, k >> _blockBits);
+        if (blockidx == -1) {
+            return _backgroundValue;
+        }
+        return _data[_getDataIndex(blockidx, i, j, k)];
+    }
+
+    T get(GridIndex g) {
+        return get(g.i, g.j, g.k);
+    }
+
+    void set(int i, int j, int k, T value) {
+        FLUIDSIM_ASSERT(_isIndexInRange(i, j, k));
+        int blockidx = _getOrAllocateBlock(i >> _blockBits, j >> _blockBits, k >> _blockBits);
+        _data[_getDataIndex(blockidx, i, j, k)] = value;
+    }
+
+    void set(GridIndex g, T value) {
+        set(g.i, g.j, g.k, value);
+    }
+
+    void add(int i, int j, int k, T value) {
+        FLUIDSIM_ASSERT(_isIndexInRange(i, j, k));
+        int blockidx = _getOrAllocateBlock(i >> _blockBits, j >> _blockBits, k >> _blockBits);
+        _data[_getDataIndex(blockidx, i, j, k)] += value;
+    }
+
+    void add(GridIndex g, T value) {
+        add(g.i, g.j, g.k, value);
+    }
+
+    T getBackgroundValue() {
+        return _backgroundValue;
+    }
+
+    bool isIndexInRange(int i, int j, int k) {
+        return _isIndexInRange(i, j, k);
+    }
+
+    bool isIndexInRange(GridIndex g) {
+        return _isIndexInRange(g.i, g.j, g.k);
+    }
+
+    bool isElementAllocated(int i, int j, int k) {
+        FLUIDSIM_ASSERT(_isIndexInRange(i, j, k));
+        return _blockIndices(i >> _blockBits, j >> _blockBits, k >> _blockBits) != -1;
+    }
+
+    bool isElementAllocated(GridIndex g) {
+        return isElementAllocated(g.i, g.j, g.k);
+    }
+
+    /*
+        Block indices range over getBlockGridDimensions(). Block (bi, bj, bk) 
+        holds elements [bi*blocksize, (bi + 1)*blocksize) in each dimension.
+    */
+    static int getBlockSize() {
+        return _blockSize;
+    }
+
+    void getBlockGridDimensions(int *bi, int *bj, int *bk) {
+        *bi = _blockIndices.width;
+        *bj = _blockIndices.height;
+        *bk = _blockIndices.depth;
+    }
+
+    bool isBlockAllocated(int bi, int bj, int bk) {
+        if (!_blockIndices.isIndexInRange(bi, bj, bk)) {
+            return false;
+        }
+        return _blockIndices(bi, bj, bk) != -1;
+    }
+
+    bool isBlockAllocated(GridIndex b) {
+        return isBlockAllocated(b.i, b.j, b.k);
+    }
+
+    void allocateBlock(int bi, int bj, int bk) {
+        FLUIDSIM_ASSERT(_blockIndices.isIndexInRange(bi, bj, bk));
+        _getOrAllocateBlock(bi, bj, bk);
+    }
+
+    void allocateBlock(GridIndex b) {
+        allocateBlock(b.i, b.j, b.k);
+    }
+
+    int getNumAllocatedBlocks() {
+        return (int)_blocks.size();
+    }
+
+    void getAllocatedBlocks(std::vector<GridIndex> &blocks) {
+        blocks.insert(blocks.end(), _blocks.begin(), _blocks.end());
+    }
+
+    long long getMemoryUsage() {
+        return (long long)_blockIndices.width*_blockIndices.height*
+                          _blockIndices.depth*sizeof(int) + 
+               (long long)_blocks.capacity()*sizeof(GridIndex) +
+               (long long)_data.capacity()*sizeof(T);
+    }
+
+    int width = 0;
+    int height = 0;
+    int depth = 0;
+
+private:
+
+    void _initializeBlockGrid() {
+        int bi = (width + _blockSize - 1) >> _blockBits;
+        int bj = (height + _blockSize - 1) >> _blockBits;
+        int bk = (depth + _blockSize - 1) >> _blockBits;
+        _blockIndices = Array3d<int>(bi, bj, bk, -1);
+    }
+
+    inline bool _isIndexInRange(int i, int j, int k) {
+        return i >= 0 && j >= 0 && k >= 0 && i < width && j < height && k < depth;
+    }
+
+    inline int _getOrAllocateBlock(int bi, int bj, int bk) {
+        int blockidx = _blockIndices(bi, bj, bk);
+        if (blockidx != -1) {
+            return blockidx;
+        }
+
+        blockidx = (int)_blocks.size();
+        _blockIndices.set(bi, bj, bk, blockidx);
+        _blocks.push_back(GridIndex(bi, bj, bk));
+        _data.resize(_data.size() + _blockVolume, _backgroundValue);
+
+        return blockidx;
+    }
+
+    inline size_t _getDataIndex(int blockidx, int i, int j, int k) {
+        return (size_t)blockidx*_blockVolume + 
+               (size_t)((i & _blockMask) + 
+                        ((j & _blockMask) << _blockBits) + 
+                        ((k & _blockMask) << (2*_blockBits)));
+    }
+
+    static const int _blockBits = 3;
+    static const int _blockSize = 1 << _blockBits;
+    static const int _blockMask = _blockSize - 1;
+    static const int _blockVolume = _blockSize*_blockSize*_blockSize;
+
+    T _backgroundValue = T();
+    Array3d<int> _blockIndices;
+    std::vector<GridIndex> _blocks;
+    std::vector<T> _data;
+};
+
+#endif
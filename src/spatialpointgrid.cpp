@@ -63,8 +63,12 @@ std::vector<GridPointReference> SpatialPointGrid::insert(FragmentedVector<vmath:
     return insert(vps);
 }
 
-bool compareByFlatGridIndex(const std::pair<GridPoint, unsigned int> p1, const std::pair<GridPoint, unsigned int> p2) {
-    return p1.second < p2.second;
+bool compareByMortonGridIndex(const std::pair<GridPoint, unsigned long long> &p1, 
+                              const std::pair<GridPoint, unsigned long long> &p2) {
+    if (p1.second != p2.second) {
+        return p1.second < p2.second;
+    }
+    return p1.first.ref.id < p2.first.ref.id;
 }
 
 void SpatialPointGrid::queryPointsInsideSphere(vmath::vec3 p, double r, std::vector<vmath::vec3> &points) {
@@ -123,6 +127,46 @@ void SpatialPointGrid::queryPointReferencesInsideSphere(GridPointReference ref,
     _queryPointReferencesInsideSphere(gp.position, r, exclusions, refs);
 }
 
+void SpatialPointGrid::queryPointReferencesInsideSphere(std::vector<vmath::vec3> &queryPoints, 
+                                                        double r,
+                                                        GridPointNeighbourList &neighbourList) {
+    std::vector<int> excludeIDs(queryPoints.size(), -1);
+    _queryPointReferencesInsideSphere(queryPoints, excludeIDs, r, neighbourList);
+}
+
+void SpatialPointGrid::queryPointReferencesInsideSphere(std::vector<GridPointReference> &queryRefs, 
+                                                        double r,
+                                                        GridPointNeighbourList &neighbourList) {
+    std::vector<vmath::vec3> queryPoints;
+    std::vector<int> excludeIDs;
+    queryPoints.reserve(queryRefs.size());
+    excludeIDs.reserve(queryRefs.size());
+
+    GridPointReference ref;
+    for (unsigned int i = 0; i < queryRefs.size(); i++) {
+        ref = queryRefs[i];
+        FLUIDSIM_ASSERT(ref.id >= 0 && ref.id < (int)_gridPoints.size());
+
+        queryPoints.push_back(_gridPoints[_refIDToGridPointIndexTable[ref.id]].position);
+        excludeIDs.push_back(ref.id);
+    }
+
+    _queryPointReferencesInsideSphere(queryPoints, excludeIDs, r, neighbourList);
+}
+
+void SpatialPointGrid::sortPointReferences(std::vector<GridPointReference> &refs) {
+    std::vector<int> &table = _refIDToGridPointIndexTable;
+    std::sort(refs.begin(), refs.end(), 
+        [&table](const GridPointReference &a, const GridPointReference &b) { 
+            return table[a.id] < table[b.id]; 
+        }
+    );
+}
+
+void SpatialPointGrid::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
+}
+
 void SpatialPointGrid::queryPointsInsideAABB(AABB bbox, std::vector<vmath::vec3> &points) {
     GridIndex gmin, gmax;
     Grid3d::getGridIndexBounds(bbox, _dx, _isize, _jsize, _ksize, &gmin, &gmax);
@@ -232,23 +276,61 @@ void SpatialPointGrid::getConnectedPointComponents(double radius,
     }
 }
 
+/*
+    Points closer than radius are united in a concurrent union-find. Chunks
+    of points are taken in storage order so that each chunk's batched query 
+    covers a compact group of cells. Components are ordered by their 
+    smallest reference id and hold their references in increasing id order.
+*/
 void SpatialPointGrid::getConnectedPointReferenceComponents(double radius, 
                                                             std::vector<std::vector<GridPointReference> > &refsList) {
 
-    std::vector<bool> visitedRefs(_gridPoints.size(), false);
-    for (unsigned int refid = 0; refid < _gridPoints.size(); refid++) {
-        if (!visitedRefs[refid]) {
-            GridPointReference ref = GridPointReference(refid);
-            std::vector<GridPointReference> connectedRefs;
-            getConnectedPointReferences(ref, radius, connectedRefs);
-            refsList.push_back(connectedRefs);
-
-            for (unsigned int idx = 0; idx < connectedRefs.size(); idx++) {
-                visitedRefs[connectedRefs[idx].id] = true;
+    int numPoints = (int)_gridPoints.size();
+    UnionFind components(numPoints);
+
+    int chunkSize = _batchTaskSize;
+    int numChunks = (numPoints + chunkSize - 1) / chunkSize;
+    _runBatchTasks(numChunks, [this, numPoints, chunkSize, radius, &components](int chunkidx) {
+        int startidx = chunkidx * chunkSize;
+        int endidx = std::min(startidx + chunkSize, numPoints);
+
+        std::vector<vmath::vec3> queryPoints;
+        std::vector<int> queryIDs;
+        queryPoints.reserve(endidx - startidx);
+        queryIDs.reserve(endidx - startidx);
+        for (int i = startidx; i < endidx; i++) {
+            queryPoints.push_back(_gridPoints[i].position);
+            queryIDs.push_back(_gridPoints[i].ref.id);
+        }
+
+        GridPointNeighbourList neighbourList;
+        _queryPointReferencesInsideSphere(queryPoints, queryIDs, radius, neighbourList);
+
+        for (unsigned int q = 0; q < queryIDs.size(); q++) {
+            int id = queryIDs[q];
+            int numNeighbours = neighbourList.getNumNeighbours(q);
+            GridPointReference *neighbours = neighbourList.getNeighbours(q);
+            for (int nidx = 0; nidx < numNeighbours; nidx++) {
+                // Each pair is found from both of its points
+                if (neighbours[nidx].id > id) {
+                    components.unite(id, neighbours[nidx].id);
+                }
             }
         }
-    }
+    });
 
+    std::vector<std::vector<int> > sets;
+    components.getSets(numPoints, sets, _threadPool);
+
+    refsList.reserve(refsList.size() + sets.size());
+    for (unsigned int i = 0; i < sets.size(); i++) {
+        std::vector<GridPointReference> refs;
+        refs.reserve(sets[i].size());
+        for (unsigned int j = 0; j < sets[i].size(); j++) {
+            refs.push_back(GridPointReference(sets[i][j]));
+        }
+        refsList.push_back(refs);
+    }
 }
 
 
@@ -256,27 +338,27 @@ void SpatialPointGrid::_sortGridPointsByGridIndex(std::vector<vmath::vec3> &poin
                                                   std::vector<GridPoint> &sortedPoints,
                                                   std::vector<GridPointReference> &refList) {
 
-    std::pair<GridPoint, unsigned int> pair;
-    std::vector<std::pair<GridPoint, unsigned int> > pointIndexPairs;
+    std::pair<GridPoint, unsigned long long> pair;
+    std::vector<std::pair<GridPoint, unsigned long long> > pointIndexPairs;
     pointIndexPairs.reserve(points.size());
     refList.reserve(points.size());
 
     GridPoint gp;
     GridPointReference ref;
-    unsigned int flatIndex;
+    unsigned long long mortonKey;
     for (unsigned int i = 0; i < points.size(); i++) {
         FLUIDSIM_ASSERT(_bbox.isPointInside(points[i]));
 
         ref = GridPointReference(i);
         gp = GridPoint(points[i], ref);
-        flatIndex = _getFlatIndex(Grid3d::positionToGridIndex(points[i], _dx));
-        pair = std::pair<GridPoint, unsigned int>(gp, flatIndex);
+        mortonKey = _getMortonKey(Grid3d::positionToGridIndex(points[i], _dx));
+        pair = std::pair<GridPoint, unsigned long long>(gp, mortonKey);
 
         pointIndexPairs.push_back(pair);
         refList.push_back(ref);
     }
 
-    std::sort(pointIndexPairs.begin(), pointIndexPairs.end(), compareByFlatGridIndex);
+    std::sort(pointIndexPairs.begin(), pointIndexPairs.end(), compareByMortonGridIndex);
 
     sortedPoints.reserve(points.size());
     for (unsigned int i = 0; i < pointIndexPairs.size(); i++) {
@@ -458,6 +540,192 @@ void SpatialPointGrid::_queryPointReferencesInsideSphere(vmath::vec3 p, double r
     }
 }
 
+void SpatialPointGrid::_queryPointReferencesInsideSphere(std::vector<vmath::vec3> &queryPoints, 
+                                                         std::vector<int> &excludeIDs, double r,
+                                                         GridPointNeighbourList &neighbourList) {
+    FLUIDSIM_ASSERT(queryPoints.size() == excludeIDs.size());
+
+    int numQueries = (int)queryPoints.size();
+    neighbourList.offsets.assign(numQueries + 1, 0);
+    neighbourList.neighbours.clear();
+    if (numQueries == 0) {
+        return;
+    }
+
+    // Group queries by the Morton key of their cell
+    std::vector<std::pair<unsigned long long, int> > queryOrder;
+    queryOrder.reserve(numQueries);
+    GridIndex g;
+    for (int q = 0; q < numQueries; q++) {
+        g = Grid3d::positionToGridIndex(queryPoints[q], _dx);
+        g.i = std::min(std::max(g.i, 0), _isize - 1);
+        g.j = std::min(std::max(g.j, 0), _jsize - 1);
+        g.k = std::min(std::max(g.k, 0), _ksize - 1);
+        queryOrder.push_back(std::pair<unsigned long long, int>(_getMortonKey(g), q));
+    }
+    std::sort(queryOrder.begin(), queryOrder.end());
+
+    std::vector<int> groupStarts;
+    for (int idx = 0; idx < numQueries; idx++) {
+        if (idx == 0 || queryOrder[idx].first != queryOrder[idx - 1].first) {
+            groupStarts.push_back(idx);
+        }
+    }
+    groupStarts.push_back(numQueries);
+
+    // Split groups into tasks of roughly _batchTaskSize queries
+    std::vector<int> taskGroupStarts;
+    int lastTaskStart = -_batchTaskSize;
+    for (unsigned int gidx = 0; gidx < groupStarts.size() - 1; gidx++) {
+        if (groupStarts[gidx] - lastTaskStart >= _batchTaskSize) {
+            taskGroupStarts.push_back(gidx);
+            lastTaskStart = groupStarts[gidx];
+        }
+    }
+    taskGroupStarts.push_back(groupStarts.size() - 1);
+
+    int numTasks = taskGroupStarts.size() - 1;
+    std::vector<std::vector<GridPointReference> > taskNeighbours(numTasks);
+    std::vector<int> &offsets = neighbourList.offsets;
+    double maxdistsq = r*r;
+
+    _runBatchTasks(numTasks, [&](int tidx) {
+        BatchCandidates candidates;
+        std::vector<GridPointReference> &neighbours = taskNeighbours[tidx];
+        int numNeighbours = 0;
+
+        for (int gidx = taskGroupStarts[tidx]; gidx < taskGroupStarts[tidx + 1]; gidx++) {
+            int qstart = groupStarts[gidx];
+            int qend = groupStarts[gidx + 1];
+
+            GridIndex gmin(_isize, _jsize, _ksize);
+            GridIndex gmax(-1, -1, -1);
+            GridIndex qmin, qmax;
+            for (int idx = qstart; idx < qend; idx++) {
+                vmath::vec3 p = queryPoints[queryOrder[idx].second];
+                Grid3d::getGridIndexBounds(p, r, _dx, _isize, _jsize, _ksize, &qmin, &qmax);
+                gmin = GridIndex(std::min(gmin.i, qmin.i), std::min(gmin.j, qmin.j), std::min(gmin.k, qmin.k));
+                gmax = GridIndex(std::max(gmax.i, qmax.i), std::max(gmax.j, qmax.j), std::max(gmax.k, qmax.k));
+            }
+
+            _gatherBatchCandidates(gmin, gmax, candidates);
+
+            // Each query visits only the cell rows of its own bounds. The 
+            // cells of a row are contiguous in the candidate arrays. 
+            // Distances are computed in the same precision and order as 
+            // the single point queries so that the results match exactly.
+            float *cx = candidates.x.data();
+            float *cy = candidates.y.data();
+            float *cz = candidates.z.data();
+            int *cids = candidates.ids.data();
+            int *cellOffsets = candidates.cellOffsets.data();
+            int gwidth = gmax.i - gmin.i + 1;
+            int gheight = gmax.j - gmin.j + 1;
+            for (int idx = qstart; idx < qend; idx++) {
+                int q = queryOrder[idx].second;
+                vmath::vec3 p = queryPoints[q];
+                int excludeID = excludeIDs[q];
+                Grid3d::getGridIndexBounds(p, r, _dx, _isize, _jsize, _ksize, &qmin, &qmax);
+
+                int count = 0;
+                for (int k = qmin.k; k <= qmax.k; k++) {
+                    for (int j = qmin.j; j <= qmax.j; j++) {
+                        int rowidx = (j - gmin.j)*gwidth + (k - gmin.k)*gwidth*gheight - gmin.i;
+                        int cstart = cellOffsets[rowidx + qmin.i];
+                        int cend = cellOffsets[rowidx + qmax.i + 1];
+                        if (numNeighbours + cend - cstart > (int)neighbours.size()) {
+                            neighbours.resize(std::max(2*neighbours.size(), 
+                                                       (size_t)(numNeighbours + cend - cstart)));
+                        }
+
+                        // Branchless append: every candidate is written and 
+                        // the count only advances for points inside the sphere
+                        GridPointReference *out = neighbours.data() + numNeighbours;
+                        int n = 0;
+                        for (int cidx = cstart; cidx < cend; cidx++) {
+                            float vx = cx[cidx] - p.x;
+                            float vy = cy[cidx] - p.y;
+                            float vz = cz[cidx] - p.z;
+                            double distsq = vx*vx + vy*vy + vz*vz;
+                            out[n].id = cids[cidx];
+                            n += (distsq < maxdistsq) & (cids[cidx] != excludeID);
+                        }
+                        numNeighbours += n;
+                        count += n;
+                    }
+                }
+                offsets[q + 1] = count;
+            }
+        }
+        neighbours.resize(numNeighbours);
+    });
+
+    for (int q = 0; q < numQueries; q++) {
+        offsets[q + 1] += offsets[q];
+    }
+    neighbourList.neighbours.resize(offsets[numQueries]);
+
+    _runBatchTasks(numTasks, [&](int tidx) {
+        std::vector<GridPointReference> &neighbours = taskNeighbours[tidx];
+        int qstart = groupStarts[taskGroupStarts[tidx]];
+        int qend = groupStarts[taskGroupStarts[tidx + 1]];
+        int nidx = 0;
+        for (int idx = qstart; idx < qend; idx++) {
+            int q = queryOrder[idx].second;
+            int count = offsets[q + 1] - offsets[q];
+            std::copy(neighbours.begin() + nidx, neighbours.begin() + nidx + count, 
+                      neighbourList.neighbours.begin() + offsets[q]);
+            nidx += count;
+        }
+
+        neighbours.clear();
+        neighbours.shrink_to_fit();
+    });
+}
+
+/*
+    Copies the points in cells [gmin, gmax] into structure of arrays form
+    in the same cell and point order that the single queries visit them.
+    The points of the n-th cell in (k, j, i) order start at cellOffsets[n].
+*/
+void SpatialPointGrid::_gatherBatchCandidates(GridIndex gmin, GridIndex gmax, 
+                                              BatchCandidates &candidates) {
+    candidates.x.clear();
+    candidates.y.clear();
+    candidates.z.clear();
+    candidates.ids.clear();
+    candidates.cellOffsets.clear();
+
+    CellNode node;
+    for (int k = gmin.k; k <= gmax.k; k++) {
+        for (int j = gmin.j; j <= gmax.j; j++) {
+            for (int i = gmin.i; i <= gmax.i; i++) {
+                candidates.cellOffsets.push_back(candidates.ids.size());
+                node = _grid(i, j, k);
+                for (int idx = node.start; idx < node.start + node.count; idx++) {
+                    GridPoint &gp = _gridPoints[idx];
+                    candidates.x.push_back(gp.position.x);
+                    candidates.y.push_back(gp.position.y);
+                    candidates.z.push_back(gp.position.z);
+                    candidates.ids.push_back(gp.ref.id);
+                }
+            }
+        }
+    }
+    candidates.cellOffsets.push_back(candidates.ids.size());
+}
+
+void SpatialPointGrid::_runBatchTasks(int numTasks, std::function<void(int)> func) {
+    if (_threadPool == nullptr || numTasks <= 1) {
+        for (int i = 0; i < numTasks; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    _threadPool->run(numTasks, func);
+}
+
 void SpatialPointGrid::_getConnectedPoints(GridPointReference seed, double radius, 
                                            std::vector<vmath::vec3> &points) {
 
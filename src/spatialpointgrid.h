@@ -24,6 +24,7 @@ freely, subject to the following restrictions:
 #include <stdio.h>
 #include <iostream>
 #include <algorithm>
+#include <functional>
 
 #include "array3d.h"
 #include "aabb.h"
@@ -31,6 +32,8 @@ freely, subject to the following restrictions:
 #include "grid3d.h"
 #include "vmath.h"
 #include "fluidsimassert.h"
+#include "threadpool.h"
+#include "unionfind.h"
 
 struct GridPointReference {
     int id;
@@ -52,6 +55,32 @@ struct GridPoint {
     GridPoint(vmath::vec3 p, unsigned int id) : position(p), ref(id) {}
 };
 
+/*
+    Neighbour lists for a batch of queries in compressed sparse row form.
+    The neighbours of query q are neighbours[offsets[q]] up to but not 
+    including neighbours[offsets[q + 1]].
+*/
+struct GridPointNeighbourList {
+    std::vector<int> offsets;
+    std::vector<GridPointReference> neighbours;
+
+    int size() {
+        return offsets.empty() ? 0 : (int)offsets.size() - 1;
+    }
+
+    int getNumNeighbours(int q) {
+        return offsets[q + 1] - offsets[q];
+    }
+
+    GridPointReference *getNeighbours(int q) {
+        return neighbours.data() + offsets[q];
+    }
+};
+
+/*
+    Points are stored grouped by grid cell with cells in Morton (Z-order)
+    so that neighbouring cells are usually close in memory.
+*/
 class SpatialPointGrid
 {
 public:
@@ -79,6 +108,31 @@ public:
                                           std::vector<bool> &exclusions,
                                           std::vector<GridPointReference> &refs);
 
+    /*
+        Batched sphere queries. Finds the references within radius r of 
+        each query point, or of each query reference excluding the query 
+        reference itself, and stores them in CSR form in the order of the 
+        queries. Each query returns the same references in the same order 
+        as the corresponding single query.
+
+        Queries are grouped by grid cell so that the points in the cells 
+        surrounding a group are gathered once for the whole group. Groups
+        are split between the threads of the pool if one is set.
+    */
+    void queryPointReferencesInsideSphere(std::vector<vmath::vec3> &queryPoints, double r,
+                                          GridPointNeighbourList &neighbourList);
+    void queryPointReferencesInsideSphere(std::vector<GridPointReference> &queryRefs, double r,
+                                          GridPointNeighbourList &neighbourList);
+
+    /*
+        Sorts references into the order that the grid stores its points. 
+        Consecutive references are then spatially close, which lets 
+        batched queries over a range of references share cell groups.
+    */
+    void sortPointReferences(std::vector<GridPointReference> &refs);
+
+    void setThreadPool(ThreadPool *pool);
+
     void queryPointsInsideAABB(AABB bbox, std::vector<vmath::vec3> &points);
     void queryPointReferencesInsideAABB(AABB bbox, std::vector<GridPointReference> &refs);
 
@@ -101,14 +155,27 @@ private:
         CellNode(int startIndex, int numPoints) : start(startIndex), count(numPoints) {}
     };
 
-    inline unsigned int _getFlatIndex(int i, int j, int k) {
-        return (unsigned int)i + (unsigned int)_isize *
-               ((unsigned int)j + (unsigned int)_jsize * (unsigned int)k);
+    struct BatchCandidates {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<int> ids;
+        std::vector<int> cellOffsets;
+    };
+
+    // Interleaves the bits of the cell index, 21 bits per dimension
+    inline unsigned long long _getMortonKey(GridIndex g) {
+        return _mortonSpread(g.i) | _mortonSpread(g.j) << 1 | _mortonSpread(g.k) << 2;
     }
 
-    inline unsigned int _getFlatIndex(GridIndex g) {
-        return (unsigned int)g.i + (unsigned int)_isize *
-               ((unsigned int)g.j + (unsigned int)_jsize * (unsigned int)g.k);
+    inline unsigned long long _mortonSpread(int v) {
+        unsigned long long x = (unsigned long long)v & 0x1FFFFF;
+        x = (x | x << 32) & 0x1F00000000FFFFULL;
+        x = (x | x << 16) & 0x1F0000FF0000FFULL;
+        x = (x | x << 8)  & 0x100F00F00F00F00FULL;
+        x = (x | x << 4)  & 0x10C30C30C30C30C3ULL;
+        x = (x | x << 2)  & 0x1249249249249249ULL;
+        return x;
     }
 
     void _sortGridPointsByGridIndex(std::vector<vmath::vec3> &points,
@@ -125,6 +192,12 @@ private:
     void _queryPointReferencesInsideSphere(vmath::vec3 p, double r, std::vector<bool> &exclusions, 
                                            std::vector<GridPointReference> &refs);
 
+    void _queryPointReferencesInsideSphere(std::vector<vmath::vec3> &queryPoints, 
+                                           std::vector<int> &excludeIDs, double r,
+                                           GridPointNeighbourList &neighbourList);
+    void _gatherBatchCandidates(GridIndex gmin, GridIndex gmax, BatchCandidates &candidates);
+    void _runBatchTasks(int numTasks, std::function<void(int)> func);
+
     void _getConnectedPoints(GridPointReference seed, double radius, 
                              std::vector<vmath::vec3> &points);
     void _getConnectedPointReferences(GridPointReference seed, double radius, 
@@ -139,6 +212,9 @@ private:
     std::vector<int> _refIDToGridPointIndexTable;
     Array3d<CellNode> _grid;
     AABB _bbox;
+
+    ThreadPool *_threadPool = nullptr;
+    int _batchTaskSize = 4096;    // approximate number of queries per task
 };
 
 #endif
\ No newline at end of file
@@ -27,7 +27,7 @@ freely, subject to the following restrictions:
 #include "gridindexvector.h"
 #include "array3d.h"
 
-template <class T>
+template <class T, class Layout = Array3dLinearLayout>
 class SubdividedArray3d
 {
 public:
@@ -160,7 +160,7 @@ public:
     }
 
     bool isOutOfRangeValueSet() {
-        return _grid.isOutOfRangeValueSet;
+        return _grid.isOutOfRangeValueSet();
     }
     T getOutOfRangeValue() {
         return _grid.getOutOfRangeValue();
@@ -184,7 +184,7 @@ private:
     int _jsize = 0;
     int _ksize = 0;
 
-    Array3d<T> _grid;
+    Array3d<T, Layout> _grid;
     unsigned int _sublevel = 1;
      double _invsublevel = 1;
 
@@ -0,0 +1,147 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "threadpool.h"
+
+ThreadPool::ThreadPool() : _nextTask(0) {
+    _initializeWorkers(getMaxThreadCount());
+}
+
+ThreadPool::ThreadPool(int numThreads) : _nextTask(0) {
+    _initializeWorkers(numThreads);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _isShutdown = true;
+    }
+    _workCondition.notify_all();
+
+    for (unsigned int i = 0; i < _workers.size(); i++) {
+        _workers[i].join();
+    }
+}
+
+int ThreadPool::getNumThreads() {
+    return _numThreads;
+}
+
+int ThreadPool::getMaxThreadCount() {
+    int n = (int)std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+void ThreadPool::run(int numTasks, std::function<void(int)> func) {
+    if (numTasks <= 0) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> dispatchLock(_dispatchMutex, std::try_to_lock);
+    if (!dispatchLock.owns_lock() || _workers.empty() || numTasks == 1) {
+        for (int i = 0; i < numTasks; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _taskFunction = func;
+        _numTasks = numTasks;
+        _nextTask.store(0);
+        _numBusyWorkers = (int)_workers.size();
+        _batchNumber++;
+    }
+    _workCondition.notify_all();
+
+    _executeTasks();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _doneCondition.wait(lock, [this]() { return _numBusyWorkers == 0; });
+    _taskFunction = nullptr;
+}
+
+void ThreadPool::parallelForRange(int begin, int end, int grainSize,
+                                  std::function<void(int, int)> func) {
+    if (end <= begin) {
+        return;
+    }
+
+    if (grainSize < 1) {
+        grainSize = 1;
+    }
+
+    int numRanges = (end - begin + grainSize - 1) / grainSize;
+    run(numRanges, [=](int rangeid) {
+        int rangeBegin = begin + rangeid*grainSize;
+        int rangeEnd = rangeBegin + grainSize;
+        if (rangeEnd > end) {
+            rangeEnd = end;
+        }
+        func(rangeBegin, rangeEnd);
+    });
+}
+
+void ThreadPool::_initializeWorkers(int numThreads) {
+    FLUIDSIM_ASSERT(numThreads >= 1);
+
+    _numThreads = numThreads;
+    _workers.reserve(numThreads - 1);
+    for (int i = 0; i < numThreads - 1; i++) {
+        _workers.push_back(std::thread(&ThreadPool::_workerLoop, this));
+    }
+}
+
+void ThreadPool::_workerLoop() {
+    unsigned int lastBatch = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _workCondition.wait(lock, [this, lastBatch]() {
+                return _isShutdown || _batchNumber != lastBatch;
+            });
+
+            if (_isShutdown) {
+                return;
+            }
+            lastBatch = _batchNumber;
+        }
+
+        _executeTasks();
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _numBusyWorkers--;
+            if (_numBusyWorkers == 0) {
+                _doneCondition.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::_executeTasks() {
+    for (;;) {
+        int taskid = _nextTask.fetch_add(1);
+        if (taskid >= _numTasks) {
+            return;
+        }
+        _taskFunction(taskid);
+    }
+}
@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "fluidsimassert.h"
+
+/*
+    A fixed set of worker threads that execute a batch of indexed tasks.
+
+    A call to run() blocks until every task in the batch has completed. The
+    calling thread takes part in executing tasks, so a pool constructed with
+    n threads spawns n - 1 worker threads. If run() is called while the pool
+    is already executing a batch (for example, from within a task), the
+    batch is executed serially on the calling thread.
+*/
+class ThreadPool
+{
+public:
+    ThreadPool();
+    ThreadPool(int numThreads);
+    ~ThreadPool();
+
+    int getNumThreads();
+
+    /*
+        Executes func(taskid) for each taskid in [0, numTasks).
+    */
+    void run(int numTasks, std::function<void(int)> func);
+
+    /*
+        Splits the range [begin, end) into contiguous subranges of at most
+        grainSize elements and executes func(rangeBegin, rangeEnd) for each
+        subrange.
+    */
+    void parallelForRange(int begin, int end, int grainSize,
+                          std::function<void(int, int)> func);
+
+    /*
+        Returns the number of hardware threads available on the system.
+    */
+    static int getMaxThreadCount();
+
+private:
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool& operator=(const ThreadPool &) = delete;
+
+    void _initializeWorkers(int numThreads);
+    void _workerLoop();
+    void _executeTasks();
+
+    std::vector<std::thread> _workers;
+    std::mutex _dispatchMutex;
+    std::mutex _mutex;
+    std::condition_variable _workCondition;
+    std::condition_variable _doneCondition;
+
+    std::function<void(int)> _taskFunction;
+    std::atomic<int> _nextTask;
+    int _numTasks = 0;
+    int _numBusyWorkers = 0;
+    unsigned int _batchNumber = 0;
+    bool _isShutdown = false;
+    int _numThreads = 1;
+
+};
+
+#endif
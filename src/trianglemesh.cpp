@@ -254,10 +254,6 @@ void TriangleMesh::writeMeshToPLY(std::string filename) {
         offset += 3*sizeof(int);
     }
 
-    std::ofstream erasefile;
-    erasefile.open(filename.c_str(), std::ofstream::out | std::ofstream::trunc);
-    erasefile.close();
-
     std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
     file.write(bin, binsize);
     file.close();
@@ -280,10 +276,6 @@ int TriangleMesh::_numDigitsInInteger(int num) {
 }
 
 void TriangleMesh::writeMeshToBOBJ(std::string filename) {
-    std::ofstream erasefile;
-    erasefile.open(filename, std::ofstream::out | std::ofstream::trunc);
-    erasefile.close();
-
     std::ofstream bobj(filename.c_str(), std::ios::out | std::ios::binary);
 
     int numVertices = (int)vertices.size();
@@ -838,49 +830,46 @@ void TriangleMesh::clearTriangleAreas() {
     _triangleAreas.clear();
 }
 
-void TriangleMesh::_getPolyhedronFromTriangle(int tidx, 
-                                              std::vector<bool> &visitedTriangles,
-                                              std::vector<int> &polyhedron) {
-
-    FLUIDSIM_ASSERT(!visitedTriangles[tidx]);
-
-    std::vector<int> queue;
-    queue.push_back(tidx);
-    visitedTriangles[tidx] = true;
-
-    std::vector<int> neighbours;
-    while (!queue.empty()) {
-        int t = queue.back();
-        queue.pop_back();
-
-        neighbours.clear();
-        getFaceNeighbours(t, neighbours);
-        for (unsigned int i = 0; i < neighbours.size(); i++) {
-            int n = neighbours[i];
-
-            if (!visitedTriangles[n]) {
-                queue.push_back(n);
-                visitedTriangles[n] = true;
+/*
+    Triangles are connected the same way as in getFaceNeighbours(): a 
+    triangle is joined to every triangle that uses its second or third 
+    vertex. Each triangle is united with a node for each of these vertices, 
+    and with the node for its first vertex when that vertex is the second or
+    third vertex of some other triangle. Polyhedra are the sets containing
+    the triangle nodes, ordered by their smallest triangle index.
+*/
+void TriangleMesh::_getPolyhedra(std::vector<std::vector<int> > &polyList,
+                                 ThreadPool *pool) {
+    int numTris = triangles.size();
+    int numVerts = vertices.size();
+
+    std::vector<bool> isLinkVertex(numVerts, false);
+    for (int i = 0; i < numTris; i++) {
+        isLinkVertex[triangles[i].tri[1]] = true;
+        isLinkVertex[triangles[i].tri[2]] = true;
+    }
+
+    UnionFind polyhedra(numTris + numVerts);
+    auto uniteTriangles = [this, numTris, &isLinkVertex, &polyhedra]
+                          (int startidx, int endidx) {
+        for (int tidx = startidx; tidx < endidx; tidx++) {
+            Triangle &t = triangles[tidx];
+            if (isLinkVertex[t.tri[0]]) {
+                polyhedra.unite(tidx, numTris + t.tri[0]);
             }
+            polyhedra.unite(tidx, numTris + t.tri[1]);
+            polyhedra.unite(tidx, numTris + t.tri[2]);
         }
+    };
 
-        polyhedron.push_back(t);
-    }
-}
-
-void TriangleMesh:: _getPolyhedra(std::vector<std::vector<int> > &polyList) {
-    updateVertexTriangles();
-
-    std::vector<bool> visitedTriangles = std::vector<bool>(triangles.size(), false);
-    for (unsigned int i = 0; i < visitedTriangles.size(); i++) {
-        if (!visitedTriangles[i]) {
-            std::vector<int> polyhedron;
-            _getPolyhedronFromTriangle(i, visitedTriangles, polyhedron);
-            polyList.push_back(polyhedron);
-        }
+    int grainSize = 16384;
+    if (pool == nullptr || numTris <= grainSize) {
+        uniteTriangles(0, numTris);
+    } else {
+        pool->parallelForRange(0, numTris, grainSize, uniteTriangles);
     }
 
-    clearVertexTriangles();
+    polyhedra.getSets(numTris, polyList, pool);
 }
 
 double TriangleMesh::_getSignedTriangleVolume(unsigned int tidx) {
@@ -990,13 +979,13 @@ void TriangleMesh::removeTriangles(std::vector<int> &removalTriangles) {
     triangles = newTriangleList;
 }
 
-void TriangleMesh::removeMinimumVolumePolyhedra(double volume) {
+void TriangleMesh::removeMinimumVolumePolyhedra(double volume, ThreadPool *pool) {
     if (volume <= 0.0) {
         return;
     }
 
     std::vector<std::vector<int> > polyList;
-    _getPolyhedra(polyList);
+    _getPolyhedra(polyList, pool);
 
     std::vector<int> removalTriangles;
     for (unsigned int i = 0; i < polyList.size(); i++) {
@@ -1015,13 +1004,13 @@ void TriangleMesh::removeMinimumVolumePolyhedra(double volume) {
     removeExtraneousVertices();
 }
 
-void TriangleMesh::removeMinimumTriangleCountPolyhedra(int count) {
+void TriangleMesh::removeMinimumTriangleCountPolyhedra(int count, ThreadPool *pool) {
     if (count <= 0) {
         return;
     }
 
     std::vector<std::vector<int> > polyList;
-    _getPolyhedra(polyList);
+    _getPolyhedra(polyList, pool);
 
     std::vector<int> removalTriangles;
     for (unsigned int i = 0; i < polyList.size(); i++) {
@@ -1075,9 +1064,9 @@ bool TriangleMesh::_isPolyhedronHole(std::vector<int> &poly) {
     return sum < 0;
 }
 
-void TriangleMesh::removeHoles() {
+void TriangleMesh::removeHoles(ThreadPool *pool) {
     std::vector<std::vector<int> > polyList;
-    _getPolyhedra(polyList);
+    _getPolyhedra(polyList, pool);
 
     std::vector<int> removalTriangles;
     for (unsigned int i = 0; i < polyList.size(); i++) {
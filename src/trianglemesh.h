@@ -27,6 +27,7 @@ freely, subject to the following restrictions:
 #include <fstream>
 #include <string.h>
 #include <algorithm>
+#include <limits>
 
 #include "triangle.h"
 #include "array3d.h"
@@ -36,6 +37,8 @@ freely, subject to the following restrictions:
 #include "vmath.h"
 #include "gridindexvector.h"
 #include "spatialpointgrid.h"
+#include "unionfind.h"
+#include "threadpool.h"
 #include "fluidsimassert.h"
 
 enum class TriangleMeshFormat : char { 
@@ -47,6 +50,10 @@ class TriangleMesh
 {
 public:
     TriangleMesh();
+    TriangleMesh(const TriangleMesh &) = default;
+    TriangleMesh(TriangleMesh &&) = default;
+    TriangleMesh& operator=(const TriangleMesh &) = default;
+    TriangleMesh& operator=(TriangleMesh &&) = default;
     ~TriangleMesh();
 
     bool loadPLY(std::string PLYFilename);
@@ -78,9 +85,9 @@ public:
     vmath::vec3 getTriangleFaceDirection(unsigned int index);
     vmath::vec3 getTriangleCenter(unsigned int index);
     vmath::vec3 getBarycentricCoordinates(unsigned int index, vmath::vec3 p);
-    void removeMinimumTriangleCountPolyhedra(int count);
-    void removeMinimumVolumePolyhedra(double volume);
-    void removeHoles();
+    void removeMinimumTriangleCountPolyhedra(int count, ThreadPool *pool = nullptr);
+    void removeMinimumVolumePolyhedra(double volume, ThreadPool *pool = nullptr);
+    void removeHoles(ThreadPool *pool = nullptr);
     void removeTriangles(std::vector<int> &triangles);
     void removeExtraneousVertices();
     void translate(vmath::vec3 trans);
@@ -118,10 +125,8 @@ private:
                                           std::vector<bool> &isSmooth);
     int _numDigitsInInteger(int num);
 
-    void _getPolyhedra(std::vector<std::vector<int> > &polyList);
-    void _getPolyhedronFromTriangle(int triangle, 
-                                    std::vector<bool> &visitedTriangles,
-                                    std::vector<int> &polyhedron);
+    void _getPolyhedra(std::vector<std::vector<int> > &polyList, 
+                       ThreadPool *pool);
     double _getSignedTriangleVolume(unsigned int tidx);
     double _getPolyhedronVolume(std::vector<int> &polyhedron);
     bool _isPolyhedronHole(std::vector<int> &poly);
@@ -0,0 +1,356 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "tricubicinterpolator.h"
+
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    #define TRICUBICINTERPOLATOR_AVX512
+    #include <immintrin.h>
+#elif defined(__AVX2__)
+    #define TRICUBICINTERPOLATOR_AVX2
+    #include <immintrin.h>
+#endif
+
+namespace {
+
+/* 
+    Cubic interpolation method from http://www.paulinternet.nl/?page=bicubic
+    written to match the operation order of cubic_interpolate in 
+    kernels/tricubicinterpolate.cl
+*/
+inline float cubicInterpolate(float p0, float p1, float p2, float p3, float x) {
+    return p1 + 0.5f*x*(p2 - p0 + x*(2.0f*p0 - 5.0f*p1 + 4.0f*p2 - p3 + 
+                                     x*(3.0f*(p1 - p2) + p3 - p0)));
+}
+
+#if defined(TRICUBICINTERPOLATOR_AVX512)
+
+    const int NUM_LANES = 16;
+    typedef __m512 vfloat;
+    typedef __m512i vint;
+    typedef __mmask16 vmask;
+
+    inline vfloat vSet(float v) { return _mm512_set1_ps(v); }
+    inline vint vSetInt(int v) { return _mm512_set1_epi32(v); }
+    inline vfloat vAdd(vfloat a, vfloat b) { return _mm512_add_ps(a, b); }
+    inline vfloat vSub(vfloat a, vfloat b) { return _mm512_sub_ps(a, b); }
+    inline vfloat vMul(vfloat a, vfloat b) { return _mm512_mul_ps(a, b); }
+    inline vint vAddInt(vint a, vint b) { return _mm512_add_epi32(a, b); }
+    inline vint vMulInt(vint a, vint b) { return _mm512_mullo_epi32(a, b); }
+    inline vfloat vFloor(vfloat a) { 
+        return _mm512_maskz_roundscale_ps(0xFFFF, a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); 
+    }
+    inline vint vToInt(vfloat a) { return _mm512_maskz_cvttps_epi32(0xFFFF, a); }
+    inline vmask vGreaterEqual(vfloat a, vfloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+    inline vmask vLess(vfloat a, vfloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    inline vmask vGreaterEqualInt(vint a, vint b) { return _mm512_cmpge_epi32_mask(a, b); }
+    inline vmask vLessInt(vint a, vint b) { return _mm512_cmplt_epi32_mask(a, b); }
+    inline vmask vAnd(vmask a, vmask b) { return a & b; }
+    inline vmask vAndNot(vmask a, vmask b) { return (vmask)(~a & b); }
+    inline int vMaskBits(vmask m) { return (int)m; }
+    inline vfloat vZeroMasked(vmask m, vfloat a) { return _mm512_maskz_mov_ps(m, a); }
+    inline vfloat vGather(vmask m, const float *base, vint idx) {
+        return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, idx, base, 4);
+    }
+    inline vfloat vLoadStrided3(const float *base) {
+        vint idx = _mm512_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21, 
+                                     24, 27, 30, 33, 36, 39, 42, 45);
+        return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), 0xFFFF, idx, base, 4);
+    }
+    inline void vStore(float *dst, vfloat a) { _mm512_storeu_ps(dst, a); }
+
+#elif defined(TRICUBICINTERPOLATOR_AVX2)
+
+    const int NUM_LANES = 8;
+    typedef __m256 vfloat;
+    typedef __m256i vint;
+    typedef __m256 vmask;
+
+    inline vfloat vSet(float v) { return _mm256_set1_ps(v); }
+    inline vint vSetInt(int v) { return _mm256_set1_epi32(v); }
+    inline vfloat vAdd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+    inline vfloat vSub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+    inline vfloat vMul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+    inline vint vAddInt(vint a, vint b) { return _mm256_add_epi32(a, b); }
+    inline vint vMulInt(vint a, vint b) { return _mm256_mullo_epi32(a, b); }
+    inline vfloat vFloor(vfloat a) { return _mm256_floor_ps(a); }
+    inline vint vToInt(vfloat a) { return _mm256_cvttps_epi32(a); }
+    inline vmask vGreaterEqual(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    inline vmask vLess(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    inline vmask vGreaterEqualInt(vint a, vint b) { 
+        return _mm256_castsi256_ps(_mm256_or_si256(_mm256_cmpgt_epi32(a, b), 
+                                                   _mm256_cmpeq_epi32(a, b))); 
+    }
+    inline vmask vLessInt(vint a, vint b) { 
+        return _mm256_castsi256_ps(_mm256_cmpgt_epi32(b, a)); 
+    }
+    inline vmask vAnd(vmask a, vmask b) { return _mm256_and_ps(a, b); }
+    inline vmask vAndNot(vmask a, vmask b) { return _mm256_andnot_ps(a, b); }
+    inline int vMaskBits(vmask m) { return _mm256_movemask_ps(m); }
+    inline vfloat vZeroMasked(vmask m, vfloat a) { return _mm256_and_ps(m, a); }
+    inline vfloat vGather(vmask m, const float *base, vint idx) {
+        return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, idx, m, 4);
+    }
+    inline vfloat vLoadStrided3(const float *base) {
+        vint idx = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+        return _mm256_i32gather_ps(base, idx, 4);
+    }
+    inline void vStore(float *dst, vfloat a) { _mm256_storeu_ps(dst, a); }
+
+#endif
+
+#if defined(TRICUBICINTERPOLATOR_AVX512) || defined(TRICUBICINTERPOLATOR_AVX2)
+
+    inline vfloat vCubicInterpolate(vfloat p0, vfloat p1, vfloat p2, vfloat p3, vfloat x) {
+        vfloat c = vSub(vAdd(vMul(vSet(3.0f), vSub(p1, p2)), p3), p0);
+        vfloat b = vSub(vAdd(vSub(vMul(vSet(2.0f), p0), vMul(vSet(5.0f), p1)), 
+                             vMul(vSet(4.0f), p2)), p3);
+        vfloat a = vSub(p2, p0);
+        vfloat t = vAdd(a, vMul(x, vAdd(b, vMul(x, c))));
+        return vAdd(p1, vMul(vMul(vSet(0.5f), x), t));
+    }
+
+#endif
+
+}
+
+TricubicInterpolator::TricubicInterpolator() {
+}
+
+TricubicInterpolator::TricubicInterpolator(MACVelocityField *vfield) {
+    int isize, jsize, ksize;
+    vfield->getGridDimensions(&isize, &jsize, &ksize);
+    double dx = vfield->getGridCellSize();
+
+    _dx = (float)dx;
+    _invdx = (float)(1.0 / dx);
+    _gridWidth = (float)(isize*dx);
+    _gridHeight = (float)(jsize*dx);
+    _gridDepth = (float)(ksize*dx);
+
+    float hdx = 0.5f*_dx;
+
+    _fields[0].data = vfield->getRawArrayU();
+    _fields[0].width = isize + 1;
+    _fields[0].height = jsize;
+    _fields[0].depth = ksize;
+    _fields[0].offsety = hdx;
+    _fields[0].offsetz = hdx;
+
+    _fields[1].data = vfield->getRawArrayV();
+    _fields[1].width = isize;
+    _fields[1].height = jsize + 1;
+    _fields[1].depth = ksize;
+    _fields[1].offsetx = hdx;
+    _fields[1].offsetz = hdx;
+
+    _fields[2].data = vfield->getRawArrayW();
+    _fields[2].width = isize;
+    _fields[2].height = jsize;
+    _fields[2].depth = ksize + 1;
+    _fields[2].offsetx = hdx;
+    _fields[2].offsety = hdx;
+}
+
+TricubicInterpolator::~TricubicInterpolator() {
+}
+
+const char* TricubicInterpolator::getInstructionSet() {
+    #if defined(TRICUBICINTERPOLATOR_AVX512)
+        return "AVX-512";
+    #elif defined(TRICUBICINTERPOLATOR_AVX2)
+        return "AVX2";
+    #else
+        return "none";
+    #endif
+}
+
+void TricubicInterpolator::interpolate(vmath::vec3 *positions, int n, 
+                                       vmath::vec3 *output) {
+    FLUIDSIM_ASSERT(_fields[0].data != nullptr);
+    _interpolateBatch(positions, n, output);
+}
+
+vmath::vec3 TricubicInterpolator::interpolate(vmath::vec3 p) {
+    FLUIDSIM_ASSERT(_fields[0].data != nullptr);
+    if (!_isPositionInGrid(p.x, p.y, p.z)) {
+        return vmath::vec3();
+    }
+
+    return vmath::vec3(_interpolateComponent(_fields[0], p.x, p.y, p.z),
+                       _interpolateComponent(_fields[1], p.x, p.y, p.z),
+                       _interpolateComponent(_fields[2], p.x, p.y, p.z));
+}
+
+float TricubicInterpolator::_interpolateComponent(FaceField &f, 
+                                                  float x, float y, float z) {
+    x -= f.offsetx;
+    y -= f.offsety;
+    z -= f.offsetz;
+
+    float fi = floor(x*_invdx);
+    float fj = floor(y*_invdx);
+    float fk = floor(z*_invdx);
+    float ix = _invdx*(x - fi*_dx);
+    float iy = _invdx*(y - fj*_dx);
+    float iz = _invdx*(z - fk*_dx);
+    int refi = (int)fi - 1;
+    int refj = (int)fj - 1;
+    int refk = (int)fk - 1;
+
+    bool isInterior = refi >= 0 && refj >= 0 && refk >= 0 &&
+                      refi + 3 < f.width && refj + 3 < f.height && refk + 3 < f.depth;
+
+    float plane[4];
+    float row[4];
+    for (int pk = 0; pk < 4; pk++) {
+        for (int pj = 0; pj < 4; pj++) {
+            float p[4];
+            if (isInterior) {
+                float *rowdata = f.data + refi + f.width*(refj + pj + f.height*(refk + pk));
+                p[0] = rowdata[0];
+                p[1] = rowdata[1];
+                p[2] = rowdata[2];
+                p[3] = rowdata[3];
+            } else {
+                for (int pi = 0; pi < 4; pi++) {
+                    p[pi] = _getFieldValue(f, refi + pi, refj + pj, refk + pk);
+                }
+            }
+            row[pj] = cubicInterpolate(p[0], p[1], p[2], p[3], ix);
+        }
+        plane[pk] = cubicInterpolate(row[0], row[1], row[2], row[3], iy);
+    }
+
+    return cubicInterpolate(plane[0], plane[1], plane[2], plane[3], iz);
+}
+
+#if defined(TRICUBICINTERPOLATOR_AVX512) || defined(TRICUBICINTERPOLATOR_AVX2)
+
+void TricubicInterpolator::_interpolateBatch(vmath::vec3 *positions, int n, 
+                                             vmath::vec3 *output) {
+    vfloat dx = vSet(_dx);
+    vfloat invdx = vSet(_invdx);
+    vfloat zero = vSet(0.0f);
+    vint one = vSetInt(1);
+
+    // The final partial batch is padded with positions outside of the grid 
+    // so that a position is always evaluated by the same code path 
+    // regardless of where the batch boundaries fall.
+    vmath::vec3 padded[NUM_LANES];
+    float results[3][NUM_LANES];
+    float px[NUM_LANES], py[NUM_LANES], pz[NUM_LANES];
+    for (int startidx = 0; startidx < n; startidx += NUM_LANES) {
+        int count = (int)fmin(NUM_LANES, n - startidx);
+        const float *pdata = (const float*)(positions + startidx);
+        if (count < NUM_LANES) {
+            for (int lane = 0; lane < NUM_LANES; lane++) {
+                padded[lane] = lane < count ? positions[startidx + lane] : 
+                                              vmath::vec3(-1.0f, -1.0f, -1.0f);
+            }
+            pdata = (const float*)padded;
+        }
+
+        vfloat x = vLoadStrided3(pdata);
+        vfloat y = vLoadStrided3(pdata + 1);
+        vfloat z = vLoadStrided3(pdata + 2);
+
+        vmask inGrid = vAnd(vAnd(vGreaterEqual(x, zero), vLess(x, vSet(_gridWidth))),
+                            vAnd(vAnd(vGreaterEqual(y, zero), vLess(y, vSet(_gridHeight))),
+                                 vAnd(vGreaterEqual(z, zero), vLess(z, vSet(_gridDepth)))));
+
+        int fallbackBits = 0;
+        for (int dir = 0; dir < 3; dir++) {
+            FaceField &f = _fields[dir];
+            vfloat fx = vSub(x, vSet(f.offsetx));
+            vfloat fy = vSub(y, vSet(f.offsety));
+            vfloat fz = vSub(z, vSet(f.offsetz));
+
+            vfloat fi = vFloor(vMul(fx, invdx));
+            vfloat fj = vFloor(vMul(fy, invdx));
+            vfloat fk = vFloor(vMul(fz, invdx));
+            vfloat ix = vMul(invdx, vSub(fx, vMul(fi, dx)));
+            vfloat iy = vMul(invdx, vSub(fy, vMul(fj, dx)));
+            vfloat iz = vMul(invdx, vSub(fz, vMul(fk, dx)));
+
+            // Lanes outside of the grid may hold values that do not fit 
+            // into an int. Their indices are never used to load data.
+            vint refi = vAddInt(vToInt(fi), vSetInt(-1));
+            vint refj = vAddInt(vToInt(fj), vSetInt(-1));
+            vint refk = vAddInt(vToInt(fk), vSetInt(-1));
+            vint zeroInt = vSetInt(0);
+            vmask isInterior = vAnd(vAnd(vGreaterEqualInt(refi, zeroInt), 
+                                         vLessInt(vAddInt(refi, vSetInt(3)), vSetInt(f.width))),
+                                    vAnd(vAnd(vGreaterEqualInt(refj, zeroInt), 
+                                              vLessInt(vAddInt(refj, vSetInt(3)), vSetInt(f.height))),
+                                         vAnd(vGreaterEqualInt(refk, zeroInt), 
+                                              vLessInt(vAddInt(refk, vSetInt(3)), vSetInt(f.depth)))));
+            vmask loadMask = vAnd(inGrid, isInterior);
+            fallbackBits |= vMaskBits(vAndNot(isInterior, inGrid));
+
+            vint base = vAddInt(refi, vMulInt(vSetInt(f.width), 
+                                              vAddInt(refj, vMulInt(vSetInt(f.height), refk))));
+
+            vfloat plane[4];
+            for (int pk = 0; pk < 4; pk++) {
+                vfloat row[4];
+                for (int pj = 0; pj < 4; pj++) {
+                    vint rowidx = vAddInt(base, vSetInt(f.width*(pj + f.height*pk)));
+                    vfloat p0 = vGather(loadMask, f.data, rowidx);
+                    rowidx = vAddInt(rowidx, one);
+                    vfloat p1 = vGather(loadMask, f.data, rowidx);
+                    rowidx = vAddInt(rowidx, one);
+                    vfloat p2 = vGather(loadMask, f.data, rowidx);
+                    rowidx = vAddInt(rowidx, one);
+                    vfloat p3 = vGather(loadMask, f.data, rowidx);
+                    row[pj] = vCubicInterpolate(p0, p1, p2, p3, ix);
+                }
+                plane[pk] = vCubicInterpolate(row[0], row[1], row[2], row[3], iy);
+            }
+
+            vfloat result = vCubicInterpolate(plane[0], plane[1], plane[2], plane[3], iz);
+            vStore(results[dir], vZeroMasked(loadMask, result));
+        }
+
+        if (fallbackBits != 0) {
+            vStore(px, x);
+            vStore(py, y);
+            vStore(pz, z);
+        }
+
+        for (int lane = 0; lane < count; lane++) {
+            vmath::vec3 v(results[0][lane], results[1][lane], results[2][lane]);
+            if (fallbackBits & (1 << lane)) {
+                v = interpolate(vmath::vec3(px[lane], py[lane], pz[lane]));
+            }
+            output[startidx + lane] = v;
+        }
+    }
+}
+
+#else
+
+void TricubicInterpolator::_interpolateBatch(vmath::vec3 *positions, int n, 
+                                             vmath::vec3 *output) {
+    for (int i = 0; i < n; i++) {
+        output[i] = interpolate(positions[i]);
+    }
+}
+
+#endif
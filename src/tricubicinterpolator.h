@@ -0,0 +1,100 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef TRICUBICINTERPOLATOR_H
+#define TRICUBICINTERPOLATOR_H
+
+#include <iostream>
+#include <cmath>
+
+#include "macvelocityfield.h"
+#include "vmath.h"
+#include "fluidsimassert.h"
+
+/*
+    Native CPU evaluation of tricubic interpolated MACVelocityField 
+    velocities for batches of positions.
+
+    Computation mirrors the tricubic_interpolate_kernel OpenCL kernel and is 
+    performed in single precision. Positions outside of the grid evaluate to 
+    a zero velocity and stencil values outside of the velocity field are 
+    treated as zero.
+
+    When compiled with AVX2 or AVX-512 support, positions are processed in 
+    batches of 8 or 16 lanes with the 4x4x4 stencils loaded by gather 
+    instructions. Lanes with stencils that cross the grid boundary are 
+    evaluated by the scalar path.
+*/
+class TricubicInterpolator
+{
+public:
+    TricubicInterpolator();
+    TricubicInterpolator(MACVelocityField *vfield);
+    ~TricubicInterpolator();
+
+    /*
+        Evaluates the velocity at positions [0, n) and writes the results
+        to output. positions and output may be the same array.
+    */
+    void interpolate(vmath::vec3 *positions, int n, vmath::vec3 *output);
+    vmath::vec3 interpolate(vmath::vec3 p);
+
+    /*
+        Name of the instruction set that the batch kernel was compiled for
+    */
+    static const char* getInstructionSet();
+
+private:
+
+    struct FaceField {
+        float *data = nullptr;
+        int width = 0;
+        int height = 0;
+        int depth = 0;
+        float offsetx = 0.0f;
+        float offsety = 0.0f;
+        float offsetz = 0.0f;
+    };
+
+    void _interpolateBatch(vmath::vec3 *positions, int n, vmath::vec3 *output);
+    float _interpolateComponent(FaceField &field, float x, float y, float z);
+
+    inline float _getFieldValue(FaceField &field, int i, int j, int k) {
+        if (i < 0 || j < 0 || k < 0 || 
+                i >= field.width || j >= field.height || k >= field.depth) {
+            return 0.0f;
+        }
+        return field.data[i + field.width*(j + field.height*k)];
+    }
+
+    inline bool _isPositionInGrid(float x, float y, float z) {
+        return x >= 0.0f && y >= 0.0f && z >= 0.0f && 
+               x < _gridWidth && y < _gridHeight && z < _gridDepth;
+    }
+
+    FaceField _fields[3];
+    float _dx = 0.0f;
+    float _invdx = 0.0f;
+    float _gridWidth = 0.0f;
+    float _gridHeight = 0.0f;
+    float _gridDepth = 0.0f;
+
+};
+
+#endif
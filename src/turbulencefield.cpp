@@ -19,119 +19,359 @@ freely, subject to the following restrictions:
 */
 #include "turbulencefield.h"
 
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    #define TURBULENCEFIELD_AVX512
+    #include <immintrin.h>
+#elif defined(__AVX2__)
+    #define TURBULENCEFIELD_AVX2
+    #include <immintrin.h>
+#endif
+
+namespace {
+
+const float VELOCITY_EPSILON = 10e-6f;
+
+#if defined(TURBULENCEFIELD_AVX512)
+
+    const int NUM_LANES = 16;
+    typedef __m512 vfloat;
+    typedef __mmask16 vmask;
+
+    inline vfloat vSet(float v) { return _mm512_set1_ps(v); }
+    inline vfloat vLoad(const float *src) { return _mm512_loadu_ps(src); }
+    inline void vStore(float *dst, vfloat a) { _mm512_storeu_ps(dst, a); }
+    inline vfloat vAdd(vfloat a, vfloat b) { return _mm512_add_ps(a, b); }
+    inline vfloat vSub(vfloat a, vfloat b) { return _mm512_sub_ps(a, b); }
+    inline vfloat vMul(vfloat a, vfloat b) { return _mm512_mul_ps(a, b); }
+    inline vfloat vSqrt(vfloat a) { return _mm512_maskz_sqrt_ps(0xFFFF, a); }
+    inline vmask vGreaterEqual(vfloat a, vfloat b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+    inline vfloat vZeroMasked(vmask m, vfloat a) { return _mm512_maskz_mov_ps(m, a); }
+
+#elif defined(TURBULENCEFIELD_AVX2)
+
+    const int NUM_LANES = 8;
+    typedef __m256 vfloat;
+    typedef __m256 vmask;
+
+    inline vfloat vSet(float v) { return _mm256_set1_ps(v); }
+    inline vfloat vLoad(const float *src) { return _mm256_loadu_ps(src); }
+    inline void vStore(float *dst, vfloat a) { _mm256_storeu_ps(dst, a); }
+    inline vfloat vAdd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+    inline vfloat vSub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+    inline vfloat vMul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+    inline vfloat vSqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+    inline vmask vGreaterEqual(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    inline vfloat vZeroMasked(vmask m, vfloat a) { return _mm256_and_ps(m, a); }
+
+#endif
+
+#if defined(TURBULENCEFIELD_AVX512) || defined(TURBULENCEFIELD_AVX2)
+
+    /*
+        Turbulence at NUM_LANES consecutive cells of a row starting at flat
+        index idx. All 124 neighbours of every cell must be inside the grid.
+    */
+    inline void vCalculateTurbulence(const float *vx, const float *vy, const float *vz,
+                                     int idx,
+                                     const int *flatOffsets,
+                                     const float *dirx, const float *diry, const float *dirz,
+                                     const float *weights,
+                                     float *turb) {
+        vfloat vix = vLoad(vx + idx);
+        vfloat viy = vLoad(vy + idx);
+        vfloat viz = vLoad(vz + idx);
+        vfloat eps = vSet(VELOCITY_EPSILON);
+        vfloat sum = vSet(0.0f);
+
+        for (int nidx = 0; nidx < 124; nidx++) {
+            int nflat = idx + flatOffsets[nidx];
+            vfloat vijx = vSub(vix, vLoad(vx + nflat));
+            vfloat vijy = vSub(viy, vLoad(vy + nflat));
+            vfloat vijz = vSub(viz, vLoad(vz + nflat));
+            vfloat vlen = vSqrt(vAdd(vAdd(vMul(vijx, vijx), vMul(vijy, vijy)), 
+                                     vMul(vijz, vijz)));
+            vfloat dot = vAdd(vAdd(vMul(vijx, vSet(dirx[nidx])), 
+                                   vMul(vijy, vSet(diry[nidx]))), 
+                              vMul(vijz, vSet(dirz[nidx])));
+            vfloat t = vMul(vSet(weights[nidx]), vSub(vlen, dot));
+            sum = vAdd(sum, vZeroMasked(vGreaterEqual(vlen, eps), t));
+        }
+
+        vStore(turb, sum);
+    }
+
+#endif
+
+}
+
 TurbulenceField::TurbulenceField() {
+    // For neighbour offset o, the direction from the neighbour to the cell
+    // is -o/|o| and the distance falloff is 1 - |o|*dx / radius, where the
+    // radius is the distance to the furthest neighbour, sqrt(12)*dx
+    Grid3d::getNeighbourGridIndices124(0, 0, 0, _neighbourOffsets);
+    double radius = sqrt(12.0);
+    for (int idx = 0; idx < 124; idx++) {
+        GridIndex o = _neighbourOffsets[idx];
+        double len = sqrt((double)(o.i*o.i + o.j*o.j + o.k*o.k));
+        _neighbourDirectionsX[idx] = (float)(-o.i / len);
+        _neighbourDirectionsY[idx] = (float)(-o.j / len);
+        _neighbourDirectionsZ[idx] = (float)(-o.k / len);
+        _neighbourWeights[idx] = (float)(1.0 - len / radius);
+        _neighbourFlatOffsets[idx] = 0;
+    }
 }
 
 
 TurbulenceField::~TurbulenceField() {
 }
 
-void TurbulenceField::_getVelocityGrid(MACVelocityField *macfield, 
-                                       Array3d<vmath::vec3> &vgrid) {
-    vmath::vec3 v;
-    for (int k = 0; k < vgrid.depth; k++) {
-        for (int j = 0; j < vgrid.height; j++) {
-            for (int i = 0; i < vgrid.width; i++) {
-                v = macfield->evaluateVelocityAtCellCenter(i, j, k);
-                vgrid.set(i, j, k, v);
-            }
+void TurbulenceField::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
+}
+
+const char* TurbulenceField::getInstructionSet() {
+    #if defined(TURBULENCEFIELD_AVX512)
+        return "AVX-512";
+    #elif defined(TURBULENCEFIELD_AVX2)
+        return "AVX2";
+    #else
+        return "none";
+    #endif
+}
+
+void TurbulenceField::_parallelForRange(int begin, int end, int grainSize,
+                                        std::function<void(int, int)> func) {
+    if (_threadPool == nullptr) {
+        if (end > begin) {
+            func(begin, end);
         }
+        return;
     }
+
+    _threadPool->parallelForRange(begin, end, grainSize, func);
 }
 
-double TurbulenceField::_calculateTurbulenceAtGridCell(int i, int j, int k, 
-                                                       Array3d<vmath::vec3> &vgrid) {
-    vmath::vec3 vi = vgrid(i, j, k);
-    vmath::vec3 xi = Grid3d::GridIndexToCellCenter(i, j, k, _dx);
-    vmath::vec3 vj, vij, vijnorm, xj, xij, xijnorm;
-    double vlen, xlen;
-    double eps = 10e-6;
-    double invradius = 1.0 / _radius;
-    double turb = 0.0;
+void TurbulenceField::_initializeGrids(MACVelocityField *vfield) {
+    vfield->getGridDimensions(&_isize, &_jsize, &_ksize);
+    _dx = vfield->getGridCellSize();
+
+    if (_field.width != _isize || _field.height != _jsize || _field.depth != _ksize) {
+        _field = Array3d<float>(_isize, _jsize, _ksize, 0.0f);
+        _turbulenceCells = Array3d<char>(_isize, _jsize, _ksize, 0);
+        _velocityCells = Array3d<char>(_isize, _jsize, _ksize, 0);
+        _vgridx = Array3d<float>(_isize, _jsize, _ksize, 0.0f);
+        _vgridy = Array3d<float>(_isize, _jsize, _ksize, 0.0f);
+        _vgridz = Array3d<float>(_isize, _jsize, _ksize, 0.0f);
+    } else {
+        _field.fill(0.0f);
+        _turbulenceCells.fill(0);
+    }
 
-    GridIndex n;
-    Grid3d::getNeighbourGridIndices124(i, j, k, cellNeighbours);
     for (int idx = 0; idx < 124; idx++) {
-        n = cellNeighbours[idx];
-        if (Grid3d::isGridIndexInRange(n.i, n.j, n.k, _isize, _jsize, _ksize)) {
+        GridIndex o = _neighbourOffsets[idx];
+        _neighbourFlatOffsets[idx] = o.i + _isize*(o.j + _jsize*o.k);
+    }
+}
+
+void TurbulenceField::_dilateVelocityCells(Array3d<char> &src, Array3d<char> &dst, 
+                                           int di, int dj, int dk) {
+    _parallelForRange(0, _ksize, 1, [&](int startk, int endk) {
+        for (int k = startk; k < endk; k++) {
+            for (int j = 0; j < _jsize; j++) {
+                for (int i = 0; i < _isize; i++) {
+                    char isSet = 0;
+                    for (int s = -2; s <= 2; s++) {
+                        int ni = i + s*di;
+                        int nj = j + s*dj;
+                        int nk = k + s*dk;
+                        if (Grid3d::isGridIndexInRange(ni, nj, nk, _isize, _jsize, _ksize) &&
+                                src(ni, nj, nk)) {
+                            isSet = 1;
+                            break;
+                        }
+                    }
+                    dst.set(i, j, k, isSet);
+                }
+            }
+        }
+    });
+}
 
-            vj = vgrid(n.i, n.j, n.k);
-            vij = vi - vj;
-            vlen = vmath::length(vij);
+void TurbulenceField::_updateVelocityCells() {
+    Array3d<char> tempCells(_isize, _jsize, _ksize, 0);
+    _dilateVelocityCells(_turbulenceCells, _velocityCells, 1, 0, 0);
+    _dilateVelocityCells(_velocityCells, tempCells, 0, 1, 0);
+    _dilateVelocityCells(tempCells, _velocityCells, 0, 0, 1);
+}
 
-            if (fabs(vlen) < eps) {
-                continue;
+void TurbulenceField::_updateVelocityGrid(MACVelocityField *macfield) {
+    _parallelForRange(0, _ksize, 1, [this, macfield](int startk, int endk) {
+        vmath::vec3 v;
+        for (int k = startk; k < endk; k++) {
+            for (int j = 0; j < _jsize; j++) {
+                for (int i = 0; i < _isize; i++) {
+                    if (!_velocityCells(i, j, k)) {
+                        continue;
+                    }
+                    v = macfield->evaluateVelocityAtCellCenter(i, j, k);
+                    _vgridx.set(i, j, k, v.x);
+                    _vgridy.set(i, j, k, v.y);
+                    _vgridz.set(i, j, k, v.z);
+                }
             }
-            vijnorm = vij / (float)vlen;
+        }
+    });
+}
 
-            xj = Grid3d::GridIndexToCellCenter(n.i, n.j, n.k, _dx);
-            xij = xi - xj;
-            xlen = vmath::length(xij);
-            xijnorm = xij / (float)xlen;
+float TurbulenceField::_calculateTurbulenceAtGridCell(int i, int j, int k) {
+    float vix = _vgridx(i, j, k);
+    float viy = _vgridy(i, j, k);
+    float viz = _vgridz(i, j, k);
+    float turb = 0.0f;
+
+    GridIndex o;
+    for (int idx = 0; idx < 124; idx++) {
+        o = _neighbourOffsets[idx];
+        int ni = i + o.i;
+        int nj = j + o.j;
+        int nk = k + o.k;
+        if (!Grid3d::isGridIndexInRange(ni, nj, nk, _isize, _jsize, _ksize)) {
+            continue;
+        }
 
-            turb += vlen*(1.0 - vmath::dot(vijnorm, xijnorm))*(1.0 - (xlen*invradius));
+        float vijx = vix - _vgridx(ni, nj, nk);
+        float vijy = viy - _vgridy(ni, nj, nk);
+        float vijz = viz - _vgridz(ni, nj, nk);
+        float vlen = sqrt(vijx*vijx + vijy*vijy + vijz*vijz);
+        if (vlen < VELOCITY_EPSILON) {
+            continue;
         }
+
+        float dot = vijx*_neighbourDirectionsX[idx] + 
+                    vijy*_neighbourDirectionsY[idx] + 
+                    vijz*_neighbourDirectionsZ[idx];
+        turb += _neighbourWeights[idx]*(vlen - dot);
     }
 
     return turb;
 }
 
-void TurbulenceField::calculateTurbulenceField(MACVelocityField *vfield,
-                                               FluidMaterialGrid &mgrid) {
+void TurbulenceField::_calculateTurbulenceAtRow(int j, int k) {
+    #if defined(TURBULENCEFIELD_AVX512) || defined(TURBULENCEFIELD_AVX2)
+        bool isInteriorRow = j >= 2 && j < _jsize - 2 && k >= 2 && k < _ksize - 2;
+        float *vx = _vgridx.getRawArray();
+        float *vy = _vgridy.getRawArray();
+        float *vz = _vgridz.getRawArray();
+        float turb[NUM_LANES];
+    #endif
+
+    int i = 0;
+    while (i < _isize) {
+        if (!_turbulenceCells(i, j, k)) {
+            i++;
+            continue;
+        }
 
-    GridIndexVector fluidcells(mgrid.width, mgrid.height, mgrid.depth);
-    for (int k = 0; k < mgrid.depth; k++) {
-        for (int j = 0; j < mgrid.height; j++) {
-            for (int i = 0; i < mgrid.width; i++) {
-                if (mgrid.isCellFluid(i, j, k)) {
-                    fluidcells.push_back(i, j, k);
+        #if defined(TURBULENCEFIELD_AVX512) || defined(TURBULENCEFIELD_AVX2)
+            if (isInteriorRow && i >= 2 && i + NUM_LANES <= _isize - 2) {
+                int flatidx = i + _isize*(j + _jsize*k);
+                vCalculateTurbulence(vx, vy, vz, flatidx, _neighbourFlatOffsets, 
+                                     _neighbourDirectionsX, 
+                                     _neighbourDirectionsY, 
+                                     _neighbourDirectionsZ, 
+                                     _neighbourWeights, turb);
+                for (int lane = 0; lane < NUM_LANES; lane++) {
+                    if (_turbulenceCells(i + lane, j, k)) {
+                        _field.set(i + lane, j, k, turb[lane]);
+                    }
                 }
+                i += NUM_LANES;
+                continue;
             }
-        }
+        #endif
+
+        _field.set(i, j, k, _calculateTurbulenceAtGridCell(i, j, k));
+        i++;
     }
+}
 
-    calculateTurbulenceField(vfield, fluidcells);
+void TurbulenceField::_calculateTurbulenceField(MACVelocityField *vfield) {
+    _updateVelocityCells();
+    _updateVelocityGrid(vfield);
+
+    int numRows = _jsize*_ksize;
+    _parallelForRange(0, numRows, 16, [this](int startidx, int endidx) {
+        for (int ridx = startidx; ridx < endidx; ridx++) {
+            _calculateTurbulenceAtRow(ridx % _jsize, ridx / _jsize);
+        }
+    });
 }
 
 void TurbulenceField::calculateTurbulenceField(MACVelocityField *vfield,
-                                               GridIndexVector &fluidCells) {
-    _field.fill(0.0);
-
-    vfield->getGridDimensions(&_isize, &_jsize, &_ksize);
-    _dx = vfield->getGridCellSize();
-    _radius = sqrt(3.0*(2*_dx)*(2*_dx));  // maximum distance from center grid cell
-                                          // to its 124 neighbours
+                                               FluidMaterialGrid &mgrid) {
+    _initializeGrids(vfield);
 
-    if (_field.width != _isize || _field.height != _jsize || _field.depth != _ksize) {
-        _field = Array3d<float>(_isize, _jsize, _ksize);
-    }
+    _parallelForRange(0, _ksize, 1, [this, &mgrid](int startk, int endk) {
+        for (int k = startk; k < endk; k++) {
+            for (int j = 0; j < _jsize; j++) {
+                for (int i = 0; i < _isize; i++) {
+                    if (mgrid.isCellFluid(i, j, k)) {
+                        _turbulenceCells.set(i, j, k, 1);
+                    }
+                }
+            }
+        }
+    });
 
-    Array3d<vmath::vec3> vgrid = Array3d<vmath::vec3>(_isize, _jsize, _ksize);
-    _getVelocityGrid(vfield, vgrid);
+    _calculateTurbulenceField(vfield);
+}
 
-    double avg = 0.0;
-    double max = 0.0;
-    double min = std::numeric_limits<double>::infinity();
+void TurbulenceField::calculateTurbulenceField(MACVelocityField *vfield,
+                                               GridIndexVector &fluidCells) {
+    _initializeGrids(vfield);
 
     GridIndex g;
     for (unsigned int i = 0; i < fluidCells.size(); i++) {
         g = fluidCells[i];
-        double t = _calculateTurbulenceAtGridCell(g.i, g.j, g.k, vgrid);
-        _field.set(g.i, g.j, g.k, (float)t);
+        _turbulenceCells.set(g, 1);
+    }
 
-        avg += t;
-        if (t > max) {
-            max = t;
-        }
-        if (t < min) {
-            min = t;
+    _calculateTurbulenceField(vfield);
+}
+
+void TurbulenceField::calculateTurbulenceField(MACVelocityField *vfield,
+                                               FluidMaterialGrid &mgrid,
+                                               std::vector<vmath::vec3> &samplePoints) {
+    _initializeGrids(vfield);
+
+    // Cells of the trilinear stencil used in evaluateTurbulenceAtPosition()
+    vmath::vec3 offset(0.5*_dx, 0.5*_dx, 0.5*_dx);
+    int i, j, k;
+    for (unsigned int idx = 0; idx < samplePoints.size(); idx++) {
+        vmath::vec3 p = samplePoints[idx] - offset;
+        Grid3d::positionToGridIndex(p.x, p.y, p.z, _dx, &i, &j, &k);
+        for (int nk = k; nk <= k + 1; nk++) {
+            for (int nj = j; nj <= j + 1; nj++) {
+                for (int ni = i; ni <= i + 1; ni++) {
+                    if (Grid3d::isGridIndexInRange(ni, nj, nk, _isize, _jsize, _ksize) &&
+                            mgrid.isCellFluid(ni, nj, nk)) {
+                        _turbulenceCells.set(ni, nj, nk, 1);
+                    }
+                }
+            }
         }
     }
-    avg /= fluidCells.size();
+
+    _calculateTurbulenceField(vfield);
 }
 
 void TurbulenceField::destroyTurbulenceField() {
     _field = Array3d<float>(0, 0, 0);
+    _turbulenceCells = Array3d<char>(0, 0, 0);
+    _velocityCells = Array3d<char>(0, 0, 0);
+    _vgridx = Array3d<float>(0, 0, 0);
+    _vgridy = Array3d<float>(0, 0, 0);
+    _vgridz = Array3d<float>(0, 0, 0);
 }
 
 double TurbulenceField::evaluateTurbulenceAtPosition(vmath::vec3 p) {
@@ -20,12 +20,16 @@ freely, subject to the following restrictions:
 #ifndef TURBULENCEFIELD_H
 #define TURBULENCEFIELD_H
 
+#include <vector>
+#include <functional>
+
 #include "array3d.h"
 #include "grid3d.h"
 #include "interpolation.h"
 #include "macvelocityfield.h"
 #include "gridindexvector.h"
 #include "fluidmaterialgrid.h"
+#include "threadpool.h"
 #include "vmath.h"
 #include "fluidsimassert.h"
 
@@ -40,24 +44,67 @@ public:
     void calculateTurbulenceField(MACVelocityField *vfield,
                                   FluidMaterialGrid &mgrid);
 
+    /*
+        Calculates turbulence only at the fluid cells that 
+        evaluateTurbulenceAtPosition() reads for the sample points. Values
+        at the sample points are the same as for the full field.
+    */
+    void calculateTurbulenceField(MACVelocityField *vfield,
+                                  FluidMaterialGrid &mgrid,
+                                  std::vector<vmath::vec3> &samplePoints);
+
     void destroyTurbulenceField();
     double evaluateTurbulenceAtPosition(vmath::vec3 p);
 
+    void setThreadPool(ThreadPool *pool);
+
+    /*
+        Name of the instruction set that the row kernel was compiled for
+    */
+    static const char* getInstructionSet();
+
 private:
-    
-    void _getVelocityGrid(MACVelocityField *macfield, 
-                          Array3d<vmath::vec3> &vgrid);
-    double _calculateTurbulenceAtGridCell(int i, int j, int k, 
-                                          Array3d<vmath::vec3> &vgrid);
 
+    void _initializeGrids(MACVelocityField *vfield);
+    void _calculateTurbulenceField(MACVelocityField *vfield);
+    void _updateVelocityCells();
+    void _dilateVelocityCells(Array3d<char> &src, Array3d<char> &dst, 
+                              int di, int dj, int dk);
+    void _updateVelocityGrid(MACVelocityField *macfield);
+    void _calculateTurbulenceAtRow(int j, int k);
+    float _calculateTurbulenceAtGridCell(int i, int j, int k);
+
+    void _parallelForRange(int begin, int end, int grainSize,
+                           std::function<void(int, int)> func);
 
     Array3d<float> _field;
 
-    int _isize, _jsize, _ksize;
-    double _dx;
-    double _radius;
+    // Cells where turbulence is calculated and the cells within the 
+    // 124 cell neighbourhood of those that need a velocity
+    Array3d<char> _turbulenceCells;
+    Array3d<char> _velocityCells;
+
+    // Cell centre velocities, kept between calculations so the grids are 
+    // only reallocated when the domain size changes
+    Array3d<float> _vgridx;
+    Array3d<float> _vgridy;
+    Array3d<float> _vgridz;
+
+    int _isize = 0;
+    int _jsize = 0;
+    int _ksize = 0;
+    double _dx = 0.0;
+
+    // The distance and direction between a cell and each of its 124 
+    // neighbours depend only on the neighbour offset
+    GridIndex _neighbourOffsets[124];
+    int _neighbourFlatOffsets[124];
+    float _neighbourDirectionsX[124];
+    float _neighbourDirectionsY[124];
+    float _neighbourDirectionsZ[124];
+    float _neighbourWeights[124];
 
-    GridIndex cellNeighbours[124];
+    ThreadPool *_threadPool = nullptr;
 };
 
-#endif
\ No newline at end of file
+#endif
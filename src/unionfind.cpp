@@ -0,0 +1,131 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "unionfind.h"
+
+UnionFind::UnionFind() {
+}
+
+UnionFind::UnionFind(int size) : _parents(size) {
+    for (int i = 0; i < size; i++) {
+        _parents[i].store(i, std::memory_order_relaxed);
+    }
+}
+
+UnionFind::~UnionFind() {
+}
+
+int UnionFind::size() {
+    return (int)_parents.size();
+}
+
+int UnionFind::find(int x) {
+    FLUIDSIM_ASSERT(x >= 0 && x < (int)_parents.size());
+
+    int parent = _parents[x].load(std::memory_order_relaxed);
+    while (parent != x) {
+        int grandparent = _parents[parent].load(std::memory_order_relaxed);
+        if (grandparent != parent) {
+            // A failed exchange means another thread has already moved 
+            // x closer to the root
+            _parents[x].compare_exchange_weak(parent, grandparent, 
+                                              std::memory_order_relaxed);
+        }
+        x = grandparent;
+        parent = _parents[x].load(std::memory_order_relaxed);
+    }
+
+    return x;
+}
+
+void UnionFind::unite(int x, int y) {
+    for (;;) {
+        x = find(x);
+        y = find(y);
+        if (x == y) {
+            return;
+        }
+
+        if (x < y) {
+            std::swap(x, y);
+        }
+
+        int expected = x;
+        if (_parents[x].compare_exchange_strong(expected, y, 
+                                                std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+bool UnionFind::isSameSet(int x, int y) {
+    for (;;) {
+        x = find(x);
+        y = find(y);
+        if (x == y) {
+            return true;
+        }
+
+        // x may have been linked below another root since it was found
+        if (_parents[x].load(std::memory_order_relaxed) == x) {
+            return false;
+        }
+    }
+}
+
+void UnionFind::getSets(int n, std::vector<std::vector<int> > &sets, 
+                        ThreadPool *pool) {
+    FLUIDSIM_ASSERT(n >= 0 && n <= (int)_parents.size());
+
+    std::vector<int> roots(n);
+    auto findRoots = [this, &roots](int startidx, int endidx) {
+        for (int i = startidx; i < endidx; i++) {
+            roots[i] = find(i);
+        }
+    };
+
+    int grainSize = 65536;
+    if (pool == nullptr || n <= grainSize) {
+        findRoots(0, n);
+    } else {
+        pool->parallelForRange(0, n, grainSize, findRoots);
+    }
+
+    // Roots are the smallest element of their set, so numbering sets in
+    // element order gives the sets in order of their smallest element
+    std::vector<int> setIndices(n, -1);
+    std::vector<int> setSizes;
+    for (int i = 0; i < n; i++) {
+        if (roots[i] == i) {
+            setIndices[i] = setSizes.size();
+            setSizes.push_back(0);
+        }
+        setSizes[setIndices[roots[i]]]++;
+    }
+
+    int offset = sets.size();
+    sets.resize(offset + setSizes.size());
+    for (unsigned int sidx = 0; sidx < setSizes.size(); sidx++) {
+        sets[offset + sidx].reserve(setSizes[sidx]);
+    }
+
+    for (int i = 0; i < n; i++) {
+        sets[offset + setIndices[roots[i]]].push_back(i);
+    }
+}
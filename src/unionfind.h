@@ -0,0 +1,67 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef UNIONFIND_H
+#define UNIONFIND_H
+
+#include <vector>
+#include <atomic>
+
+#include "threadpool.h"
+#include "fluidsimassert.h"
+
+/*
+    Disjoint sets over the elements [0, size) that can be united and 
+    searched concurrently without locks.
+
+    A set is always rooted at its smallest element. unite() links the root
+    with the larger index below the other root with a compare-and-swap and 
+    retries if another thread relinked either root first. find() shortens
+    paths by halving as it goes. Parent indices only ever decrease, so 
+    concurrent updates can not form a cycle.
+*/
+class UnionFind
+{
+public:
+    UnionFind();
+    UnionFind(int size);
+    ~UnionFind();
+
+    int size();
+    int find(int x);
+    void unite(int x, int y);
+    bool isSameSet(int x, int y);
+
+    /*
+        Groups the elements [0, n) by set. Sets are ordered by their 
+        smallest element and the elements of a set are in increasing order.
+        Elements at or above n are used only to connect sets and are not 
+        listed. Must not be called while other threads are uniting.
+    */
+    void getSets(int n, std::vector<std::vector<int> > &sets, 
+                 ThreadPool *pool = nullptr);
+
+private:
+    UnionFind(const UnionFind &) = delete;
+    UnionFind& operator=(const UnionFind &) = delete;
+
+    std::vector<std::atomic<int> > _parents;
+};
+
+#endif
@@ -21,6 +21,7 @@ freely, subject to the following restrictions:
 #define UTILS_H
 
 #include <vector>
+#include <limits>
 
 #include "trianglemesh.h"
 #include "array3d.h"
@@ -0,0 +1,235 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "velocitytransfer.h"
+
+VelocityTransfer::VelocityTransfer() {
+}
+
+VelocityTransfer::~VelocityTransfer() {
+}
+
+void VelocityTransfer::setThreadPool(ThreadPool *pool) {
+    _threadPool = pool;
+}
+
+void VelocityTransfer::transfer(MarkerParticleVector &particles, double dx,
+                                Array3d<float> &ugrid, 
+                                Array3d<float> &vgrid, 
+                                Array3d<float> &wgrid,
+                                Array3d<bool> &isUValueSet, 
+                                Array3d<bool> &isVValueSet, 
+                                Array3d<bool> &isWValueSet) {
+    _isize = wgrid.width;
+    _jsize = wgrid.height;
+    _ksize = wgrid.depth - 1;
+    FLUIDSIM_ASSERT(ugrid.width == _isize + 1 && ugrid.height == _jsize && ugrid.depth == _ksize);
+    FLUIDSIM_ASSERT(vgrid.width == _isize && vgrid.height == _jsize + 1 && vgrid.depth == _ksize);
+    FLUIDSIM_ASSERT(isUValueSet.width == ugrid.width && isUValueSet.height == ugrid.height && 
+                    isUValueSet.depth == ugrid.depth);
+    FLUIDSIM_ASSERT(isVValueSet.width == vgrid.width && isVValueSet.height == vgrid.height && 
+                    isVValueSet.depth == vgrid.depth);
+    FLUIDSIM_ASSERT(isWValueSet.width == wgrid.width && isWValueSet.height == wgrid.height && 
+                    isWValueSet.depth == wgrid.depth);
+
+    _dx = dx;
+    _radius = dx;
+    double r = _radius;
+    _coef1 = (4.0 / 9.0)*(1.0 / (r*r*r*r*r*r));
+    _coef2 = (17.0 / 9.0)*(1.0 / (r*r*r*r));
+    _coef3 = (22.0 / 9.0)*(1.0 / (r*r));
+
+    _ugrid = &ugrid;
+    _vgrid = &vgrid;
+    _wgrid = &wgrid;
+    ugrid.fill(0.0f);
+    vgrid.fill(0.0f);
+    wgrid.fill(0.0f);
+    _initializeWeightGrid(ugrid, _uweights);
+    _initializeWeightGrid(vgrid, _vweights);
+    _initializeWeightGrid(wgrid, _wweights);
+
+    _binParticlesBySlab(particles);
+
+    for (int parity = 0; parity < 2; parity++) {
+        int numTasks = (_numSlabs - parity + 1) / 2;
+        _runTasks(numTasks, [this, &particles, parity](int taskidx) {
+            _transferSlab(particles, 2*taskidx + parity);
+        });
+    }
+
+    _normalizeField(ugrid, _uweights, isUValueSet);
+    _normalizeField(vgrid, _vweights, isVValueSet);
+    _normalizeField(wgrid, _wweights, isWValueSet);
+}
+
+/*
+    Weight grids are kept between transfers and are only reallocated when 
+    the grid dimensions change.
+*/
+void VelocityTransfer::_initializeWeightGrid(Array3d<float> &field, 
+                                             Array3d<float> &weights) {
+    if (weights.width != field.width || weights.height != field.height || 
+            weights.depth != field.depth) {
+        weights = Array3d<float>(field.width, field.height, field.depth, 0.0f);
+    } else {
+        weights.fill(0.0f);
+    }
+}
+
+/*
+    Counting sort of particle indices by slab. Particles keep their relative
+    order within a slab. Particles outside of the grid are placed in the 
+    nearest slab.
+*/
+void VelocityTransfer::_binParticlesBySlab(MarkerParticleVector &particles) {
+    _numSlabs = (_ksize + _slabWidth - 1) / _slabWidth;
+    if (_numSlabs < 1) {
+        _numSlabs = 1;
+    }
+
+    int numParticles = (int)particles.size();
+    vmath::vec3 *positions = particles.getPositions()->data();
+    _particleSlabs.resize(numParticles);
+    _slabOffsets.assign(_numSlabs + 1, 0);
+
+    double invdx = 1.0 / _dx;
+    for (int i = 0; i < numParticles; i++) {
+        int k = (int)floor(positions[i].z * invdx);
+        int slabidx = k < 0 ? 0 : k / _slabWidth;
+        if (slabidx >= _numSlabs) {
+            slabidx = _numSlabs - 1;
+        }
+        _particleSlabs[i] = slabidx;
+        _slabOffsets[slabidx + 1]++;
+    }
+
+    for (int sidx = 0; sidx < _numSlabs; sidx++) {
+        _slabOffsets[sidx + 1] += _slabOffsets[sidx];
+    }
+
+    std::vector<int> insertPositions(_slabOffsets.begin(), _slabOffsets.end() - 1);
+    _slabParticles.resize(numParticles);
+    for (int i = 0; i < numParticles; i++) {
+        _slabParticles[insertPositions[_particleSlabs[i]]++] = i;
+    }
+}
+
+void VelocityTransfer::_transferSlab(MarkerParticleVector &particles, 
+                                     int slabidx) {
+    vmath::vec3 uoffset(0.0, 0.5*_dx, 0.5*_dx);
+    vmath::vec3 voffset(0.5*_dx, 0.0, 0.5*_dx);
+    vmath::vec3 woffset(0.5*_dx, 0.5*_dx, 0.0);
+
+    vmath::vec3 *positions = particles.getPositions()->data();
+    vmath::vec3 *velocities = particles.getVelocities()->data();
+    for (int idx = _slabOffsets[slabidx]; idx < _slabOffsets[slabidx + 1]; idx++) {
+        int pidx = _slabParticles[idx];
+        vmath::vec3 p = positions[pidx];
+        vmath::vec3 v = velocities[pidx];
+        _addPointValue(p, v.x, uoffset, _ugrid, _uweights);
+        _addPointValue(p, v.y, voffset, _vgrid, _vweights);
+        _addPointValue(p, v.z, woffset, _wgrid, _wweights);
+    }
+}
+
+void VelocityTransfer::_addPointValue(vmath::vec3 p, float value, vmath::vec3 offset, 
+                                      Array3d<float> *field, Array3d<float> &weights) {
+    p -= offset;
+
+    GridIndex gmin, gmax;
+    Grid3d::getGridIndexBounds(p, _radius, _dx, 
+                               field->width, field->height, field->depth, 
+                               &gmin, &gmax);
+
+    // Squared distances are separable along each axis
+    double distsqx[3], distsqy[3], distsqz[3];
+    int ni = gmax.i - gmin.i + 1;
+    int nj = gmax.j - gmin.j + 1;
+    int nk = gmax.k - gmin.k + 1;
+    if (ni <= 0 || nj <= 0 || nk <= 0) {
+        return;
+    }
+    FLUIDSIM_ASSERT(ni <= 3 && nj <= 3 && nk <= 3);
+
+    for (int i = 0; i < ni; i++) {
+        double d = (gmin.i + i)*_dx - p.x;
+        distsqx[i] = d*d;
+    }
+    for (int j = 0; j < nj; j++) {
+        double d = (gmin.j + j)*_dx - p.y;
+        distsqy[j] = d*d;
+    }
+    for (int k = 0; k < nk; k++) {
+        double d = (gmin.k + k)*_dx - p.z;
+        distsqz[k] = d*d;
+    }
+
+    float *fieldData = field->getRawArray();
+    float *weightData = weights.getRawArray();
+    int width = field->width;
+    int height = field->height;
+
+    double rsq = _radius*_radius;
+    for (int k = 0; k < nk; k++) {
+        for (int j = 0; j < nj; j++) {
+            double distsqyz = distsqy[j] + distsqz[k];
+            if (distsqyz >= rsq) {
+                continue;
+            }
+
+            int flatidx = Grid3d::getFlatIndex(gmin.i, gmin.j + j, gmin.k + k, width, height);
+            for (int i = 0; i < ni; i++) {
+                double distsq = distsqx[i] + distsqyz;
+                if (distsq < rsq) {
+                    double weight = _evaluateTricubicFieldFunctionForRadiusSquared(distsq);
+                    fieldData[flatidx + i] += (float)(weight*value);
+                    weightData[flatidx + i] += (float)weight;
+                }
+            }
+        }
+    }
+}
+
+void VelocityTransfer::_normalizeField(Array3d<float> &field, 
+                                       Array3d<float> &weights, 
+                                       Array3d<bool> &isValueSet) {
+    _runTasks(field.depth, [this, &field, &weights, &isValueSet](int k) {
+        for (int j = 0; j < field.height; j++) {
+            for (int i = 0; i < field.width; i++) {
+                float weight = weights(i, j, k);
+                if (weight > 0.0) {
+                    field.set(i, j, k, field(i, j, k) / weight);
+                }
+                isValueSet.set(i, j, k, weight > _eps);
+            }
+        }
+    });
+}
+
+void VelocityTransfer::_runTasks(int numTasks, std::function<void(int)> func) {
+    if (_threadPool == nullptr) {
+        for (int i = 0; i < numTasks; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    _threadPool->run(numTasks, func);
+}
@@ -0,0 +1,115 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef VELOCITYTRANSFER_H
+#define VELOCITYTRANSFER_H
+
+#include <vector>
+#include <iostream>
+#include <functional>
+
+#include "array3d.h"
+#include "grid3d.h"
+#include "markerparticlevector.h"
+#include "threadpool.h"
+#include "vmath.h"
+#include "fluidsimassert.h"
+
+/*
+    Transfers marker particle velocities to the U, V and W faces of a MAC 
+    grid in a single pass over the particles.
+
+    Each face value is the weighted average of the velocity components of 
+    particles within a radius of one cell width, using the same tricubic 
+    weighting as ScalarField. A face value is marked as set if its total
+    weight is non-zero.
+
+    Particles are binned into slabs of cells along the k axis. A particle 
+    only contributes to faces within one cell of its own cell, so slabs of 
+    the same parity never write to the same face and can be processed 
+    concurrently without atomics. Even slabs are processed before odd 
+    slabs, which makes the result independent of the number of threads.
+*/
+class VelocityTransfer
+{
+public:
+    VelocityTransfer();
+    ~VelocityTransfer();
+
+    /*
+        Tasks are distributed across the threads of the pool. If no pool 
+        is set, the transfer runs on the calling thread.
+    */
+    void setThreadPool(ThreadPool *pool);
+
+    void transfer(MarkerParticleVector &particles, double dx,
+                  Array3d<float> &ugrid, 
+                  Array3d<float> &vgrid, 
+                  Array3d<float> &wgrid,
+                  Array3d<bool> &isUValueSet, 
+                  Array3d<bool> &isVValueSet, 
+                  Array3d<bool> &isWValueSet);
+
+private:
+
+    VelocityTransfer(const VelocityTransfer &) = delete;
+    VelocityTransfer& operator=(const VelocityTransfer &) = delete;
+
+    void _initializeWeightGrid(Array3d<float> &field, Array3d<float> &weights);
+    void _binParticlesBySlab(MarkerParticleVector &particles);
+    void _transferSlab(MarkerParticleVector &particles, int slabidx);
+    void _addPointValue(vmath::vec3 p, float value, vmath::vec3 offset, 
+                        Array3d<float> *field, Array3d<float> &weights);
+    void _normalizeField(Array3d<float> &field, 
+                         Array3d<float> &weights, 
+                         Array3d<bool> &isValueSet);
+    void _runTasks(int numTasks, std::function<void(int)> func);
+
+    inline double _evaluateTricubicFieldFunctionForRadiusSquared(double rsq) {
+        return 1.0 - _coef1*rsq*rsq*rsq + _coef2*rsq*rsq - _coef3*rsq;
+    }
+
+    int _isize = 0;
+    int _jsize = 0;
+    int _ksize = 0;
+    double _dx = 0.0;
+    double _radius = 0.0;
+    double _coef1 = 0.0;
+    double _coef2 = 0.0;
+    double _coef3 = 0.0;
+    double _eps = 1e-9;
+
+    int _slabWidth = 4;
+    int _numSlabs = 0;
+    std::vector<int> _slabOffsets;
+    std::vector<int> _slabParticles;
+    std::vector<int> _particleSlabs;
+
+    Array3d<float> *_ugrid = nullptr;
+    Array3d<float> *_vgrid = nullptr;
+    Array3d<float> *_wgrid = nullptr;
+    Array3d<float> _uweights;
+    Array3d<float> _vweights;
+    Array3d<float> _wweights;
+
+    ThreadPool *_threadPool = nullptr;
+
+};
+
+#endif